@@ -0,0 +1,286 @@
+#include "bench/RtpReplay.h"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <map>
+
+#include "ingest/RtpPacket.h"
+
+namespace bench {
+namespace {
+
+constexpr uint8_t kPayloadType = 96;
+constexpr uint32_t kSsrc = 0x0BE1C0DE;
+
+// Append a 12-byte RTP header.
+void WriteHeader(uint16_t sequence, uint32_t timestamp, bool marker, std::vector<uint8_t>* out) {
+  const uint8_t header[12] = {0x80,
+                              static_cast<uint8_t>((marker ? 0x80 : 0) | kPayloadType),
+                              static_cast<uint8_t>(sequence >> 8),
+                              static_cast<uint8_t>(sequence),
+                              static_cast<uint8_t>(timestamp >> 24),
+                              static_cast<uint8_t>(timestamp >> 16),
+                              static_cast<uint8_t>(timestamp >> 8),
+                              static_cast<uint8_t>(timestamp),
+                              static_cast<uint8_t>(kSsrc >> 24),
+                              static_cast<uint8_t>(kSsrc >> 16),
+                              static_cast<uint8_t>(kSsrc >> 8),
+                              static_cast<uint8_t>(kSsrc)};
+  out->insert(out->end(), header, header + sizeof(header));
+}
+
+// Split an Annex B buffer into NAL units (start codes removed).
+std::vector<std::pair<const uint8_t*, size_t>> SplitAnnexB(const uint8_t* data, size_t size) {
+  std::vector<std::pair<const uint8_t*, size_t>> nals;
+  size_t start = 0;
+  bool in_nal = false;
+  for (size_t i = 0; i + 3 <= size; ++i) {
+    if (data[i] == 0 && data[i + 1] == 0 && data[i + 2] == 1) {
+      if (in_nal) {
+        size_t end = i;
+        while (end > start && data[end - 1] == 0) {
+          --end;
+        }
+        nals.emplace_back(data + start, end - start);
+      }
+      start = i + 3;
+      in_nal = true;
+      i += 2;
+    }
+  }
+  if (in_nal && start < size) {
+    nals.emplace_back(data + start, size - start);
+  }
+  return nals;
+}
+
+uint16_t ReadU16(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+uint32_t ReadU32Le(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[3]) << 24) | (static_cast<uint32_t>(p[2]) << 16) |
+         (static_cast<uint32_t>(p[1]) << 8) | p[0];
+}
+
+// Keep a datagram if it parses as RTP and is not RTCP (PT 72-76 when
+// parsed as RTP, i.e. packet types 200-204).
+void AddIfRtp(int64_t time_us, const uint8_t* data, size_t size, std::vector<RtpDatagram>* out) {
+  ingest::RtpPacket packet;
+  if (!ingest::ParseRtpPacket(data, size, &packet) || (packet.payload_type >= 72 && packet.payload_type <= 76)) {
+    return;
+  }
+  out->push_back(RtpDatagram{time_us, std::vector<uint8_t>(data, data + size)});
+}
+
+// rtptools rtpdump: text line, 16-byte binary header, then records of
+// (length, packet length, offset ms) + packet. plen 0 marks RTCP.
+bool ParseRtpDump(const std::vector<uint8_t>& file, std::vector<RtpDatagram>* out) {
+  const uint8_t* newline = static_cast<const uint8_t*>(std::memchr(file.data(), '\n', file.size()));
+  if (!newline) {
+    return false;
+  }
+  size_t offset = static_cast<size_t>(newline - file.data()) + 1 + 16;
+  while (offset + 8 <= file.size()) {
+    const size_t length = ReadU16(&file[offset]);
+    const size_t packet_length = ReadU16(&file[offset + 2]);
+    const uint32_t time_ms = ReadU32(&file[offset + 4]);
+    if (length < 8 || offset + length > file.size()) {
+      break;
+    }
+    if (packet_length > 0) {
+      AddIfRtp(static_cast<int64_t>(time_ms) * 1000, &file[offset + 8], length - 8, out);
+    }
+    offset += length;
+  }
+  return true;
+}
+
+// libpcap: 24-byte global header (magic gives byte order and time unit),
+// then (16-byte record header, frame) pairs. Frames are unwrapped down to
+// the UDP payload.
+bool ParsePcap(const std::vector<uint8_t>& file, std::vector<RtpDatagram>* out) {
+  if (file.size() < 24) {
+    return false;
+  }
+  const uint32_t magic = ReadU32Le(file.data());
+  bool swapped = false;
+  bool nanoseconds = false;
+  if (magic == 0xa1b2c3d4 || magic == 0xa1b23c4d) {
+    nanoseconds = magic == 0xa1b23c4d;
+  } else if (magic == 0xd4c3b2a1 || magic == 0x4d3cb2a1) {
+    swapped = true;
+    nanoseconds = magic == 0x4d3cb2a1;
+  } else {
+    return false;
+  }
+  auto read32 = [swapped](const uint8_t* p) { return swapped ? ReadU32(p) : ReadU32Le(p); };
+  const uint32_t link_type = read32(&file[20]);
+
+  size_t offset = 24;
+  while (offset + 16 <= file.size()) {
+    const int64_t seconds = read32(&file[offset]);
+    const int64_t fraction = read32(&file[offset + 4]);
+    const size_t captured = read32(&file[offset + 8]);
+    offset += 16;
+    if (offset + captured > file.size()) {
+      break;
+    }
+    const uint8_t* frame = &file[offset];
+    size_t size = captured;
+    offset += captured;
+
+    // Link layer → IPv4
+    uint16_t ethertype = 0x0800;
+    size_t link_header = 0;
+    if (link_type == 1) {  // Ethernet
+      if (size < 14) {
+        continue;
+      }
+      ethertype = ReadU16(frame + 12);
+      link_header = 14;
+      if (ethertype == 0x8100 && size >= 18) {  // 802.1Q VLAN tag
+        ethertype = ReadU16(frame + 16);
+        link_header = 18;
+      }
+    } else if (link_type == 113) {  // Linux cooked capture
+      if (size < 16) {
+        continue;
+      }
+      ethertype = ReadU16(frame + 14);
+      link_header = 16;
+    } else if (link_type != 101 && link_type != 12 && link_type != 228) {  // raw IPv4
+      return false;
+    }
+    if (ethertype != 0x0800) {
+      continue;
+    }
+    frame += link_header;
+    size -= link_header;
+
+    // IPv4 → UDP (unfragmented only)
+    if (size < 20 || (frame[0] >> 4) != 4 || frame[9] != 17 || (ReadU16(frame + 6) & 0x3FFF) != 0) {
+      continue;
+    }
+    const size_t ip_header = (frame[0] & 0x0F) * 4u;
+    if (size < ip_header + 8) {
+      continue;
+    }
+    const size_t udp_length = ReadU16(frame + ip_header + 4);
+    if (udp_length < 8 || ip_header + udp_length > size) {
+      continue;
+    }
+    const int64_t time_us = seconds * 1000000 + (nanoseconds ? fraction / 1000 : fraction);
+    AddIfRtp(time_us, frame + ip_header + 8, udp_length - 8, out);
+  }
+  return true;
+}
+
+}  // namespace
+
+std::vector<RtpDatagram> PacketizeRtp(const EncodedStream& stream, ingest::RtpCodec codec, int fps, size_t mtu) {
+  std::vector<RtpDatagram> datagrams;
+  uint16_t sequence = 0x4A17;
+
+  // Start a datagram and return its payload writer position
+  auto begin = [&](int64_t offset_us, uint32_t timestamp, bool marker) -> std::vector<uint8_t>& {
+    datagrams.push_back(RtpDatagram{offset_us, {}});
+    WriteHeader(sequence++, timestamp, marker, &datagrams.back().data);
+    return datagrams.back().data;
+  };
+
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    const AVPacket* packet = stream.packets[i];
+    const int64_t index = packet->pts != AV_NOPTS_VALUE ? packet->pts : static_cast<int64_t>(i);
+    const uint32_t timestamp = static_cast<uint32_t>(index * 90000 / fps);
+    const int64_t offset_us = index * 1000000 / fps;
+
+    if (codec == ingest::RtpCodec::kVp8) {
+      // Payload descriptor: S=1, PID=0 on the first packet, 0 afterwards
+      for (size_t pos = 0; pos < static_cast<size_t>(packet->size); pos += mtu - 1) {
+        const size_t chunk = std::min(mtu - 1, packet->size - pos);
+        const bool last = pos + chunk == static_cast<size_t>(packet->size);
+        std::vector<uint8_t>& out = begin(offset_us, timestamp, last);
+        out.push_back(pos == 0 ? 0x10 : 0x00);
+        out.insert(out.end(), packet->data + pos, packet->data + pos + chunk);
+      }
+      continue;
+    }
+
+    const auto nals = SplitAnnexB(packet->data, packet->size);
+    for (size_t n = 0; n < nals.size(); ++n) {
+      const uint8_t* nal = nals[n].first;
+      const size_t size = nals[n].second;
+      const bool last_nal = n + 1 == nals.size();
+      if (size <= mtu) {
+        std::vector<uint8_t>& out = begin(offset_us, timestamp, last_nal);
+        out.insert(out.end(), nal, nal + size);
+        continue;
+      }
+      // FU-A: indicator keeps F/NRI, header carries S/E and the NAL type
+      for (size_t pos = 1; pos < size; pos += mtu - 2) {
+        const size_t chunk = std::min(mtu - 2, size - pos);
+        const bool end = pos + chunk == size;
+        std::vector<uint8_t>& out = begin(offset_us, timestamp, last_nal && end);
+        out.push_back(static_cast<uint8_t>((nal[0] & 0xE0) | 28));
+        out.push_back(static_cast<uint8_t>((pos == 1 ? 0x80 : 0) | (end ? 0x40 : 0) | (nal[0] & 0x1F)));
+        out.insert(out.end(), nal + pos, nal + pos + chunk);
+      }
+    }
+  }
+  return datagrams;
+}
+
+bool LoadRtpRecording(const std::string& path, std::vector<RtpDatagram>* datagrams, std::string* error) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    *error = "cannot open " + path;
+    return false;
+  }
+  const std::vector<uint8_t> file((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+
+  std::vector<RtpDatagram> all;
+  const bool rtpdump = file.size() > 12 && std::memcmp(file.data(), "#!rtpplay1.0", 12) == 0;
+  if (!(rtpdump ? ParseRtpDump(file, &all) : ParsePcap(file, &all))) {
+    *error = path + ": not an rtpdump or pcap file (or unsupported link type)";
+    return false;
+  }
+
+  // Keep the busiest SSRC (the video stream in a typical capture)
+  std::map<uint32_t, size_t> counts;
+  for (const RtpDatagram& datagram : all) {
+    ++counts[ReadU32(datagram.data.data() + 8)];
+  }
+  uint32_t ssrc = 0;
+  size_t best = 0;
+  for (const auto& entry : counts) {
+    if (entry.second > best) {
+      ssrc = entry.first;
+      best = entry.second;
+    }
+  }
+  if (best == 0) {
+    *error = path + ": no RTP packets found";
+    return false;
+  }
+
+  datagrams->clear();
+  for (RtpDatagram& datagram : all) {
+    if (ReadU32(datagram.data.data() + 8) == ssrc) {
+      datagrams->push_back(std::move(datagram));
+    }
+  }
+  const int64_t first_us = datagrams->front().offset_us;
+  for (RtpDatagram& datagram : *datagrams) {
+    datagram.offset_us -= first_us;
+  }
+  return true;
+}
+
+}  // namespace bench
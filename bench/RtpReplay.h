@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bench/SyntheticStream.h"
+#include "ingest/Depacketizer.h"
+
+namespace bench {
+
+// One RTP datagram and when to send it, relative to the first one.
+struct RtpDatagram {
+  int64_t offset_us = 0;
+  std::vector<uint8_t> data;
+};
+
+// Packetize an encoded stream the way a WebRTC sender would: VP8 with a
+// minimal payload descriptor (RFC 7741), H.264 as single NAL units or FU-A
+// fragments (RFC 6184), at most `mtu` payload bytes per packet. Frame i is
+// scheduled at i / fps seconds, all of its packets back to back.
+//
+// Param: stream - Encoded packets (H.264 must be Annex B, as libx264 and
+//                 libopenh264 produce without a global header)
+// Param: codec - Payload format to use
+// Param: fps - Frame rate used for timestamps and pacing
+// Param: mtu - Maximum RTP payload size
+std::vector<RtpDatagram> PacketizeRtp(const EncodedStream& stream, ingest::RtpCodec codec, int fps, size_t mtu = 1200);
+
+// Load RTP datagrams from a recording, keeping their original spacing.
+//
+//   .rtpdump - rtptools format ("#!rtpplay1.0" header, RTCP records skipped)
+//   .pcap    - libpcap capture (Ethernet, raw IPv4 or Linux cooked link
+//              types; every IPv4/UDP payload that parses as RTP, pcapng
+//              is not supported)
+// The format is detected from the file contents, not the extension. Only
+// the most frequent SSRC is kept, so audio or other streams in the same
+// capture are ignored.
+//
+// Returns: false (with error set) if the file cannot be read or holds no RTP
+bool LoadRtpRecording(const std::string& path, std::vector<RtpDatagram>* datagrams, std::string* error);
+
+}  // namespace bench
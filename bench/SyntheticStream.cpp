@@ -0,0 +1,192 @@
+#include "bench/SyntheticStream.h"
+
+extern "C" {
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+}
+
+#include <algorithm>
+#include <iostream>
+
+namespace bench {
+namespace {
+
+// Fill a YUV420P frame with a scrolling gradient and pseudo-random blocks.
+void FillPattern(AVFrame* frame, int index) {
+  uint32_t seed = 0x9e3779b9u * static_cast<uint32_t>(index + 1);
+  for (int y = 0; y < frame->height; ++y) {
+    uint8_t* row = frame->data[0] + y * frame->linesize[0];
+    for (int x = 0; x < frame->width; ++x) {
+      row[x] = static_cast<uint8_t>(x + y + index * 3);
+    }
+  }
+  // Random 16x16 luma blocks, so inter prediction has real work to do
+  for (int block = 0; block < (frame->width * frame->height) / 4096; ++block) {
+    seed = seed * 1664525u + 1013904223u;
+    const int bx = static_cast<int>(seed % static_cast<uint32_t>(std::max(1, frame->width - 16)));
+    const int by = static_cast<int>((seed >> 12) % static_cast<uint32_t>(std::max(1, frame->height - 16)));
+    for (int y = by; y < by + 16 && y < frame->height; ++y) {
+      uint8_t* row = frame->data[0] + y * frame->linesize[0];
+      for (int x = bx; x < bx + 16 && x < frame->width; ++x) {
+        row[x] = static_cast<uint8_t>(seed >> 24);
+      }
+    }
+  }
+  for (int plane = 1; plane < 3; ++plane) {
+    for (int y = 0; y < frame->height / 2; ++y) {
+      uint8_t* row = frame->data[plane] + y * frame->linesize[plane];
+      for (int x = 0; x < frame->width / 2; ++x) {
+        row[x] = static_cast<uint8_t>(128 + ((x + index) & 0x1f) - 16 * (plane - 1));
+      }
+    }
+  }
+}
+
+// Pick an encoder for the codec, preferring the ones WebRTC peers use.
+const AVCodec* FindEncoder(AVCodecID codec_id) {
+  const char* preferred[3] = {nullptr, nullptr, nullptr};
+  if (codec_id == AV_CODEC_ID_VP8) {
+    preferred[0] = "libvpx";
+  } else if (codec_id == AV_CODEC_ID_H264) {
+    preferred[0] = "libx264";
+    preferred[1] = "libopenh264";
+  }
+  for (const char* name : preferred) {
+    if (!name) {
+      continue;
+    }
+    if (const AVCodec* codec = avcodec_find_encoder_by_name(name)) {
+      return codec;
+    }
+  }
+  return avcodec_find_encoder(codec_id);
+}
+
+// Move every packet the encoder has ready into stream->packets.
+bool Drain(AVCodecContext* ctx, EncodedStream* stream) {
+  while (true) {
+    AVPacket* packet = av_packet_alloc();
+    const int ret = avcodec_receive_packet(ctx, packet);
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+      av_packet_free(&packet);
+      return true;
+    }
+    if (ret < 0) {
+      av_packet_free(&packet);
+      return false;
+    }
+    stream->packets.push_back(packet);
+  }
+}
+
+}  // namespace
+
+EncodedStream::~EncodedStream() {
+  for (AVPacket*& packet : packets) {
+    av_packet_free(&packet);
+  }
+  avcodec_parameters_free(&codecpar);
+}
+
+std::unique_ptr<EncodedStream> EncodeSynthetic(AVCodecID codec_id, int width, int height, int frames, int fps) {
+  const AVCodec* codec = FindEncoder(codec_id);
+  if (!codec) {
+    std::cerr << "No encoder for " << avcodec_get_name(codec_id) << "\n";
+    return nullptr;
+  }
+
+  AVCodecContext* ctx = avcodec_alloc_context3(codec);
+  ctx->width = width;
+  ctx->height = height;
+  ctx->pix_fmt = AV_PIX_FMT_YUV420P;
+  ctx->time_base = AVRational{1, fps};
+  ctx->framerate = AVRational{fps, 1};
+  ctx->gop_size = fps * 2;
+  ctx->max_b_frames = 0;
+  ctx->bit_rate = static_cast<int64_t>(width) * height * fps / 10;  // ~0.1 bpp
+
+  // Real-time presets: the benchmark measures decoding, not encoding
+  AVDictionary* options = nullptr;
+  av_dict_set(&options, "deadline", "realtime", 0);
+  av_dict_set(&options, "cpu-used", "8", 0);
+  av_dict_set(&options, "preset", "ultrafast", 0);
+  av_dict_set(&options, "tune", "zerolatency", 0);
+  const int ret = avcodec_open2(ctx, codec, &options);
+  av_dict_free(&options);
+  if (ret < 0) {
+    std::cerr << "Failed to open encoder " << codec->name << "\n";
+    avcodec_free_context(&ctx);
+    return nullptr;
+  }
+
+  auto stream = std::make_unique<EncodedStream>();
+  stream->encoder = codec->name;
+  stream->time_base = ctx->time_base;
+
+  AVFrame* frame = av_frame_alloc();
+  frame->width = width;
+  frame->height = height;
+  frame->format = AV_PIX_FMT_YUV420P;
+  bool ok = av_frame_get_buffer(frame, 32) >= 0;
+  for (int i = 0; ok && i < frames; ++i) {
+    ok = av_frame_make_writable(frame) >= 0;
+    FillPattern(frame, i);
+    frame->pts = i;
+    ok = ok && avcodec_send_frame(ctx, frame) >= 0 && Drain(ctx, stream.get());
+  }
+  ok = ok && avcodec_send_frame(ctx, nullptr) >= 0 && Drain(ctx, stream.get());
+
+  stream->codecpar = avcodec_parameters_alloc();
+  avcodec_parameters_from_context(stream->codecpar, ctx);
+  av_frame_free(&frame);
+  avcodec_free_context(&ctx);
+  if (!ok) {
+    std::cerr << "Encoding with " << stream->encoder << " failed\n";
+    return nullptr;
+  }
+  return stream;
+}
+
+bool WriteContainer(const EncodedStream& stream, const std::string& path) {
+  AVFormatContext* out = nullptr;
+  if (avformat_alloc_output_context2(&out, nullptr, nullptr, path.c_str()) < 0 || !out) {
+    return false;
+  }
+  AVStream* video = avformat_new_stream(out, nullptr);
+  bool ok = video && avcodec_parameters_copy(video->codecpar, stream.codecpar) >= 0;
+  if (ok) {
+    video->codecpar->codec_tag = 0;
+    video->time_base = stream.time_base;
+  }
+  if (ok && !(out->oformat->flags & AVFMT_NOFILE)) {
+    ok = avio_open(&out->pb, path.c_str(), AVIO_FLAG_WRITE) >= 0;
+  }
+  ok = ok && avformat_write_header(out, nullptr) >= 0;
+  for (size_t i = 0; ok && i < stream.packets.size(); ++i) {
+    AVPacket* packet = av_packet_clone(stream.packets[i]);
+    packet->stream_index = video->index;
+    av_packet_rescale_ts(packet, stream.time_base, video->time_base);
+    ok = av_interleaved_write_frame(out, packet) >= 0;
+    av_packet_free(&packet);
+  }
+  if (ok) {
+    ok = av_write_trailer(out) >= 0;
+  }
+  if (!(out->oformat->flags & AVFMT_NOFILE)) {
+    avio_closep(&out->pb);
+  }
+  avformat_free_context(out);
+  return ok;
+}
+
+AVCodecID ParseCodec(const std::string& name) {
+  if (name == "vp8") {
+    return AV_CODEC_ID_VP8;
+  }
+  if (name == "h264") {
+    return AV_CODEC_ID_H264;
+  }
+  return AV_CODEC_ID_NONE;
+}
+
+}  // namespace bench
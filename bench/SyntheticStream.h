@@ -0,0 +1,54 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+namespace bench {
+
+// A locally encoded test stream: codec parameters plus encoded packets.
+//
+// Packets carry pts = frame index (time base 1/fps) so benchmarks can
+// match decoded frames back to the packet that produced them.
+struct EncodedStream {
+  EncodedStream() = default;
+  ~EncodedStream();
+  EncodedStream(const EncodedStream&) = delete;
+  EncodedStream& operator=(const EncodedStream&) = delete;
+
+  std::string encoder;                      // Encoder that produced the stream
+  AVCodecParameters* codecpar = nullptr;    // Owned; feed to the decoder
+  AVRational time_base{1, 30};
+  std::vector<AVPacket*> packets;           // Owned, in decode order
+};
+
+// Encode a moving test pattern with libavcodec.
+//
+// The pattern (scrolling gradient plus pseudo-random blocks) keeps the
+// encoder busy enough that bitrates resemble camera content. Encoders are
+// tried in order of preference for the codec (libvpx for VP8; libx264,
+// libopenh264 for H.264), then whatever libavcodec registers for the id.
+//
+// Param: codec_id - AV_CODEC_ID_VP8 or AV_CODEC_ID_H264 (others use the default encoder)
+// Param: width, height - Frame size
+// Param: frames - Number of frames to encode
+// Param: fps - Nominal frame rate (sets time base and GOP = 2 s)
+// Returns: The encoded stream, or nullptr if no encoder is available
+std::unique_ptr<EncodedStream> EncodeSynthetic(AVCodecID codec_id, int width, int height, int frames, int fps = 30);
+
+// Write an encoded stream to a container file (format guessed from the
+// extension, e.g. ".webm", ".mkv", ".mp4") so it can be replayed through
+// RtpReceiver, which opens files like any other libavformat URL.
+//
+// Returns: true on success
+bool WriteContainer(const EncodedStream& stream, const std::string& path);
+
+// Parse "vp8" / "h264" into a codec id.
+// Returns: AV_CODEC_ID_NONE for unknown names
+AVCodecID ParseCodec(const std::string& name);
+
+}  // namespace bench
@@ -0,0 +1,172 @@
+// Colour conversion benchmark.
+//
+// Measures media::ColorConverter (YUV420P → BGR24) per-frame latency at
+// common capture resolutions, for each swscale algorithm and slice thread
+// count. Use it to pick --convert-threads and --sws-flags for a host.
+//
+// A second table compares producing a 640x360 BGR image in one pass
+// (--resize 640x360, resize inside sws_scale) with converting at full
+// size and then calling cv::resize, as a consumer downscaling on its own
+// would.
+//
+// Usage: bench_convert [iterations]   (default: 50 per configuration)
+//
+// Output: one line per configuration with ms/frame and speedup relative
+// to the single-threaded run (or the two-pass run) of the same algorithm.
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "media/ColorConverter.h"
+
+namespace {
+
+// Allocate a YUV420P frame filled with a deterministic gradient.
+AVFrame* MakeFrame(int width, int height) {
+  AVFrame* frame = av_frame_alloc();
+  frame->width = width;
+  frame->height = height;
+  frame->format = AV_PIX_FMT_YUV420P;
+  if (av_frame_get_buffer(frame, 32) < 0) {
+    av_frame_free(&frame);
+    return nullptr;
+  }
+  for (int plane = 0; plane < 3; ++plane) {
+    const int rows = plane == 0 ? height : height / 2;
+    const int cols = plane == 0 ? width : width / 2;
+    for (int y = 0; y < rows; ++y) {
+      uint8_t* row = frame->data[plane] + y * frame->linesize[plane];
+      for (int x = 0; x < cols; ++x) {
+        row[x] = static_cast<uint8_t>((x + y + plane * 64) & 0xff);
+      }
+    }
+  }
+  return frame;
+}
+
+// Average milliseconds per Convert() call over iterations (after warm-up).
+double TimeConvert(media::ColorConverter& converter, const AVFrame* frame, cv::Mat& dst, int iterations) {
+  for (int i = 0; i < 3; ++i) {
+    converter.Convert(frame, dst);
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    converter.Convert(frame, dst);
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+// Average milliseconds per full-size Convert() plus cv::resize to size.
+double TimeTwoPass(media::ColorConverter& converter, const AVFrame* frame, cv::Mat& full, cv::Mat& dst,
+                   cv::Size size, int interpolation, int iterations) {
+  auto run = [&]() {
+    converter.Convert(frame, full);
+    cv::resize(full, dst, size, 0, 0, interpolation);
+  };
+  for (int i = 0; i < 3; ++i) {
+    run();
+  }
+  auto start = std::chrono::steady_clock::now();
+  for (int i = 0; i < iterations; ++i) {
+    run();
+  }
+  std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+  return elapsed.count() / iterations;
+}
+
+media::ColorConverterOptions ConvertOptions(size_t threads, media::ScaleAlgorithm algorithm) {
+  media::ColorConverterOptions options;
+  options.threads = threads;
+  options.algorithm = algorithm;
+  return options;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 50;
+  const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+
+  std::vector<size_t> thread_counts = {1, 2, 4, 8};
+  thread_counts.erase(std::remove_if(thread_counts.begin(), thread_counts.end(),
+                                     [cores](size_t n) { return n > cores; }),
+                      thread_counts.end());
+  if (std::find(thread_counts.begin(), thread_counts.end(), cores) == thread_counts.end()) {
+    thread_counts.push_back(cores);
+  }
+
+  const std::vector<std::pair<int, int>> resolutions = {{1280, 720}, {1920, 1080}, {3840, 2160}};
+  const std::vector<media::ScaleAlgorithm> algorithms = {
+      media::ScaleAlgorithm::kBilinear, media::ScaleAlgorithm::kFastBilinear, media::ScaleAlgorithm::kPoint};
+
+  std::cout << std::left << std::setw(11) << "resolution" << std::setw(15) << "algorithm"
+            << std::setw(9) << "threads" << std::setw(9) << "slices" << std::setw(12) << "ms/frame"
+            << "speedup\n";
+  for (const auto& [width, height] : resolutions) {
+    AVFrame* frame = MakeFrame(width, height);
+    if (!frame) {
+      std::cerr << "Failed to allocate " << width << "x" << height << " frame\n";
+      return 1;
+    }
+    cv::Mat dst(height, width, CV_8UC3);
+    for (media::ScaleAlgorithm algorithm : algorithms) {
+      double baseline = 0.0;
+      for (size_t threads : thread_counts) {
+        media::ColorConverter converter(ConvertOptions(threads, algorithm));
+        const double ms = TimeConvert(converter, frame, dst, iterations);
+        if (threads == 1) {
+          baseline = ms;
+        }
+        std::cout << std::left << std::setw(11) << (std::to_string(width) + "x" + std::to_string(height))
+                  << std::setw(15) << media::ToString(algorithm) << std::setw(9) << threads
+                  << std::setw(9) << converter.slice_count() << std::setw(12) << std::fixed
+                  << std::setprecision(3) << ms << std::setprecision(2) << (baseline / ms) << "x\n";
+      }
+    }
+    av_frame_free(&frame);
+  }
+
+  // One pass (--resize) vs convert + cv::resize, single-threaded
+  const cv::Size target(640, 360);
+  const std::vector<std::pair<media::ScaleAlgorithm, int>> resizers = {
+      {media::ScaleAlgorithm::kBilinear, cv::INTER_LINEAR}, {media::ScaleAlgorithm::kArea, cv::INTER_AREA}};
+  std::cout << "\n"
+            << std::left << std::setw(11) << "resolution" << std::setw(15) << "algorithm" << std::setw(16)
+            << "two-pass ms" << std::setw(16) << "one-pass ms" << "speedup\n";
+  for (const auto& [width, height] : resolutions) {
+    AVFrame* frame = MakeFrame(width, height);
+    if (!frame) {
+      std::cerr << "Failed to allocate " << width << "x" << height << " frame\n";
+      return 1;
+    }
+    cv::Mat full(height, width, CV_8UC3);
+    cv::Mat dst(target.height, target.width, CV_8UC3);
+    for (const auto& [algorithm, interpolation] : resizers) {
+      media::ColorConverter full_converter(ConvertOptions(1, algorithm));
+      const double two_pass = TimeTwoPass(full_converter, frame, full, dst, target, interpolation, iterations);
+      media::ColorConverterOptions options = ConvertOptions(1, algorithm);
+      options.size = target;
+      media::ColorConverter converter(options);
+      const double one_pass = TimeConvert(converter, frame, dst, iterations);
+      std::cout << std::left << std::setw(11) << (std::to_string(width) + "x" + std::to_string(height))
+                << std::setw(15) << media::ToString(algorithm) << std::setw(16) << std::fixed
+                << std::setprecision(3) << two_pass << std::setw(16) << one_pass << std::setprecision(2)
+                << (two_pass / one_pass) << "x\n";
+    }
+    av_frame_free(&frame);
+  }
+  return 0;
+}
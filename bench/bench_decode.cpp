@@ -0,0 +1,150 @@
+// Decoder threading benchmark.
+//
+// Encodes a synthetic VP8 or H.264 stream locally, then decodes it with
+// each decoder threading configuration accepted by --decode-threads /
+// --decode-thread-type / --low-delay. For every configuration it reports:
+//   - fps:        decode throughput (all packets, including the flush)
+//   - lat avg/max: time from avcodec_send_packet() of a packet to
+//                 avcodec_receive_frame() of the matching frame
+//   - delay:      packets that had to be sent before the first frame came
+//                 out (frame threading holds back threads - 1 frames)
+//
+// Usage: bench_decode [vp8|h264] [width] [height] [frames]
+//        defaults: vp8 1920 1080 300
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/SyntheticStream.h"
+#include "ingest/RtpReceiver.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Config {
+  std::string label;
+  ingest::DecoderOptions options;
+};
+
+struct Result {
+  double fps = 0.0;
+  double latency_avg_ms = 0.0;
+  double latency_max_ms = 0.0;
+  int delay_packets = -1;
+};
+
+// Decode every packet of the stream once with the given options.
+bool Decode(const bench::EncodedStream& stream, const ingest::DecoderOptions& options, Result* result) {
+  const AVCodec* codec = avcodec_find_decoder(stream.codecpar->codec_id);
+  AVCodecContext* ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+  if (!ctx || avcodec_parameters_to_context(ctx, stream.codecpar) < 0) {
+    avcodec_free_context(&ctx);
+    return false;
+  }
+  ingest::ApplyDecoderOptions(options, ctx);
+  if (avcodec_open2(ctx, codec, nullptr) < 0) {
+    avcodec_free_context(&ctx);
+    return false;
+  }
+
+  AVFrame* frame = av_frame_alloc();
+  std::vector<Clock::time_point> sent(stream.packets.size());
+  double latency_sum = 0.0;
+  size_t decoded = 0;
+  int sent_count = 0;
+
+  auto receive_all = [&]() {
+    while (avcodec_receive_frame(ctx, frame) >= 0) {
+      const auto now = Clock::now();
+      const int64_t index = frame->best_effort_timestamp;
+      if (index >= 0 && static_cast<size_t>(index) < sent.size()) {
+        const double ms = std::chrono::duration<double, std::milli>(now - sent[index]).count();
+        latency_sum += ms;
+        result->latency_max_ms = std::max(result->latency_max_ms, ms);
+      }
+      if (result->delay_packets < 0) {
+        result->delay_packets = sent_count;
+      }
+      ++decoded;
+    }
+  };
+
+  const auto start = Clock::now();
+  for (size_t i = 0; i < stream.packets.size(); ++i) {
+    sent[i] = Clock::now();
+    ++sent_count;
+    avcodec_send_packet(ctx, stream.packets[i]);
+    receive_all();
+  }
+  avcodec_send_packet(ctx, nullptr);
+  receive_all();
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  result->fps = decoded / seconds;
+  result->latency_avg_ms = decoded ? latency_sum / decoded : 0.0;
+  av_frame_free(&frame);
+  avcodec_free_context(&ctx);
+  return decoded > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const std::string codec_name = argc > 1 ? argv[1] : "vp8";
+  const int width = argc > 2 ? std::atoi(argv[2]) : 1920;
+  const int height = argc > 3 ? std::atoi(argv[3]) : 1080;
+  const int frames = argc > 4 ? std::atoi(argv[4]) : 300;
+
+  const AVCodecID codec_id = bench::ParseCodec(codec_name);
+  if (codec_id == AV_CODEC_ID_NONE) {
+    std::cerr << "Unknown codec " << codec_name << " (use vp8 or h264)\n";
+    return 1;
+  }
+  auto stream = bench::EncodeSynthetic(codec_id, width, height, frames);
+  if (!stream) {
+    return 1;
+  }
+  std::cout << "Stream: " << codec_name << " " << width << "x" << height << ", " << stream->packets.size()
+            << " packets (encoder " << stream->encoder << ")\n";
+
+  const int cores = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+  std::vector<Config> configs;
+  configs.push_back({"single", {1, ingest::DecodeThreading::kAuto, false}});
+  std::vector<int> thread_counts = {2, 4, cores};
+  std::sort(thread_counts.begin(), thread_counts.end());
+  thread_counts.erase(std::unique(thread_counts.begin(), thread_counts.end()), thread_counts.end());
+  for (int threads : thread_counts) {
+    if (threads < 2 || threads > cores) {
+      continue;
+    }
+    configs.push_back({"frame x" + std::to_string(threads), {threads, ingest::DecodeThreading::kFrame, false}});
+    configs.push_back({"slice x" + std::to_string(threads), {threads, ingest::DecodeThreading::kSlice, false}});
+  }
+  configs.push_back({"auto x0", {0, ingest::DecodeThreading::kAuto, false}});
+  configs.push_back({"low-delay x" + std::to_string(cores), {cores, ingest::DecodeThreading::kAuto, true}});
+
+  std::cout << std::left << std::setw(16) << "config" << std::setw(10) << "fps" << std::setw(14)
+            << "lat avg ms" << std::setw(14) << "lat max ms" << "delay pkts\n";
+  for (const Config& config : configs) {
+    Result result;
+    if (!Decode(*stream, config.options, &result)) {
+      std::cout << std::setw(16) << config.label << "failed\n";
+      continue;
+    }
+    std::cout << std::left << std::setw(16) << config.label << std::fixed << std::setprecision(1)
+              << std::setw(10) << result.fps << std::setprecision(2) << std::setw(14) << result.latency_avg_ms
+              << std::setw(14) << result.latency_max_ms << result.delay_packets << "\n";
+  }
+  return 0;
+}
@@ -0,0 +1,176 @@
+// Image encoding benchmark.
+//
+// Encodes two synthetic 8-bit BGR frames with each --image-format setting
+// and reports encode time against file size, to help pick the
+// throughput/storage tradeoff for a host:
+//   - camera: smooth gradients plus sensor-like noise (photos, webcams)
+//   - screen: flat areas, hard edges and text (screen shares, slides)
+// For every configuration it reports:
+//   - ms/frame:  media::ImageEncoder::Encode() on one thread, averaged
+//   - fps/core:  frames per second one encode thread sustains
+//   - KB/frame:  encoded size
+//   - ratio:     size relative to the raw BGR frame
+//   - MB/s@30fps: disk write bandwidth for one 30 fps stream
+// Encoding parallelizes across frames with --encode-threads, so divide
+// ms/frame by the thread count for a multi-core estimate.
+//
+// Usage: bench_encode [width] [height] [iterations]
+//        defaults: 1920 1080 20
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/imgproc.hpp>
+
+#include "media/ImageEncoder.h"
+
+namespace {
+
+struct Config {
+  std::string label;
+  media::ImageEncoderOptions options;
+};
+
+// Gradient background with Gaussian noise, like a camera frame.
+cv::Mat MakeCamera(int width, int height) {
+  cv::Mat frame(height, width, CV_8UC3);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = frame.ptr<uint8_t>(y);
+    for (int x = 0; x < width; ++x) {
+      row[3 * x + 0] = static_cast<uint8_t>(64 + 128 * x / width);
+      row[3 * x + 1] = static_cast<uint8_t>(32 + 160 * y / height);
+      row[3 * x + 2] = static_cast<uint8_t>(96 + 64 * (x + y) / (width + height));
+    }
+  }
+  cv::Mat noise(height, width, CV_16SC3);
+  cv::randn(noise, cv::Scalar(0, 0, 0), cv::Scalar(6, 6, 6));
+  cv::add(frame, noise, frame, cv::noArray(), CV_8U);
+  return frame;
+}
+
+// Window-like rectangles and lines of text on a flat background.
+cv::Mat MakeScreen(int width, int height) {
+  cv::Mat frame(height, width, CV_8UC3, cv::Scalar(245, 245, 245));
+  cv::rectangle(frame, cv::Rect(0, 0, width, height / 20), cv::Scalar(60, 60, 60), cv::FILLED);
+  cv::rectangle(frame, cv::Rect(width / 20, height / 8, width / 3, height * 3 / 4), cv::Scalar(230, 200, 160),
+                cv::FILLED);
+  const double scale = std::max(0.4, height / 1080.0 * 0.8);
+  for (int line = 0; line < 24; ++line) {
+    const int y = height / 6 + line * height / 32;
+    cv::putText(frame, "The quick brown fox jumps over the lazy dog " + std::to_string(line),
+                cv::Point(width / 2 - width / 10, y), cv::FONT_HERSHEY_SIMPLEX, scale, cv::Scalar(20, 20, 20), 1,
+                cv::LINE_AA);
+  }
+  return frame;
+}
+
+// Build the YUV420P frame a decoder would have produced for bgr, so the
+// raw yuv row measures the production path (a plane copy, no conversion).
+AVFrame* MakeNative(const cv::Mat& bgr) {
+  cv::Mat i420;
+  cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+  AVFrame* frame = av_frame_alloc();
+  frame->width = bgr.cols;
+  frame->height = bgr.rows;
+  frame->format = AV_PIX_FMT_YUV420P;
+  if (av_frame_get_buffer(frame, 32) < 0) {
+    av_frame_free(&frame);
+    return nullptr;
+  }
+  const uint8_t* src = i420.data;
+  for (int plane = 0; plane < 3; ++plane) {
+    const int rows = plane == 0 ? bgr.rows : bgr.rows / 2;
+    const int cols = plane == 0 ? bgr.cols : bgr.cols / 2;
+    for (int y = 0; y < rows; ++y) {
+      std::memcpy(frame->data[plane] + y * frame->linesize[plane], src, static_cast<size_t>(cols));
+      src += cols;
+    }
+  }
+  return frame;
+}
+
+Config Make(const std::string& label, media::ImageFormat format, int png_compression, int quality) {
+  Config config;
+  config.label = label;
+  config.options.format = format;
+  config.options.png_compression = png_compression;
+  config.options.quality = quality;
+  return config;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  const int width = argc > 1 ? std::atoi(argv[1]) : 1920;
+  const int height = argc > 2 ? std::atoi(argv[2]) : 1080;
+  const int iterations = argc > 3 ? std::max(1, std::atoi(argv[3])) : 20;
+  if (width <= 0 || height <= 0 || width % 2 != 0 || height % 2 != 0) {
+    std::cerr << "Width and height must be positive and even\n";
+    return 1;
+  }
+
+  const std::vector<Config> configs = {
+      Make("png (default)", media::ImageFormat::kPng, -1, 0),
+      Make("png level 0", media::ImageFormat::kPng, 0, 0),
+      Make("png level 1", media::ImageFormat::kPng, 1, 0),
+      Make("png level 3", media::ImageFormat::kPng, 3, 0),
+      Make("png level 6", media::ImageFormat::kPng, 6, 0),
+      Make("png level 9", media::ImageFormat::kPng, 9, 0),
+      Make("jpeg q75", media::ImageFormat::kJpeg, -1, 75),
+      Make("jpeg q90", media::ImageFormat::kJpeg, -1, 90),
+      Make("jpeg q95", media::ImageFormat::kJpeg, -1, 95),
+      Make("webp q75", media::ImageFormat::kWebp, -1, 75),
+      Make("webp q90", media::ImageFormat::kWebp, -1, 90),
+      Make("webp lossless", media::ImageFormat::kWebp, -1, 101),
+      Make("raw bgr", media::ImageFormat::kRawBgr, -1, 0),
+      Make("raw yuv", media::ImageFormat::kRawYuv, -1, 0),
+  };
+
+  const double raw_bytes = static_cast<double>(width) * height * 3;
+  std::cout << width << "x" << height << ", " << iterations << " iterations per configuration\n";
+  std::cout << std::left << std::setw(9) << "content" << std::setw(16) << "format" << std::setw(11) << "ms/frame"
+            << std::setw(10) << "fps/core" << std::setw(11) << "KB/frame" << std::setw(9) << "ratio"
+            << "MB/s@30fps\n";
+
+  for (const std::string content : {"camera", "screen"}) {
+    const cv::Mat bgr = content == "camera" ? MakeCamera(width, height) : MakeScreen(width, height);
+    AVFrame* native = MakeNative(bgr);
+    if (!native) {
+      std::cerr << "Failed to allocate " << width << "x" << height << " frame\n";
+      return 1;
+    }
+    std::vector<uchar> bytes;
+    for (const Config& config : configs) {
+      const media::ImageEncoder encoder(config.options);
+      if (!encoder.Encode(bgr, native, &bytes)) {
+        std::cout << std::left << std::setw(9) << content << std::setw(16) << config.label
+                  << "unsupported by this OpenCV build\n";
+        continue;
+      }
+      const auto start = std::chrono::steady_clock::now();
+      for (int i = 0; i < iterations; ++i) {
+        encoder.Encode(bgr, native, &bytes);
+      }
+      const std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+      const double ms = elapsed.count() / iterations;
+      const double kb = bytes.size() / 1024.0;
+      std::cout << std::left << std::setw(9) << content << std::setw(16) << config.label << std::fixed
+                << std::setprecision(2) << std::setw(11) << ms << std::setprecision(1) << std::setw(10)
+                << (ms > 0.0 ? 1000.0 / ms : 0.0) << std::setw(11) << kb << std::setprecision(3) << std::setw(9)
+                << (bytes.size() / raw_bytes) << std::setprecision(1) << (bytes.size() * 30.0 / 1e6) << "\n";
+    }
+    av_frame_free(&native);
+  }
+  return 0;
+}
@@ -0,0 +1,509 @@
+// Capture pipeline benchmark: RTP in, frames on disk out.
+//
+// Replays an RTP stream over loopback UDP into the same components
+// CaptureStream wires together, and measures three stages:
+//   receive - RtpReceiver with the native ingest (socket, jitter buffer,
+//             depacketizer, decoder, BGR conversion). Latency: last packet
+//             of a frame sent → frame callback.
+//   write   - FrameWriter alone, fed decoded frames as fast as it accepts
+//             them. Latency: OnFrame() duration (PNG encode + write with
+//             --encode-threads 0, hand-off to the encode pool otherwise;
+//             the file write itself leaves this path with --file-output
+//             threads|uring).
+//   e2e     - RtpReceiver → BoundedQueue → writer thread → FrameWriter.
+//             Latency: last packet of a frame sent → OnFrame() returned.
+// Each stage reports frames delivered/expected, fps, latency percentiles
+// and process CPU time per frame (all threads, including the sender, which
+// costs little next to decoding).
+//
+// Input is either a synthetic stream encoded locally with libavcodec (one
+// per --sizes entry, see SyntheticStream.h) or a recorded .rtpdump/.pcap
+// (--input, with --codec naming its payload format).
+//
+// Usage: bench_pipeline [--codec vp8|h264] [--sizes 640x360,1280x720,1920x1080]
+//                       [--frames 300] [--fps 30] [--input <file>]
+//                       [--speed 1] [--port 47000] [--stages receive,write,e2e]
+//                       [--decode-threads 1] [--convert-threads 1]
+//                       [--encode-threads 0] [--file-output sync] [--video 0]
+//   --speed 1 replays in real time (latency as seen in production);
+//   --speed 0 sends as fast as possible (throughput; once the socket
+//   buffer overflows, frames are lost and reported as such).
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "bench/RtpReplay.h"
+#include "bench/SyntheticStream.h"
+#include "ingest/Depacketizer.h"
+#include "ingest/RtpPacket.h"
+#include "ingest/RtpReceiver.h"
+#include "media/FrameWriter.h"
+#include "util/BoundedQueue.h"
+#include "util/FileOutput.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Decoded frames kept from the receive stage to feed the write stage
+constexpr size_t kWriteFrames = 30;
+
+struct Options {
+  std::string codec = "vp8";
+  std::vector<std::pair<int, int>> sizes = {{640, 360}, {1280, 720}, {1920, 1080}};
+  int frames = 300;
+  int fps = 30;
+  std::string input;
+  double speed = 1.0;
+  int port = 47000;
+  std::string stages = "receive,write,e2e";
+  int decode_threads = 1;
+  size_t convert_threads = 1;
+  size_t encode_threads = 0;
+  util::FileBackend file_output = util::FileBackend::kSync;
+  bool video = false;
+};
+
+// An RTP stream ready to replay, with the frame each marker packet ends.
+struct Replay {
+  std::string label;
+  ingest::RtpCodec codec = ingest::RtpCodec::kVp8;
+  std::vector<bench::RtpDatagram> datagrams;
+  std::vector<int> frame_of_datagram;                 // -1 unless it completes a frame
+  std::unordered_map<uint32_t, size_t> frame_of_timestamp;
+  uint32_t base_timestamp = 0;                        // RTP timestamp of the first decodable frame
+  size_t frames = 0;
+};
+
+// Run the stream through a depacketizer once, as the receiver will, to
+// learn which frames it will decode and which packet completes each.
+bool IndexFrames(Replay* replay) {
+  auto depacketizer = ingest::CreateDepacketizer(replay->codec);
+  replay->frame_of_datagram.assign(replay->datagrams.size(), -1);
+  for (size_t i = 0; i < replay->datagrams.size(); ++i) {
+    const auto& data = replay->datagrams[i].data;
+    ingest::RtpPacket packet;
+    if (!ingest::ParseRtpPacket(data.data(), data.size(), &packet) || !depacketizer->Push(packet, false)) {
+      continue;
+    }
+    if (replay->frames == 0) {
+      replay->base_timestamp = depacketizer->frame_timestamp();
+    }
+    replay->frame_of_timestamp[depacketizer->frame_timestamp()] = replay->frames;
+    replay->frame_of_datagram[i] = static_cast<int>(replay->frames++);
+  }
+  return replay->frames > 0;
+}
+
+// Send times per frame and the latency samples matched against them.
+class Timeline {
+ public:
+  explicit Timeline(const Replay& replay) : replay_(replay), sent_ns_(replay.frames) {}
+
+  void MarkSent(size_t frame) { sent_ns_[frame].store(Now(), std::memory_order_relaxed); }
+
+  // Map a delivered frame back to its RTP timestamp (native ingest pts
+  // counts from the first decoded frame) and record its latency.
+  void Record(const media::Frame& frame) {
+    const int64_t now = Now();
+    std::lock_guard<std::mutex> lock(mutex_);
+    ++delivered_;
+    last_ns_ = now;
+    if (frame.pts_us < 0) {
+      return;
+    }
+    const uint32_t timestamp =
+        replay_.base_timestamp + static_cast<uint32_t>(std::llround(frame.pts_us * 90000.0 / 1e6));
+    const auto it = replay_.frame_of_timestamp.find(timestamp);
+    if (it == replay_.frame_of_timestamp.end()) {
+      return;
+    }
+    const int64_t sent = sent_ns_[it->second].load(std::memory_order_relaxed);
+    if (sent > 0) {
+      latency_ms_.push_back((now - sent) / 1e6);
+    }
+  }
+
+  size_t delivered() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return delivered_;
+  }
+
+  int64_t last_ns() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return last_ns_;
+  }
+
+  std::vector<double> latency_ms() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return latency_ms_;
+  }
+
+  static int64_t Now() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now().time_since_epoch()).count();
+  }
+
+ private:
+  const Replay& replay_;
+  std::vector<std::atomic<int64_t>> sent_ns_;
+  std::mutex mutex_;
+  size_t delivered_ = 0;
+  int64_t last_ns_ = 0;
+  std::vector<double> latency_ms_;
+};
+
+struct StageResult {
+  size_t frames = 0;
+  size_t expected = 0;
+  double seconds = 0.0;
+  double cpu_seconds = 0.0;
+  std::vector<double> latency_ms;
+};
+
+// User + system CPU time of the whole process.
+double CpuSeconds() {
+  rusage usage{};
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_utime.tv_sec + usage.ru_stime.tv_sec + (usage.ru_utime.tv_usec + usage.ru_stime.tv_usec) / 1e6;
+}
+
+// Nearest-rank percentile of sorted samples.
+double Percentile(const std::vector<double>& sorted, double p) {
+  if (sorted.empty()) {
+    return 0.0;
+  }
+  const size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * sorted.size()));
+  return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+}
+
+// Send every datagram to 127.0.0.1:port, paced by offset_us / speed.
+void SendAll(const Replay& replay, int port, double speed, Timeline* timeline) {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  const int send_buffer = 8 * 1024 * 1024;
+  setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &send_buffer, sizeof(send_buffer));
+  sockaddr_in destination{};
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(static_cast<uint16_t>(port));
+  inet_pton(AF_INET, "127.0.0.1", &destination.sin_addr);
+
+  const auto start = Clock::now();
+  for (size_t i = 0; i < replay.datagrams.size(); ++i) {
+    const bench::RtpDatagram& datagram = replay.datagrams[i];
+    if (speed > 0) {
+      std::this_thread::sleep_until(start + std::chrono::microseconds(static_cast<int64_t>(datagram.offset_us / speed)));
+    }
+    sendto(fd, datagram.data.data(), datagram.data.size(), 0, reinterpret_cast<const sockaddr*>(&destination),
+           sizeof(destination));
+    if (replay.frame_of_datagram[i] >= 0) {
+      timeline->MarkSent(static_cast<size_t>(replay.frame_of_datagram[i]));
+    }
+  }
+  close(fd);
+}
+
+// Run a native-ingest RtpReceiver on loopback while the stream is
+// replayed into it. Returns once every frame arrived (per `done`) or
+// nothing arrived for a second after the last packet was sent.
+void ReplayThroughReceiver(const Replay& replay,
+                           const Options& options,
+                           Timeline* timeline,
+                           const ingest::RtpReceiver::FrameCallback& on_frame,
+                           const std::function<size_t()>& done) {
+  ingest::ReceiverOptions receiver_options;
+  receiver_options.ingest = ingest::IngestMode::kNative;
+  receiver_options.decode.threads = options.decode_threads;
+  receiver_options.convert.threads = options.convert_threads;
+  const std::string url = "rtp://127.0.0.1:" + std::to_string(options.port) +
+                          (replay.codec == ingest::RtpCodec::kH264 ? "?codec=h264" : "?codec=vp8");
+  ingest::RtpReceiver receiver(url, on_frame, receiver_options);
+  std::thread receive_thread([&receiver]() { receiver.Run(); });
+
+  // RunNative() opens the decoder, then binds; give it time before sending
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  SendAll(replay, options.port, options.speed, timeline);
+
+  size_t last_count = 0;
+  auto last_progress = Clock::now();
+  while (done() < replay.frames && Clock::now() - last_progress < std::chrono::seconds(1)) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    const size_t count = done();
+    if (count != last_count) {
+      last_count = count;
+      last_progress = Clock::now();
+    }
+  }
+  receiver.Stop();
+  receive_thread.join();
+}
+
+// receive: decode + convert only; keeps the first kWriteFrames frames.
+StageResult RunReceive(const Replay& replay, const Options& options, std::vector<media::FrameRef>* keep) {
+  Timeline timeline(replay);
+  const double cpu_start = CpuSeconds();
+  const int64_t start_ns = Timeline::Now();
+  ReplayThroughReceiver(
+      replay, options, &timeline,
+      [&](const media::FrameRef& frame) {
+        timeline.Record(*frame);
+        if (keep->size() < kWriteFrames) {
+          keep->push_back(frame);
+        }
+      },
+      [&]() { return timeline.delivered(); });
+
+  StageResult result;
+  result.frames = timeline.delivered();
+  result.expected = replay.frames;
+  result.seconds = (timeline.last_ns() - start_ns) / 1e9;
+  result.cpu_seconds = CpuSeconds() - cpu_start;
+  result.latency_ms = timeline.latency_ms();
+  return result;
+}
+
+media::FrameWriterOptions WriterOptions(const Options& options, const std::string& dir) {
+  media::FrameWriterOptions writer;
+  writer.output_dir = dir;
+  writer.write_images = true;
+  writer.write_video = options.video;
+  writer.mp4_path = dir + "/capture.mp4";
+  writer.mp4_fps = options.fps;
+  writer.encode_threads = options.encode_threads;
+  writer.files.backend = options.file_output;
+  return writer;
+}
+
+// write: FrameWriter alone, as many frames as the stream has, cycling
+// through the frames kept by the receive stage.
+StageResult RunWrite(const Replay& replay, const Options& options, const std::vector<media::FrameRef>& frames) {
+  const std::string dir = (std::filesystem::temp_directory_path() / "bench_pipeline").string();
+  std::filesystem::remove_all(dir);
+
+  StageResult result;
+  result.expected = replay.frames;
+  const double cpu_start = CpuSeconds();
+  const auto start = Clock::now();
+  {
+    media::FrameWriter writer(WriterOptions(options, dir));
+    for (size_t i = 0; i < replay.frames && !frames.empty(); ++i) {
+      const auto call = Clock::now();
+      writer.OnFrame(frames[i % frames.size()]);
+      result.latency_ms.push_back(std::chrono::duration<double, std::milli>(Clock::now() - call).count());
+      ++result.frames;
+    }
+    writer.Close();
+  }
+  result.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+  result.cpu_seconds = CpuSeconds() - cpu_start;
+  std::filesystem::remove_all(dir);
+  return result;
+}
+
+// e2e: receiver → queue → writer thread → FrameWriter, as CaptureStream.
+StageResult RunEndToEnd(const Replay& replay, const Options& options) {
+  const std::string dir = (std::filesystem::temp_directory_path() / "bench_pipeline").string();
+  std::filesystem::remove_all(dir);
+
+  Timeline timeline(replay);
+  const double cpu_start = CpuSeconds();
+  const int64_t start_ns = Timeline::Now();
+  {
+    media::FrameWriter writer(WriterOptions(options, dir));
+    util::BoundedQueue<media::FrameRef> queue(64, util::OverflowPolicy::kDropOldest);
+    std::thread writer_thread([&]() {
+      media::FrameRef frame;
+      while (queue.Pop(frame)) {
+        writer.OnFrame(frame);
+        timeline.Record(*frame);
+        frame.reset();
+      }
+    });
+    std::atomic<size_t> received{0};
+    ReplayThroughReceiver(
+        replay, options, &timeline,
+        [&](const media::FrameRef& frame) {
+          queue.Push(frame);
+          ++received;
+        },
+        [&]() { return received.load(); });
+    queue.Close();
+    writer_thread.join();
+    writer.Close();
+  }
+
+  StageResult result;
+  result.frames = timeline.delivered();
+  result.expected = replay.frames;
+  result.seconds = (timeline.last_ns() - start_ns) / 1e9;
+  result.cpu_seconds = CpuSeconds() - cpu_start;
+  result.latency_ms = timeline.latency_ms();
+  std::filesystem::remove_all(dir);
+  return result;
+}
+
+void PrintHeader() {
+  std::cout << std::left << std::setw(22) << "input" << std::setw(9) << "stage" << std::setw(11) << "frames"
+            << std::setw(9) << "fps" << std::setw(9) << "p50 ms" << std::setw(9) << "p90 ms" << std::setw(9)
+            << "p99 ms" << std::setw(9) << "max ms"
+            << "cpu ms/frame\n";
+}
+
+void PrintResult(const std::string& label, const std::string& stage, StageResult result) {
+  std::sort(result.latency_ms.begin(), result.latency_ms.end());
+  const double fps = result.seconds > 0 ? result.frames / result.seconds : 0.0;
+  const double cpu = result.frames ? result.cpu_seconds * 1000.0 / result.frames : 0.0;
+  std::cout << std::left << std::setw(22) << label << std::setw(9) << stage << std::setw(11)
+            << (std::to_string(result.frames) + "/" + std::to_string(result.expected)) << std::fixed
+            << std::setprecision(1) << std::setw(9) << fps << std::setprecision(2) << std::setw(9)
+            << Percentile(result.latency_ms, 50) << std::setw(9) << Percentile(result.latency_ms, 90)
+            << std::setw(9) << Percentile(result.latency_ms, 99) << std::setw(9)
+            << (result.latency_ms.empty() ? 0.0 : result.latency_ms.back()) << cpu << "\n";
+}
+
+void RunStages(Replay& replay, const Options& options) {
+  if (!IndexFrames(&replay)) {
+    std::cerr << replay.label << ": no decodable frame in the stream\n";
+    return;
+  }
+  const bool want_receive = options.stages.find("receive") != std::string::npos;
+  const bool want_write = options.stages.find("write") != std::string::npos;
+  const bool want_e2e = options.stages.find("e2e") != std::string::npos;
+
+  std::vector<media::FrameRef> frames;
+  if (want_receive || want_write) {
+    StageResult result = RunReceive(replay, options, &frames);
+    if (want_receive) {
+      PrintResult(replay.label, "receive", std::move(result));
+    }
+  }
+  if (want_write) {
+    PrintResult(replay.label, "write", RunWrite(replay, options, frames));
+  }
+  frames.clear();
+  if (want_e2e) {
+    PrintResult(replay.label, "e2e", RunEndToEnd(replay, options));
+  }
+}
+
+bool ParseSizes(const std::string& text, std::vector<std::pair<int, int>>* sizes) {
+  sizes->clear();
+  std::istringstream list(text);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    int width = 0;
+    int height = 0;
+    char x = 0;
+    std::istringstream size(item);
+    if (!(size >> width >> x >> height) || x != 'x' || width <= 0 || height <= 0) {
+      return false;
+    }
+    sizes->emplace_back(width, height);
+  }
+  return !sizes->empty();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i < argc; ++i) {
+    const std::string key = argv[i];
+    if (i + 1 >= argc) {
+      std::cerr << "Missing value for " << key << "\n";
+      return 1;
+    }
+    const std::string value = argv[++i];
+    if (key == "--codec") {
+      options.codec = value;
+    } else if (key == "--sizes") {
+      if (!ParseSizes(value, &options.sizes)) {
+        std::cerr << "Invalid --sizes " << value << " (use WxH,WxH,...)\n";
+        return 1;
+      }
+    } else if (key == "--frames") {
+      options.frames = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "--fps") {
+      options.fps = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "--input") {
+      options.input = value;
+    } else if (key == "--speed") {
+      options.speed = std::max(0.0, std::atof(value.c_str()));
+    } else if (key == "--port") {
+      options.port = std::atoi(value.c_str());
+    } else if (key == "--stages") {
+      options.stages = value;
+    } else if (key == "--decode-threads") {
+      options.decode_threads = std::max(0, std::atoi(value.c_str()));
+    } else if (key == "--convert-threads") {
+      options.convert_threads = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+    } else if (key == "--encode-threads") {
+      options.encode_threads = static_cast<size_t>(std::max(0, std::atoi(value.c_str())));
+    } else if (key == "--file-output") {
+      if (!util::ParseFileBackend(value, &options.file_output)) {
+        std::cerr << "Unknown file output " << value << " (use sync, threads, uring or auto)\n";
+        return 1;
+      }
+    } else if (key == "--video") {
+      options.video = std::atoi(value.c_str()) != 0;
+    } else {
+      std::cerr << "Unknown option " << key << "\n";
+      return 1;
+    }
+  }
+
+  ingest::RtpCodec codec;
+  const AVCodecID codec_id = bench::ParseCodec(options.codec);
+  if (codec_id == AV_CODEC_ID_NONE || !ingest::ParseRtpCodec(options.codec, &codec)) {
+    std::cerr << "Unknown codec " << options.codec << " (use vp8 or h264)\n";
+    return 1;
+  }
+
+  PrintHeader();
+  if (!options.input.empty()) {
+    Replay replay;
+    replay.label = std::filesystem::path(options.input).filename().string();
+    replay.codec = codec;
+    std::string error;
+    if (!bench::LoadRtpRecording(options.input, &replay.datagrams, &error)) {
+      std::cerr << error << "\n";
+      return 1;
+    }
+    RunStages(replay, options);
+    return 0;
+  }
+
+  for (const auto& [width, height] : options.sizes) {
+    auto stream = bench::EncodeSynthetic(codec_id, width, height, options.frames, options.fps);
+    if (!stream) {
+      return 1;
+    }
+    Replay replay;
+    replay.label = options.codec + " " + std::to_string(width) + "x" + std::to_string(height);
+    replay.codec = codec;
+    replay.datagrams = bench::PacketizeRtp(*stream, codec, options.fps);
+    RunStages(replay, options);
+  }
+  return 0;
+}
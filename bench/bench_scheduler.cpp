@@ -0,0 +1,252 @@
+// Decode scheduler benchmark: core scaling and fairness of the reactor
+// ingest's decode pool (util::Scheduler + one util::Strand per stream).
+//
+// Encodes one heavy synthetic stream and one light one locally, then
+// decodes --light copies of the light stream plus the heavy stream, each
+// on its own single-threaded decoder and strand, as the reactor ingest
+// does. Every packet is posted up front, heavy stream first, so the pool
+// is saturated and a FIFO pool would decode the heavy backlog before
+// the light streams. For each worker count it reports:
+//   - fps:      frames decoded per second over all streams
+//   - speedup:  fps relative to one worker (ideal: the worker count, up to
+//               the number of cores)
+//   - light ms: when the last light stream finished
+//   - heavy ms: when the heavy stream finished
+//   - stolen:   tasks run by a worker other than the one they were queued on
+// With a fair pool, light ms stays well below heavy ms: the light streams
+// are not queued behind the heavy one.
+//
+// Usage: bench_scheduler [--codec vp8|h264] [--heavy 1920x1080] [--light-size 640x360]
+//                        [--light 16] [--frames 120] [--threads 1,2,4,<cores>]
+//                        [--batch 8] [--budget-us 2000] [--cpus <list>] [--numa-node <n>]
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/SyntheticStream.h"
+#include "ingest/RtpReceiver.h"
+#include "util/Scheduler.h"
+#include "util/Strand.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Options {
+  std::string codec = "vp8";
+  int heavy_width = 1920;
+  int heavy_height = 1080;
+  int light_width = 640;
+  int light_height = 360;
+  int light = 16;
+  int frames = 120;
+  std::vector<size_t> threads;
+  size_t batch = 8;
+  int64_t budget_us = 2000;
+  std::string cpus;
+  int numa_node = -1;
+};
+
+struct Result {
+  double fps = 0.0;
+  double light_ms = 0.0;
+  double heavy_ms = 0.0;
+  uint64_t stolen = 0;
+};
+
+// One stream being decoded: its decoder, strand and progress.
+struct Stream {
+  const bench::EncodedStream* encoded = nullptr;
+  AVCodecContext* ctx = nullptr;
+  AVFrame* frame = nullptr;
+  std::unique_ptr<util::Strand> strand;
+  uint64_t decoded = 0;  // Strand tasks only
+  double done_ms = 0.0;  // Set by the stream's last task
+
+  ~Stream() {
+    strand.reset();
+    av_frame_free(&frame);
+    avcodec_free_context(&ctx);
+  }
+};
+
+bool ParseSize(const std::string& text, int* width, int* height) {
+  const size_t x = text.find('x');
+  if (x == std::string::npos) {
+    return false;
+  }
+  *width = std::atoi(text.substr(0, x).c_str());
+  *height = std::atoi(text.substr(x + 1).c_str());
+  return *width > 0 && *height > 0;
+}
+
+// Single-threaded decoder: the pool provides the parallelism.
+bool OpenDecoder(Stream* stream) {
+  const AVCodec* codec = avcodec_find_decoder(stream->encoded->codecpar->codec_id);
+  stream->ctx = codec ? avcodec_alloc_context3(codec) : nullptr;
+  stream->frame = av_frame_alloc();
+  if (!stream->ctx || !stream->frame || avcodec_parameters_to_context(stream->ctx, stream->encoded->codecpar) < 0) {
+    return false;
+  }
+  ingest::DecoderOptions options;
+  options.threads = 1;
+  ingest::ApplyDecoderOptions(options, stream->ctx);
+  return avcodec_open2(stream->ctx, codec, nullptr) >= 0;
+}
+
+// Decode every stream once on a scheduler with the given worker count.
+bool Run(const Options& options, const bench::EncodedStream& heavy, const bench::EncodedStream& light,
+         size_t threads, Result* result) {
+  util::SchedulerOptions scheduler_options;
+  scheduler_options.threads = threads;
+  scheduler_options.cpus = options.cpus;
+  scheduler_options.numa_node = options.numa_node;
+  util::Scheduler scheduler(scheduler_options);
+
+  // Heavy stream first: it is queued ahead of every light stream
+  std::vector<std::unique_ptr<Stream>> streams;
+  for (int i = 0; i <= options.light; ++i) {
+    auto stream = std::make_unique<Stream>();
+    stream->encoded = i == 0 ? &heavy : &light;
+    if (!OpenDecoder(stream.get())) {
+      return false;
+    }
+    stream->strand = std::make_unique<util::Strand>(&scheduler, options.batch, options.budget_us);
+    streams.push_back(std::move(stream));
+  }
+
+  const auto start = Clock::now();
+  for (auto& stream : streams) {
+    Stream* target = stream.get();
+    const size_t count = target->encoded->packets.size();
+    for (size_t i = 0; i < count; ++i) {
+      const AVPacket* packet = target->encoded->packets[i];
+      const bool last = i + 1 == count;
+      target->strand->Post([target, packet, last, start]() {
+        if (avcodec_send_packet(target->ctx, packet) >= 0) {
+          while (avcodec_receive_frame(target->ctx, target->frame) >= 0) {
+            ++target->decoded;
+          }
+        }
+        if (last) {
+          target->done_ms = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        }
+      });
+    }
+  }
+  uint64_t decoded = 0;
+  for (auto& stream : streams) {
+    stream->strand->Drain();
+    decoded += stream->decoded;
+  }
+  const double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+
+  result->fps = decoded / seconds;
+  result->heavy_ms = streams[0]->done_ms;
+  result->light_ms = 0.0;
+  for (size_t i = 1; i < streams.size(); ++i) {
+    result->light_ms = std::max(result->light_ms, streams[i]->done_ms);
+  }
+  result->stolen = scheduler.GetStats().stolen;
+  return decoded > 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  Options options;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    const std::string key = argv[i];
+    const std::string value = argv[i + 1];
+    if (key == "--codec") {
+      options.codec = value;
+    } else if (key == "--heavy") {
+      if (!ParseSize(value, &options.heavy_width, &options.heavy_height)) {
+        std::cerr << "Invalid --heavy " << value << "\n";
+        return 1;
+      }
+    } else if (key == "--light-size") {
+      if (!ParseSize(value, &options.light_width, &options.light_height)) {
+        std::cerr << "Invalid --light-size " << value << "\n";
+        return 1;
+      }
+    } else if (key == "--light") {
+      options.light = std::max(0, std::atoi(value.c_str()));
+    } else if (key == "--frames") {
+      options.frames = std::max(1, std::atoi(value.c_str()));
+    } else if (key == "--threads") {
+      std::stringstream list(value);
+      std::string item;
+      while (std::getline(list, item, ',')) {
+        options.threads.push_back(static_cast<size_t>(std::max(1, std::atoi(item.c_str()))));
+      }
+    } else if (key == "--batch") {
+      options.batch = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+    } else if (key == "--budget-us") {
+      options.budget_us = std::max(0, std::atoi(value.c_str()));
+    } else if (key == "--cpus") {
+      options.cpus = value;
+    } else if (key == "--numa-node") {
+      options.numa_node = std::atoi(value.c_str());
+    } else {
+      std::cerr << "Unknown argument " << key << "\n";
+      return 1;
+    }
+  }
+
+  const size_t cores = std::max(1u, std::thread::hardware_concurrency());
+  if (options.threads.empty()) {
+    options.threads = {1, 2, 4, 8, 16, cores};
+    options.threads.erase(std::remove_if(options.threads.begin(), options.threads.end(),
+                                         [cores](size_t threads) { return threads > cores; }),
+                          options.threads.end());
+    std::sort(options.threads.begin(), options.threads.end());
+    options.threads.erase(std::unique(options.threads.begin(), options.threads.end()), options.threads.end());
+  }
+
+  const AVCodecID codec_id = bench::ParseCodec(options.codec);
+  if (codec_id == AV_CODEC_ID_NONE) {
+    std::cerr << "Unknown codec " << options.codec << " (use vp8 or h264)\n";
+    return 1;
+  }
+  auto heavy = bench::EncodeSynthetic(codec_id, options.heavy_width, options.heavy_height, options.frames);
+  auto light = bench::EncodeSynthetic(codec_id, options.light_width, options.light_height, options.frames);
+  if (!heavy || !light) {
+    return 1;
+  }
+  std::cout << "Streams: " << options.codec << " 1 x " << options.heavy_width << "x" << options.heavy_height
+            << " + " << options.light << " x " << options.light_width << "x" << options.light_height << ", "
+            << options.frames << " frames each (encoder " << heavy->encoder << "), " << cores
+            << " cores, batch " << options.batch << ", budget " << options.budget_us << " us\n";
+
+  std::cout << std::left << std::setw(10) << "workers" << std::setw(10) << "fps" << std::setw(10) << "speedup"
+            << std::setw(12) << "light ms" << std::setw(12) << "heavy ms" << "stolen\n";
+  double base_fps = 0.0;
+  for (size_t threads : options.threads) {
+    Result result;
+    if (!Run(options, *heavy, *light, threads, &result)) {
+      std::cout << std::setw(10) << threads << "failed\n";
+      continue;
+    }
+    if (base_fps == 0.0) {
+      base_fps = result.fps / static_cast<double>(threads);
+    }
+    std::cout << std::left << std::setw(10) << threads << std::fixed << std::setprecision(1) << std::setw(10)
+              << result.fps << std::setprecision(2) << std::setw(10) << result.fps / base_fps
+              << std::setprecision(1) << std::setw(12) << result.light_ms << std::setw(12) << result.heavy_ms
+              << result.stolen << "\n";
+  }
+  return 0;
+}
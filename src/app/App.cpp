@@ -1,89 +1,140 @@
 #include "app/App.h"
 
+#include <algorithm>
+#include <string>
+
+#include "ingest/RtpReceiver.h"
 #include "util/Log.h"
 
 namespace app {
 
-App::App(util::Args args)
-    : args_(std::move(args)),
-      frame_writer_(args_.output_dir, args_.write_images, args_.write_video, args_.mp4_path, args_.fps) {}
+App::App(util::Args args) : args_(std::move(args)) {}
+
+// Build the list of streams to capture.
+// --streams wins; otherwise a single stream named "default" is built from
+// --rtp-url, --out and --mp4 so existing deployments behave as before.
+//
+// Param: streams - Receives the stream configs
+// Returns: false if the --streams file could not be loaded or was empty
+bool App::LoadStreams(std::vector<StreamConfig>* streams) const {
+  if (args_.streams_file.empty()) {
+    streams->push_back(StreamConfig{"default", args_.rtp_url, args_.output_dir, args_.mp4_path});
+    return true;
+  }
+  std::string error;
+  if (!LoadStreamConfig(args_.streams_file, args_.output_dir, streams, &error)) {
+    LOG_ERROR("Invalid stream config: " + error);
+    return false;
+  }
+  if (streams->empty()) {
+    LOG_ERROR("Stream config " + args_.streams_file + " defines no streams");
+    return false;
+  }
+  return true;
+}
 
 // Start the RTP capture service.
 //
-// This method sets up the complete capture pipeline:
+// 1. Load the stream list
 //
-// 1. Create RtpReceiver with a lambda callback
-//    - The callback receives BGR frames from the RTP stream
-//    - It forwards frames to FrameWriter for disk I/O
+// 2. Create the shared encode pool
+//    - Sized by --encode-threads, shared by every stream
+//    - Each stream may have max(2, 2 * threads / streams) frames on the
+//      pool, so the pool queue stays bounded and no stream can occupy
+//      all encoders
 //
-// 2. Start RTP receiver in a dedicated thread
-//    - The receiver_thread_ calls receiver_->Run() (blocking)
-//    - Run() loops until Stop() is called or stream ends
-//    - Each decoded frame invokes the callback
+// 3. Start each CaptureStream
+//    - See CaptureStream::Start() for the per-stream pipeline
 //
-// The frame flow:
-//   RTP (UDP) → FFmpeg decode → BGR Mat → callback → FrameWriter → disk
+// 4. Start the /metrics endpoint if --metrics-port is set
 //
 // Thread model:
 //   - Main thread: calls Start() and continues
-//   - receiver_thread_: blocks on receiver_->Run()
-//   - FrameWriter.OnFrame() runs on receiver_thread_
+//   - Per stream: one receiver thread, threads per sink (--writer-threads
+//     for images, see SinkRegistry)
+//   - encode_pool_: --encode-threads PNG encoders for all streams
+//   - --ingest reactor: reactor_ and decode_pool_ replace the per-stream
+//     receiver threads
 //
-// Returns: true (always; errors are logged)
-// Side effects:
-//   - Creates RtpReceiver and starts reception
-//   - Frames begin flowing through the pipeline
+// Returns: true if all streams were started, false on config errors
 bool App::Start() {
-  // Create RTP receiver with frame callback
-  // The lambda captures 'this' to call frame_writer_
-  receiver_ = std::make_unique<ingest::RtpReceiver>(args_.rtp_url, [this](const cv::Mat& frame) {
-    frame_writer_.OnFrame(frame);
-  });
+  std::vector<StreamConfig> configs;
+  if (!LoadStreams(&configs)) {
+    return false;
+  }
+
+  size_t max_in_flight = 0;
+  if (args_.encode_threads > 0 && args_.write_images) {
+    encode_pool_ = std::make_unique<util::ThreadPool>(args_.encode_threads);
+    max_in_flight = std::max<size_t>(2, 2 * args_.encode_threads / configs.size());
+  }
+
+  // An unknown --ingest value is warned about by each stream, which then
+  // uses its own receiver thread
+  ingest::IngestMode mode = ingest::IngestMode::kAvformat;
+  ingest::ParseIngestMode(args_.ingest, &mode);
+  if (mode == ingest::IngestMode::kReactor) {
+    util::SchedulerOptions decode_options;
+    decode_options.threads = args_.decode_pool_threads;
+    decode_options.cpus = args_.decode_pool_cpus;
+    decode_options.numa_node = args_.decode_pool_numa_node;
+    reactor_ = std::make_unique<ingest::Reactor>(args_.reactor_threads);
+    decode_pool_ = std::make_unique<util::Scheduler>(decode_options);
+    LOG_INFO("Reactor ingest: " + std::to_string(reactor_->threads()) + " I/O threads, " +
+             std::to_string(decode_pool_->size()) + " decode workers" +
+             (decode_pool_->cpus().empty() ? std::string() : " (pinned)"));
+  }
 
-  // Start receiver in dedicated thread
-  // Run() is blocking, so it needs its own thread
-  receiver_thread_ = std::thread([this]() {
-    if (!receiver_->Run()) {
-      LOG_ERROR("RTP receiver stopped with error");
-    }
-  });
+  for (auto& config : configs) {
+    streams_.push_back(std::make_unique<CaptureStream>(std::move(config), args_, encode_pool_.get(), max_in_flight,
+                                                       reactor_.get(), decode_pool_.get()));
+    streams_.back()->Start();
+  }
+  if (streams_.size() > 1) {
+    LOG_INFO("Capturing " + std::to_string(streams_.size()) + " streams");
+  }
 
+  // A metrics endpoint that cannot bind is logged but not fatal: capture
+  // matters more than observing it
+  if (args_.metrics_port > 0) {
+    metrics_server_.Start(args_.metrics_address, args_.metrics_port);
+  }
   return true;
 }
 
 // Stop the RTP capture service and cleanup.
 //
-// This method performs a graceful shutdown sequence:
+// 0. Stop serving /metrics
 //
-// 1. Signal RTP receiver to stop
-//    - receiver_->Stop() sets atomic flag
-//    - The Run() loop checks this flag and exits
+// 1. Signal every receiver first
+//    - RequestStop() only sets a flag, so all streams wind down in
+//      parallel instead of one after the other
 //
-// 2. Wait for receiver thread to finish
-//    - receiver_thread_.join() blocks until thread exits
-//    - This ensures all frames are processed before continuing
+// 2. Stop each stream
+//    - Joins its receiver, drains its queue, finalizes its video file and
+//      logs its counters (see CaptureStream::Stop())
 //
-// 3. Finalize frame writer
-//    - frame_writer_.Close() releases video file
-//    - Video file is invalid until Close() is called
+// 3. Destroy the shared pools (and the reactor) once no stream uses them
 //
 // Thread safety:
 //   - Stop() can be called from any thread (e.g., signal handler)
-//   - FrameWriter is thread-safe, so concurrent OnFrame() during Close() is OK
 //
 // Side effects:
 //   - Stops RTP packet reception
 //   - Waits for thread completion (blocking)
-//   - Finalizes video file on disk
-//   - Cleans up RTP receiver resources
+//   - Finalizes video files on disk
 void App::Stop() {
-  if (receiver_) {
-    receiver_->Stop();
+  metrics_server_.Stop();
+  for (auto& stream : streams_) {
+    stream->RequestStop();
   }
-  if (receiver_thread_.joinable()) {
-    receiver_thread_.join();
+  for (auto& stream : streams_) {
+    stream->Stop();
   }
-  frame_writer_.Close();
+  streams_.clear();
+  decode_pool_.reset();
+  reactor_.reset();
+  encode_pool_.reset();
 }
 
 }  // namespace app
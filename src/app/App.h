@@ -1,26 +1,38 @@
 #pragma once
 
 #include <memory>
-#include <thread>
+#include <vector>
 
-#include "ingest/RtpReceiver.h"
-#include "media/FrameWriter.h"
+#include "app/CaptureStream.h"
+#include "ingest/Reactor.h"
 #include "util/Args.h"
+#include "util/MetricsServer.h"
+#include "util/Scheduler.h"
+#include "util/ThreadPool.h"
 
 namespace app {
 
 // Application orchestrator for RTP capture service.
 //
-// This class coordinates the RTP receiver and frame writer to create
-// the complete capture pipeline. It's the main application component
-// managed by main.cpp.
+// This class creates one CaptureStream per RTP source and the resources
+// they share. It's the main application component managed by main.cpp.
 //
-// Architecture:
-//   Browser → Janus → RTP → RtpReceiver (FFmpeg) → BGR Mat
-//                                                  ↓
-//                                          FrameWriter (OpenCV)
-//                                                  ↓
-//                                          PNG frames + MP4/AVI video
+// Architecture (per stream):
+//   Browser → Janus → RTP → RtpReceiver (FFmpeg) → pooled frame
+//                                                  ↓ fan-out (--sinks)
+//                       ┌──────────────────────────┼───────────────────┐
+//                  shm (inline)        images (queue, threads)   video (queue)
+//                       ↓                          ↓                   ↓
+//              /dev/shm ring          FrameWriter → encode_pool_   Recorder
+//                                     (shared by all streams)         ↓
+//                                                  ↓              MP4/MKV
+//                                             PNG frames
+//
+// Streams:
+//   - Without --streams, a single stream is built from --rtp-url / --out
+//     / --mp4 (the original single-participant behaviour)
+//   - With --streams <file>, one stream per line of the file (see
+//     LoadStreamConfig()), each with its own output directory
 //
 // Lifecycle:
 //   1. Create App with Args configuration
@@ -28,8 +40,17 @@ namespace app {
 //   3. Call Stop() to gracefully shutdown
 //
 // Thread model:
-//   - RtpReceiver runs in a dedicated thread (blocking Run() call)
-//   - FrameWriter is called from the RTP receiver thread
+//   - Each stream has its own receiver thread and per-sink threads, so a
+//     stalled stream never blocks another one, and a slow sink never
+//     blocks the stream's other sinks (unless its policy is block)
+//   - PNG encoding for all streams runs on encode_pool_ (--encode-threads);
+//     each stream gets a fair share of in-flight slots
+//   - With --ingest reactor, streams have no receiver thread: reactor_
+//     (--reactor-threads) reads every socket and decode_pool_
+//     (--decode-pool-threads, work-stealing, optionally pinned with
+//     --decode-pool-cpus / --decode-pool-numa-node) decodes, one frame
+//     per stream at a time
+//   - One thread serves /metrics when --metrics-port is set
 //   - Stop() coordinates thread shutdown
 class App {
  public:
@@ -41,48 +62,54 @@ class App {
 
   // Start the RTP capture service.
   // This method:
-  //   1. Creates RtpReceiver with frame callback to FrameWriter
-  //   2. Starts RTP receiver in a dedicated thread
-  //   3. Returns immediately (non-blocking)
+  //   1. Builds the stream list (from --streams or the single-stream args)
+  //   2. Creates the shared encode pool
+  //   3. Starts every stream (receiver + sink threads)
+  //   4. Returns immediately (non-blocking)
   //
-  // Returns: true if started successfully, false otherwise
+  // Returns: true if started successfully, false if the stream config
+  //          could not be loaded
   // Side effects:
-  //   - Initializes RtpReceiver and FrameWriter
-  //   - Spawns receiver_thread_ for RTP reception
-  //   - Frames flow through: RTP → RtpReceiver → FrameWriter → disk
+  //   - Spawns receiver and sink threads for each stream
+  //   - Frames flow through: RTP → RtpReceiver → sink queues → sinks
   bool Start();
 
   // Stop the RTP capture service and cleanup.
   // This method:
-  //   1. Signals RtpReceiver to stop (thread-safe)
-  //   2. Waits for receiver thread to finish (join)
-  //   3. Closes FrameWriter to finalize video file
+  //   1. Signals every stream's receiver to stop (all at once)
+  //   2. Stops each stream: join, drain queue, close output, log counters
   //
-  // Important: Must be called to properly close video file.
+  // Important: Must be called to properly close video files.
   //            Video file is invalid until Close() is called.
   //
   // Thread-safe: can be called from any thread
   // Side effects:
   //   - Stops RTP reception
   //   - Waits for thread completion (blocking)
-  //   - Finalizes and closes video file
+  //   - Finalizes and closes video files
   void Stop();
 
  private:
+  // Build the stream list from args_. Returns false on config errors.
+  bool LoadStreams(std::vector<StreamConfig>* streams) const;
+
   // Configuration from command-line arguments
   util::Args args_;
 
-  // Frame writer: receives decoded frames and writes to disk
-  // Thread-safe: OnFrame() and Close() can be called concurrently
-  media::FrameWriter frame_writer_;
+  // PNG encode pool shared by all streams (null when --encode-threads 0).
+  // Declared before streams_ so it outlives every FrameWriter using it.
+  std::unique_ptr<util::ThreadPool> encode_pool_;
+
+  // Reactor ingest: I/O threads and decode workers shared by all streams
+  // (null otherwise). Declared before streams_ so they outlive them.
+  std::unique_ptr<ingest::Reactor> reactor_;
+  std::unique_ptr<util::Scheduler> decode_pool_;
 
-  // RTP receiver: receives packets, decodes to BGR Mat
-  // Runs in a dedicated thread; callback runs on that thread
-  std::unique_ptr<ingest::RtpReceiver> receiver_;
+  // One capture pipeline per RTP source
+  std::vector<std::unique_ptr<CaptureStream>> streams_;
 
-  // Thread running the RTP receiver
-  // Created in Start(), joined in Stop()
-  std::thread receiver_thread_;
+  // /metrics endpoint (only started with --metrics-port)
+  util::MetricsServer metrics_server_;
 };
 
 }  // namespace app
@@ -0,0 +1,238 @@
+#include "app/CaptureStream.h"
+
+#include <algorithm>
+#include <string>
+
+#include "app/SinkRegistry.h"
+#include "util/Log.h"
+
+namespace app {
+namespace {
+
+// "a, b, c" for log lines.
+std::string JoinNames(const std::vector<std::string>& names) {
+  std::string joined;
+  for (const std::string& name : names) {
+    joined += (joined.empty() ? "" : ", ") + name;
+  }
+  return joined;
+}
+
+}  // namespace
+
+// Build this stream's sinks (SelectSinks(), SinkRegistry). Unknown names
+// and sinks that fail to build are logged and skipped; the stream still
+// runs with the rest.
+CaptureStream::CaptureStream(StreamConfig config,
+                             const util::Args& args,
+                             util::ThreadPool* encode_pool,
+                             size_t max_in_flight,
+                             ingest::Reactor* reactor,
+                             util::Scheduler* decode_pool)
+    : config_(std::move(config)), args_(args), reactor_(reactor), decode_pool_(decode_pool) {
+  const SinkRegistry& registry = SinkRegistry::Instance();
+  const SinkContext context{config_, args, encode_pool, max_in_flight};
+  for (const std::string& name : SelectSinks(args)) {
+    if (!registry.Contains(name)) {
+      LOG_WARN(Tag("Unknown sink '" + name + "' in --sinks; known sinks are " + JoinNames(registry.Names())));
+      continue;
+    }
+    SinkExecutorOptions options;
+    std::unique_ptr<media::FrameSink> sink = registry.Create(name, context, &options);
+    if (!sink) {
+      LOG_ERROR(Tag("Sink '" + name + "' could not be created"));
+      continue;
+    }
+    const bool wants_packets = sink->WantsPackets();
+    sinks_.push_back(std::make_unique<SinkExecutor>(name, config_.name, std::move(sink), options));
+    if (wants_packets) {
+      packet_sinks_.push_back(sinks_.back().get());
+    }
+  }
+  std::stable_partition(sinks_.begin(), sinks_.end(),
+                        [](const std::unique_ptr<SinkExecutor>& sink) { return sink->inline_sink(); });
+  if (sinks_.empty()) {
+    LOG_WARN(Tag("No frame sinks; received frames are discarded"));
+  }
+}
+
+std::string CaptureStream::Tag(const std::string& message) const {
+  return "[" + config_.name + "] " + message;
+}
+
+uint32_t CaptureStream::RequiredFormats() const {
+  uint32_t formats = media::kFormatNone;
+  for (const auto& sink : sinks_) {
+    formats |= sink->sink().RequiredFormats();
+  }
+  return formats;
+}
+
+// Start the capture pipeline for this stream.
+//
+// 1. Start the sink executors
+//    - Each queued sink pops frames from its own queue on its own
+//      threads; Pop() blocks while the queue is empty, so idle sinks use
+//      no CPU
+//
+// 2. Create RtpReceiver with a lambda callback
+//    - The callback receives pooled frames from the RTP stream
+//    - It hands each frame to every sink: inline sinks (shared memory)
+//      run right there, queued sinks get a reference (no pixel copy) and
+//      their overflow policy decides what happens when they fall behind
+//    - Compressed packets go to the sinks that want them (stream copy)
+//    - Output formats are negotiated from the sinks' RequiredFormats(),
+//      so BGR conversion is skipped when nothing consumes it, and
+//      decoding when the recorder stream-copies and no other sink needs
+//      frames
+//
+// 3. Start RTP receiver in a dedicated thread
+//    - Run() loops until Stop() is called or stream ends
+//    - A failing receiver only ends this stream; others keep running
+//    - With --ingest reactor, attach it to the shared reactor instead; no
+//      thread is started
+//
+// 4. Register a metrics collector for the frame pool counters (each
+//    executor exports its own queue counters)
+//
+// Returns: true (always; errors are logged)
+bool CaptureStream::Start() {
+  // Start sink threads before the receiver so the queues are drained
+  // from the first frame on
+  for (auto& sink : sinks_) {
+    sink->Start();
+  }
+
+  // Receiver tuning from command-line arguments
+  ingest::ReceiverOptions receiver_options;
+  receiver_options.name = config_.name;
+  receiver_options.convert.threads = args_.convert_threads;
+  if (!media::ParseScaleAlgorithm(args_.sws_flags, &receiver_options.convert.algorithm)) {
+    LOG_WARN("Unknown --sws-flags value '" + args_.sws_flags + "', using bilinear");
+  }
+  if (!args_.resize.empty() && !media::ParseOutputSize(args_.resize, &receiver_options.convert.size)) {
+    LOG_WARN("Invalid --resize value '" + args_.resize + "', keeping the decoded size");
+  }
+  if (!args_.crop.empty() && !media::ParseCropRect(args_.crop, &receiver_options.convert.crop)) {
+    LOG_WARN("Invalid --crop value '" + args_.crop + "', converting the whole frame");
+  }
+  receiver_options.decode.threads = args_.decode_threads;
+  receiver_options.decode.low_delay = args_.low_delay;
+  receiver_options.decode.keyframes_only = args_.decode_keyframes_only;
+  receiver_options.decode.keyframe_interval_ms = args_.decode_keyframe_interval_ms;
+  if (!ingest::ParseDecodeThreading(args_.decode_thread_type, &receiver_options.decode.threading)) {
+    LOG_WARN("Unknown --decode-thread-type value '" + args_.decode_thread_type + "', using auto");
+  }
+  if (!ingest::ParseIngestMode(args_.ingest, &receiver_options.ingest)) {
+    LOG_WARN("Unknown --ingest value '" + args_.ingest + "', using avformat");
+  }
+  receiver_options.jitter.depth = args_.jitter_depth;
+  receiver_options.jitter.max_delay_ms = args_.jitter_delay_ms;
+  receiver_options.udp.batch_size = args_.udp_batch;
+  receiver_options.udp.receive_buffer_bytes = args_.udp_buffer;
+  receiver_options.reconnect.enabled = args_.reconnect;
+  receiver_options.reconnect.read_timeout_ms = args_.read_timeout_ms;
+
+  // Create RTP receiver with frame callback
+  // The lambda captures 'this' to fan frames out to the sinks
+  receiver_ = std::make_unique<ingest::RtpReceiver>(
+      config_.rtp_url,
+      [this](const media::FrameRef& frame) {
+        for (auto& sink : sinks_) {
+          sink->Submit(frame);
+        }
+      },
+      receiver_options);
+
+  // Negotiate pixel formats: the receiver only converts to BGR if a sink
+  // will use it, and stops decoding altogether when the recorder
+  // stream-copies and nothing else needs frames. Packets go through the
+  // sink's queue like frames (muxing stays off this thread); the recorder
+  // decides once its thread sees the first packet, so formats are
+  // renegotiated from the packet callback until the decision shows.
+  if (!packet_sinks_.empty()) {
+    receiver_->SetPacketCallback([this](const ingest::EncodedPacket& packet) {
+      for (SinkExecutor* sink : packet_sinks_) {
+        sink->SubmitPacket(packet.packet, packet.codecpar, packet.time_base);
+      }
+      receiver_->SetOutputFormats(RequiredFormats());
+    });
+  }
+  receiver_->SetOutputFormats(RequiredFormats());
+
+  // Pool counters are kept under their own lock; copy them into the
+  // registry only when metrics are scraped
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string labels = util::MetricLabel("stream", config_.name);
+  util::Gauge* outstanding = metrics.GetGauge(
+      "capture_frames_outstanding", "Decoded frames held by sink queues, sinks or encoders", labels);
+  metrics_collector_ = metrics.AddCollector([this, outstanding]() {
+    outstanding->Set(static_cast<int64_t>(receiver_->frame_pool().GetStats().outstanding));
+  });
+
+  if (receiver_options.ingest == ingest::IngestMode::kReactor && reactor_ && decode_pool_) {
+    attached_ = receiver_->Attach(reactor_, decode_pool_);
+    if (!attached_) {
+      LOG_ERROR(Tag("RTP receiver could not be attached to the reactor"));
+    }
+  } else {
+    // Start receiver in dedicated thread
+    // Run() is blocking, so it needs its own thread
+    receiver_thread_ = std::thread([this]() {
+      if (!receiver_->Run()) {
+        LOG_ERROR(Tag("RTP receiver stopped with error"));
+      }
+    });
+  }
+
+  std::vector<std::string> names;
+  for (const auto& sink : sinks_) {
+    names.push_back(sink->name());
+  }
+  LOG_INFO(Tag("Capturing " + config_.rtp_url + " to " + config_.output_dir + " (sinks: " + JoinNames(names) + ")"));
+  return true;
+}
+
+// Signal the receiver to stop; returns immediately.
+void CaptureStream::RequestStop() {
+  if (receiver_) {
+    receiver_->Stop();
+  }
+}
+
+// Stop this stream and cleanup.
+//
+// 0. Unregister the metrics collector (it reads the receiver)
+// 1. Signal the receiver and join its thread (or detach it from the
+//    reactor, which waits for the frame being decoded)
+// 2. Stop every sink executor: its queue is drained, then the sink is
+//    closed (FrameWriter waits for this stream's encode jobs, the
+//    recorder finalizes the video file, the shared-memory ring is closed)
+//    and the queue counters are logged
+// 3. Report frame pool counters
+void CaptureStream::Stop() {
+  if (metrics_collector_) {
+    util::Metrics::Instance().RemoveCollector(metrics_collector_);
+    metrics_collector_ = 0;
+  }
+  RequestStop();
+  if (receiver_thread_.joinable()) {
+    receiver_thread_.join();
+  }
+  if (attached_) {
+    receiver_->Detach();
+    attached_ = false;
+  }
+  for (auto& sink : sinks_) {
+    sink->Stop();
+  }
+
+  if (receiver_) {
+    media::FramePoolStats pool = receiver_->frame_pool().GetStats();
+    LOG_INFO(Tag("Frame pool: acquired=" + std::to_string(pool.acquired) +
+                 " allocations=" + std::to_string(pool.allocations) +
+                 " high_water=" + std::to_string(pool.high_water)));
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "app/SinkExecutor.h"
+#include "app/StreamConfig.h"
+#include "ingest/Reactor.h"
+#include "ingest/RtpReceiver.h"
+#include "media/FramePool.h"
+#include "util/Args.h"
+#include "util/Metrics.h"
+#include "util/Scheduler.h"
+#include "util/ThreadPool.h"
+
+namespace app {
+
+// Capture pipeline for a single RTP stream.
+//
+// Each stream owns everything on its path from socket to disk, so a
+// stalled or broken stream cannot block another one:
+//
+//   RtpReceiver (own thread, ─┬→ SinkExecutor "shm"    (inline)  → ShmPublisher
+//     or shared reactor +     ├→ SinkExecutor "images" (queue, threads)
+//     decode pool)            │      → FrameGate → FrameWriter → shared encode pool
+//                             └→ SinkExecutor "video"  (queue, thread) → Recorder
+//   RtpReceiver packet callback → sinks wanting packets (Recorder stream copy)
+//
+// Sinks are chosen with --sinks and built by SinkRegistry; each has its
+// own queue, threads and overflow policy, so a slow sink (PNG) drops or
+// delays only its own frames. The only shared resource is the encode
+// pool, and each FrameWriter may only have a bounded number of frames on
+// it (see FrameWriterOptions::max_in_flight). With --ingest reactor the
+// I/O threads and decode pool are shared too; a stream's decode backlog
+// is bounded the same way (see RtpReceiver::Attach()).
+//
+// Lifecycle:
+//   1. Construct with the stream config, global args and the shared pool;
+//      the sinks are created here
+//   2. Start() spawns the sink threads and the receiver thread (or, with
+//      --ingest reactor, attaches the receiver to the shared reactor)
+//   3. RequestStop() signals the receiver (non-blocking), so all streams
+//      can be told to stop before any of them is joined
+//   4. Stop() joins, drains, closes output and logs counters
+class CaptureStream {
+ public:
+  // Param: config - Stream source and output locations
+  // Param: args - Global tuning options (queue, decoder, conversion, ...)
+  // Param: encode_pool - Shared PNG encode pool, or nullptr to encode inline
+  // Param: max_in_flight - This stream's limit on the shared pool (0 = 2 x pool size)
+  // Param: reactor - Shared I/O threads for --ingest reactor, else nullptr
+  // Param: decode_pool - Shared decode workers for --ingest reactor, else nullptr
+  CaptureStream(StreamConfig config,
+                const util::Args& args,
+                util::ThreadPool* encode_pool,
+                size_t max_in_flight,
+                ingest::Reactor* reactor = nullptr,
+                util::Scheduler* decode_pool = nullptr);
+
+  CaptureStream(const CaptureStream&) = delete;
+  CaptureStream& operator=(const CaptureStream&) = delete;
+
+  // Start sink threads and the receiver thread (or reactor attachment).
+  // Returns: true (errors surface asynchronously in the logs)
+  bool Start();
+
+  // Ask the receiver to stop without waiting for it.
+  void RequestStop();
+
+  // Stop the receiver, drain the sink queues, finalize output, log counters.
+  // Blocking; safe to call after RequestStop().
+  void Stop();
+
+  const std::string& name() const { return config_.name; }
+
+ private:
+  // Prefix log lines with the stream name.
+  std::string Tag(const std::string& message) const;
+
+  // Pixel formats the receiver must produce for all of this stream's sinks.
+  uint32_t RequiredFormats() const;
+
+  StreamConfig config_;
+  const util::Args& args_;
+
+  // One executor per sink, inline sinks first so they see each frame
+  // before the receiver can block on a full queue
+  std::vector<std::unique_ptr<SinkExecutor>> sinks_;
+
+  // The sinks that want compressed packets (owned by sinks_)
+  std::vector<SinkExecutor*> packet_sinks_;
+
+  // Reactor ingest: shared I/O threads and decode workers (not owned;
+  // nullptr otherwise)
+  ingest::Reactor* reactor_;
+  util::Scheduler* decode_pool_;
+
+  // RTP receiver: receives packets, decodes to pooled frames
+  // Runs in a dedicated thread; callback runs on that thread (reactor
+  // ingest: on the decode pool, one frame of this stream at a time)
+  std::unique_ptr<ingest::RtpReceiver> receiver_;
+
+  // Thread running the RTP receiver (not started with a reactor)
+  std::thread receiver_thread_;
+
+  // Whether receiver_ is attached to reactor_ instead
+  bool attached_ = false;
+
+  // util::Metrics collector publishing frame pool stats (0 = none)
+  uint64_t metrics_collector_ = 0;
+};
+
+}  // namespace app
@@ -0,0 +1,153 @@
+#include "app/SinkExecutor.h"
+
+#include <algorithm>
+#include <cstring>
+#include <utility>
+
+#include "util/Log.h"
+#include "util/Metrics.h"
+
+namespace app {
+
+namespace {
+
+// Whether two sets of stream parameters describe the same stream, as far
+// as a sink can tell (codec, geometry, pixel format, extradata).
+bool SameParameters(const AVCodecParameters& a, const AVCodecParameters& b) {
+  return a.codec_id == b.codec_id && a.width == b.width && a.height == b.height && a.format == b.format &&
+         a.extradata_size == b.extradata_size &&
+         (a.extradata_size == 0 || std::memcmp(a.extradata, b.extradata, a.extradata_size) == 0);
+}
+
+}  // namespace
+
+SinkExecutor::SinkExecutor(std::string name, std::string stream, std::unique_ptr<media::FrameSink> sink,
+                           SinkExecutorOptions options)
+    : name_(std::move(name)),
+      stream_(std::move(stream)),
+      sink_(std::move(sink)),
+      options_(options),
+      // Inline sinks never queue; keep their (unused) queue minimal
+      queue_(options.threads == 0 ? 1 : std::max<size_t>(options.queue_size, 1), options.policy) {}
+
+SinkExecutor::~SinkExecutor() {
+  Stop();
+}
+
+// Start the sink's threads (none when inline) and register a collector
+// copying the queue counters into util::Metrics on scrape.
+//
+// Each thread pops frames and packets until the queue is closed and
+// drained; Pop() blocks while the queue is empty, so an idle sink uses no
+// CPU.
+void SinkExecutor::Start() {
+  for (size_t i = 0; i < options_.threads; ++i) {
+    threads_.emplace_back([this]() {
+      SinkItem item;
+      while (queue_.Pop(item)) {
+        if (item.packet) {
+          const SinkPacket& packet = *item.packet;
+          sink_->OnPacket(packet.packet, packet.codecpar.get(), packet.time_base);
+        } else {
+          sink_->OnFrame(item.frame);
+        }
+        item = SinkItem();
+      }
+    });
+  }
+  if (inline_sink()) {
+    return;
+  }
+
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string labels = util::MetricLabel("stream", stream_) + "," + util::MetricLabel("sink", name_);
+  util::Gauge* depth = metrics.GetGauge("capture_queue_depth", "Frames and packets waiting for a sink", labels);
+  util::Counter* dropped = metrics.GetCounter("capture_queue_dropped_total",
+                                              "Frames and packets dropped by a sink queue's overflow policy", labels);
+  metrics_collector_ = metrics.AddCollector([this, depth, dropped]() {
+    const util::QueueStats stats = queue_.GetStats();
+    depth->Set(static_cast<int64_t>(stats.depth));
+    dropped->Set(stats.dropped_oldest + stats.dropped_newest);
+  });
+}
+
+void SinkExecutor::Submit(const media::FrameRef& frame) {
+  if (inline_sink()) {
+    sink_->OnFrame(frame);
+  } else {
+    queue_.Push(SinkItem{frame, nullptr});
+  }
+}
+
+// Queue a packet for the sink's threads.
+//
+// The packet gets a new reference (av_packet_ref() shares the refcounted
+// data, so nothing is copied for the demuxer's and depacketizer's
+// packets). Stream parameters change rarely, so they are copied only
+// when they differ from the previous packet's and shared otherwise.
+//
+// Side effects: logs and discards the packet if a copy cannot be made
+void SinkExecutor::SubmitPacket(const AVPacket* packet, const AVCodecParameters* codecpar, AVRational time_base) {
+  if (inline_sink()) {
+    sink_->OnPacket(packet, codecpar, time_base);
+    return;
+  }
+
+  if (!codecpar_ || !SameParameters(*codecpar_, *codecpar)) {
+    std::shared_ptr<AVCodecParameters> copy(avcodec_parameters_alloc(), [](AVCodecParameters* parameters) {
+      avcodec_parameters_free(&parameters);
+    });
+    if (!copy || avcodec_parameters_copy(copy.get(), codecpar) < 0) {
+      LOG_WARN("[" + stream_ + "] Sink " + name_ + ": cannot copy stream parameters, packet discarded");
+      return;
+    }
+    codecpar_ = std::move(copy);
+  }
+
+  auto queued = std::make_unique<SinkPacket>();
+  queued->packet = av_packet_alloc();
+  if (!queued->packet || av_packet_ref(queued->packet, packet) < 0) {
+    LOG_WARN("[" + stream_ + "] Sink " + name_ + ": cannot reference packet, packet discarded");
+    return;
+  }
+  queued->codecpar = codecpar_;
+  queued->time_base = time_base;
+  queue_.Push(SinkItem{media::FrameRef(), std::move(queued)});
+}
+
+// Drain and close the sink.
+//
+// 1. Unregister the metrics collector (it reads the queue)
+// 2. Close the queue; threads finish what is queued and exit
+// 3. Close the sink (flushes encoders, finalizes files)
+// 4. Log the queue counters of queued sinks
+void SinkExecutor::Stop() {
+  if (stopped_) {
+    return;
+  }
+  stopped_ = true;
+  if (metrics_collector_) {
+    util::Metrics::Instance().RemoveCollector(metrics_collector_);
+    metrics_collector_ = 0;
+  }
+  queue_.Close();
+  for (auto& thread : threads_) {
+    if (thread.joinable()) {
+      thread.join();
+    }
+  }
+  threads_.clear();
+  sink_->Close();
+
+  if (!inline_sink()) {
+    const util::QueueStats stats = queue_.GetStats();
+    LOG_INFO("[" + stream_ + "] Sink " + name_ + " queue: pushed=" + std::to_string(stats.pushed) +
+             " consumed=" + std::to_string(stats.popped) +
+             " dropped_oldest=" + std::to_string(stats.dropped_oldest) +
+             " dropped_newest=" + std::to_string(stats.dropped_newest) +
+             " high_water=" + std::to_string(stats.high_water) + "/" + std::to_string(queue_.capacity()) +
+             " policy=" + util::ToString(queue_.policy()));
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,124 @@
+#pragma once
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "media/FrameSink.h"
+#include "util/BoundedQueue.h"
+
+namespace app {
+
+// How a sink is fed, see SinkExecutor.
+struct SinkExecutorOptions {
+  // Threads calling the sink; 0 runs it inline on the receiver thread
+  // (for sinks that are cheaper than a queue hop, e.g. shared memory)
+  size_t threads = 1;
+
+  // Frames queued ahead of the sink
+  size_t queue_size = 64;
+
+  // What happens when the queue is full. kBlock makes the receiver (and
+  // so every other sink of the stream) wait for this one.
+  util::OverflowPolicy policy = util::OverflowPolicy::kDropOldest;
+};
+
+// A compressed packet queued for a sink: a new reference to the packet
+// data and a snapshot of the stream parameters it was received with.
+struct SinkPacket {
+  SinkPacket() = default;
+  ~SinkPacket() { av_packet_free(&packet); }
+  SinkPacket(const SinkPacket&) = delete;
+  SinkPacket& operator=(const SinkPacket&) = delete;
+
+  AVPacket* packet = nullptr;
+  std::shared_ptr<const AVCodecParameters> codecpar;  // Shared by packets until it changes
+  AVRational time_base{1, 90000};
+};
+
+// One item of a sink's queue: a frame, or a packet (frame unset).
+struct SinkItem {
+  media::FrameRef frame;
+  std::unique_ptr<SinkPacket> packet;
+};
+
+// Runs one media::FrameSink: a bounded queue of frame references drained
+// by its own threads, so a slow sink (PNG encoding) never delays a fast
+// one (shared memory, muxer) of the same stream.
+//
+// Submit() only bumps a reference count and queues it; no pixels are
+// copied. SubmitPacket() queues compressed packets the same way (a new
+// reference to the packet data), in order with the frames, so a muxing
+// sink does its disk I/O on its own thread rather than the receiver's or
+// a decode worker's. The overflow policy decides, per sink, whether a full queue
+// drops the oldest frame, the new one, or blocks the receiver.
+//
+// A packet dropped by the overflow policy damages a stream-copied
+// recording up to the next keyframe; use the kBlock policy for the sink
+// when the recording must be complete.
+//
+// Metrics (util::Metrics, labels stream="<stream>",sink="<name>"):
+//   capture_queue_depth          - frames and packets waiting in this sink's queue
+//   capture_queue_dropped_total  - frames and packets dropped by the overflow policy
+//
+// Thread-safe: Submit() and SubmitPacket() from the receiver thread;
+// Start() and Stop() from the owning stream.
+class SinkExecutor {
+ public:
+  // Param: name - Sink name (registry name), used in logs and metrics
+  // Param: stream - Stream name, used in logs and metrics
+  // Param: sink - The sink to run
+  // Param: options - Threads, queue size and overflow policy
+  SinkExecutor(std::string name, std::string stream, std::unique_ptr<media::FrameSink> sink,
+               SinkExecutorOptions options);
+
+  // Stops (see Stop()).
+  ~SinkExecutor();
+
+  SinkExecutor(const SinkExecutor&) = delete;
+  SinkExecutor& operator=(const SinkExecutor&) = delete;
+
+  // Start the threads and the metrics collector.
+  void Start();
+
+  // Hand a frame to the sink: inline, or through the queue.
+  void Submit(const media::FrameRef& frame);
+
+  // Hand a compressed packet to the sink: inline, or copied into the queue.
+  //
+  // Param: packet, codecpar, time_base - As for media::FrameSink::OnPacket()
+  void SubmitPacket(const AVPacket* packet, const AVCodecParameters* codecpar, AVRational time_base);
+
+  // Close the queue, let the threads drain it, close the sink and log the
+  // queue counters. Safe to call more than once.
+  void Stop();
+
+  const std::string& name() const { return name_; }
+  bool inline_sink() const { return options_.threads == 0; }
+  media::FrameSink& sink() { return *sink_; }
+  const media::FrameSink& sink() const { return *sink_; }
+
+  util::QueueStats GetStats() const { return queue_.GetStats(); }
+
+ private:
+  std::string name_;
+  std::string stream_;
+  std::unique_ptr<media::FrameSink> sink_;
+  SinkExecutorOptions options_;
+  util::BoundedQueue<SinkItem> queue_;
+
+  // Last stream parameters queued with a packet (receiver thread only)
+  std::shared_ptr<const AVCodecParameters> codecpar_;
+  std::vector<std::thread> threads_;
+  uint64_t metrics_collector_ = 0;
+  bool stopped_ = false;
+};
+
+}  // namespace app
@@ -0,0 +1,352 @@
+#include "app/SinkRegistry.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <sstream>
+#include <utility>
+
+extern "C" {
+#include <libavutil/rational.h>
+}
+
+#include "media/FrameGate.h"
+#include "media/FrameWriter.h"
+#include "media/Recorder.h"
+#include "media/ShmPublisher.h"
+#include "util/Log.h"
+
+namespace app {
+namespace {
+
+// Parse --record, warning once per stream on an unknown value.
+media::RecordMode ParseRecordArg(const util::Args& args) {
+  media::RecordMode mode = media::RecordMode::kAuto;
+  if (!media::ParseRecordMode(args.record_mode, &mode)) {
+    LOG_WARN("Unknown --record value '" + args.record_mode + "', using auto");
+  }
+  return mode;
+}
+
+// Image encoder settings from --image-format, --image-quality and
+// --png-compression, warning once per stream on an unknown format.
+media::ImageEncoderOptions ImageOptions(const util::Args& args) {
+  media::ImageEncoderOptions options;
+  if (!media::ParseImageFormat(args.image_format, &options.format)) {
+    LOG_WARN("Unknown --image-format value '" + args.image_format + "', using png");
+  }
+  options.quality = args.image_quality;
+  options.png_compression = args.png_compression;
+  return options;
+}
+
+// --image-output: true for spool, warning once per stream on an unknown value.
+bool SpoolArg(const util::Args& args) {
+  if (args.image_output != "files" && args.image_output != "spool") {
+    LOG_WARN("Unknown --image-output value '" + args.image_output + "', using files");
+  }
+  return args.image_output == "spool";
+}
+
+// Image file output settings from the --file-* arguments, warning once per
+// stream on an unknown backend.
+util::FileOutputOptions FileOptions(const util::Args& args, const std::string& name) {
+  util::FileOutputOptions options;
+  if (!util::ParseFileBackend(args.file_output, &options.backend)) {
+    LOG_WARN("Unknown --file-output value '" + args.file_output + "', using sync");
+  }
+  options.queue_depth = args.file_output_depth;
+  options.threads = args.file_output_threads;
+  options.fsync = args.file_fsync;
+  options.name = name;
+  return options;
+}
+
+// Frame gate settings from the --frame-* arguments.
+media::FrameGateOptions GateOptions(const util::Args& args, const std::string& name) {
+  media::FrameGateOptions options;
+  options.keyframes_only = args.frame_keyframes_only;
+  options.every_n = args.frame_every;
+  options.max_fps = args.frame_max_fps;
+  options.scene_threshold = args.frame_scene_threshold;
+  options.name = name;
+  return options;
+}
+
+// Shared-memory publisher settings from the --shm-* arguments, warning
+// once per stream on an unknown format. With --streams the stream name is
+// appended, so every stream gets its own ring.
+media::ShmPublisherOptions ShmOptions(const util::Args& args, const std::string& name) {
+  media::ShmPublisherOptions options;
+  const std::string base = args.shm_publish.empty() ? options.name : args.shm_publish;
+  options.name = args.streams_file.empty() ? base : base + "-" + name;
+  options.slots = args.shm_slots;
+  if (args.shm_format != "bgr" && args.shm_format != "native") {
+    LOG_WARN("Unknown --shm-format value '" + args.shm_format + "', using bgr");
+  }
+  options.format = args.shm_format == "native" ? media::kFormatNative : media::kFormatBgr;
+  options.stream = name;
+  return options;
+}
+
+// FrameWriter settings for images or opencv video of one stream; the
+// image settings are only parsed (and warned about) for images.
+media::FrameWriterOptions WriterOptions(const SinkContext& context, bool images, bool video) {
+  const util::Args& args = context.args;
+  media::FrameWriterOptions options;
+  options.output_dir = context.config.output_dir;
+  options.write_images = images;
+  options.write_video = video;
+  options.mp4_path = context.config.mp4_path;
+  options.mp4_fps = args.fps;
+  options.ordered_writes = args.ordered_writes;
+  options.name = context.config.name;
+  if (images) {
+    options.shared_pool = context.encode_pool;
+    options.max_in_flight = context.max_in_flight;
+    options.image = ImageOptions(args);
+    options.spool_images = SpoolArg(args);
+    options.files = FileOptions(args, context.config.name);
+  }
+  options.spool_segment_bytes = static_cast<uint64_t>(args.spool_segment_mb) << 20;
+  return options;
+}
+
+// FrameWriter behind a FrameGate: the images sink, and (with a disabled
+// gate) the opencv video sink.
+class WriterSink : public media::FrameSink {
+ public:
+  WriterSink(media::FrameWriterOptions writer, media::FrameGateOptions gate, std::string stream)
+      : gate_(std::move(gate)), writer_(std::move(writer)), stream_(std::move(stream)) {}
+
+  uint32_t RequiredFormats() const override { return writer_.RequiredFormats(); }
+
+  void OnFrame(const media::FrameRef& frame) override {
+    if (gate_.Accept(*frame)) {
+      writer_.OnFrame(frame);
+    }
+  }
+
+  // Close the writer (waits for this stream's encode jobs) and report the
+  // gate counters.
+  void Close() override {
+    writer_.Close();
+    if (gate_.enabled()) {
+      const media::FrameGateStats gate = gate_.GetStats();
+      LOG_INFO("[" + stream_ + "] Frame gate: seen=" + std::to_string(gate.seen) +
+               " kept=" + std::to_string(gate.kept) +
+               " skipped_keyframe=" + std::to_string(gate.skipped_keyframe) +
+               " skipped_every_n=" + std::to_string(gate.skipped_every_n) +
+               " skipped_fps=" + std::to_string(gate.skipped_fps) +
+               " skipped_unchanged=" + std::to_string(gate.skipped_unchanged));
+    }
+  }
+
+ private:
+  media::FrameGate gate_;
+  media::FrameWriter writer_;
+  std::string stream_;
+};
+
+// libavformat recording: stream copy from packets, or transcoding of frames.
+class RecorderSink : public media::FrameSink {
+ public:
+  explicit RecorderSink(const media::RecorderOptions& options) : recorder_(options) {}
+
+  uint32_t RequiredFormats() const override { return recorder_.RequiredFormats(); }
+  void OnFrame(const media::FrameRef& frame) override { recorder_.OnFrame(frame); }
+  bool WantsPackets() const override { return true; }
+  void OnPacket(const AVPacket* packet, const AVCodecParameters* codecpar, const AVRational& time_base) override {
+    recorder_.OnPacket(packet, codecpar, time_base);
+  }
+  void Close() override { recorder_.Close(); }
+
+ private:
+  media::Recorder recorder_;
+};
+
+// Shared-memory ring. ShmPublisher expects one thread; the mutex only
+// matters if the sink is given several threads with --sink-option. Close()
+// destroys the publisher, so consumers see the ring closed when the
+// stream stops.
+class ShmSink : public media::FrameSink {
+ public:
+  explicit ShmSink(media::ShmPublisherOptions options)
+      : publisher_(std::make_unique<media::ShmPublisher>(std::move(options))),
+        formats_(publisher_->RequiredFormats()) {}
+
+  uint32_t RequiredFormats() const override { return formats_; }
+
+  void OnFrame(const media::FrameRef& frame) override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (publisher_) {
+      publisher_->OnFrame(*frame);
+    }
+  }
+
+  void Close() override {
+    std::lock_guard<std::mutex> lock(mutex_);
+    publisher_.reset();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::unique_ptr<media::ShmPublisher> publisher_;
+  const uint32_t formats_;
+};
+
+SinkExecutorOptions QueueDefaults(const util::Args& args, size_t threads) {
+  SinkExecutorOptions options;
+  options.threads = threads;
+  options.queue_size = args.queue_size;
+  options.policy = args.queue_policy;
+  return options;
+}
+
+}  // namespace
+
+// Register the built-in sinks (see class comment).
+SinkRegistry::SinkRegistry() {
+  Register("images", SinkRegistration{
+      [](const SinkContext& context) -> std::unique_ptr<media::FrameSink> {
+        return std::make_unique<WriterSink>(WriterOptions(context, true, false),
+                                            GateOptions(context.args, context.config.name), context.config.name);
+      },
+      [](const util::Args& args) { return QueueDefaults(args, args.writer_threads); },
+      "image files or spool (--image-*, --frame-*)"});
+
+  Register("video", SinkRegistration{
+      [](const SinkContext& context) -> std::unique_ptr<media::FrameSink> {
+        const util::Args& args = context.args;
+        const media::RecordMode mode = ParseRecordArg(args);
+        if (args.decode_keyframes_only && mode != media::RecordMode::kCopy) {
+          LOG_WARN("[" + context.config.name +
+                   "] --decode-keyframes-only: a transcoded or opencv recording only contains keyframes");
+        }
+        if (mode == media::RecordMode::kOpenCv) {
+          // Video only, every frame: the images sink has its own writer
+          media::FrameGateOptions no_gate;
+          no_gate.name = context.config.name;
+          return std::make_unique<WriterSink>(WriterOptions(context, false, true), no_gate, context.config.name);
+        }
+        media::RecorderOptions options;
+        options.path = context.config.mp4_path;
+        options.mode = mode;
+        options.encoder = args.record_encoder;
+        options.bit_rate = args.record_bitrate;
+        options.fps = args.fps;
+        options.name = context.config.name;
+        return std::make_unique<RecorderSink>(options);
+      },
+      [](const util::Args& args) { return QueueDefaults(args, 1); },
+      "video recording (--record, --mp4)"});
+
+  Register("shm", SinkRegistration{
+      [](const SinkContext& context) -> std::unique_ptr<media::FrameSink> {
+        return std::make_unique<ShmSink>(ShmOptions(context.args, context.config.name));
+      },
+      [](const util::Args& args) { return QueueDefaults(args, 0); },
+      "shared-memory ring for local consumers (--shm-*)"});
+}
+
+SinkRegistry& SinkRegistry::Instance() {
+  static SinkRegistry registry;
+  return registry;
+}
+
+void SinkRegistry::Register(const std::string& name, SinkRegistration registration) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  sinks_[name] = std::move(registration);
+}
+
+std::unique_ptr<media::FrameSink> SinkRegistry::Create(const std::string& name, const SinkContext& context,
+                                                       SinkExecutorOptions* options) const {
+  SinkRegistration registration;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = sinks_.find(name);
+    if (it == sinks_.end()) {
+      return nullptr;
+    }
+    registration = it->second;
+  }
+  *options = registration.defaults ? registration.defaults(context.args) : SinkExecutorOptions();
+  ApplySinkOptions(context.args, name, options);
+  return registration.create(context);
+}
+
+bool SinkRegistry::Contains(const std::string& name) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return sinks_.count(name) > 0;
+}
+
+std::vector<std::string> SinkRegistry::Names() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<std::string> names;
+  for (const auto& entry : sinks_) {
+    names.push_back(entry.first);
+  }
+  return names;
+}
+
+std::vector<std::string> SelectSinks(const util::Args& args) {
+  std::vector<std::string> names;
+  if (args.sinks.empty()) {
+    if (args.write_images) {
+      names.push_back("images");
+    }
+    if (args.write_video) {
+      names.push_back("video");
+    }
+    if (!args.shm_publish.empty()) {
+      names.push_back("shm");
+    }
+    return names;
+  }
+  std::stringstream list(args.sinks);
+  std::string name;
+  while (std::getline(list, name, ',')) {
+    name.erase(0, name.find_first_not_of(" \t"));
+    name.erase(name.find_last_not_of(" \t") + 1);
+    if (!name.empty() && std::find(names.begin(), names.end(), name) == names.end()) {
+      names.push_back(name);
+    }
+  }
+  return names;
+}
+
+// Entries look like "images.threads=4" or "video.policy=block". The video
+// sink is limited to one thread.
+void ApplySinkOptions(const util::Args& args, const std::string& sink, SinkExecutorOptions* options) {
+  for (const std::string& entry : args.sink_options) {
+    const size_t dot = entry.find('.');
+    const size_t equals = entry.find('=', dot == std::string::npos ? 0 : dot);
+    if (dot == std::string::npos || equals == std::string::npos) {
+      LOG_WARN("Ignoring --sink-option '" + entry + "' (expected <sink>.<key>=<value>)");
+      continue;
+    }
+    if (entry.compare(0, dot, sink) != 0 || dot != sink.size()) {
+      continue;
+    }
+    const std::string key = entry.substr(dot + 1, equals - dot - 1);
+    const std::string value = entry.substr(equals + 1);
+    if (key == "queue") {
+      options->queue_size = static_cast<size_t>(std::max(1, std::atoi(value.c_str())));
+    } else if (key == "threads") {
+      options->threads = static_cast<size_t>(std::max(0, std::atoi(value.c_str())));
+      if (sink == "video" && options->threads > 1) {
+        // The muxer needs frames and packets in order; a second thread
+        // would hand them over out of order and the Recorder drops those
+        LOG_WARN("Ignoring --sink-option '" + entry + "': the video sink runs on one thread");
+        options->threads = 1;
+      }
+    } else if (key == "policy") {
+      if (!util::ParseOverflowPolicy(value, &options->policy)) {
+        LOG_WARN("Unknown queue policy in --sink-option '" + entry + "'");
+      }
+    } else {
+      LOG_WARN("Unknown key in --sink-option '" + entry + "' (queue, policy, threads)");
+    }
+  }
+}
+
+}  // namespace app
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "app/SinkExecutor.h"
+#include "app/StreamConfig.h"
+#include "media/FrameSink.h"
+#include "util/Args.h"
+#include "util/ThreadPool.h"
+
+namespace app {
+
+// What a sink factory gets to build a sink for one stream.
+struct SinkContext {
+  const StreamConfig& config;
+  const util::Args& args;
+  util::ThreadPool* encode_pool;  // Shared image encoders (may be null)
+  size_t max_in_flight;           // This stream's share of encode_pool
+};
+
+// A named kind of sink.
+struct SinkRegistration {
+  // Create the sink; null (after logging) if it cannot run
+  std::function<std::unique_ptr<media::FrameSink>(const SinkContext&)> create;
+
+  // Executor defaults before --sink-option overrides
+  std::function<SinkExecutorOptions(const util::Args&)> defaults;
+
+  // One line for --help and logs
+  std::string description;
+};
+
+// Sinks by name, chosen per stream with --sinks.
+//
+// Built in:
+//   images - FrameGate + FrameWriter: --write-images, --image-*,
+//            --frame-*; queue --queue-size/--queue-policy, --writer-threads
+//   video  - Recorder (--record auto|copy|transcode), or FrameWriter's
+//            cv::VideoWriter for --record opencv; one thread
+//   shm    - ShmPublisher (--shm-*); inline on the receiver thread
+//
+// New outputs register a factory (at startup, before streams are
+// created) instead of being wired into CaptureStream.
+//
+// Thread-safe: yes (one mutex).
+class SinkRegistry {
+ public:
+  // The process-wide registry, with the built-in sinks registered.
+  static SinkRegistry& Instance();
+
+  // Add or replace a sink kind.
+  void Register(const std::string& name, SinkRegistration registration);
+
+  // Build a sink and its executor options (defaults, then --sink-option
+  // overrides for this name).
+  //
+  // Param: name - Registered name
+  // Param: context - Stream and arguments
+  // Param: options - Receives the executor options
+  // Returns: the sink, or null if the name is unknown or creation failed
+  std::unique_ptr<media::FrameSink> Create(const std::string& name, const SinkContext& context,
+                                           SinkExecutorOptions* options) const;
+
+  bool Contains(const std::string& name) const;
+
+  // Registered names, sorted.
+  std::vector<std::string> Names() const;
+
+ private:
+  SinkRegistry();
+
+  mutable std::mutex mutex_;
+  std::map<std::string, SinkRegistration> sinks_;
+};
+
+// Sink names for a stream: --sinks (comma-separated) if set, else derived
+// from the output flags so existing command lines keep working: images
+// with --write-images 1, video with --write-video 1, shm with
+// --shm-publish <name>. Duplicates are dropped.
+std::vector<std::string> SelectSinks(const util::Args& args);
+
+// Apply the --sink-option entries "<sink>.<key>=<value>" for sink (keys
+// queue, policy, threads) to options, warning on malformed entries.
+// video.threads above 1 is clamped to 1 with a warning.
+void ApplySinkOptions(const util::Args& args, const std::string& sink, SinkExecutorOptions* options);
+
+}  // namespace app
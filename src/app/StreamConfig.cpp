@@ -0,0 +1,59 @@
+#include "app/StreamConfig.h"
+
+#include <fstream>
+#include <set>
+#include <sstream>
+
+namespace app {
+
+// Parse the stream config file line by line.
+// Blank lines and '#' comments are skipped; names must be unique so log
+// lines and default output directories can't collide.
+bool LoadStreamConfig(const std::string& path,
+                      const std::string& default_output_dir,
+                      std::vector<StreamConfig>* streams,
+                      std::string* error) {
+  std::ifstream in(path);
+  if (!in) {
+    *error = "cannot open " + path;
+    return false;
+  }
+
+  std::set<std::string> names;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(in, line)) {
+    ++line_number;
+    const size_t comment = line.find('#');
+    if (comment != std::string::npos) {
+      line.resize(comment);
+    }
+    std::istringstream fields(line);
+    StreamConfig stream;
+    if (!(fields >> stream.name)) {
+      continue;
+    }
+    const std::string where = path + ":" + std::to_string(line_number);
+    if (!(fields >> stream.rtp_url)) {
+      *error = where + ": missing RTP URL for stream '" + stream.name + "'";
+      return false;
+    }
+    if (!(fields >> stream.output_dir)) {
+      stream.output_dir = default_output_dir + "/" + stream.name;
+    }
+    std::string extra;
+    if (fields >> extra) {
+      *error = where + ": unexpected field '" + extra + "'";
+      return false;
+    }
+    if (!names.insert(stream.name).second) {
+      *error = where + ": duplicate stream name '" + stream.name + "'";
+      return false;
+    }
+    stream.mp4_path = stream.output_dir + "/capture.mp4";
+    streams->push_back(std::move(stream));
+  }
+  return true;
+}
+
+}  // namespace app
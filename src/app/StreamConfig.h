@@ -0,0 +1,45 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+namespace app {
+
+// One RTP stream captured by the process.
+struct StreamConfig {
+  // Identifier used in log lines; unique within a config file
+  std::string name;
+
+  // RTP source URL or SDP file path (same forms as --rtp-url)
+  std::string rtp_url;
+
+  // Output directory for this stream's frames ("<dir>/frames/")
+  std::string output_dir;
+
+  // Video output path for this stream
+  std::string mp4_path;
+};
+
+// Load stream definitions from a text file.
+//
+// Format: one stream per line, whitespace separated, '#' starts a comment:
+//   <name> <rtp-url|sdp> [output-dir]
+// Example:
+//   # Janus forwards each participant to its own port
+//   alice  /app/config/alice.sdp
+//   bob    rtp://0.0.0.0:5006?protocol_whitelist=file,udp,rtp  /data/bob
+//
+// When output-dir is omitted it defaults to "<default_output_dir>/<name>".
+// The video path is always "<output-dir>/capture.mp4".
+//
+// Param: path - Config file path
+// Param: default_output_dir - Base directory for streams without an explicit one
+// Param: streams - Receives the parsed streams (appended)
+// Param: error - Receives a description of the first problem found
+// Returns: true if the file was read and every line was valid
+bool LoadStreamConfig(const std::string& path,
+                      const std::string& default_output_dir,
+                      std::vector<StreamConfig>* streams,
+                      std::string* error);
+
+}  // namespace app
@@ -0,0 +1,304 @@
+#include "ingest/Depacketizer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace ingest {
+namespace {
+
+// Parsed VP8 payload descriptor (RFC 7741 section 4.2):
+//
+//   |X|R|N|S|R| PID |   required
+//   |I|L|T|K| RSV   |   if X
+//   |M| PictureID   |   if I (second byte if M)
+//   |   TL0PICIDX   |   if L
+//   |TID|Y| KEYIDX  |   if T or K
+struct Vp8Descriptor {
+  bool start = false;   // S: first packet of a partition
+  int partition = 0;    // PID
+  size_t size = 0;      // Descriptor length; the VP8 payload follows
+};
+
+bool ParseVp8Descriptor(const uint8_t* data, size_t size, Vp8Descriptor* descriptor) {
+  if (size < 1) {
+    return false;
+  }
+  descriptor->start = (data[0] & 0x10) != 0;
+  descriptor->partition = data[0] & 0x07;
+  size_t offset = 1;
+  if (data[0] & 0x80) {
+    if (offset >= size) {
+      return false;
+    }
+    const uint8_t extension = data[offset++];
+    if (extension & 0x80) {
+      if (offset >= size) {
+        return false;
+      }
+      offset += (data[offset] & 0x80) ? 2 : 1;
+    }
+    if (extension & 0x40) {
+      ++offset;
+    }
+    if (extension & 0x30) {
+      ++offset;
+    }
+  }
+  if (offset >= size) {
+    return false;
+  }
+  descriptor->size = offset;
+  return true;
+}
+
+constexpr uint8_t kStartCode[] = {0, 0, 0, 1};
+
+// H.264 NAL unit types (ITU-T H.264 table 7-1, RFC 6184 table 1)
+constexpr int kNalIdr = 5;
+constexpr int kNalStapA = 24;
+constexpr int kNalFuA = 28;
+
+}  // namespace
+
+// Parse an SDP encoding name.
+bool ParseRtpCodec(const std::string& name, RtpCodec* codec) {
+  std::string upper = name;
+  std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+  if (upper == "VP8") {
+    *codec = RtpCodec::kVp8;
+  } else if (upper == "H264") {
+    *codec = RtpCodec::kH264;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Feed one packet, in sequence order.
+//
+// 1. A loss marks the frame in progress as broken; a loss between two
+//    frames means whole frames are missing, so wait for a keyframe
+// 2. A new timestamp or an explicit start flag ends the frame in progress
+//    (if its marker never arrived it is dropped) and starts a new one
+// 3. The payload is appended unless the frame is already broken
+// 4. On the marker bit the frame is complete: it is emitted if intact and
+//    the decoder has (or this is) a keyframe since the last dropped frame
+bool Depacketizer::Push(const RtpPacket& packet, bool after_loss) {
+  if (after_loss) {
+    if (in_frame_) {
+      broken_ = true;
+    } else {
+      have_keyframe_ = false;
+    }
+  }
+  if (in_frame_ && packet.timestamp != timestamp_) {
+    DropFrame();
+  }
+
+  bool first = false;
+  if (StartsFrame(packet)) {
+    if (in_frame_) {
+      DropFrame();
+    }
+    BeginFrame(packet.timestamp);
+    first = true;
+  } else if (!in_frame_) {
+    if (HasFrameStartFlag()) {
+      // Continuation of a frame whose first packet was lost
+      ++stats_.dropped_packets;
+      return false;
+    }
+    BeginFrame(packet.timestamp);
+    broken_ = after_loss;
+    first = true;
+  }
+
+  if (!broken_ && !Append(packet, first)) {
+    broken_ = true;
+  }
+  if (broken_) {
+    ++stats_.dropped_packets;
+  }
+  if (!packet.marker) {
+    return false;
+  }
+
+  in_frame_ = false;
+  if (broken_ || frame_size_ == 0) {
+    ++stats_.dropped_frames;
+    have_keyframe_ = false;
+    return false;
+  }
+  if (!have_keyframe_ && !key_) {
+    ++stats_.skipped_frames;
+    return false;
+  }
+  have_keyframe_ = true;
+  std::memset(frame_.data() + frame_size_, 0, kPadding);
+  ++stats_.frames;
+  return true;
+}
+
+void Depacketizer::Reset() {
+  in_frame_ = false;
+  broken_ = false;
+  have_keyframe_ = false;
+}
+
+void Depacketizer::BeginFrame(uint32_t timestamp) {
+  frame_size_ = 0;
+  timestamp_ = timestamp;
+  key_ = false;
+  broken_ = false;
+  in_frame_ = true;
+}
+
+// Later frames may reference the dropped one: wait for a keyframe.
+void Depacketizer::DropFrame() {
+  in_frame_ = false;
+  have_keyframe_ = false;
+  ++stats_.dropped_frames;
+}
+
+// Grow the buffer (never shrinks, so steady state does not allocate) and
+// keep kPadding bytes of room after the data.
+void Depacketizer::Write(const uint8_t* data, size_t size) {
+  if (frame_.size() < frame_size_ + size + kPadding) {
+    frame_.resize(frame_size_ + size + kPadding);
+  }
+  std::memcpy(frame_.data() + frame_size_, data, size);
+  frame_size_ += size;
+}
+
+// S=1 with partition index 0 marks the first packet of a VP8 frame.
+bool Vp8Depacketizer::StartsFrame(const RtpPacket& packet) const {
+  Vp8Descriptor descriptor;
+  return ParseVp8Descriptor(packet.payload, packet.payload_size, &descriptor) && descriptor.start &&
+         descriptor.partition == 0;
+}
+
+// Strip the payload descriptor; in the first packet, bit 0 of the VP8
+// frame tag (P, inverse keyframe flag, RFC 6386 section 9.1) flags
+// keyframes.
+bool Vp8Depacketizer::Append(const RtpPacket& packet, bool first) {
+  Vp8Descriptor descriptor;
+  if (!ParseVp8Descriptor(packet.payload, packet.payload_size, &descriptor)) {
+    return false;
+  }
+  const uint8_t* data = packet.payload + descriptor.size;
+  if (first && (data[0] & 0x01) == 0) {
+    SetKey();
+  }
+  Write(data, packet.payload_size - descriptor.size);
+  return true;
+}
+
+// Unpack one RTP payload into Annex B NAL units.
+//
+//   1-23  Single NAL unit packet: the payload is the NAL unit
+//   24    STAP-A: 1-byte header, then (16-bit size, NAL unit) pairs
+//   28    FU-A: FU indicator, FU header (S, E, type), fragment; the NAL
+//         header is rebuilt from the indicator's F/NRI and the FU type
+//
+// Interleaved-mode packets (STAP-B, MTAP, FU-B) are rejected.
+bool H264Depacketizer::Append(const RtpPacket& packet, bool first) {
+  if (first) {
+    in_fragment_ = false;
+  }
+  const uint8_t* data = packet.payload;
+  const size_t size = packet.payload_size;
+  if (size < 1) {
+    return false;
+  }
+  const int type = data[0] & 0x1F;
+
+  if (type >= 1 && type <= 23) {
+    WriteNal(data, size);
+    return true;
+  }
+
+  if (type == kNalStapA) {
+    size_t offset = 1;
+    while (offset + 2 <= size) {
+      const size_t nal_size = (static_cast<size_t>(data[offset]) << 8) | data[offset + 1];
+      offset += 2;
+      if (nal_size == 0 || offset + nal_size > size) {
+        return false;
+      }
+      WriteNal(data + offset, nal_size);
+      offset += nal_size;
+    }
+    return offset == size;
+  }
+
+  if (type == kNalFuA) {
+    if (size < 3) {
+      return false;
+    }
+    const bool start = (data[1] & 0x80) != 0;
+    const bool end = (data[1] & 0x40) != 0;
+    if (start) {
+      const uint8_t header = static_cast<uint8_t>((data[0] & 0xE0) | (data[1] & 0x1F));
+      Write(kStartCode, sizeof(kStartCode));
+      Write(&header, 1);
+      if ((header & 0x1F) == kNalIdr) {
+        SetKey();
+      }
+      in_fragment_ = true;
+    } else if (!in_fragment_) {
+      return false;
+    }
+    Write(data + 2, size - 2);
+    if (end) {
+      in_fragment_ = false;
+    }
+    return true;
+  }
+
+  return false;
+}
+
+void H264Depacketizer::WriteNal(const uint8_t* nal, size_t size) {
+  if ((nal[0] & 0x1F) == kNalIdr) {
+    SetKey();
+  }
+  Write(kStartCode, sizeof(kStartCode));
+  Write(nal, size);
+}
+
+std::unique_ptr<Depacketizer> CreateDepacketizer(RtpCodec codec) {
+  switch (codec) {
+    case RtpCodec::kVp8:
+      return std::make_unique<Vp8Depacketizer>();
+    case RtpCodec::kH264:
+      return std::make_unique<H264Depacketizer>();
+  }
+  return nullptr;
+}
+
+bool IsKeyframe(RtpCodec codec, const uint8_t* data, size_t size) {
+  if (!data) {
+    return false;
+  }
+  if (codec == RtpCodec::kVp8) {
+    // Keyframes carry a 3-byte start code after the 3-byte frame tag
+    return size >= 10 && (data[0] & 0x01) == 0 && data[3] == 0x9d && data[4] == 0x01 && data[5] == 0x2a;
+  }
+
+  // Walk the start codes; parameter sets and SEI may precede the first
+  // slice, which decides
+  for (size_t i = 0; i + 3 < size; ++i) {
+    if (data[i] != 0 || data[i + 1] != 0 || data[i + 2] != 1) {
+      continue;
+    }
+    const int type = data[i + 3] & 0x1F;
+    if (type >= 1 && type <= kNalIdr) {
+      return type == kNalIdr;
+    }
+    i += 3;
+  }
+  return false;
+}
+
+}  // namespace ingest
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "ingest/RtpPacket.h"
+
+namespace ingest {
+
+// Video payload formats supported by the native RTP ingest.
+enum class RtpCodec {
+  kVp8,   // RFC 7741
+  kH264,  // RFC 6184, packetization-mode 0 or 1
+};
+
+// Parse a codec name as used in SDP rtpmap lines ("VP8", "H264"),
+// case-insensitively.
+//
+// Returns: true if recognized (codec set), false otherwise
+bool ParseRtpCodec(const std::string& name, RtpCodec* codec);
+
+// Counters, see Depacketizer::GetStats().
+struct DepacketizerStats {
+  uint64_t frames = 0;            // Complete frames produced
+  uint64_t dropped_frames = 0;    // Frames discarded as incomplete
+  uint64_t skipped_frames = 0;    // Complete frames discarded while waiting for a keyframe
+  uint64_t dropped_packets = 0;   // Packets that belonged to no usable frame
+};
+
+// Reassembles RTP payloads into encoded frames for avcodec_send_packet().
+//
+// Packets must be fed in sequence order (see JitterBuffer). A frame is
+// emitted when its last packet (RTP marker bit) arrives, and only if every
+// packet of the frame was seen: a frame with a hole is dropped instead of
+// being handed to the decoder, which would otherwise conceal the damage
+// into every frame up to the next keyframe.
+//
+// Nothing is emitted before the first keyframe, since a decoder cannot
+// start on an inter frame. This is what bounds time-to-first-frame to one
+// keyframe interval. The same holds after a dropped frame, or a loss
+// between two frames (a frame lost whole): the inter frames that follow
+// reference what is missing and are skipped until the next keyframe.
+//
+// The frame buffer is reused across frames and followed by kPadding zero
+// bytes, as libavcodec requires of packet data.
+//
+// Thread-safe: no, owned by the receive thread.
+class Depacketizer {
+ public:
+  // Zeroed bytes after frame_data() (>= AV_INPUT_BUFFER_PADDING_SIZE).
+  static constexpr size_t kPadding = 64;
+
+  virtual ~Depacketizer() = default;
+
+  // Feed the next packet in sequence order.
+  //
+  // Param: packet - RTP packet of the stream's payload type
+  // Param: after_loss - One or more packets before this one were lost
+  // Returns: true if the packet completed a frame, available through
+  //          frame_data() until the next Push() or Reset()
+  bool Push(const RtpPacket& packet, bool after_loss);
+
+  // Discard any partial frame and wait for a keyframe again (e.g. the
+  // sender changed SSRC).
+  void Reset();
+
+  const uint8_t* frame_data() const { return frame_.data(); }
+  size_t frame_size() const { return frame_size_; }
+  uint32_t frame_timestamp() const { return timestamp_; }
+  bool frame_key() const { return key_; }
+
+  DepacketizerStats GetStats() const { return stats_; }
+
+ protected:
+  // Whether the packet is the first of a frame. Payload formats without
+  // an explicit start flag (H.264) return false and rely on the timestamp:
+  // a packet with a new timestamp starts a frame, and after a loss that
+  // frame must be assumed to miss its first packets.
+  virtual bool StartsFrame(const RtpPacket& packet) const = 0;
+
+  // Whether StartsFrame() is authoritative (continuations of a frame whose
+  // start was lost can then be dropped right away).
+  virtual bool HasFrameStartFlag() const = 0;
+
+  // Append one packet's payload to the current frame via Write().
+  //
+  // Param: packet - Packet to depacketize
+  // Param: first - The packet is the first one of the frame
+  // Returns: false if the payload is malformed or cannot be placed (e.g. a
+  //          fragment continuation whose start was lost)
+  virtual bool Append(const RtpPacket& packet, bool first) = 0;
+
+  // Append raw bytes to the current frame.
+  void Write(const uint8_t* data, size_t size);
+
+  // Mark the current frame as a keyframe.
+  void SetKey() { key_ = true; }
+
+ private:
+  // Start collecting a new frame (reuses the buffer).
+  void BeginFrame(uint32_t timestamp);
+
+  // Give up on the current partial frame.
+  void DropFrame();
+
+  std::vector<uint8_t> frame_;
+  size_t frame_size_ = 0;
+  uint32_t timestamp_ = 0;
+  bool key_ = false;
+  bool in_frame_ = false;    // Packets are being collected into frame_
+  bool broken_ = false;      // The current frame lost a packet
+  bool have_keyframe_ = false;
+  DepacketizerStats stats_;
+};
+
+// VP8 payload descriptor parsing (RFC 7741 section 4.2). A frame starts at
+// the packet with S=1 and partition index 0; the P bit of the VP8 payload
+// header in that packet flags keyframes.
+class Vp8Depacketizer : public Depacketizer {
+ protected:
+  bool StartsFrame(const RtpPacket& packet) const override;
+  bool HasFrameStartFlag() const override { return true; }
+  bool Append(const RtpPacket& packet, bool first) override;
+};
+
+// H.264 depacketization (RFC 6184): single NAL unit packets, STAP-A and
+// FU-A. Output is Annex B (start code before every NAL unit), which the
+// libavcodec h264 decoder accepts without extradata. IDR slices flag
+// keyframes.
+class H264Depacketizer : public Depacketizer {
+ protected:
+  bool StartsFrame(const RtpPacket&) const override { return false; }
+  bool HasFrameStartFlag() const override { return false; }
+  bool Append(const RtpPacket& packet, bool first) override;
+
+ private:
+  // Append a start code and one NAL unit; flags IDR slices.
+  void WriteNal(const uint8_t* nal, size_t size);
+
+  // A FU-A fragmented NAL unit is being reassembled
+  bool in_fragment_ = false;
+};
+
+// Create the depacketizer for a payload format.
+std::unique_ptr<Depacketizer> CreateDepacketizer(RtpCodec codec);
+
+// Tell from the bitstream whether an encoded frame is a keyframe, without
+// decoding it. Works on the depacketizers' output and on libavformat's
+// RTP demuxer packets alike:
+//   VP8   - P bit of the frame tag clear (RFC 6386 section 9.1)
+//   H.264 - the first slice in the Annex B stream is an IDR slice (all
+//           slices of an IDR picture are)
+// Only the first bytes (VP8) or the NAL headers up to the first slice
+// (H.264) are read.
+//
+// Param: codec - Payload format of the frame
+// Param: data, size - Encoded frame (VP8 frame, or Annex B access unit)
+// Returns: true for a keyframe, false otherwise (including malformed data)
+bool IsKeyframe(RtpCodec codec, const uint8_t* data, size_t size);
+
+}  // namespace ingest
@@ -0,0 +1,112 @@
+#include "ingest/JitterBuffer.h"
+
+namespace ingest {
+namespace {
+
+// Signed distance from `from` to `to` in 16-bit serial arithmetic.
+int SequenceDelta(uint16_t from, uint16_t to) {
+  return static_cast<int16_t>(static_cast<uint16_t>(to - from));
+}
+
+}  // namespace
+
+// The ring holds at least twice the depth (and a power of two so the slot
+// is a mask of the sequence number): a gap is expired when `depth`
+// packets wait behind it, well before the window wraps onto itself.
+JitterBuffer::JitterBuffer(JitterBufferOptions options) : options_(options) {
+  size_t capacity = 16;
+  while (capacity < 2 * options_.depth + 2 && capacity < 16384) {
+    capacity *= 2;
+  }
+  slots_.resize(capacity);
+  mask_ = capacity - 1;
+}
+
+// Store a packet in its sequence slot.
+//
+// Packets shortly behind next_sequence_ are late (their slot was released
+// or skipped). A packet further away than the ring can hold, in either
+// direction, means the sender jumped (restart, huge burst loss):
+// everything buffered is dropped and the stream restarts at that packet.
+bool JitterBuffer::Insert(const RtpPacket& packet) {
+  if (!started_) {
+    started_ = true;
+    next_sequence_ = packet.sequence;
+  }
+
+  const int delta = SequenceDelta(next_sequence_, packet.sequence);
+  const size_t distance = static_cast<size_t>(delta < 0 ? -delta : delta);
+  if (delta < 0 && distance <= mask_) {
+    ++stats_.late;
+    return false;
+  }
+  if (distance > mask_) {
+    Reset();
+    ++stats_.resets;
+    started_ = true;
+    next_sequence_ = packet.sequence;
+    loss_pending_ = true;
+  }
+
+  Slot& slot = SlotFor(packet.sequence);
+  if (slot.used) {
+    ++stats_.duplicates;
+    return false;
+  }
+  slot.used = true;
+  slot.payload.assign(packet.payload, packet.payload + packet.payload_size);
+  slot.entry.packet = packet;
+  slot.entry.packet.payload = slot.payload.data();
+  ++buffered_;
+  ++stats_.received;
+  return true;
+}
+
+// Release the next packet, expiring the gap in front of it if it has
+// waited long enough.
+const JitterBuffer::Entry* JitterBuffer::Pop(int64_t now_us) {
+  while (buffered_ > 0) {
+    Slot& slot = SlotFor(next_sequence_);
+    if (slot.used) {
+      slot.used = false;
+      --buffered_;
+      ++next_sequence_;
+      gap_since_us_ = -1;
+      slot.entry.after_loss = loss_pending_;
+      loss_pending_ = false;
+      ++stats_.released;
+      return &slot.entry;
+    }
+
+    // next_sequence_ is missing but later packets are waiting
+    if (gap_since_us_ < 0) {
+      gap_since_us_ = now_us;
+    }
+    const bool too_deep = buffered_ > options_.depth;
+    const bool too_old = now_us - gap_since_us_ >= static_cast<int64_t>(options_.max_delay_ms) * 1000;
+    if (!too_deep && !too_old) {
+      return nullptr;
+    }
+
+    // Give up on the gap: skip to the next buffered packet
+    while (!SlotFor(next_sequence_).used) {
+      ++next_sequence_;
+      ++stats_.lost;
+    }
+    loss_pending_ = true;
+    gap_since_us_ = -1;
+  }
+  return nullptr;
+}
+
+void JitterBuffer::Reset() {
+  for (Slot& slot : slots_) {
+    slot.used = false;
+  }
+  started_ = false;
+  buffered_ = 0;
+  loss_pending_ = false;
+  gap_since_us_ = -1;
+}
+
+}  // namespace ingest
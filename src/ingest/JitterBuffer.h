@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "ingest/RtpPacket.h"
+
+namespace ingest {
+
+// How long the jitter buffer waits for a missing packet.
+struct JitterBufferOptions {
+  // Maximum packets held behind a gap. When more arrive, the gap is
+  // declared lost. A 1080p keyframe is ~100 packets; reordering on a LAN
+  // spans a handful, so this rarely triggers before max_delay_ms.
+  size_t depth = 64;
+
+  // Maximum time a gap may hold back later packets, in milliseconds.
+  // This is the latency the buffer adds on loss; 0 releases immediately
+  // (reorders become losses).
+  int max_delay_ms = 40;
+};
+
+// Snapshot of jitter buffer counters, see JitterBuffer::GetStats().
+struct JitterStats {
+  uint64_t received = 0;    // Packets accepted into the buffer
+  uint64_t released = 0;    // Packets handed out in sequence order
+  uint64_t lost = 0;        // Sequence numbers skipped after waiting
+  uint64_t late = 0;        // Packets arriving after their slot was released
+  uint64_t duplicates = 0;  // Packets already buffered
+  uint64_t resets = 0;      // Sequence jumps too large to bridge
+};
+
+// Reorders RTP packets of one SSRC by sequence number.
+//
+// Packets are stored in a ring indexed by sequence number, so insertion
+// and release are O(1) and, once every slot's payload buffer has grown to
+// the largest packet seen, nothing is allocated.
+//
+// Pop() releases packets strictly in sequence order. When the next
+// expected packet is missing, later packets are held until either it
+// arrives, more than `depth` packets are waiting, or the gap has been open
+// for `max_delay_ms`; the gap is then counted as lost and the packet after
+// it is released with after_loss set, so the depacketizer can drop the
+// damaged frame.
+//
+// Sequence numbers wrap at 2^16; comparisons use 16-bit serial arithmetic.
+//
+// Thread-safe: no, owned by the receive thread.
+class JitterBuffer {
+ public:
+  // A buffered packet. `packet.payload` points into the entry's storage.
+  struct Entry {
+    RtpPacket packet;
+    bool after_loss = false;  // One or more packets before this one were lost
+  };
+
+  explicit JitterBuffer(JitterBufferOptions options = {});
+
+  // Store a packet (its payload is copied).
+  //
+  // Param: packet - Parsed RTP packet of the stream's SSRC
+  // Returns: false if the packet was late or a duplicate and was dropped
+  bool Insert(const RtpPacket& packet);
+
+  // Release the next packet in sequence order, if it is due.
+  //
+  // Param: now_us - Current time (monotonic microseconds), used to expire gaps
+  // Returns: the packet, or nullptr if nothing can be released yet. The
+  //          entry stays valid until the next Insert(), Pop() or Reset().
+  const Entry* Pop(int64_t now_us);
+
+  // Drop everything and restart from the next inserted packet (e.g. the
+  // sender changed SSRC).
+  void Reset();
+
+  // When Pop() will release a held-back packet by expiring the gap in
+  // front of it (same clock as now_us), or -1 if no gap is open. The
+  // receive loop sleeps until then instead of polling.
+  int64_t NextDeadlineUs() const {
+    return buffered_ > 0 && gap_since_us_ >= 0 ? gap_since_us_ + static_cast<int64_t>(options_.max_delay_ms) * 1000
+                                               : -1;
+  }
+
+  JitterStats GetStats() const { return stats_; }
+
+ private:
+  struct Slot {
+    bool used = false;
+    Entry entry;
+    std::vector<uint8_t> payload;
+  };
+
+  Slot& SlotFor(uint16_t sequence) { return slots_[sequence & mask_]; }
+
+  JitterBufferOptions options_;
+  std::vector<Slot> slots_;
+  size_t mask_ = 0;
+
+  bool started_ = false;
+  uint16_t next_sequence_ = 0;  // Next sequence number to release
+  size_t buffered_ = 0;         // Occupied slots
+  bool loss_pending_ = false;   // Next released packet follows a loss
+  int64_t gap_since_us_ = -1;   // When Pop() first found next_sequence_ missing
+
+  JitterStats stats_;
+};
+
+}  // namespace ingest
@@ -0,0 +1,218 @@
+#include "ingest/Reactor.h"
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <string>
+
+#include "util/Log.h"
+#include "util/Metrics.h"
+
+namespace ingest {
+
+namespace {
+
+// Events taken per epoll_wait(); more stay queued for the next call.
+constexpr int kMaxEvents = 64;
+
+}  // namespace
+
+// Create each thread's epoll set with its wake eventfd, then start it.
+// A thread whose epoll_create1() failed is not started and Add() skips
+// it, so a transient descriptor shortage is not fatal.
+Reactor::Reactor(size_t threads) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  loops_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    auto loop = std::make_unique<Loop>();
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->wake_fd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (loop->epoll_fd < 0 || loop->wake_fd < 0) {
+      LOG_ERROR(std::string("Reactor: epoll/eventfd setup failed: ") + std::strerror(errno));
+    } else {
+      epoll_event event{};
+      event.events = EPOLLIN;
+      event.data.ptr = nullptr;  // nullptr marks the wake descriptor
+      epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &event);
+    }
+    loops_.push_back(std::move(loop));
+  }
+  for (auto& loop : loops_) {
+    Loop* raw = loop.get();
+    if (raw->epoll_fd >= 0 && raw->wake_fd >= 0) {
+      raw->thread = std::thread([this, raw]() { Run(raw); });
+    }
+  }
+}
+
+// Stop every thread, join it and close its descriptors.
+Reactor::~Reactor() {
+  for (auto& loop : loops_) {
+    {
+      std::lock_guard<std::mutex> lock(loop->mutex);
+      loop->stop = true;
+    }
+    Wake(loop.get());
+  }
+  for (auto& loop : loops_) {
+    if (loop->thread.joinable()) {
+      loop->thread.join();
+    }
+    if (loop->wake_fd >= 0) {
+      close(loop->wake_fd);
+    }
+    if (loop->epoll_fd >= 0) {
+      close(loop->epoll_fd);
+    }
+  }
+}
+
+// Register handler with the least-loaded thread and wake it, so its next
+// wait accounts for the handler's deadline.
+//
+// Param: handler - Must stay valid until Remove() returns
+// Returns: false if no thread could take the descriptor
+// Side effects: logs on failure
+bool Reactor::Add(ReactorHandler* handler) {
+  Loop* target = nullptr;
+  size_t least = 0;
+  for (auto& loop : loops_) {
+    if (!loop->thread.joinable()) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    if (!target || loop->handlers.size() < least) {
+      target = loop.get();
+      least = loop->handlers.size();
+    }
+  }
+  if (!target) {
+    LOG_ERROR("Reactor: no usable I/O thread");
+    return false;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(target->mutex);
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.ptr = handler;
+    if (epoll_ctl(target->epoll_fd, EPOLL_CTL_ADD, handler->fd(), &event) != 0) {
+      LOG_ERROR(std::string("Reactor: epoll_ctl(ADD) failed: ") + std::strerror(errno));
+      return false;
+    }
+    target->handlers.push_back(handler);
+  }
+  Wake(target);
+  return true;
+}
+
+// Find the handler's thread and drop it from the list and the epoll set.
+// Taking the thread's mutex waits for a callback in progress; events
+// already returned by epoll_wait() for the handler are discarded by the
+// thread, which dispatches only to handlers still in its list.
+void Reactor::Remove(ReactorHandler* handler) {
+  for (auto& loop : loops_) {
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    auto it = std::find(loop->handlers.begin(), loop->handlers.end(), handler);
+    if (it == loop->handlers.end()) {
+      continue;
+    }
+    loop->handlers.erase(it);
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, handler->fd(), nullptr);
+    return;
+  }
+}
+
+size_t Reactor::size() const {
+  size_t total = 0;
+  for (const auto& loop : loops_) {
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    total += loop->handlers.size();
+  }
+  return total;
+}
+
+// Thread body.
+//
+// 1. Under the lock, find the earliest handler deadline and turn it into
+//    the epoll_wait() timeout (rounded up, so a wakeup is never early)
+// 2. Wait without the lock; Add()/Remove() proceed meanwhile
+// 3. Under the lock, clear the wake descriptor, dispatch OnReadable() to
+//    ready handlers still registered (removing those that return false),
+//    then OnTimer() to handlers whose deadline has passed
+void Reactor::Run(Loop* loop) {
+  epoll_event events[kMaxEvents];
+  for (;;) {
+    int timeout_ms = -1;
+    {
+      std::lock_guard<std::mutex> lock(loop->mutex);
+      if (loop->stop) {
+        return;
+      }
+      int64_t earliest = -1;
+      for (ReactorHandler* handler : loop->handlers) {
+        const int64_t deadline = handler->NextDeadlineUs();
+        if (deadline >= 0 && (earliest < 0 || deadline < earliest)) {
+          earliest = deadline;
+        }
+      }
+      if (earliest >= 0) {
+        const int64_t wait_us = std::max<int64_t>(0, earliest - util::NowMicros());
+        timeout_ms = static_cast<int>(std::min<int64_t>((wait_us + 999) / 1000, 1000 * 1000));
+      }
+    }
+
+    const int ready = epoll_wait(loop->epoll_fd, events, kMaxEvents, timeout_ms);
+    if (ready < 0 && errno != EINTR) {
+      LOG_ERROR(std::string("Reactor: epoll_wait failed: ") + std::strerror(errno));
+    }
+
+    std::lock_guard<std::mutex> lock(loop->mutex);
+    if (loop->stop) {
+      return;
+    }
+    for (int i = 0; i < ready; ++i) {
+      auto* handler = static_cast<ReactorHandler*>(events[i].data.ptr);
+      if (!handler) {
+        uint64_t count = 0;
+        ssize_t ignored = read(loop->wake_fd, &count, sizeof(count));
+        (void)ignored;
+        continue;
+      }
+      auto it = std::find(loop->handlers.begin(), loop->handlers.end(), handler);
+      if (it == loop->handlers.end()) {
+        continue;  // Removed after epoll_wait() returned
+      }
+      if (!handler->OnReadable()) {
+        loop->handlers.erase(it);
+        epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, handler->fd(), nullptr);
+      }
+    }
+
+    const int64_t now = util::NowMicros();
+    for (ReactorHandler* handler : loop->handlers) {
+      const int64_t deadline = handler->NextDeadlineUs();
+      if (deadline >= 0 && deadline <= now) {
+        handler->OnTimer();
+      }
+    }
+  }
+}
+
+// Add 1 to the eventfd counter; the thread reads it back to clear it.
+void Reactor::Wake(Loop* loop) {
+  if (loop->wake_fd < 0) {
+    return;
+  }
+  const uint64_t one = 1;
+  ssize_t ignored = write(loop->wake_fd, &one, sizeof(one));
+  (void)ignored;
+}
+
+}  // namespace ingest
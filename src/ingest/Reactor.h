@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace ingest {
+
+// Something a Reactor services: a readable descriptor plus an optional
+// timer (jitter buffer gaps, stall detection).
+//
+// Callbacks run on the reactor thread the handler was assigned to, one at
+// a time, never concurrently with Reactor::Add()/Remove() of the same
+// handler.
+class ReactorHandler {
+ public:
+  virtual ~ReactorHandler() = default;
+
+  // Descriptor to watch for readability (fixed while registered).
+  virtual int fd() const = 0;
+
+  // The descriptor is readable. Read one batch: the descriptor is
+  // level-triggered, so remaining data is reported again after every
+  // other ready handler of the thread had its turn.
+  // Returns: false to be removed from the reactor (e.g. socket error)
+  virtual bool OnReadable() = 0;
+
+  // When OnTimer() is due (util::NowMicros()), or -1 for no timer.
+  virtual int64_t NextDeadlineUs() const = 0;
+
+  // The deadline has passed.
+  virtual void OnTimer() = 0;
+};
+
+// A fixed number of I/O threads, each waiting in epoll on the descriptors
+// of the handlers assigned to it.
+//
+// With one thread per receiver, hundreds of streams mean hundreds of
+// mostly blocked threads and a context switch per packet batch. Here the
+// thread count is fixed (typically a few, independent of the stream
+// count); a wakeup services every ready socket of the thread before
+// sleeping again, and the sleep ends at the earliest handler deadline.
+//
+// Handlers are assigned to the thread with the fewest handlers. Each
+// thread keeps a plain list of its handlers and scans it for deadlines
+// once per wakeup, which is cheap for the hundreds of streams per thread
+// this is meant for.
+//
+// Lifecycle:
+//   1. Construct with the number of threads (they start immediately)
+//   2. Add() handlers; Remove() each before destroying it
+//   3. Destruction stops and joins the threads
+//
+// Thread-safe: Add() and Remove() from any thread except the reactor's
+// own (Remove() waits for a running callback to return).
+class Reactor {
+ public:
+  // Param: threads - I/O threads (clamped to >= 1)
+  explicit Reactor(size_t threads);
+
+  // Stops and joins the threads. Handlers still registered are dropped
+  // without callbacks.
+  ~Reactor();
+
+  Reactor(const Reactor&) = delete;
+  Reactor& operator=(const Reactor&) = delete;
+
+  // Start servicing handler.
+  // Returns: false (after logging) if epoll refused the descriptor
+  bool Add(ReactorHandler* handler);
+
+  // Stop servicing handler; when this returns, no callback of it runs or
+  // will run. No-op if it is not registered.
+  void Remove(ReactorHandler* handler);
+
+  size_t threads() const { return loops_.size(); }
+
+  // Handlers currently registered, over all threads.
+  size_t size() const;
+
+ private:
+  // One I/O thread: its epoll set, a wake eventfd and its handlers.
+  struct Loop {
+    int epoll_fd = -1;
+    int wake_fd = -1;  // Readable after Wake(): handler list or stop changed
+    mutable std::mutex mutex;  // Guards handlers and stop; held during callbacks
+    std::vector<ReactorHandler*> handlers;
+    bool stop = false;
+    std::thread thread;
+  };
+
+  // I/O thread body: wait, dispatch readable handlers, run due timers.
+  void Run(Loop* loop);
+
+  // Interrupt the loop's epoll_wait().
+  static void Wake(Loop* loop);
+
+  std::vector<std::unique_ptr<Loop>> loops_;
+};
+
+}  // namespace ingest
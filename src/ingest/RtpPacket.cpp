@@ -0,0 +1,78 @@
+#include "ingest/RtpPacket.h"
+
+namespace ingest {
+namespace {
+
+constexpr size_t kFixedHeaderSize = 12;
+
+uint16_t ReadU16(const uint8_t* p) {
+  return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+uint32_t ReadU32(const uint8_t* p) {
+  return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16) |
+         (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+}  // namespace
+
+// Parse the RTP header:
+//
+//    0                   1                   2                   3
+//   |V=2|P|X|  CC   |M|     PT      |       sequence number         |
+//   |                           timestamp                           |
+//   |                             SSRC                              |
+//   |                     CSRC list (CC x 32 bit)                   |
+//   |   extension profile           |   extension length (words)    |
+//   |                     extension data ...                        |
+//
+// Every length is checked against the datagram size, so truncated or
+// hostile packets are rejected instead of read past the end.
+bool ParseRtpPacket(const uint8_t* data, size_t size, RtpPacket* packet) {
+  if (size < kFixedHeaderSize || (data[0] >> 6) != 2) {
+    return false;
+  }
+  // RTCP multiplexed on the RTP port (RFC 5761 section 4): packet types
+  // 192-223 would read as marker + payload type 64-95, and bytes 8-11 are
+  // not the media SSRC
+  if (data[1] >= 192 && data[1] <= 223) {
+    return false;
+  }
+  const bool padding = (data[0] & 0x20) != 0;
+  const bool extension = (data[0] & 0x10) != 0;
+  const size_t csrc_count = data[0] & 0x0F;
+
+  size_t offset = kFixedHeaderSize + 4 * csrc_count;
+  if (offset > size) {
+    return false;
+  }
+  if (extension) {
+    if (offset + 4 > size) {
+      return false;
+    }
+    offset += 4 + 4 * static_cast<size_t>(ReadU16(data + offset + 2));
+    if (offset > size) {
+      return false;
+    }
+  }
+
+  size_t end = size;
+  if (padding) {
+    const size_t padding_size = data[size - 1];
+    if (padding_size == 0 || padding_size > end - offset) {
+      return false;
+    }
+    end -= padding_size;
+  }
+
+  packet->marker = (data[1] & 0x80) != 0;
+  packet->payload_type = data[1] & 0x7F;
+  packet->sequence = ReadU16(data + 2);
+  packet->timestamp = ReadU32(data + 4);
+  packet->ssrc = ReadU32(data + 8);
+  packet->payload = data + offset;
+  packet->payload_size = end - offset;
+  return true;
+}
+
+}  // namespace ingest
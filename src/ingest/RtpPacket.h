@@ -0,0 +1,32 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace ingest {
+
+// Fixed RTP header fields (RFC 3550 section 5.1) and the payload span.
+//
+// The payload points into the buffer given to ParseRtpPacket(); it is only
+// valid as long as that buffer is.
+struct RtpPacket {
+  uint8_t payload_type = 0;
+  bool marker = false;
+  uint16_t sequence = 0;
+  uint32_t timestamp = 0;
+  uint32_t ssrc = 0;
+  const uint8_t* payload = nullptr;
+  size_t payload_size = 0;
+};
+
+// Parse one RTP datagram.
+// CSRC lists and header extensions are skipped, padding is removed.
+//
+// Param: data, size - The UDP payload
+// Param: packet - Receives the header fields and payload span
+// Returns: false if the datagram is not a well-formed RTP version 2 packet,
+//          or is RTCP (second byte 192-223, RFC 5761 section 4), as sent
+//          on the RTP port by senders that multiplex RTP and RTCP
+bool ParseRtpPacket(const uint8_t* data, size_t size, RtpPacket* packet);
+
+}  // namespace ingest
@@ -4,17 +4,32 @@ extern "C" {
 #include <libavcodec/avcodec.h>
 #include <libavformat/avformat.h>
 #include <libavutil/imgutils.h>
+#include <libavutil/mem.h>
 #include <libavutil/opt.h>
-#include <libswscale/swscale.h>
+#include <libavutil/time.h>
 }
 
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#include <mutex>
 #include <sstream>
+#include <vector>
 
+#include "ingest/Depacketizer.h"
+#include "ingest/RtpSession.h"
+#include "ingest/UdpSource.h"
 #include "util/Log.h"
 
 namespace ingest {
 namespace {
 
+// Reactor mode: frames a stream may have waiting for its decoder before
+// new ones are dropped (about a second of video at 30 fps).
+constexpr size_t kMaxDecodeBacklog = 32;
+
 // Convert FFmpeg error code to human-readable string.
 // FFmpeg returns negative error codes; this converts them to messages.
 // Example: -109 → "Invalid data found when processing input"
@@ -27,35 +42,614 @@ std::string AvErrorToString(int err) {
   return buffer;
 }
 
+// Check whether the decoder flagged a frame as a keyframe.
+// AVFrame::key_frame was replaced by AV_FRAME_FLAG_KEY in FFmpeg 6.1.
+bool IsKeyFrame(const AVFrame* frame) {
+#ifdef AV_FRAME_FLAG_KEY
+  return (frame->flags & AV_FRAME_FLAG_KEY) != 0;
+#else
+  return frame->key_frame != 0;
+#endif
+}
+
+// Recognize VP8 and H.264 keyframes from the bitstream, since
+// libavformat's RTP demuxer does not flag H.264 IDR packets; other codecs
+// fall back to AV_PKT_FLAG_KEY.
+bool IsKeyPacket(AVCodecID codec_id, const AVPacket* packet) {
+  switch (codec_id) {
+    case AV_CODEC_ID_VP8:
+      return IsKeyframe(RtpCodec::kVp8, packet->data, static_cast<size_t>(packet->size));
+    case AV_CODEC_ID_H264:
+      return IsKeyframe(RtpCodec::kH264, packet->data, static_cast<size_t>(packet->size));
+    default:
+      return (packet->flags & AV_PKT_FLAG_KEY) != 0;
+  }
+}
+
+// Describe the threading libavcodec actually enabled (after avcodec_open2).
+std::string DescribeThreading(const AVCodecContext* codec_ctx) {
+  std::string type = "none";
+  if (codec_ctx->active_thread_type & FF_THREAD_FRAME) {
+    type = "frame";
+  } else if (codec_ctx->active_thread_type & FF_THREAD_SLICE) {
+    type = "slice";
+  }
+  return type + " x" + std::to_string(codec_ctx->thread_count) +
+         ((codec_ctx->flags & AV_CODEC_FLAG_LOW_DELAY) ? " low-delay" : "");
+}
+
+// Whether an open decoder for old can decode a stream described by
+// current: same codec, and the same out-of-band parameter sets unless the
+// new description has none (they then arrive in-band).
+bool SameDecoderInput(const AVCodecParameters* old, const AVCodecParameters* current) {
+  if (old->codec_id != current->codec_id) {
+    return false;
+  }
+  if (current->extradata_size <= 0) {
+    return true;
+  }
+  return old->extradata_size == current->extradata_size &&
+         std::memcmp(old->extradata, current->extradata, static_cast<size_t>(current->extradata_size)) == 0;
+}
+
 }  // namespace
 
-RtpReceiver::RtpReceiver(std::string url, FrameCallback on_frame)
-    : url_(std::move(url)), on_frame_(std::move(on_frame)) {}
+// Parse an --ingest value.
+//
+// Param: name - "avformat", "native" or "reactor"
+// Param: mode - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseIngestMode(const std::string& name, IngestMode* mode) {
+  if (name == "avformat") {
+    *mode = IngestMode::kAvformat;
+  } else if (name == "native") {
+    *mode = IngestMode::kNative;
+  } else if (name == "reactor") {
+    *mode = IngestMode::kReactor;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Parse a --decode-thread-type value.
+//
+// Param: name - "auto", "frame" or "slice"
+// Param: threading - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseDecodeThreading(const std::string& name, DecodeThreading* threading) {
+  if (name == "auto") {
+    *threading = DecodeThreading::kAuto;
+  } else if (name == "frame") {
+    *threading = DecodeThreading::kFrame;
+  } else if (name == "slice") {
+    *threading = DecodeThreading::kSlice;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Apply DecoderOptions to a codec context before avcodec_open2().
+// Low delay and keyframe-only decoding win over the requested threading
+// mode: frame threading always holds back (threads - 1) frames, which
+// defeats the point of the flag and, with one keyframe every few seconds,
+// would delay each image by seconds.
+//
+// Param: options - Requested threading and latency settings
+// Param: codec_ctx - Allocated, not yet opened decoder context
+void ApplyDecoderOptions(const DecoderOptions& options, AVCodecContext* codec_ctx) {
+  codec_ctx->thread_count = options.threads;
+  switch (options.threading) {
+    case DecodeThreading::kAuto:
+      codec_ctx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+      break;
+    case DecodeThreading::kFrame:
+      codec_ctx->thread_type = FF_THREAD_FRAME;
+      break;
+    case DecodeThreading::kSlice:
+      codec_ctx->thread_type = FF_THREAD_SLICE;
+      break;
+  }
+  if (options.low_delay) {
+    codec_ctx->flags |= AV_CODEC_FLAG_LOW_DELAY;
+  }
+  if (options.low_delay || options.keyframes_only) {
+    codec_ctx->thread_type &= ~FF_THREAD_FRAME;
+  }
+}
+
+// Look up this stream's metrics once so the receive loop only touches
+// the returned atomics.
+RtpReceiver::RtpReceiver(std::string url, FrameCallback on_frame, ReceiverOptions options)
+    : url_(std::move(url)), on_frame_(std::move(on_frame)), options_(options) {
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string labels = util::MetricLabel("stream", options_.name.empty() ? "default" : options_.name);
+  metrics_.packets = metrics.GetCounter(
+      "capture_packets_total", "Packets read: RTP datagrams (native) or demuxed frames (avformat)", labels);
+  metrics_.bytes = metrics.GetCounter("capture_packet_bytes_total", "Bytes of the packets read", labels);
+  metrics_.frames = metrics.GetCounter("capture_frames_decoded_total", "Frames decoded and delivered", labels);
+  metrics_.decode_errors =
+      metrics.GetCounter("capture_decode_errors_total", "Packets or frames the decoder rejected", labels);
+  metrics_.decode_skipped =
+      metrics.GetCounter("capture_decode_skipped_total", "Packets not decoded (keyframe-only decoding)", labels);
+  metrics_.lost_packets =
+      metrics.GetCounter("capture_rtp_lost_packets_total", "RTP packets never received (native ingest)", labels);
+  metrics_.kernel_drops = metrics.GetCounter(
+      "capture_udp_kernel_drops_total", "Datagrams dropped by the kernel, receive buffer full (native ingest)", labels);
+  metrics_.reconnects =
+      metrics.GetCounter("capture_reconnects_total", "Receive sessions restarted after a stall or error", labels);
+  metrics_.backlog_dropped = metrics.GetCounter(
+      "capture_decode_backlog_dropped_total", "Frames dropped because the decoder fell behind (reactor ingest)", labels);
+  metrics_.receive = metrics.GetHistogram(
+      "capture_receive_seconds", "Time per av_read_frame() call or per native recvmmsg batch processed", labels);
+  metrics_.decode =
+      metrics.GetHistogram("capture_decode_seconds", "Time in avcodec_send_packet/receive_frame per packet", labels);
+  metrics_.convert = metrics.GetHistogram("capture_convert_seconds", "Time in sws_scale per frame", labels);
+}
+
+std::string RtpReceiver::Tag(const std::string& message) const {
+  return options_.name.empty() ? message : "[" + options_.name + "] " + message;
+}
+
+// Record the union of the sinks' format requirements.
+// A relaxed store: Run() picks the new value up at its next packet.
+//
+// Param: formats - media::FrameFormat bitmask
+void RtpReceiver::SetOutputFormats(uint32_t formats) {
+  output_formats_.store(formats, std::memory_order_relaxed);
+}
+
+// Not synchronized with Run(); call before starting the receiver thread.
+//
+// Param: on_packet - Callback for each compressed video packet
+void RtpReceiver::SetPacketCallback(PacketCallback on_packet) {
+  on_packet_ = std::move(on_packet);
+}
+
+// Decoder state shared by both ingest paths.
+// Owns the codec context and scratch frame; freed on every exit path.
+// Created once per Run(), so a reconnect keeps the open decoder, the
+// frame sequence and the timestamp timeline.
+struct RtpReceiver::DecodeContext {
+  explicit DecodeContext(const media::ColorConverterOptions& convert) : converter(convert) {}
+  ~DecodeContext() {
+    av_frame_free(&frame);
+    avcodec_free_context(&codec_ctx);
+    avcodec_parameters_free(&codecpar);
+  }
+
+  AVCodecContext* codec_ctx = nullptr;
+  AVFrame* frame = nullptr;
+
+  // Stream parameters handed to the packet callback; dimensions are
+  // filled in from the decoder once it has seen the first frame
+  AVCodecParameters* codecpar = nullptr;
+
+  // Time base of packet timestamps (stream time base, or 1/clock rate)
+  AVRational time_base{1, 90000};
+
+  // Switch to a session's time base, keeping the timeline comparable.
+  void SetTimeBase(AVRational session_time_base) {
+    timeline.Rescale(time_base, session_time_base);
+    time_base = session_time_base;
+  }
+
+  // Pixel format converter: FFmpeg decodes to YUV (usually), OpenCV
+  // needs BGR. Contexts are created lazily on the first frame and rebuilt
+  // if the stream changes resolution.
+  media::ColorConverter converter;
+
+  // Frames delivered so far
+  uint64_t sequence = 0;
+
+  // Keyframe-only decoding: timestamp (us) of the last keyframe decoded
+  int64_t last_keyframe_us = -1;
+
+  // When the session started, for the time-to-first-frame log line
+  int64_t start_us = 0;
+  bool first_frame_pending = true;
+
+  // Packets handled in the current session, and when the stream was lost
+  // (util::NowMicros(), 0 while receiving)
+  uint64_t session_packets = 0;
+  int64_t lost_us = 0;
+
+  // Timestamp continuity across sessions and senders
+  PtsTimeline timeline;
+};
+
+// Main RTP receive and decode loop: a supervisor running one session
+// (RunAvformat() or RunNative(), per ReceiverOptions::ingest; kReactor
+// runs as kNative here) after another.
+//
+// A session that loses its stream (stall, end of stream, socket error)
+// is followed by a new one at once if it had received packets, otherwise
+// after a doubling backoff (ReconnectOptions). The DecodeContext outlives
+// sessions, so a reconnect reuses the open decoder and skips libavformat's
+// stream probe when the codec is unchanged: recovery costs an input open
+// and the wait for the next keyframe, not the analyzeduration probe.
+//
+// Setup failures of the first session are configuration errors and end
+// Run(); later ones are retried.
+//
+// Returns: true on successful shutdown, false on initialization error or
+//          a fatal conversion error
+// Side effects:
+//   - Runs on the calling thread (blocking)
+//   - Invokes on_frame_ callback for each decoded frame
+bool RtpReceiver::Run() {
+  const ReconnectOptions& reconnect = options_.reconnect;
+  DecodeContext decode(options_.convert);
+  ReconnectBackoff backoff(reconnect);
+  bool established = false;
+  while (running()) {
+    decode.start_us = av_gettime_relative();
+    decode.first_frame_pending = true;
+    decode.session_packets = 0;
+    const SessionEnd end = options_.ingest == IngestMode::kAvformat ? RunAvformat(&decode) : RunNative(&decode);
+    switch (end) {
+      case SessionEnd::kStopped:
+        return true;
+      case SessionEnd::kFatal:
+        return false;
+      case SessionEnd::kSetupFailed:
+        if (!established) {
+          return false;
+        }
+        break;
+      case SessionEnd::kStreamLost:
+        break;
+    }
+    established = true;
+    if (!reconnect.enabled || !running()) {
+      return true;
+    }
+
+    const int delay_ms = backoff.NextDelayMs(decode.session_packets > 0);
+    if (decode.lost_us == 0) {
+      decode.lost_us = util::NowMicros();
+    }
+    decode.timeline.Rebase();
+    metrics_.reconnects->Add();
+    LOG_WARN(Tag("Reconnecting" + (delay_ms > 0 ? " in " + std::to_string(delay_ms) + " ms" : std::string())));
+    if (!WaitForRetry(delay_ms)) {
+      return true;
+    }
+  }
+  return true;
+}
 
-// Main RTP receive and decode loop.
+// Sleep on the stop event, so Stop() ends a long backoff at once.
 //
-// This method orchestrates the entire FFmpeg pipeline:
-//   1. Open RTP input (network or SDP file)
-//   2. Detect stream format and codec
-//   3. Initialize decoder context
-//   4. Read packets, decode to frames
-//   5. Convert pixel format to BGR (OpenCV format)
-//   6. Invoke callback with each decoded frame
+// Param: delay_ms - Time to wait
+// Returns: false if Stop() was called
+bool RtpReceiver::WaitForRetry(int delay_ms) {
+  const int64_t until_us = util::NowMicros() + static_cast<int64_t>(delay_ms) * 1000;
+  for (int64_t remaining_us = until_us - util::NowMicros(); remaining_us > 0;
+       remaining_us = until_us - util::NowMicros()) {
+    if (stop_event_.Wait(static_cast<int>((remaining_us + 999) / 1000))) {
+      return false;
+    }
+  }
+  return running();
+}
+
+// Abort libavformat I/O when the receiver is stopping or the current
+// read has waited past its deadline. libavformat polls this while it
+// waits for data (every 100 ms in the UDP protocol), so a blocked
+// av_read_frame() returns AVERROR_EXIT instead of waiting forever.
+//
+// Param: opaque - The RtpReceiver
+// Returns: nonzero to abort the blocking call
+int RtpReceiver::InterruptCallback(void* opaque) {
+  const RtpReceiver* receiver = static_cast<const RtpReceiver*>(opaque);
+  if (!receiver->running()) {
+    return 1;
+  }
+  return receiver->read_deadline_us_ > 0 && util::NowMicros() > receiver->read_deadline_us_ ? 1 : 0;
+}
+
+// Doubles from backoff_min_ms per consecutive empty session, capped at
+// backoff_max_ms (the shift is bounded so it cannot overflow).
+int ReconnectBackoff::NextDelayMs(bool received_packets) {
+  failures_ = received_packets ? 0 : failures_ + 1;
+  if (failures_ == 0) {
+    return 0;
+  }
+  const int64_t delay = static_cast<int64_t>(std::max(options_.backoff_min_ms, 1)) << std::min(failures_ - 1, 20);
+  return static_cast<int>(std::min<int64_t>(delay, std::max(options_.backoff_max_ms, 1)));
+}
+
+// On a rebase the packet is placed at the last pts plus the wall time
+// since the last packet (at least one tick), so the new timeline never
+// overlaps the old one whatever the new sender's timestamps are.
+void PtsTimeline::Continue(AVPacket* packet, AVRational time_base, int64_t now_us) {
+  if (packet->pts == AV_NOPTS_VALUE) {
+    return;
+  }
+  if (rebase_) {
+    rebase_ = false;
+    int64_t target = packet->pts;
+    if (last_pts_ != AV_NOPTS_VALUE) {
+      const int64_t gap = av_rescale_q(now_us - last_packet_us_, AVRational{1, 1000000}, time_base);
+      target = last_pts_ + std::max<int64_t>(gap, 1);
+    }
+    offset_ = target - packet->pts;
+  }
+  packet->pts += offset_;
+  if (packet->dts != AV_NOPTS_VALUE) {
+    packet->dts += offset_;
+  }
+  last_pts_ = packet->pts;
+  last_packet_us_ = now_us;
+}
+
+// Only last_pts is converted: every new session starts with a rebase,
+// which recomputes the offset in the new time base.
+void PtsTimeline::Rescale(AVRational from, AVRational to) {
+  if (last_pts_ != AV_NOPTS_VALUE && (from.num != to.num || from.den != to.den)) {
+    last_pts_ = av_rescale_q(last_pts_, from, to);
+  }
+}
+
+// Allocate the codec context, apply the stream parameters and decoder
+// threading, and open it.
+//
+// On a reconnect the decoder from the previous session is kept if
+// SameDecoderInput() holds: avcodec_flush_buffers() drops its reference
+// frames, which is all a new session needs, and skips reallocating
+// frame threads. The kept codecpar also keeps the stream dimensions, so
+// stream-copy recording continues without decoding.
+//
+// Param: codec - Decoder to use
+// Param: codecpar - Stream parameters (codec id, extradata, ...)
+// Param: decode - Receives the opened context and scratch frame
+// Returns: false on failure (partially initialized state is freed by the
+//          DecodeContext destructor)
+bool RtpReceiver::OpenDecoder(const AVCodec* codec, const AVCodecParameters* codecpar, DecodeContext* decode) {
+  if (decode->codec_ctx) {
+    if (SameDecoderInput(decode->codecpar, codecpar)) {
+      avcodec_flush_buffers(decode->codec_ctx);
+      decode->last_keyframe_us = -1;
+      LOG_INFO(Tag(std::string("Reusing open ") + codec->name + " decoder"));
+      return true;
+    }
+    LOG_INFO(Tag("Stream parameters changed, reopening the decoder"));
+    av_frame_free(&decode->frame);
+    avcodec_free_context(&decode->codec_ctx);
+    avcodec_parameters_free(&decode->codecpar);
+  }
+
+  decode->codec_ctx = avcodec_alloc_context3(codec);
+  decode->frame = av_frame_alloc();
+  decode->codecpar = avcodec_parameters_alloc();
+  if (!decode->codec_ctx || !decode->frame || !decode->codecpar) {
+    LOG_ERROR(Tag("Failed to allocate codec context"));
+    return false;
+  }
+
+  int ret = avcodec_parameters_copy(decode->codecpar, codecpar);
+  if (ret >= 0) {
+    ret = avcodec_parameters_to_context(decode->codec_ctx, codecpar);
+  }
+  if (ret < 0) {
+    LOG_ERROR(Tag("Failed to copy codec parameters: " + AvErrorToString(ret)));
+    return false;
+  }
+
+  // Configure decoder threading, then open the decoder
+  ApplyDecoderOptions(options_.decode, decode->codec_ctx);
+  ret = avcodec_open2(decode->codec_ctx, codec, nullptr);
+  if (ret < 0) {
+    LOG_ERROR(Tag("Failed to open codec: " + AvErrorToString(ret)));
+    return false;
+  }
+  LOG_INFO(Tag(std::string("Decoder ") + codec->name + " threading: " + DescribeThreading(decode->codec_ctx)));
+  return true;
+}
+
+// Route one compressed packet to the decoder and the packet callback.
+//
+// When no sink needs frames (kFormatNone) decoding stops as soon as the
+// decoder has reported the stream dimensions, which muxers need for the
+// file header. From then on a packet costs no decoding at all.
+// With keyframe-only decoding, packets SelectKeyframe() rejects are not
+// decoded either. Every packet still reaches the packet callback, with
+// AV_PKT_FLAG_KEY set on keyframes the demuxer left unflagged (stream-copy
+// recording starts at the first flagged packet).
+//
+// Param: decode - Opened decoder state
+// Param: packet - Encoded frame with pts in decode->time_base
+// Returns: false on a fatal conversion error
+bool RtpReceiver::HandlePacket(DecodeContext* decode, AVPacket* packet) {
+  if (decode->session_packets++ == 0 && decode->lost_us > 0) {
+    LOG_INFO(Tag("Stream recovered after " + std::to_string((util::NowMicros() - decode->lost_us) / 1000) + " ms"));
+    decode->lost_us = 0;
+  }
+  const uint32_t formats = output_formats_.load(std::memory_order_relaxed);
+  AVCodecParameters* codecpar = decode->codecpar;
+  if (!(packet->flags & AV_PKT_FLAG_KEY) && IsKeyPacket(codecpar->codec_id, packet)) {
+    packet->flags |= AV_PKT_FLAG_KEY;
+  }
+  bool decode_packet = formats != media::kFormatNone || codecpar->width <= 0;
+  if (decode_packet && options_.decode.keyframes_only && !SelectKeyframe(decode, packet)) {
+    metrics_.decode_skipped->Add();
+    decode_packet = false;
+  }
+  if (decode_packet && !Decode(decode, packet, formats)) {
+    return false;
+  }
+  if (codecpar->width <= 0 && decode->codec_ctx->width > 0) {
+    codecpar->width = decode->codec_ctx->width;
+    codecpar->height = decode->codec_ctx->height;
+    codecpar->format = decode->codec_ctx->pix_fmt;
+    codecpar->sample_aspect_ratio = decode->codec_ctx->sample_aspect_ratio;
+  }
+  if (on_packet_) {
+    on_packet_(EncodedPacket{packet, codecpar, decode->time_base});
+  }
+  return true;
+}
+
+// Keyframe-only decoding. HandlePacket() has already flagged keyframes
+// (see IsKeyPacket()). With an interval, keyframes closer than
+// keyframe_interval_ms to the last decoded one are skipped too (a
+// backwards PTS jump restarts the schedule).
+//
+// Param: decode - Decoder state (holds the last decoded keyframe time)
+// Param: packet - Encoded frame with pts in decode->time_base
+// Returns: true if the packet should be decoded
+bool RtpReceiver::SelectKeyframe(DecodeContext* decode, const AVPacket* packet) {
+  if (!(packet->flags & AV_PKT_FLAG_KEY)) {
+    return false;
+  }
+
+  const int64_t interval_us = static_cast<int64_t>(options_.decode.keyframe_interval_ms) * 1000;
+  if (interval_us > 0) {
+    const int64_t now_us = packet->pts != AV_NOPTS_VALUE
+                               ? av_rescale_q(packet->pts, decode->time_base, AVRational{1, 1000000})
+                               : util::NowMicros();
+    if (decode->last_keyframe_us >= 0 && now_us >= decode->last_keyframe_us &&
+        now_us - decode->last_keyframe_us < interval_us) {
+      return false;
+    }
+    decode->last_keyframe_us = now_us;
+  }
+  return true;
+}
+
+// Send one packet to the decoder and deliver every frame it produces.
+//
+// Frames are converted straight into pooled buffers, so sinks can keep
+// them without copying and steady-state decoding allocates nothing.
+// Only the representations some sink asked for are produced (see
+// SetOutputFormats()).
+//
+// Param: decode - Opened decoder state
+// Param: packet - Encoded frame with pts in decode->time_base
+// Param: formats - media::FrameFormat bitmask to produce
+// Returns: false on a fatal conversion error, true otherwise (decode
+//          errors are logged and skipped)
+bool RtpReceiver::Decode(DecodeContext* decode, const AVPacket* packet, uint32_t formats) {
+  const bool want_bgr = (formats & media::kFormatBgr) != 0;
+  const bool want_native = (formats & media::kFormatNative) != 0;
+  const AVRational us_time_base{1, 1000000};
+  AVFrame* frame = decode->frame;
+
+  // Send packet to decoder. Decode time excludes conversion and the
+  // callback, which are measured (or owned) elsewhere.
+  int64_t start_us = util::NowMicros();
+  int ret = avcodec_send_packet(decode->codec_ctx, packet);
+  int64_t decode_us = util::NowMicros() - start_us;
+  if (ret < 0) {
+    metrics_.decode->Observe(decode_us);
+    metrics_.decode_errors->Add();
+    LOG_WARN(Tag("Failed to send packet: " + AvErrorToString(ret)));
+    return true;
+  }
+
+  // Receive all frames from this packet (may be 0 or multiple)
+  while (ret >= 0) {
+    start_us = util::NowMicros();
+    ret = avcodec_receive_frame(decode->codec_ctx, frame);
+    decode_us += util::NowMicros() - start_us;
+    if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
+      // Need more input or end of stream
+      break;
+    }
+    if (ret < 0) {
+      // Decode error
+      metrics_.decode_errors->Add();
+      LOG_WARN(Tag("Failed to decode frame: " + AvErrorToString(ret)));
+      break;
+    }
+
+    // Validate frame dimensions
+    const int width = frame->width;
+    const int height = frame->height;
+    if (width <= 0 || height <= 0) {
+      continue;
+    }
+
+    // The BGR image has the converter's output size (after crop and
+    // resize), the native frame the decoder's
+    const cv::Size bgr_size = decode->converter.OutputSize(width, height);
+    media::FrameRef out = want_bgr ? frame_pool_.Acquire(bgr_size.height, bgr_size.width, CV_8UC3)
+                                   : frame_pool_.AcquireEmpty();
+    media::Frame& decoded = out.mutable_frame();
+    decoded.width = want_bgr ? bgr_size.width : width;
+    decoded.height = want_bgr ? bgr_size.height : height;
+
+    if (want_native && !out.AttachNative(frame)) {
+      LOG_WARN(Tag("Failed to reference decoded frame"));
+      continue;
+    }
+
+    // Convert pixel format (e.g., YUV420P -> BGR24), crop and resize into
+    // the pooled Mat in one pass, in parallel slices if configured
+    if (want_bgr) {
+      start_us = util::NowMicros();
+      if (!decode->converter.Convert(frame, decoded.bgr)) {
+        return false;
+      }
+      metrics_.convert->Observe(util::NowMicros() - start_us);
+    }
+
+    decoded.sequence = ++decode->sequence;
+    decoded.key_frame = IsKeyFrame(frame);
+    if (frame->best_effort_timestamp != AV_NOPTS_VALUE) {
+      decoded.pts_us = av_rescale_q(frame->best_effort_timestamp, decode->time_base, us_time_base);
+    }
+    if (decode->first_frame_pending) {
+      decode->first_frame_pending = false;
+      LOG_INFO(Tag("First frame " + std::to_string(width) + "x" + std::to_string(height) + " after " +
+                   std::to_string((av_gettime_relative() - decode->start_us) / 1000) + " ms"));
+    }
+
+    // Invoke callback with the decoded frame
+    metrics_.frames->Add();
+    if (on_frame_) {
+      on_frame_(out);
+    }
+  }
+  metrics_.decode->Observe(decode_us);
+  return true;
+}
+
+// One session on libavformat's RTP demuxer.
+//
+// This method orchestrates the FFmpeg pipeline:
+//   1. Open RTP input (network or SDP file), with InterruptCallback()
+//      installed so Stop() and stalls abort blocking reads
+//   2. Detect stream format and codec (probing, see options below). On a
+//      reconnect the input already names the decoder's codec, and the
+//      probe is skipped
+//   3. Initialize decoder context (threading per ReceiverOptions::decode),
+//      or keep the previous session's (see OpenDecoder())
+//   4. Read packets and hand them to HandlePacket(); a read waiting longer
+//      than ReconnectOptions::read_timeout_ms ends the session as a stall
 //
 // FFmpeg context cleanup:
 //   - All allocated resources are freed on error or exit
 //   - Follows FFmpeg resource allocation pattern
 //
-// Returns: true on successful shutdown, false on initialization error
+// Param: decode - Decoder state kept across sessions
+// Returns: how the session ended
 // Side effects:
 //   - Initializes FFmpeg network subsystem
-//   - Runs on the calling thread (blocking)
-//   - Invokes on_frame_ callback for each decoded frame
-bool RtpReceiver::Run() {
-  running_ = true;
+RtpReceiver::SessionEnd RtpReceiver::RunAvformat(DecodeContext* decode) {
   avformat_network_init();
 
-  AVFormatContext* format_ctx = nullptr;
+  AVFormatContext* format_ctx = avformat_alloc_context();
+  if (!format_ctx) {
+    LOG_ERROR(Tag("Failed to allocate format context"));
+    return SessionEnd::kSetupFailed;
+  }
+  format_ctx->interrupt_callback.callback = &RtpReceiver::InterruptCallback;
+  format_ctx->interrupt_callback.opaque = this;
+  read_deadline_us_ = 0;
+
   AVDictionary* options = nullptr;
 
   // Configure FFmpeg input options:
@@ -66,198 +660,682 @@ bool RtpReceiver::Run() {
   av_dict_set(&options, "protocol_whitelist", "file,udp,rtp", 0);
   av_dict_set(&options, "analyzeduration", "10000000", 0);
   av_dict_set(&options, "probesize", "5000000", 0);
+  // - buffer_size: UDP socket receive buffer (SO_RCVBUF); the kernel
+  //   default overflows on a single high-resolution keyframe burst
+  if (options_.udp.receive_buffer_bytes > 0) {
+    av_dict_set_int(&options, "buffer_size", options_.udp.receive_buffer_bytes, 0);
+  }
+  // avformat_open_input() frees format_ctx on failure
   int ret = avformat_open_input(&format_ctx, url_.c_str(), nullptr, &options);
   av_dict_free(&options);
   if (ret < 0) {
-    LOG_ERROR("Failed to open input: " + AvErrorToString(ret));
-    return false;
+    if (running()) {
+      LOG_ERROR(Tag("Failed to open input: " + AvErrorToString(ret)));
+    }
+    return running() ? SessionEnd::kSetupFailed : SessionEnd::kStopped;
   }
 
-  // Analyze stream to find codec parameters
-  ret = avformat_find_stream_info(format_ctx, nullptr);
-  if (ret < 0) {
-    LOG_ERROR("Failed to find stream info: " + AvErrorToString(ret));
-    avformat_close_input(&format_ctx);
-    return false;
+  // Analyze stream to find codec parameters, unless this is a reconnect
+  // and the SDP already names the codec the open decoder handles
+  bool probe = true;
+  if (decode->codecpar) {
+    for (unsigned i = 0; i < format_ctx->nb_streams; ++i) {
+      const AVCodecParameters* par = format_ctx->streams[i]->codecpar;
+      if (par->codec_type == AVMEDIA_TYPE_VIDEO && par->codec_id == decode->codecpar->codec_id) {
+        probe = false;
+      }
+    }
+  }
+  if (probe) {
+    ret = avformat_find_stream_info(format_ctx, nullptr);
+    if (ret < 0) {
+      if (running()) {
+        LOG_ERROR(Tag("Failed to find stream info: " + AvErrorToString(ret)));
+      }
+      avformat_close_input(&format_ctx);
+      return running() ? SessionEnd::kSetupFailed : SessionEnd::kStopped;
+    }
   }
 
   // Find the video stream in the input (could be multiple streams: audio, video, etc.)
   int video_stream_index = av_find_best_stream(format_ctx, AVMEDIA_TYPE_VIDEO, -1, -1, nullptr, 0);
   if (video_stream_index < 0) {
-    LOG_ERROR("No video stream found: " + AvErrorToString(video_stream_index));
+    LOG_ERROR(Tag("No video stream found: " + AvErrorToString(video_stream_index)));
     avformat_close_input(&format_ctx);
-    return false;
+    return SessionEnd::kSetupFailed;
   }
 
   // Get codec parameters from the stream
   AVStream* video_stream = format_ctx->streams[video_stream_index];
   const AVCodec* codec = avcodec_find_decoder(video_stream->codecpar->codec_id);
   if (!codec) {
-    LOG_ERROR("No decoder for codec id: " + std::to_string(video_stream->codecpar->codec_id));
-    avformat_close_input(&format_ctx);
-    return false;
-  }
-
-  // Allocate codec context and copy parameters from stream
-  AVCodecContext* codec_ctx = avcodec_alloc_context3(codec);
-  if (!codec_ctx) {
-    LOG_ERROR("Failed to allocate codec context");
+    LOG_ERROR(Tag("No decoder for codec id: " + std::to_string(video_stream->codecpar->codec_id)));
     avformat_close_input(&format_ctx);
-    return false;
+    return SessionEnd::kSetupFailed;
   }
-
-  ret = avcodec_parameters_to_context(codec_ctx, video_stream->codecpar);
-  if (ret < 0) {
-    LOG_ERROR("Failed to copy codec parameters: " + AvErrorToString(ret));
-    avcodec_free_context(&codec_ctx);
-    avformat_close_input(&format_ctx);
-    return false;
-  }
-
-  // Open the decoder
-  ret = avcodec_open2(codec_ctx, codec, nullptr);
-  if (ret < 0) {
-    LOG_ERROR("Failed to open codec: " + AvErrorToString(ret));
-    avcodec_free_context(&codec_ctx);
+  if (!OpenDecoder(codec, video_stream->codecpar, decode)) {
     avformat_close_input(&format_ctx);
-    return false;
+    return SessionEnd::kSetupFailed;
   }
-
-  // Prepare swscale context for pixel format conversion
-  // FFmpeg decodes to YUV (usually), OpenCV needs BGR
-  SwsContext* sws_ctx = nullptr;
+  decode->SetTimeBase(video_stream->time_base);
 
   AVPacket* packet = av_packet_alloc();
-  AVFrame* frame = av_frame_alloc();
-  if (!packet || !frame) {
-    LOG_ERROR("Failed to allocate packet/frame");
-    av_packet_free(&packet);
-    av_frame_free(&frame);
-    sws_freeContext(sws_ctx);
-    avcodec_free_context(&codec_ctx);
+  if (!packet) {
+    LOG_ERROR(Tag("Failed to allocate packet"));
     avformat_close_input(&format_ctx);
-    return false;
+    return SessionEnd::kSetupFailed;
   }
 
-  // OpenCV Mat to hold the BGR frame (reused for each frame)
-  cv::Mat bgr;
-  int last_width = 0;
-  int last_height = 0;
-
   // Main receive loop: read packets, decode, convert, callback
-  while (running_) {
+  constexpr int kRetryMs = 10;
+  const int64_t read_timeout_us = static_cast<int64_t>(options_.reconnect.read_timeout_ms) * 1000;
+  SessionEnd end = SessionEnd::kStopped;
+  while (running()) {
+    const int64_t read_start_us = util::NowMicros();
+    read_deadline_us_ = read_timeout_us > 0 ? read_start_us + read_timeout_us : 0;
     ret = av_read_frame(format_ctx, packet);
+    read_deadline_us_ = 0;
+    metrics_.receive->Observe(util::NowMicros() - read_start_us);
     if (ret == AVERROR(EAGAIN)) {
-      // Temporary failure, try again
+      // No data yet (non-blocking input): back off on the stop event
+      // instead of spinning on av_read_frame()
+      stop_event_.Wait(kRetryMs);
       continue;
     }
     if (ret < 0) {
-      // Stream ended or error
-      LOG_INFO("Stream ended or error: " + AvErrorToString(ret));
+      if (!running()) {
+        // Stop() interrupted the read
+        break;
+      }
+      if (ret == AVERROR_EXIT) {
+        LOG_WARN(Tag("No data for " + std::to_string(options_.reconnect.read_timeout_ms) + " ms, stream stalled"));
+      } else {
+        // Stream ended or error
+        LOG_INFO(Tag("Stream ended or error: " + AvErrorToString(ret)));
+      }
+      end = SessionEnd::kStreamLost;
       break;
     }
 
     // Only process packets from the video stream
+    bool ok = true;
     if (packet->stream_index == video_stream_index) {
-      // Send packet to decoder
-      ret = avcodec_send_packet(codec_ctx, packet);
-      if (ret < 0) {
-        LOG_WARN("Failed to send packet: " + AvErrorToString(ret));
-      } else {
-        // Receive all frames from this packet (may be 0 or multiple)
-        while (ret >= 0) {
-          ret = avcodec_receive_frame(codec_ctx, frame);
-          if (ret == AVERROR(EAGAIN) || ret == AVERROR_EOF) {
-            // Need more input or end of stream
-            break;
-          }
-          if (ret < 0) {
-            // Decode error
-            LOG_WARN("Failed to decode frame: " + AvErrorToString(ret));
-            break;
-          }
-
-          // Validate frame dimensions
-          const int width = frame->width;
-          const int height = frame->height;
-          if (width <= 0 || height <= 0) {
-            continue;
-          }
-
-          // Reinitialize swscale context if frame size changed
-          // This can happen if the stream switches resolution
-          if (width != last_width || height != last_height || !sws_ctx) {
-            if (sws_ctx) {
-              sws_freeContext(sws_ctx);
-            }
-            // Create swscale context: convert from source format to BGR24
-            sws_ctx = sws_getContext(width,
-                                     height,
-                                     static_cast<AVPixelFormat>(frame->format),
-                                     width,
-                                     height,
-                                     AV_PIX_FMT_BGR24,
-                                     SWS_BILINEAR,
-                                     nullptr,
-                                     nullptr,
-                                     nullptr);
-            if (!sws_ctx) {
-              LOG_ERROR("Failed to create swscale context");
-              av_packet_unref(packet);
-              av_packet_free(&packet);
-              av_frame_free(&frame);
-              avcodec_free_context(&codec_ctx);
-              avformat_close_input(&format_ctx);
-              return false;
-            }
-            // Allocate OpenCV Mat for BGR data (reused)
-            bgr = cv::Mat(height, width, CV_8UC3);
-            last_width = width;
-            last_height = height;
-          }
-
-          // Prepare destination arrays for swscale
-          // OpenCV Mat is BGR packed (single buffer)
-          uint8_t* dst_data[4] = {bgr.data, nullptr, nullptr, nullptr};
-          int dst_linesize[4] = {static_cast<int>(bgr.step[0]), 0, 0, 0};
-
-          // Convert pixel format (e.g., YUV420P -> BGR24)
-          sws_scale(sws_ctx,
-                    frame->data,
-                    frame->linesize,
-                    0,
-                    height,
-                    dst_data,
-                    dst_linesize);
-
-          // Invoke callback with decoded BGR frame
-          if (on_frame_) {
-            on_frame_(bgr);
-          }
-        }
-      }
+      metrics_.packets->Add();
+      metrics_.bytes->Add(static_cast<uint64_t>(packet->size));
+      decode->timeline.Continue(packet, decode->time_base, util::NowMicros());
+      ok = HandlePacket(decode, packet);
     }
 
     // Unref packet to free its internal buffers
     av_packet_unref(packet);
+    if (!ok) {
+      end = SessionEnd::kFatal;
+      break;
+    }
   }
 
   // Cleanup: release all FFmpeg resources in reverse order of allocation
   av_packet_free(&packet);
-  av_frame_free(&frame);
-  if (sws_ctx) {
-    sws_freeContext(sws_ctx);
-  }
-  avcodec_free_context(&codec_ctx);
   avformat_close_input(&format_ctx);
+  return end;
+}
+
+// Socket side of the native ingest: the UDP socket, jitter buffer and
+// depacketizer of one session, plus the state that follows the sender
+// (SSRC, RTP timestamp unwrapping, stall detection).
+//
+// Shared by both ways of driving it:
+//   - RunNative(): the Run() thread waits on the socket itself and
+//     decodes every completed frame inline (no strand)
+//   - Attach(): a Reactor thread calls OnReadable()/OnTimer(), and each
+//     completed frame is copied and posted to the stream's strand, where
+//     it is decoded on the shared decode pool
+//
+// The I/O side never touches the DecodeContext: timeline resets
+// (PtsTimeline::Rebase()) travel with the frame to whoever decodes it.
+class RtpReceiver::NativeIngest : public ReactorHandler {
+ public:
+  // Param: receiver - Owner (options, metrics, decode path)
+  // Param: decode - Decoder state; used on the decoding side only
+  // Param: strand - Decode queue for reactor mode; nullptr decodes inline
+  NativeIngest(RtpReceiver* receiver, DecodeContext* decode, util::Strand* strand)
+      : receiver_(receiver), decode_(decode), strand_(strand), socket_(receiver->options_.udp),
+        jitter_(receiver->options_.jitter) {}
+
+  ~NativeIngest() override { av_packet_free(&packet_); }
+
+  NativeIngest(const NativeIngest&) = delete;
+  NativeIngest& operator=(const NativeIngest&) = delete;
+
+  // Describe the stream, open the decoder and bind the socket.
+  // Returns: false (after logging) on failure
+  bool Open();
+
+  // Handle the datagrams the socket just read (possibly none): stall
+  // detection, reordering, gap expiry, depacketizing, and delivery of
+  // every completed frame.
+  // Returns: false on a fatal decode error (inline decoding only)
+  bool Process(int received);
+
+  // Log the session's packet and frame counters.
+  void LogStats() const;
+
+  UdpSource& socket() { return socket_; }
+
+  // ReactorHandler
+  int fd() const override { return socket_.fd(); }
+  bool OnReadable() override;
+  int64_t NextDeadlineUs() const override;
+  void OnTimer() override;
+
+ private:
+  // A completed frame copied for the decode pool (reactor mode).
+  struct QueuedFrame {
+    std::vector<uint8_t> data;  // Frame followed by zeroed input padding
+    size_t size = 0;
+    int64_t pts = 0;
+    bool key = false;
+    bool rebase = false;  // Start a new timeline (see PtsTimeline)
+  };
+
+  // Hand the depacketizer's current frame to the decoder, inline or via
+  // the strand.
+  // Returns: false on a fatal decode error (inline decoding only)
+  bool Deliver(int64_t pts);
+
+  // Decoding side: timestamps, HandlePacket(). Runs inline or on the
+  // strand, one frame at a time.
+  // Returns: false on a fatal decode error
+  bool DecodeFrame(const uint8_t* data, size_t size, int64_t pts, bool key, bool rebase);
+
+  // Reactor mode: a free frame buffer, or nullptr when kMaxDecodeBacklog
+  // frames are already waiting for the decoder.
+  QueuedFrame* AcquireFrame();
+  void ReleaseFrame(QueuedFrame* frame);
+
+  RtpReceiver* receiver_;
+  DecodeContext* decode_;
+  util::Strand* strand_;
+
+  RtpSession session_;
+  UdpSource socket_;
+  JitterBuffer jitter_;
+  std::unique_ptr<Depacketizer> depacketizer_;
+
+  // Decode-side packet (points into the depacketizer or a QueuedFrame)
+  AVPacket* packet_ = nullptr;
+
+  // Sender state, I/O side
+  int64_t last_receive_us_ = 0;
+  bool stalled_ = false;
+  bool have_ssrc_ = false;
+  uint32_t ssrc_ = 0;
+  bool have_pts_ = false;
+  uint32_t last_timestamp_ = 0;
+  int64_t pts_ = 0;
+  bool rebase_ = false;  // Next delivered frame starts a new timeline
+
+  // Counters, I/O side
+  uint64_t invalid_ = 0;
+  uint64_t reported_lost_ = 0;
+  uint64_t reported_drops_ = 0;
+
+  // Reactor mode: frame buffers (all_ owns them, free_ is the freelist)
+  // and whether decoding hit a fatal error
+  std::mutex frames_mutex_;
+  std::vector<std::unique_ptr<QueuedFrame>> all_frames_;
+  std::vector<QueuedFrame*> free_frames_;
+  std::atomic<bool> fatal_{false};
+};
+
+// Describe the stream from the SDP (or rtp:// URL): port, payload type,
+// codec, H.264 parameter sets. Nothing is probed. Then open the decoder
+// for that codec and bind the socket.
+bool RtpReceiver::NativeIngest::Open() {
+  static_assert(Depacketizer::kPadding >= AV_INPUT_BUFFER_PADDING_SIZE,
+                "depacketized frames must carry libavcodec's input padding");
+  std::string error;
+  if (!LoadRtpSession(receiver_->url_, &session_, &error)) {
+    LOG_ERROR(receiver_->Tag("Invalid RTP source: " + error));
+    return false;
+  }
+  const AVCodecID codec_id = session_.codec == RtpCodec::kH264 ? AV_CODEC_ID_H264 : AV_CODEC_ID_VP8;
+  const AVCodec* codec = avcodec_find_decoder(codec_id);
+  if (!codec) {
+    LOG_ERROR(receiver_->Tag("No decoder for codec id: " + std::to_string(codec_id)));
+    return false;
+  }
+
+  // Build the codec parameters libavformat would have probed
+  AVCodecParameters* codecpar = avcodec_parameters_alloc();
+  if (!codecpar) {
+    LOG_ERROR(receiver_->Tag("Failed to allocate codec parameters"));
+    return false;
+  }
+  codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+  codecpar->codec_id = codec_id;
+  if (!session_.parameter_sets.empty()) {
+    codecpar->extradata =
+        static_cast<uint8_t*>(av_mallocz(session_.parameter_sets.size() + AV_INPUT_BUFFER_PADDING_SIZE));
+    if (codecpar->extradata) {
+      std::memcpy(codecpar->extradata, session_.parameter_sets.data(), session_.parameter_sets.size());
+      codecpar->extradata_size = static_cast<int>(session_.parameter_sets.size());
+    }
+  }
+  const bool opened = receiver_->OpenDecoder(codec, codecpar, decode_);
+  avcodec_parameters_free(&codecpar);
+  if (!opened) {
+    return false;
+  }
+  decode_->SetTimeBase(AVRational{1, session_.clock_rate});
+
+  if (!socket_.Open(session_.address, session_.port, &error)) {
+    LOG_ERROR(receiver_->Tag("Failed to open RTP socket: " + error));
+    return false;
+  }
+  const ReceiverOptions& options = receiver_->options_;
+  LOG_INFO(receiver_->Tag(
+      std::string(strand_ ? "Reactor" : "Native") + " RTP ingest on " + session_.address + ":" +
+      std::to_string(session_.port) + " (" + codec->name + ", jitter depth " + std::to_string(options.jitter.depth) +
+      " packets / " + std::to_string(options.jitter.max_delay_ms) + " ms, batch " +
+      std::to_string(options.udp.batch_size) + ", receive buffer " + std::to_string(socket_.receive_buffer_bytes()) +
+      " bytes)"));
+
+  depacketizer_ = CreateDepacketizer(session_.codec);
+  packet_ = av_packet_alloc();
+  if (!packet_) {
+    LOG_ERROR(receiver_->Tag("Failed to allocate packet"));
+    return false;
+  }
+  last_receive_us_ = util::NowMicros();
+  return true;
+}
+
+// Per batch:
+//   - Stall detection: after a silence longer than read_timeout_ms, drop
+//     partial state so the next packet starts over like a new sender
+//   - ParseRtpPacket: drop non-RTP and multiplexed RTCP, then (with a
+//     payload type from the SDP) other payload types
+//   - A new SSRC (sender restarted) resets the jitter buffer and the
+//     depacketizer, which then waits for the new sender's keyframe
+//   - JitterBuffer: reorder, expire gaps after --jitter-delay-ms
+//   - Depacketizer: reassemble frames, drop damaged ones, hold back
+//     everything before the first keyframe
+//   - Deliver() each completed frame
+//
+// Receive time covers parsing, reordering and depacketizing, but not the
+// decoding (measured separately) or the wait for the socket.
+bool RtpReceiver::NativeIngest::Process(int received) {
+  StageMetrics& metrics = receiver_->metrics_;
+  const int read_timeout_ms = receiver_->options_.reconnect.read_timeout_ms;
+  if (received > 0) {
+    if (stalled_) {
+      LOG_INFO(receiver_->Tag("RTP packets resumed after " +
+                              std::to_string((util::NowMicros() - last_receive_us_) / 1000) + " ms"));
+      stalled_ = false;
+    }
+    last_receive_us_ = util::NowMicros();
+  } else if (read_timeout_ms > 0 && have_ssrc_ &&
+             util::NowMicros() - last_receive_us_ > static_cast<int64_t>(read_timeout_ms) * 1000) {
+    LOG_WARN(receiver_->Tag("No RTP packets for " + std::to_string(read_timeout_ms) + " ms, waiting for the sender"));
+    stalled_ = true;
+    have_ssrc_ = false;
+    have_pts_ = false;
+    rebase_ = true;
+    jitter_.Reset();
+    depacketizer_->Reset();
+  }
+
+  int64_t start_us = util::NowMicros();
+  int64_t receive_us = 0;
+  for (int i = 0; i < received; ++i) {
+    metrics.packets->Add();
+    metrics.bytes->Add(socket_.size(i));
+    RtpPacket rtp;
+    if (!ParseRtpPacket(socket_.data(i), socket_.size(i), &rtp) ||
+        (session_.payload_type >= 0 && rtp.payload_type != session_.payload_type)) {
+      ++invalid_;
+      continue;
+    }
+    if (!have_ssrc_ || rtp.ssrc != ssrc_) {
+      if (have_ssrc_) {
+        LOG_INFO(receiver_->Tag("RTP sender changed SSRC, waiting for a keyframe"));
+        have_pts_ = false;
+        rebase_ = true;
+      }
+      jitter_.Reset();
+      depacketizer_->Reset();
+      have_ssrc_ = true;
+      ssrc_ = rtp.ssrc;
+    }
+    jitter_.Insert(rtp);
+  }
+
+  // Release packets in order and deliver every completed frame
+  bool ok = true;
+  while (const JitterBuffer::Entry* entry = jitter_.Pop(util::NowMicros())) {
+    if (!depacketizer_->Push(entry->packet, entry->after_loss)) {
+      continue;
+    }
+
+    // Unwrap the 32-bit RTP timestamp into a monotonic pts
+    if (have_pts_) {
+      pts_ += static_cast<int32_t>(depacketizer_->frame_timestamp() - last_timestamp_);
+    }
+    have_pts_ = true;
+    last_timestamp_ = depacketizer_->frame_timestamp();
+
+    receive_us += util::NowMicros() - start_us;
+    if (!Deliver(pts_)) {
+      ok = false;
+      break;
+    }
+    start_us = util::NowMicros();
+  }
+  if (received > 0) {
+    metrics.receive->Observe(receive_us + util::NowMicros() - start_us);
+  }
+
+  // Both totals only grow; publish the increase since the last batch
+  const uint64_t lost = jitter_.GetStats().lost;
+  metrics.lost_packets->Add(lost - reported_lost_);
+  reported_lost_ = lost;
+  metrics.kernel_drops->Add(socket_.kernel_drops() - reported_drops_);
+  reported_drops_ = socket_.kernel_drops();
+  return ok;
+}
+
+// Inline: decode straight from the depacketizer's buffer, which is padded
+// and outlives the call (avcodec_send_packet() copies unreferenced data).
+//
+// Reactor mode: copy the frame into a pooled buffer and post its decoding
+// to the strand. If the decoder has fallen kMaxDecodeBacklog frames
+// behind, drop this frame and make the depacketizer wait for the next
+// keyframe, so the decoder never sees a frame whose reference is missing
+// and the backlog cannot grow without bound.
+bool RtpReceiver::NativeIngest::Deliver(int64_t pts) {
+  const bool rebase = rebase_;
+  rebase_ = false;
+  if (!strand_) {
+    return DecodeFrame(depacketizer_->frame_data(), depacketizer_->frame_size(), pts, depacketizer_->frame_key(),
+                       rebase);
+  }
+
+  QueuedFrame* frame = AcquireFrame();
+  if (!frame) {
+    receiver_->metrics_.backlog_dropped->Add();
+    LOG_WARN(receiver_->Tag("Decoder " + std::to_string(kMaxDecodeBacklog) +
+                            " frames behind, dropping until the next keyframe"));
+    depacketizer_->Reset();
+    rebase_ = rebase;
+    return true;
+  }
+  const size_t size = depacketizer_->frame_size();
+  frame->data.resize(size + AV_INPUT_BUFFER_PADDING_SIZE);
+  std::memcpy(frame->data.data(), depacketizer_->frame_data(), size);
+  std::memset(frame->data.data() + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+  frame->size = size;
+  frame->pts = pts;
+  frame->key = depacketizer_->frame_key();
+  frame->rebase = rebase;
+  strand_->Post([this, frame]() {
+    if (!fatal_.load(std::memory_order_relaxed) && receiver_->running() &&
+        !DecodeFrame(frame->data.data(), frame->size, frame->pts, frame->key, frame->rebase)) {
+      fatal_.store(true, std::memory_order_relaxed);
+      LOG_ERROR(receiver_->Tag("Fatal decode error, no more frames from this stream"));
+    }
+    ReleaseFrame(frame);
+  });
   return true;
 }
 
+bool RtpReceiver::NativeIngest::DecodeFrame(const uint8_t* data, size_t size, int64_t pts, bool key, bool rebase) {
+  packet_->data = const_cast<uint8_t*>(data);
+  packet_->size = static_cast<int>(size);
+  packet_->pts = pts;
+  packet_->dts = AV_NOPTS_VALUE;
+  packet_->flags = key ? AV_PKT_FLAG_KEY : 0;
+  if (rebase) {
+    decode_->timeline.Rebase();
+  }
+  decode_->timeline.Continue(packet_, decode_->time_base, util::NowMicros());
+  return receiver_->HandlePacket(decode_, packet_);
+}
+
+// Buffers are allocated on first use and kept; the frame copy into a
+// recycled buffer reuses its capacity.
+RtpReceiver::NativeIngest::QueuedFrame* RtpReceiver::NativeIngest::AcquireFrame() {
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  if (!free_frames_.empty()) {
+    QueuedFrame* frame = free_frames_.back();
+    free_frames_.pop_back();
+    return frame;
+  }
+  if (all_frames_.size() >= kMaxDecodeBacklog) {
+    return nullptr;
+  }
+  all_frames_.push_back(std::make_unique<QueuedFrame>());
+  return all_frames_.back().get();
+}
+
+void RtpReceiver::NativeIngest::ReleaseFrame(QueuedFrame* frame) {
+  std::lock_guard<std::mutex> lock(frames_mutex_);
+  free_frames_.push_back(frame);
+}
+
+// Drain one recvmmsg() batch. The socket is level-triggered, so a burst
+// larger than the batch is read over several wakeups, interleaved with
+// the thread's other streams.
+bool RtpReceiver::NativeIngest::OnReadable() {
+  const int received = socket_.Read();
+  if (received < 0) {
+    const bool reconnect = receiver_->options_.reconnect.enabled;
+    LOG_ERROR(receiver_->Tag(std::string(reconnect ? "RTP socket error: " : "RTP socket error, stream detached: ") +
+                             std::strerror(errno)));
+    if (reconnect) {
+      RtpReceiver* receiver = receiver_;
+      strand_->Post([receiver]() { receiver->Reattach(); });
+    }
+    return false;
+  }
+  Process(received);
+  return true;
+}
+
+// The earlier of the jitter buffer's open gap expiring and the stall
+// timeout (only while a sender is known), on util::NowMicros().
+int64_t RtpReceiver::NativeIngest::NextDeadlineUs() const {
+  int64_t deadline = jitter_.NextDeadlineUs();
+  const int read_timeout_ms = receiver_->options_.reconnect.read_timeout_ms;
+  if (read_timeout_ms > 0 && have_ssrc_) {
+    const int64_t stall_us = last_receive_us_ + static_cast<int64_t>(read_timeout_ms) * 1000 + 1;
+    deadline = deadline < 0 ? stall_us : std::min(deadline, stall_us);
+  }
+  return deadline;
+}
+
+void RtpReceiver::NativeIngest::OnTimer() {
+  Process(0);
+}
+
+void RtpReceiver::NativeIngest::LogStats() const {
+  const JitterStats jitter_stats = jitter_.GetStats();
+  LOG_INFO(receiver_->Tag("RTP packets: received=" + std::to_string(jitter_stats.received) +
+                          " lost=" + std::to_string(jitter_stats.lost) +
+                          " late=" + std::to_string(jitter_stats.late) +
+                          " duplicates=" + std::to_string(jitter_stats.duplicates) +
+                          " resets=" + std::to_string(jitter_stats.resets) +
+                          " invalid=" + std::to_string(invalid_ + socket_.truncated()) +
+                          " kernel_drops=" + std::to_string(socket_.kernel_drops()) +
+                          " max_batch=" + std::to_string(socket_.max_batch())));
+  if (depacketizer_) {
+    const DepacketizerStats frame_stats = depacketizer_->GetStats();
+    LOG_INFO(receiver_->Tag("RTP frames: complete=" + std::to_string(frame_stats.frames) +
+                            " dropped=" + std::to_string(frame_stats.dropped_frames) +
+                            " before_keyframe=" + std::to_string(frame_stats.skipped_frames)));
+  }
+}
+
+// Receive loop on a plain UDP socket, on the Run() thread (see
+// NativeIngest for the packet path).
+//
+// The socket wait lasts until a datagram arrives, Stop() sets the stop
+// event, the jitter buffer's open gap expires or the stall timeout is
+// due, whichever comes first. An idle stream blocks in poll() and uses no
+// CPU.
+//
+// The socket stays bound across sender restarts and stalls, so a
+// publisher reconnecting to the same port is picked up without a new
+// session. Only socket errors end the session.
+//
+// Param: decode - Decoder state kept across sessions
+// Returns: how the session ended
+RtpReceiver::SessionEnd RtpReceiver::RunNative(DecodeContext* decode) {
+  constexpr int kNoEventWaitMs = 10;
+  NativeIngest ingest(this, decode, nullptr);
+  if (!ingest.Open()) {
+    return SessionEnd::kSetupFailed;
+  }
+
+  SessionEnd end = SessionEnd::kStopped;
+  while (running()) {
+    // Sleep until the earliest deadline, or indefinitely while idle
+    int wait_ms = -1;
+    const int64_t deadline_us = ingest.NextDeadlineUs();
+    if (deadline_us >= 0) {
+      wait_ms = static_cast<int>(std::max<int64_t>(0, (deadline_us - util::NowMicros() + 999) / 1000));
+    }
+    if (stop_event_.fd() < 0 && (wait_ms < 0 || wait_ms > kNoEventWaitMs)) {
+      wait_ms = kNoEventWaitMs;  // No eventfd to wake us: poll the flag
+    }
+    const int received = ingest.socket().Receive(wait_ms, stop_event_.fd());
+    if (received < 0) {
+      LOG_ERROR(Tag(std::string("RTP socket error: ") + std::strerror(errno)));
+      end = SessionEnd::kStreamLost;
+      break;
+    }
+    if (!ingest.Process(received)) {
+      end = SessionEnd::kFatal;
+      break;
+    }
+  }
+  ingest.LogStats();
+  return end;
+}
+
+// Reactor mode setup: everything RunNative() does before its loop, on the
+// caller's thread, then hand the socket to the reactor.
+//
+// Param: reactor - I/O threads; must outlive the attachment
+// Param: decode_pool - Decode workers; must outlive the attachment
+// Returns: false (after logging) if the stream could not be set up
+bool RtpReceiver::Attach(Reactor* reactor, util::Scheduler* decode_pool) {
+  attached_decode_ = std::make_unique<DecodeContext>(options_.convert);
+  attached_decode_->start_us = av_gettime_relative();
+  strand_ = std::make_unique<util::Strand>(decode_pool);
+  attached_ = std::make_unique<NativeIngest>(this, attached_decode_.get(), strand_.get());
+  attached_backoff_ = std::make_unique<ReconnectBackoff>(options_.reconnect);
+  std::lock_guard<std::mutex> lock(attach_mutex_);  // A Reattach() waits for reactor_
+  if (!attached_->Open() || !reactor->Add(attached_.get())) {
+    attached_.reset();
+    strand_.reset();
+    attached_backoff_.reset();
+    attached_decode_.reset();
+    return false;
+  }
+  reactor_ = reactor;
+  return true;
+}
+
+// Reactor mode reconnect, posted by NativeIngest::OnReadable() after a
+// socket error. On the strand, so the frames read before the error have
+// been decoded; the reactor dropped the handler when OnReadable()
+// returned false, and Remove() waits until its thread is done with it.
+//
+// Like Run() after a lost session: close the old socket, back off, then
+// open a new session (same decoder, rebased timeline) and register it.
+// A failed open backs off and retries. The backoff blocks this pool
+// worker; Stop() (from Detach()) ends it at once.
+void RtpReceiver::Reattach() {
+  std::unique_ptr<NativeIngest> lost;
+  {
+    std::lock_guard<std::mutex> lock(attach_mutex_);
+    if (!reactor_) {
+      return;  // Detached
+    }
+    reactor_->Remove(attached_.get());
+    lost = std::move(attached_);
+  }
+  lost->LogStats();
+  lost.reset();
+
+  DecodeContext& decode = *attached_decode_;
+  while (running()) {
+    const int delay_ms = attached_backoff_->NextDelayMs(decode.session_packets > 0);
+    if (decode.lost_us == 0) {
+      decode.lost_us = util::NowMicros();
+    }
+    decode.timeline.Rebase();
+    metrics_.reconnects->Add();
+    LOG_WARN(Tag("Reconnecting" + (delay_ms > 0 ? " in " + std::to_string(delay_ms) + " ms" : std::string())));
+    if (!WaitForRetry(delay_ms)) {
+      return;
+    }
+
+    decode.start_us = av_gettime_relative();
+    decode.first_frame_pending = true;
+    decode.session_packets = 0;
+    auto ingest = std::make_unique<NativeIngest>(this, &decode, strand_.get());
+    if (!ingest->Open()) {
+      continue;
+    }
+    std::lock_guard<std::mutex> lock(attach_mutex_);
+    if (!reactor_) {
+      return;  // Detached while opening
+    }
+    if (reactor_->Add(ingest.get())) {
+      attached_ = std::move(ingest);
+      return;
+    }
+  }
+}
+
+// Stop first, so frames still queued on the strand are discarded instead
+// of decoded (and a pending Reattach() gives up); then unregister from the
+// reactor (waits out a running callback), drain the strand and free the
+// session. attached_ is null if a Reattach() had not finished.
+void RtpReceiver::Detach() {
+  if (!strand_) {
+    return;
+  }
+  Stop();
+  {
+    std::lock_guard<std::mutex> lock(attach_mutex_);
+    if (reactor_ && attached_) {
+      reactor_->Remove(attached_.get());
+    }
+    reactor_ = nullptr;
+  }
+  strand_->Drain();
+  if (attached_) {
+    attached_->LogStats();
+  }
+  attached_.reset();
+  strand_.reset();
+  attached_backoff_.reset();
+  attached_decode_.reset();
+}
+
+RtpReceiver::~RtpReceiver() {
+  Detach();
+}
+
 // Signal the receive loop to stop.
-// Thread-safe: sets atomic flag checked by Run() loop.
-// The loop will exit on the next iteration, triggering cleanup.
+// Thread-safe: sets the stop event, which wakes the native socket wait
+// and the reconnect backoff at once; a blocking libavformat read is
+// aborted by InterruptCallback().
 void RtpReceiver::Stop() {
-  running_ = false;
+  stop_event_.Set();
 }
 
 }  // namespace ingest
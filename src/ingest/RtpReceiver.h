@@ -1,13 +1,211 @@
 #pragma once
 
 #include <atomic>
+#include <cstdint>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <string>
 
 #include <opencv2/core.hpp>
 
+extern "C" {
+#include <libavutil/avutil.h>
+#include <libavutil/rational.h>
+}
+
+#include "ingest/JitterBuffer.h"
+#include "ingest/Reactor.h"
+#include "ingest/UdpSource.h"
+#include "media/ColorConverter.h"
+#include "media/FramePool.h"
+#include "util/Metrics.h"
+#include "util/StopEvent.h"
+#include "util/Scheduler.h"
+#include "util/Strand.h"
+
+struct AVCodec;
+struct AVCodecContext;
+struct AVCodecParameters;
+struct AVPacket;
+
 namespace ingest {
 
+// Where RTP packets are read and reassembled.
+enum class IngestMode {
+  kAvformat,  // libavformat RTP demuxer; probes the stream before the
+              // first frame (up to analyzeduration = 10 s)
+  kNative,    // Own UDP socket, jitter buffer and VP8/H.264 depacketizer;
+              // codec comes from the SDP, first frame at the first keyframe
+  kReactor,   // kNative's packet path, with the socket serviced by a shared
+              // Reactor and decoding on a shared pool (RtpReceiver::Attach())
+};
+
+// Parse an ingest mode name ("avformat", "native", "reactor").
+//
+// Returns: true if recognized (mode set), false otherwise
+bool ParseIngestMode(const std::string& name, IngestMode* mode);
+
+// Decoder threading model, mapped onto AVCodecContext::thread_type.
+enum class DecodeThreading {
+  kAuto,   // Let libavcodec choose (frame and slice where supported)
+  kFrame,  // Decode several frames concurrently: best throughput, adds
+           // (thread_count - 1) frames of latency
+  kSlice,  // Split each frame across threads: no added latency, but only
+           // helps streams encoded with several slices/partitions
+};
+
+// Parse a threading mode name ("auto", "frame", "slice").
+//
+// Returns: true if recognized (threading set), false otherwise
+bool ParseDecodeThreading(const std::string& name, DecodeThreading* threading);
+
+// Decoder configuration applied before avcodec_open2().
+struct DecoderOptions {
+  // AVCodecContext::thread_count. 0 lets libavcodec pick one thread per
+  // core; 1 (the libavcodec default) decodes on the receiver thread only.
+  int threads = 1;
+
+  // Which kind of threading to allow
+  DecodeThreading threading = DecodeThreading::kAuto;
+
+  // Set AV_CODEC_FLAG_LOW_DELAY and disable frame threading so every
+  // packet produces its frame immediately.
+  bool low_delay = false;
+
+  // Decode keyframes only. Inter frames are recognized from the bitstream
+  // (see IsKeyframe()) and never reach avcodec_send_packet(), so decoding
+  // costs one keyframe per GOP instead of every frame. Frame threading is
+  // disabled, since it would hold each keyframe back until threads - 1
+  // more arrive.
+  bool keyframes_only = false;
+
+  // With keyframes_only: decode at most one keyframe per this many
+  // milliseconds of stream time (PTS); 0 decodes every keyframe.
+  int keyframe_interval_ms = 0;
+};
+
+// Apply DecoderOptions to a codec context; call before avcodec_open2().
+// Shared with the benchmarks so they decode exactly like the receiver.
+void ApplyDecoderOptions(const DecoderOptions& options, AVCodecContext* codec_ctx);
+
+// Supervision of the receive loop: what happens when the stream stalls
+// or ends (see RtpReceiver::Run()).
+struct ReconnectOptions {
+  // Reopen the input after a stall or error instead of returning from
+  // Run(). Failures to set up the very first session still return.
+  bool enabled = true;
+
+  // A read that waits longer than this for data counts as a stall
+  // (avformat: interrupts av_read_frame(); native: resets the jitter
+  // buffer and depacketizer). 0 waits forever.
+  int read_timeout_ms = 5000;
+
+  // Delay before retrying a session that received nothing, doubling from
+  // backoff_min_ms up to backoff_max_ms. A session that received packets
+  // is reconnected at once.
+  int backoff_min_ms = 100;
+  int backoff_max_ms = 5000;
+};
+
+// Delay schedule of the reconnect loop (see ReconnectOptions): after a
+// session that received packets the next one starts at once; every
+// consecutive session that received nothing doubles the wait.
+//
+// Thread-safe: no, owned by the Run() thread.
+class ReconnectBackoff {
+ public:
+  explicit ReconnectBackoff(const ReconnectOptions& options) : options_(options) {}
+
+  // Account for a finished session and return the wait before the next.
+  //
+  // Param: received_packets - The session handled at least one packet
+  // Returns: delay in milliseconds (0 = reconnect at once)
+  int NextDelayMs(bool received_packets);
+
+  // Consecutive sessions that received nothing.
+  int failures() const { return failures_; }
+
+ private:
+  ReconnectOptions options_;
+  int failures_ = 0;
+};
+
+// Keeps packet timestamps increasing across receive sessions, so muxers
+// (which need monotonic DTS) see one timeline through reconnects and
+// sender restarts. The first packet after Rebase() is placed after the
+// last one by the wall time that passed in between; every later packet
+// gets the same offset.
+//
+// Thread-safe: no, used by whoever decodes the stream.
+class PtsTimeline {
+ public:
+  // The next packet starts a new sender timeline.
+  void Rebase() { rebase_ = true; }
+
+  // Shift a packet onto the timeline.
+  //
+  // Param: packet - Packet to adjust in place (pts and dts); packets
+  //                 without pts are left alone
+  // Param: time_base - Time base of the packet timestamps
+  // Param: now_us - Arrival time (util::NowMicros())
+  void Continue(AVPacket* packet, AVRational time_base, int64_t now_us);
+
+  // Express the timeline in another time base (a new session's).
+  void Rescale(AVRational from, AVRational to);
+
+  // Last pts handed out (AV_NOPTS_VALUE before the first packet).
+  int64_t last_pts() const { return last_pts_; }
+
+ private:
+  bool rebase_ = false;
+  int64_t offset_ = 0;
+  int64_t last_pts_ = AV_NOPTS_VALUE;
+  int64_t last_packet_us_ = 0;
+};
+
+// Tuning knobs for RtpReceiver (see util::Args for the command-line side).
+struct ReceiverOptions {
+  // Stream name prefixed to log lines (empty for none) and used as the
+  // stream label of this receiver's metrics ("default" if empty)
+  std::string name;
+
+  // BGR conversion: number of parallel slices, swscale interpolation,
+  // crop and output size (the native frame is never cropped or resized)
+  media::ColorConverterOptions convert;
+
+  // Decoder threading and latency
+  DecoderOptions decode;
+
+  // Packet source; see IngestMode
+  IngestMode ingest = IngestMode::kAvformat;
+
+  // Reordering window of the native ingest
+  JitterBufferOptions jitter;
+
+  // Socket batching and receive buffer. batch_size applies to the native
+  // ingest; receive_buffer_bytes to both (libavformat "buffer_size").
+  UdpSourceOptions udp;
+
+  // Stall detection and reconnects
+  ReconnectOptions reconnect;
+};
+
+// A compressed frame as received, before decoding (see
+// RtpReceiver::SetPacketCallback()). Pointers are valid during the
+// callback only.
+struct EncodedPacket {
+  // Encoded frame (Annex B for H.264); pts in time_base, dts may be unset
+  const AVPacket* packet = nullptr;
+
+  // Stream parameters: codec, extradata and, once the first frame has
+  // been decoded, width/height/pixel format
+  const AVCodecParameters* codecpar = nullptr;
+
+  // Time base of the packet timestamps
+  AVRational time_base{1, 90000};
+};
+
 // RTP receiver using FFmpeg/libav.
 //
 // This class receives RTP packets, decodes them using FFmpeg, and converts
@@ -28,14 +226,52 @@ namespace ingest {
 //   - Stop() is thread-safe and can be called from any thread
 //   - Frame callback is invoked on the Run() thread
 //
+// Reactor mode (IngestMode::kReactor) replaces Run() with Attach(): a
+// Reactor thread shared by many streams reads the socket and reassembles
+// frames, and the stream's frames are decoded one at a time, in order, on
+// a shared work-stealing decode pool (a util::Strand per stream on a
+// util::Scheduler). Callbacks then run on
+// whichever pool worker decodes the frame, never two at once for one
+// stream. Hundreds of streams cost a few I/O threads and a pool sized to
+// the cores instead of a thread each.
+//
 // Architecture:
-//   Janus → RTP (UDP) → FFmpeg libavformat → libavcodec → swscale → BGR Mat
+//   Janus → RTP (UDP) → FFmpeg libavformat ───────────────────┐
+//                     → UdpSource → JitterBuffer → Depacketizer ─┴┬→ libavcodec ─┬─ swscale → pooled BGR frame
+//                                                                 │              └─ AVFrame reference (native YUV)
+//                                                                 └→ packet callback (stream copy)
+//
+// The second row is IngestMode::kNative: it skips libavformat's stream
+// probing, which otherwise delays the first frame by seconds.
+//
+// Metrics (util::Metrics, label stream="<name>"):
+//   capture_packets_total, capture_packet_bytes_total - RTP datagrams
+//                              (native) or demuxed packets (avformat) read
+//   capture_receive_seconds  - time per av_read_frame() call (avformat,
+//                              includes waiting for data) or per recvmmsg
+//                              batch parsed, reordered and depacketized
+//                              (native)
+//   capture_decode_seconds   - avcodec_send_packet() + receive_frame() per packet
+//   capture_convert_seconds  - sws_scale per frame
+//   capture_frames_decoded_total, capture_decode_errors_total
+//   capture_decode_skipped_total - packets not decoded (keyframes_only)
+//   capture_rtp_lost_packets_total, capture_udp_kernel_drops_total (native)
+//   capture_reconnects_total - sessions restarted after a stall or error
+//   capture_decode_backlog_dropped_total - frames dropped because the
+//                              decoder fell behind (reactor mode)
+// Recording costs a clock read per stage and a few relaxed atomics.
 class RtpReceiver {
  public:
   // Callback type invoked for each decoded frame.
-  // The callback receives a cv::Mat in BGR format (3 channels, 8-bit).
-  // The Mat is reused for each frame; copy it if you need to retain data.
-  using FrameCallback = std::function<void(const cv::Mat&)>;
+  // The callback receives a pooled frame in BGR format (3 channels, 8-bit).
+  // Keep a copy of the FrameRef to retain the frame past the callback; no
+  // pixel copy is needed. The buffer returns to the pool once every
+  // FrameRef copy is gone. Do not modify the frame: several sinks may share it.
+  using FrameCallback = std::function<void(const media::FrameRef&)>;
+
+  // Callback invoked for each compressed packet, after it was decoded (so
+  // dimensions are known by the first keyframe's callback).
+  using PacketCallback = std::function<void(const EncodedPacket&)>;
 
   // Create an RTP receiver with the given source and callback.
   //
@@ -45,18 +281,49 @@ class RtpReceiver {
   //                 "/app/config/rtp.sdp"
   // Param: on_frame - Callback invoked for each decoded frame
   //                   The callback runs on the Run() thread
-  RtpReceiver(std::string url, FrameCallback on_frame);
+  // Param: options - Conversion and decoder tuning (defaults match the
+  //                  original single-threaded behaviour)
+  RtpReceiver(std::string url, FrameCallback on_frame, ReceiverOptions options = {});
+
+  // Detaches (see Detach()).
+  ~RtpReceiver();
+
+  RtpReceiver(const RtpReceiver&) = delete;
+  RtpReceiver& operator=(const RtpReceiver&) = delete;
+
+  // Declare which pixel representations the sinks need (media::FrameFormat
+  // bitmask, OR of every sink's requirement).
+  //   kFormatBgr    - convert with swscale into Frame::bgr (default)
+  //   kFormatNative - reference the decoder's AVFrame in Frame::native
+  //   kFormatNone   - no sink needs frames: packets are only decoded until
+  //                   the stream dimensions are known, then go straight
+  //                   to the packet callback (stream-copy recording)
+  // BGR conversion is skipped entirely when kFormatBgr is not requested.
+  // Thread-safe: may change while running, e.g. from the packet callback
+  // once a recorder has decided whether it needs frames; takes effect from
+  // the next packet.
+  void SetOutputFormats(uint32_t formats);
+
+  // Receive every compressed packet of the video stream (stream copy
+  // recording). Must be called before Run(); the callback runs on the
+  // Run() thread.
+  void SetPacketCallback(PacketCallback on_packet);
 
   // Start the RTP receiver loop.
   // This is a blocking call that:
-  //   1. Opens the RTP stream using FFmpeg
+  //   1. Opens the RTP stream (libavformat, or a UDP socket for kNative)
   //   2. Finds and opens the video codec
   //   3. Reads packets, decodes frames, and invokes the callback
-  //   4. Returns when the stream ends or Stop() is called
+  //   4. On a stall or stream error, reopens the input (see
+  //      ReconnectOptions), reusing the open decoder and the stream
+  //      parameters if the codec is unchanged
+  //   5. Returns when Stop() is called (or the stream ends, with
+  //      reconnects disabled)
   //
   // Thread model: blocks the calling thread; typically run in a dedicated thread
   //
-  // Returns: true on success, false if initialization failed
+  // Returns: true on success, false if initialization failed (the first
+  //          session could not be set up) or on a fatal decode error
   // Side effects:
   //   - Initializes FFmpeg network subsystem
   //   - Allocates FFmpeg contexts and buffers
@@ -64,8 +331,10 @@ class RtpReceiver {
   bool Run();
 
   // Request graceful shutdown of the receiver.
-  // Thread-safe: can be called from any thread.
-  // Sets a flag checked by the Run() loop, causing it to exit cleanly.
+  // Thread-safe: can be called from any thread, also before Run() (which
+  // then returns at once); a receiver runs once.
+  // Wakes the Run() thread from any wait; a read blocked inside
+  // libavformat returns within its interrupt polling interval (100 ms).
   //
   // After calling Stop(), the Run() method will:
   //   - Stop reading new packets
@@ -74,16 +343,139 @@ class RtpReceiver {
   //   - Return to the caller
   void Stop();
 
+  // Reactor mode: set up the native ingest (SDP, decoder, socket) and
+  // register the socket with reactor instead of running a receive loop.
+  // Frames are decoded on decode_pool. Use instead of Run(); stall
+  // handling is the same as kNative's, and a socket error starts a new
+  // session after the same backoff as Run() (see Reattach()).
+  //
+  // Param: reactor - I/O threads; must outlive the attachment
+  // Param: decode_pool - Decode workers; must outlive the attachment
+  // Returns: false (after logging) if the stream could not be set up
+  // Thread-safe: no; call once, before or instead of Run()
+  bool Attach(Reactor* reactor, util::Scheduler* decode_pool);
+
+  // Reactor mode: stop, unregister the socket and wait for the frame
+  // being decoded; frames still queued are dropped. No-op if not attached.
+  // Thread-safe: no; call from the thread that called Attach()
+  void Detach();
+
+  // Pool backing the frames handed to the callback (for stats reporting).
+  const media::FramePool& frame_pool() const { return frame_pool_; }
+
  private:
+  // Decoder, scratch frame and converter shared by both ingest paths.
+  // Lives across reconnects.
+  struct DecodeContext;
+
+  // Socket, jitter buffer and depacketizer of the native ingest, driven by
+  // RunNative() or a Reactor.
+  class NativeIngest;
+
+  // How one receive session (open, read until ...) ended.
+  enum class SessionEnd {
+    kStopped,      // Stop() was called
+    kSetupFailed,  // Input, stream or decoder could not be opened
+    kStreamLost,   // Stall, end of stream or read/socket error
+    kFatal,        // Conversion failure; not worth retrying
+  };
+
+  // Metrics looked up once at construction (owned by util::Metrics).
+  struct StageMetrics {
+    util::Counter* packets;
+    util::Counter* bytes;
+    util::Counter* frames;
+    util::Counter* decode_errors;
+    util::Counter* decode_skipped;
+    util::Counter* lost_packets;
+    util::Counter* kernel_drops;
+    util::Counter* reconnects;
+    util::Counter* backlog_dropped;
+    util::Histogram* receive;
+    util::Histogram* decode;
+    util::Histogram* convert;
+  };
+
+  // Prefix a log message with the stream name, if any.
+  std::string Tag(const std::string& message) const;
+
+  // One session reading through libavformat (IngestMode::kAvformat).
+  SessionEnd RunAvformat(DecodeContext* decode);
+
+  // One session reading the UDP socket directly (IngestMode::kNative).
+  SessionEnd RunNative(DecodeContext* decode);
+
+  // Allocate and open the decoder described by codecpar into decode, or
+  // keep the one already open if it decodes the same codec with the same
+  // extradata (a reconnect); it is then only flushed.
+  // Returns: false (after logging) on failure
+  bool OpenDecoder(const AVCodec* codec, const AVCodecParameters* codecpar, DecodeContext* decode);
+
+  // Wait before the next reconnect attempt; false if Stop() was called.
+  bool WaitForRetry(int delay_ms);
+
+  // Reactor mode: replace attached_ after its socket failed and the
+  // reactor dropped it. Runs on the strand.
+  void Reattach();
+
+  bool running() const { return !stop_event_.IsSet(); }
+
+  // libavformat interrupt callback (AVIOInterruptCB): aborts blocking
+  // I/O on Stop() or once read_deadline_us_ has passed.
+  static int InterruptCallback(void* opaque);
+
+  // Flag keyframes, decode a packet (unless no sink needs frames), then
+  // hand it to the packet callback.
+  // Returns: false on a fatal error (conversion failure)
+  bool HandlePacket(DecodeContext* decode, AVPacket* packet);
+
+  // Keyframe-only decoding: whether this packet is a keyframe that is due
+  // (see DecoderOptions::keyframes_only).
+  bool SelectKeyframe(DecodeContext* decode, const AVPacket* packet);
+
+  // Send one packet to the decoder and deliver every frame it yields.
+  // Returns: false on a fatal error (conversion failure)
+  bool Decode(DecodeContext* decode, const AVPacket* packet, uint32_t formats);
+
   // RTP source URL or SDP file path
   std::string url_;
 
   // Callback invoked for each decoded frame
   FrameCallback on_frame_;
 
-  // Flag controlling the Run() loop.
-  // Atomic for thread-safe Stop() from another thread.
-  std::atomic<bool> running_{false};
+  // Callback invoked for each compressed packet (optional)
+  PacketCallback on_packet_;
+
+  // Reusable BGR buffers used as the sws_scale destination
+  media::FramePool frame_pool_;
+
+  // Tuning options fixed at construction
+  ReceiverOptions options_;
+
+  // Per-stage counters and latency histograms
+  StageMetrics metrics_;
+
+  // Negotiated media::FrameFormat bitmask, see SetOutputFormats()
+  std::atomic<uint32_t> output_formats_{media::kFormatBgr};
+
+  // Set by Stop(). Every wait of the Run() thread (socket poll, backoff,
+  // libavformat's interrupt callback) watches it, so a stop takes effect
+  // within a bounded time and idle waits need no timeout.
+  util::StopEvent stop_event_;
+
+  // util::NowMicros() after which InterruptCallback() reports a stall; 0
+  // for no deadline. Set and read on the Run() thread only.
+  int64_t read_deadline_us_ = 0;
+
+  // Reactor mode state, see Attach(). Declared last: destroyed first.
+  // attach_mutex_ guards reactor_ and attached_ between Detach() and
+  // Reattach().
+  std::mutex attach_mutex_;
+  Reactor* reactor_ = nullptr;
+  std::unique_ptr<ReconnectBackoff> attached_backoff_;
+  std::unique_ptr<DecodeContext> attached_decode_;
+  std::unique_ptr<util::Strand> strand_;
+  std::unique_ptr<NativeIngest> attached_;
 };
 
 }  // namespace ingest
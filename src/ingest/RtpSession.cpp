@@ -0,0 +1,169 @@
+#include "ingest/RtpSession.h"
+
+extern "C" {
+#include <libavutil/base64.h>
+}
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace ingest {
+namespace {
+
+// Parse a decimal port number (1-65535).
+bool ParsePort(const std::string& text, int* port) {
+  char* end = nullptr;
+  const long value = std::strtol(text.c_str(), &end, 10);
+  if (text.empty() || *end != '\0' || value < 1 || value > 65535) {
+    return false;
+  }
+  *port = static_cast<int>(value);
+  return true;
+}
+
+// Decode "sprop-parameter-sets=<b64>,<b64>" into Annex B NAL units.
+void ParseParameterSets(const std::string& value, std::vector<uint8_t>* out) {
+  std::istringstream sets(value);
+  std::string set;
+  while (std::getline(sets, set, ',')) {
+    std::vector<uint8_t> nal(set.size());
+    const int size = av_base64_decode(nal.data(), set.c_str(), static_cast<int>(nal.size()));
+    if (size <= 0) {
+      continue;
+    }
+    out->insert(out->end(), {0, 0, 0, 1});
+    out->insert(out->end(), nal.begin(), nal.begin() + size);
+  }
+}
+
+// Parse "rtp://host:port[?query]".
+bool ParseRtpUrl(const std::string& url, RtpSession* session, std::string* error) {
+  std::string rest = url.substr(6);
+  std::string query;
+  const size_t question = rest.find('?');
+  if (question != std::string::npos) {
+    query = rest.substr(question + 1);
+    rest.resize(question);
+  }
+  const size_t colon = rest.rfind(':');
+  if (colon == std::string::npos || !ParsePort(rest.substr(colon + 1), &session->port)) {
+    *error = "missing or invalid port in " + url;
+    return false;
+  }
+  if (colon > 0) {
+    session->address = rest.substr(0, colon);
+  }
+
+  std::istringstream params(query);
+  std::string param;
+  while (std::getline(params, param, '&')) {
+    if (param.compare(0, 6, "codec=") == 0 && !ParseRtpCodec(param.substr(6), &session->codec)) {
+      *error = "unsupported codec in " + url;
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+// Read the SDP line by line. Only the first video media section is used;
+// session-level c= lines apply unless the media section has its own.
+bool ParseSdp(const std::string& sdp, RtpSession* session, std::string* error) {
+  std::istringstream lines(sdp);
+  std::string line;
+  bool in_video = false;
+  bool seen_video = false;
+  bool have_codec = false;
+  while (std::getline(lines, line)) {
+    if (!line.empty() && line.back() == '\r') {
+      line.pop_back();
+    }
+    std::istringstream fields(line.size() > 2 ? line.substr(2) : std::string());
+
+    if (line.compare(0, 2, "m=") == 0) {
+      if (seen_video) {
+        break;
+      }
+      std::string media, port, proto;
+      fields >> media >> port >> proto;
+      in_video = media == "video";
+      if (in_video) {
+        seen_video = true;
+        if (!ParsePort(port, &session->port)) {
+          *error = "invalid port in '" + line + "'";
+          return false;
+        }
+        fields >> session->payload_type;
+      }
+    } else if (line.compare(0, 2, "c=") == 0 && (in_video || !seen_video)) {
+      std::string net, type, address;
+      fields >> net >> type >> address;
+      session->address = address.substr(0, address.find('/'));
+    } else if (in_video && line.compare(0, 9, "a=rtpmap:") == 0) {
+      // a=rtpmap:<pt> <encoding>/<clock rate>
+      std::istringstream rtpmap(line.substr(9));
+      int payload_type = -1;
+      std::string encoding;
+      rtpmap >> payload_type >> encoding;
+      if (payload_type != session->payload_type) {
+        continue;
+      }
+      const size_t slash = encoding.find('/');
+      if (!ParseRtpCodec(encoding.substr(0, slash), &session->codec)) {
+        *error = "unsupported codec '" + encoding + "'";
+        return false;
+      }
+      if (slash != std::string::npos) {
+        session->clock_rate = std::atoi(encoding.c_str() + slash + 1);
+      }
+      have_codec = true;
+    } else if (in_video && line.compare(0, 7, "a=fmtp:") == 0) {
+      // a=fmtp:<pt> key=value;key=value
+      const size_t key = line.find("sprop-parameter-sets=");
+      if (key != std::string::npos) {
+        const size_t begin = key + 21;
+        const size_t end = line.find(';', begin);
+        ParseParameterSets(line.substr(begin, end == std::string::npos ? std::string::npos : end - begin),
+                           &session->parameter_sets);
+      }
+    }
+  }
+
+  if (!seen_video) {
+    *error = "no m=video section";
+    return false;
+  }
+  if (!have_codec) {
+    *error = "no rtpmap for video payload type " + std::to_string(session->payload_type);
+    return false;
+  }
+  if (session->clock_rate <= 0) {
+    *error = "invalid clock rate";
+    return false;
+  }
+  return true;
+}
+
+// Dispatch on the URL scheme; anything that is not rtp:// is read as an
+// SDP file, as libavformat does.
+bool LoadRtpSession(const std::string& url, RtpSession* session, std::string* error) {
+  if (url.compare(0, 6, "rtp://") == 0) {
+    return ParseRtpUrl(url, session, error);
+  }
+  std::ifstream in(url);
+  if (!in) {
+    *error = "cannot open SDP file " + url;
+    return false;
+  }
+  std::stringstream sdp;
+  sdp << in.rdbuf();
+  if (!ParseSdp(sdp.str(), session, error)) {
+    *error = url + ": " + *error;
+    return false;
+  }
+  return true;
+}
+
+}  // namespace ingest
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ingest/Depacketizer.h"
+
+namespace ingest {
+
+// What the native ingest needs to know about an RTP video stream: where to
+// listen and how to depacketize. Everything libavformat would otherwise
+// learn by probing the stream.
+struct RtpSession {
+  // Local address and UDP port to bind
+  std::string address = "0.0.0.0";
+  int port = 0;
+
+  // RTP payload type of the video stream (-1 accepts any)
+  int payload_type = -1;
+
+  RtpCodec codec = RtpCodec::kVp8;
+
+  // RTP timestamp clock rate (90 kHz for all video payload formats)
+  int clock_rate = 90000;
+
+  // H.264 only: SPS/PPS from the SDP sprop-parameter-sets, in Annex B form.
+  // Passed to the decoder as extradata so streams that only send them out
+  // of band still decode.
+  std::vector<uint8_t> parameter_sets;
+};
+
+// Describe an RTP source from the same --rtp-url values the avformat
+// ingest accepts.
+//
+//   SDP file path - first m=video section: port, payload type, rtpmap
+//                   codec and clock rate, c= address, H.264
+//                   sprop-parameter-sets
+//   rtp://host:port[?codec=vp8|h264] - codec defaults to VP8; other query
+//                   parameters (protocol_whitelist, ...) are ignored
+//
+// Param: url - SDP path or rtp:// URL
+// Param: session - Receives the description
+// Param: error - Receives a message on failure
+// Returns: false if the source cannot be described (bad file, no video
+//          section, unsupported codec)
+bool LoadRtpSession(const std::string& url, RtpSession* session, std::string* error);
+
+// Parse SDP text (see LoadRtpSession()); exposed for testing.
+bool ParseSdp(const std::string& sdp, RtpSession* session, std::string* error);
+
+}  // namespace ingest
@@ -0,0 +1,158 @@
+#include "ingest/UdpSource.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "util/Log.h"
+
+namespace ingest {
+namespace {
+
+// Room for one SO_RXQ_OVFL control message (a 32-bit drop counter)
+const size_t kControlSize = CMSG_SPACE(sizeof(uint32_t));
+
+}  // namespace
+
+static_assert(UdpSource::kMaxBatchSize <= UIO_MAXIOV, "recvmmsg() accepts at most UIO_MAXIOV messages");
+
+UdpSource::UdpSource(UdpSourceOptions options) : options_(options) {
+  const size_t batch = std::min(std::max<size_t>(1, options_.batch_size), kMaxBatchSize);
+  if (batch != options_.batch_size) {
+    LOG_WARN("UDP batch size " + std::to_string(options_.batch_size) + " out of range, using " +
+             std::to_string(batch) + " (1-" + std::to_string(kMaxBatchSize) + ")");
+    options_.batch_size = batch;
+  }
+}
+
+UdpSource::~UdpSource() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+// Create, bind and set up the batch buffers. SO_REUSEADDR lets a restarted
+// process rebind the port immediately. The receive buffer is sized before
+// bind() so no datagram arrives into a default-sized buffer.
+bool UdpSource::Open(const std::string& address, int port, std::string* error) {
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(static_cast<uint16_t>(port));
+  if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+    *error = "invalid IPv4 address '" + address + "'";
+    return false;
+  }
+
+  fd_ = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    *error = std::string("socket: ") + std::strerror(errno);
+    return false;
+  }
+  const int one = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (setsockopt(fd_, SOL_SOCKET, SO_RXQ_OVFL, &one, sizeof(one)) < 0) {
+    LOG_WARN(std::string("SO_RXQ_OVFL unavailable, kernel drops will not be counted: ") + std::strerror(errno));
+  }
+  SetReceiveBuffer();
+  if (bind(fd_, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) < 0) {
+    *error = "bind " + address + ":" + std::to_string(port) + ": " + std::strerror(errno);
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  const size_t batch = options_.batch_size;
+  buffers_.resize(batch * kMaxDatagramSize);
+  control_.resize(batch * kControlSize);
+  iovecs_.resize(batch);
+  messages_.resize(batch);
+  for (size_t i = 0; i < batch; ++i) {
+    iovecs_[i].iov_base = buffers_.data() + i * kMaxDatagramSize;
+    iovecs_[i].iov_len = kMaxDatagramSize;
+  }
+  return true;
+}
+
+// SO_RCVBUFFORCE bypasses net.core.rmem_max but requires CAP_NET_ADMIN;
+// without it, fall back to SO_RCVBUF, which the kernel silently caps.
+// Reading the size back is the only way to tell, so a short grant is
+// logged with the sysctl to raise.
+void UdpSource::SetReceiveBuffer() {
+  const int requested = options_.receive_buffer_bytes;
+  if (requested > 0 &&
+      setsockopt(fd_, SOL_SOCKET, SO_RCVBUFFORCE, &requested, sizeof(requested)) < 0 &&
+      setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &requested, sizeof(requested)) < 0) {
+    LOG_WARN(std::string("SO_RCVBUF failed: ") + std::strerror(errno));
+  }
+
+  socklen_t length = sizeof(receive_buffer_bytes_);
+  getsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &receive_buffer_bytes_, &length);
+  // Linux doubles the requested value for bookkeeping; compare half of it
+  if (requested > 0 && receive_buffer_bytes_ / 2 < requested) {
+    LOG_WARN("UDP receive buffer is " + std::to_string(receive_buffer_bytes_ / 2) + " bytes, " +
+             std::to_string(requested) + " requested; raise net.core.rmem_max (sysctl -w net.core.rmem_max=" +
+             std::to_string(requested) + ") or grant CAP_NET_ADMIN");
+  }
+}
+
+// poll() the socket (and wake_fd) for readability, then drain with Read().
+int UdpSource::Receive(int timeout_ms, int wake_fd) {
+  pollfd pfds[2] = {{fd_, POLLIN, 0}, {wake_fd, POLLIN, 0}};
+  const int ready = poll(pfds, wake_fd >= 0 ? 2 : 1, timeout_ms);
+  if (ready <= 0) {
+    return (ready == 0 || errno == EINTR) ? 0 : -1;
+  }
+  if (!(pfds[0].revents & (POLLIN | POLLERR))) {
+    return 0;  // Woken by wake_fd only
+  }
+  return Read();
+}
+
+// Non-blocking recvmmsg(). Truncated datagrams are compacted out of the
+// batch. The kernel attaches its cumulative drop counter to every
+// datagram; the last one wins.
+int UdpSource::Read() {
+  const size_t batch = options_.batch_size;
+  for (size_t i = 0; i < batch; ++i) {
+    std::memset(&messages_[i].msg_hdr, 0, sizeof(messages_[i].msg_hdr));
+    messages_[i].msg_hdr.msg_iov = &iovecs_[i];
+    messages_[i].msg_hdr.msg_iovlen = 1;
+    messages_[i].msg_hdr.msg_control = control_.data() + i * kControlSize;
+    messages_[i].msg_hdr.msg_controllen = kControlSize;
+  }
+  const int received = recvmmsg(fd_, messages_.data(), static_cast<unsigned int>(batch), MSG_DONTWAIT, nullptr);
+  if (received < 0) {
+    return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) ? 0 : -1;
+  }
+
+  max_batch_ = std::max(max_batch_, static_cast<size_t>(received));
+  int kept = 0;
+  for (int i = 0; i < received; ++i) {
+    msghdr& header = messages_[i].msg_hdr;
+    for (cmsghdr* cmsg = CMSG_FIRSTHDR(&header); cmsg; cmsg = CMSG_NXTHDR(&header, cmsg)) {
+      if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+        uint32_t drops = 0;
+        std::memcpy(&drops, CMSG_DATA(cmsg), sizeof(drops));
+        kernel_drops_ = drops;
+      }
+    }
+    if (header.msg_flags & MSG_TRUNC) {
+      ++truncated_;
+      continue;
+    }
+    if (kept != i) {
+      std::memcpy(buffers_.data() + kept * kMaxDatagramSize, data(i), messages_[i].msg_len);
+      messages_[kept].msg_len = messages_[i].msg_len;
+    }
+    ++kept;
+  }
+  return kept;
+}
+
+}  // namespace ingest
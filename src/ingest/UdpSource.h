@@ -0,0 +1,123 @@
+#pragma once
+
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace ingest {
+
+// Socket tuning for UdpSource (see util::Args for the command-line side).
+struct UdpSourceOptions {
+  // Datagrams read per recvmmsg() call, 1 to UdpSource::kMaxBatchSize. A
+  // 4K keyframe arrives as several hundred packets within a few
+  // milliseconds; larger batches drain such a burst in fewer system calls.
+  size_t batch_size = 32;
+
+  // Requested kernel receive buffer (SO_RCVBUF) in bytes; 0 keeps the
+  // kernel default (~200 KB, under one 1080p keyframe). Tried with
+  // SO_RCVBUFFORCE first, which ignores net.core.rmem_max but needs
+  // CAP_NET_ADMIN; otherwise the kernel caps it at net.core.rmem_max.
+  int receive_buffer_bytes = 8 * 1024 * 1024;
+};
+
+// UDP socket reading datagrams in batches with recvmmsg().
+//
+// One recvmmsg() call returns every datagram already queued on the socket
+// (up to the batch size), so at high packet rates the receive thread makes
+// one system call per batch instead of one per packet. Buffers are
+// allocated once at Open().
+//
+// Kernel drops (datagrams discarded because the receive buffer was full)
+// are read from the SO_RXQ_OVFL control message attached to each datagram.
+//
+// Thread-safe: no, owned by the receive thread.
+class UdpSource {
+ public:
+  // Largest datagram accepted; RTP over a 1500-byte MTU is ~1200 bytes,
+  // jumbo frames and loopback may carry more. Longer datagrams are truncated
+  // and dropped.
+  static constexpr size_t kMaxDatagramSize = 9000;
+
+  // Largest batch_size: recvmmsg() rejects more than UIO_MAXIOV messages
+  // with EINVAL, and each slot costs kMaxDatagramSize bytes of buffer.
+  static constexpr size_t kMaxBatchSize = 1024;
+
+  // Param: options - Socket tuning; batch_size is clamped to
+  //                  [1, kMaxBatchSize] (logged)
+  explicit UdpSource(UdpSourceOptions options = {});
+  ~UdpSource();
+
+  UdpSource(const UdpSource&) = delete;
+  UdpSource& operator=(const UdpSource&) = delete;
+
+  // Bind a UDP socket.
+  //
+  // Param: address - Local IPv4 address ("0.0.0.0" for any)
+  // Param: port - Local UDP port
+  // Param: error - Receives a message on failure
+  // Returns: false if the socket could not be created or bound
+  // Side effects: sizes the receive buffer; logs a warning if the kernel
+  //               granted less than requested
+  bool Open(const std::string& address, int port, std::string* error);
+
+  // Wait for datagrams and read up to batch_size of them.
+  //
+  // Param: timeout_ms - Maximum wait when the socket is empty; -1 waits
+  //                     until a datagram arrives or wake_fd is readable
+  // Param: wake_fd - Descriptor that ends the wait when readable (e.g.
+  //                  util::StopEvent::fd()); -1 for none. It is not read.
+  // Returns: number of datagrams read (0 on timeout, wakeup or EINTR), -1
+  //          on error (errno is set). Datagrams are available through
+  //          data()/size() until the next call.
+  int Receive(int timeout_ms, int wake_fd = -1);
+
+  // Read up to batch_size datagrams already queued, without waiting (for
+  // callers that learned readiness from epoll).
+  //
+  // Returns: as Receive(); 0 if the socket is empty
+  int Read();
+
+  // The socket descriptor, for callers multiplexing several sources
+  // (-1 before Open()).
+  int fd() const { return fd_; }
+
+  const uint8_t* data(size_t index) const { return buffers_.data() + index * kMaxDatagramSize; }
+  size_t size(size_t index) const { return messages_[index].msg_len; }
+
+  // Datagrams dropped because they exceeded kMaxDatagramSize
+  uint64_t truncated() const { return truncated_; }
+
+  // Datagrams the kernel dropped on this socket since Open() (receive
+  // buffer full), as of the last datagram received
+  uint64_t kernel_drops() const { return kernel_drops_; }
+
+  // Receive buffer size granted by the kernel (bytes; Linux reports twice
+  // the requested value to account for bookkeeping overhead)
+  int receive_buffer_bytes() const { return receive_buffer_bytes_; }
+
+  // Datagrams read per Receive() at most (batch_size after clamping)
+  size_t batch_size() const { return options_.batch_size; }
+
+  // Largest number of datagrams returned by one Receive()
+  size_t max_batch() const { return max_batch_; }
+
+ private:
+  // Request the configured receive buffer and read back what was granted.
+  void SetReceiveBuffer();
+
+  UdpSourceOptions options_;
+  int fd_ = -1;
+  std::vector<uint8_t> buffers_;
+  std::vector<uint8_t> control_;  // SO_RXQ_OVFL control messages, one slot per datagram
+  std::vector<struct iovec> iovecs_;
+  std::vector<struct mmsghdr> messages_;
+  uint64_t truncated_ = 0;
+  uint64_t kernel_drops_ = 0;
+  int receive_buffer_bytes_ = 0;
+  size_t max_batch_ = 0;
+};
+
+}  // namespace ingest
@@ -2,6 +2,7 @@
 //
 // This is the main entry point for the WebRTC RTP capture service. It:
 // 1. Initializes the logging system with a prefix for identification
+//    (an asynchronous writer thread; flushed before returning)
 // 2. Parses command-line arguments for configuration
 // 3. Starts the App which orchestrates RTP receiving and frame writing
 // 4. Handles graceful shutdown via SIGINT/SIGTERM signals
@@ -9,59 +10,62 @@
 // The application runs in a dedicated thread for RTP reception, while the main
 // thread waits for shutdown signals. This ensures proper resource cleanup.
 //
+// SIGINT and SIGTERM are blocked in every thread (the mask is set before
+// any thread starts and is inherited) and taken synchronously with
+// sigwait(), so the main thread sleeps until a signal arrives instead of
+// polling a flag, and shutdown runs in normal thread context rather than
+// in a signal handler.
+//
 // Architecture:
 //   Browser → Janus → RTP → FFmpeg/libav → OpenCV → disk
 //
 // See src/app/App.h for orchestration details.
 
-#include <atomic>
-#include <chrono>
+#include <pthread.h>
+
 #include <csignal>
-#include <thread>
+#include <string>
 
 #include "app/App.h"
 #include "util/Args.h"
 #include "util/Log.h"
 
-namespace {
-// Global flag for controlling the main event loop.
-// Set to false by signal handlers to trigger graceful shutdown.
-std::atomic<bool> g_running{true};
-
-// Signal handler for SIGINT and SIGTERM.
-// Sets the running flag to false, which causes the main loop to exit
-// and initiate cleanup of the RTP receiver and frame writer.
-void HandleSignal(int) {
-  g_running = false;
-}
-}
-
 int main(int argc, char** argv) {
+  // Block the shutdown signals before the first thread (the log writer)
+  // starts, so every thread inherits the mask and only sigwait() below
+  // receives them
+  sigset_t shutdown_signals;
+  sigemptyset(&shutdown_signals);
+  sigaddset(&shutdown_signals, SIGINT);
+  sigaddset(&shutdown_signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &shutdown_signals, nullptr);
+
   // Initialize logging with a prefix for easy log filtering
   util::Log::Instance().SetPrefix("rtp-capture");
-  std::signal(SIGINT, HandleSignal);
-  std::signal(SIGTERM, HandleSignal);
 
   // Parse command-line arguments (RTP URL, output directory, flags)
   util::Args args = util::ParseArgs(argc, argv);
+  util::Log::Instance().SetRateLimit(args.log_rate_limit);
 
   // Create and start the application
   // This initializes the RTP receiver and frame writer with parsed arguments
   app::App app(args);
   if (!app.Start()) {
     LOG_ERROR("Failed to start app");
+    util::Log::Instance().Flush();
     return 1;
   }
 
-  // Main event loop: wait for shutdown signal
-  // The RTP receiver runs in a separate thread, so this loop just
-  // waits for the user to press Ctrl+C or for the service to be terminated
+  // Wait for a shutdown signal
+  // The RTP receivers run in separate threads, so the main thread just
+  // sleeps until the user presses Ctrl+C or the service is terminated
   LOG_INFO("Service running. Press Ctrl+C to stop.");
-  while (g_running) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(200));
-  }
+  int signal_number = 0;
+  sigwait(&shutdown_signals, &signal_number);
+  LOG_INFO(std::string("Received ") + (signal_number == SIGINT ? "SIGINT" : "SIGTERM") + ", stopping");
 
   // Graceful shutdown: stop RTP receiver, close video writer, cleanup resources
   app.Stop();
+  util::Log::Instance().Flush();
   return 0;
 }
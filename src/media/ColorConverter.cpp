@@ -0,0 +1,318 @@
+#include "media/ColorConverter.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+
+#include "util/Log.h"
+
+namespace media {
+namespace {
+
+// Map ScaleAlgorithm to the libswscale flag.
+int ToSwsFlags(ScaleAlgorithm algorithm) {
+  switch (algorithm) {
+    case ScaleAlgorithm::kFastBilinear:
+      return SWS_FAST_BILINEAR;
+    case ScaleAlgorithm::kBilinear:
+      return SWS_BILINEAR;
+    case ScaleAlgorithm::kBicubic:
+      return SWS_BICUBIC;
+    case ScaleAlgorithm::kPoint:
+      return SWS_POINT;
+    case ScaleAlgorithm::kArea:
+      return SWS_AREA;
+  }
+  return SWS_BILINEAR;
+}
+
+// Minimum band height: keeps per-band setup cost small relative to the work.
+constexpr int kMinSliceRows = 64;
+
+// Parse comma- or 'x'-separated non-negative integers spanning all of text.
+bool ParseInts(const std::string& text, char separator, int* values, size_t count) {
+  size_t pos = 0;
+  for (size_t i = 0; i < count; ++i) {
+    const size_t end = i + 1 < count ? text.find(separator, pos) : text.size();
+    if (end == std::string::npos || end == pos || end - pos > 5) {
+      return false;
+    }
+    for (size_t c = pos; c < end; ++c) {
+      if (!std::isdigit(static_cast<unsigned char>(text[c]))) {
+        return false;
+      }
+    }
+    values[i] = std::atoi(text.substr(pos, end - pos).c_str());
+    pos = end + 1;
+  }
+  return true;
+}
+
+}  // namespace
+
+// Parse a --sws-flags value.
+//
+// Param: name - Algorithm name
+// Param: algorithm - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseScaleAlgorithm(const std::string& name, ScaleAlgorithm* algorithm) {
+  if (name == "fast-bilinear") {
+    *algorithm = ScaleAlgorithm::kFastBilinear;
+  } else if (name == "bilinear") {
+    *algorithm = ScaleAlgorithm::kBilinear;
+  } else if (name == "bicubic") {
+    *algorithm = ScaleAlgorithm::kBicubic;
+  } else if (name == "point") {
+    *algorithm = ScaleAlgorithm::kPoint;
+  } else if (name == "area") {
+    *algorithm = ScaleAlgorithm::kArea;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Convert ScaleAlgorithm enum to its command-line name.
+std::string ToString(ScaleAlgorithm algorithm) {
+  switch (algorithm) {
+    case ScaleAlgorithm::kFastBilinear:
+      return "fast-bilinear";
+    case ScaleAlgorithm::kBilinear:
+      return "bilinear";
+    case ScaleAlgorithm::kBicubic:
+      return "bicubic";
+    case ScaleAlgorithm::kPoint:
+      return "point";
+    case ScaleAlgorithm::kArea:
+      return "area";
+  }
+  return "unknown";
+}
+
+// Parse a --resize value.
+//
+// Param: text - "WxH"; one side may be 0, not both
+// Param: size - Receives the parsed value on success
+// Returns: true if valid, false otherwise
+bool ParseOutputSize(const std::string& text, cv::Size* size) {
+  int values[2];
+  if (!ParseInts(text, 'x', values, 2) || (values[0] == 0 && values[1] == 0)) {
+    return false;
+  }
+  *size = cv::Size(values[0], values[1]);
+  return true;
+}
+
+// Parse a --crop value.
+//
+// Param: text - "x,y,w,h" with w and h positive
+// Param: crop - Receives the parsed value on success
+// Returns: true if valid, false otherwise
+bool ParseCropRect(const std::string& text, cv::Rect* crop) {
+  int values[4];
+  if (!ParseInts(text, ',', values, 4) || values[2] == 0 || values[3] == 0) {
+    return false;
+  }
+  *crop = cv::Rect(values[0], values[1], values[2], values[3]);
+  return true;
+}
+
+ColorConverter::ColorConverter(ColorConverterOptions options)
+    : options_(options), sws_flags_(ToSwsFlags(options.algorithm)) {
+  if (options_.threads == 0) {
+    options_.threads = 1;
+  }
+  if (options_.threads > 1) {
+    // The calling thread converts one band itself
+    pool_ = std::make_unique<util::ThreadPool>(options_.threads - 1);
+  }
+}
+
+ColorConverter::~ColorConverter() {
+  Reset();
+}
+
+// Free all slice contexts (called on reconfiguration and destruction).
+void ColorConverter::Reset() {
+  for (Slice& slice : slices_) {
+    sws_freeContext(slice.ctx);
+  }
+  slices_.clear();
+}
+
+cv::Rect ColorConverter::CropFor(int width, int height) const {
+  const cv::Rect& crop = options_.crop;
+  if (crop.width <= 0 || crop.height <= 0) {
+    return cv::Rect(0, 0, width, height);
+  }
+  const int x = std::clamp(crop.x, 0, std::max(0, width - 1));
+  const int y = std::clamp(crop.y, 0, std::max(0, height - 1));
+  return cv::Rect(x, y, std::min(crop.width, width - x), std::min(crop.height, height - y));
+}
+
+// A 0 side follows the aspect ratio of the cropped source, rounded to
+// the nearest pixel.
+//
+// Param: width, height - Source frame size
+// Returns: The size of the BGR image Convert() writes
+cv::Size ColorConverter::OutputSize(int width, int height) const {
+  const cv::Rect crop = CropFor(width, height);
+  cv::Size size = options_.size;
+  if (size.width <= 0 && size.height <= 0) {
+    return crop.size();
+  }
+  if (crop.width <= 0 || crop.height <= 0) {
+    return cv::Size(0, 0);
+  }
+  if (size.width <= 0) {
+    size.width = std::max(1, static_cast<int>(std::lround(static_cast<double>(crop.width) * size.height / crop.height)));
+  } else if (size.height <= 0) {
+    size.height = std::max(1, static_cast<int>(std::lround(static_cast<double>(crop.height) * size.width / crop.width)));
+  }
+  return size;
+}
+
+// Build one SwsContext per band for the given input geometry.
+//
+// The crop corner is rounded down to the chroma subsampling so chroma
+// planes can be offset by whole samples; its size is kept, so the output
+// matches OutputSize(). Per plane, the byte offset of the crop column
+// comes from the first component stored in that plane (for packed YUYV,
+// luma's 2-byte step, not chroma's 4).
+//
+// Bands are aligned to the vertical chroma subsampling so each band's
+// chroma rows map one-to-one onto its luma rows. Only planar, non-paletted,
+// non-hardware formats are sliced, and only without resizing; everything
+// else gets a single band.
+//
+// Param: width, height, format - Input frame geometry and AVPixelFormat
+// Returns: true if every context was created (errors are logged)
+bool ColorConverter::Configure(int width, int height, int format) {
+  Reset();
+  width_ = width;
+  height_ = height;
+  format_ = format;
+
+  const auto pix_fmt = static_cast<AVPixelFormat>(format);
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(pix_fmt);
+  crop_ = CropFor(width, height);
+  output_ = OutputSize(width, height);
+  std::fill(std::begin(plane_offset_), std::end(plane_offset_), 0);
+  if (crop_.x != 0 || crop_.y != 0) {
+    if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_BITSTREAM))) {
+      const char* name = av_get_pix_fmt_name(pix_fmt);
+      LOG_ERROR(std::string("Cannot crop frames of pixel format ") + (name ? name : "unknown"));
+      return false;
+    }
+    crop_.x &= ~((1 << desc->log2_chroma_w) - 1);
+    crop_.y &= ~((1 << desc->log2_chroma_h) - 1);
+    bool seen[4] = {false, false, false, false};
+    for (int i = 0; i < desc->nb_components; ++i) {
+      const AVComponentDescriptor& comp = desc->comp[i];
+      if (seen[comp.plane]) {
+        continue;
+      }
+      seen[comp.plane] = true;
+      // Planes 1 and 2 carry chroma, subsampled horizontally too
+      const int column = (comp.plane == 1 || comp.plane == 2) ? (crop_.x >> desc->log2_chroma_w) : crop_.x;
+      plane_offset_[comp.plane] = column * comp.step;
+    }
+  }
+
+  const bool resize = output_ != crop_.size();
+  const bool sliceable = desc && !resize && (desc->flags & AV_PIX_FMT_FLAG_PLANAR) &&
+                         !(desc->flags & (AV_PIX_FMT_FLAG_PAL | AV_PIX_FMT_FLAG_HWACCEL));
+  chroma_shift_ = desc ? desc->log2_chroma_h : 0;
+
+  const int rows = crop_.height;
+  size_t bands = sliceable ? options_.threads : 1;
+  bands = std::min<size_t>(bands, std::max(1, rows / kMinSliceRows));
+
+  const int align = 1 << chroma_shift_;
+  const int rows_per_band =
+      resize ? rows : std::max(align, static_cast<int>((rows / align + bands - 1) / bands) * align);
+  for (int y = 0; y < rows; y += rows_per_band) {
+    Slice slice;
+    slice.y = y;
+    slice.height = std::min(rows_per_band, rows - y);
+    slice.ctx = sws_getContext(crop_.width,
+                               slice.height,
+                               pix_fmt,
+                               output_.width,
+                               resize ? output_.height : slice.height,
+                               AV_PIX_FMT_BGR24,
+                               sws_flags_,
+                               nullptr,
+                               nullptr,
+                               nullptr);
+    if (!slice.ctx) {
+      Reset();
+      LOG_ERROR("Failed to create swscale context");
+      return false;
+    }
+    slices_.push_back(slice);
+  }
+  return !slices_.empty();
+}
+
+// Convert one band: offset every source plane to the band's first row
+// (chroma planes by the subsampled row) and the crop's first column, and
+// the destination to its row.
+void ColorConverter::ConvertSlice(const Slice& slice, const AVFrame* src, cv::Mat& dst) const {
+  const uint8_t* src_data[4] = {nullptr, nullptr, nullptr, nullptr};
+  const int y = crop_.y + slice.y;
+  for (int plane = 0; plane < 4; ++plane) {
+    if (!src->data[plane]) {
+      continue;
+    }
+    // Planes 1 and 2 carry chroma; plane 0 (luma) and 3 (alpha) are full height
+    const int row = (plane == 1 || plane == 2) ? (y >> chroma_shift_) : y;
+    src_data[plane] = src->data[plane] + static_cast<ptrdiff_t>(row) * src->linesize[plane] + plane_offset_[plane];
+  }
+  uint8_t* dst_data[4] = {dst.ptr<uint8_t>(slice.y), nullptr, nullptr, nullptr};
+  int dst_linesize[4] = {static_cast<int>(dst.step[0]), 0, 0, 0};
+  sws_scale(slice.ctx, src_data, src->linesize, 0, slice.height, dst_data, dst_linesize);
+}
+
+// Convert src into dst, spreading bands over the pool.
+//
+// Param: src - Decoded frame
+// Param: dst - Preallocated BGR24 destination of OutputSize()
+// Returns: false if the swscale contexts could not be created or dst has
+//          the wrong size
+bool ColorConverter::Convert(const AVFrame* src, cv::Mat& dst) {
+  if (src->width != width_ || src->height != height_ || src->format != format_ || slices_.empty()) {
+    if (!Configure(src->width, src->height, src->format)) {
+      return false;
+    }
+  }
+  if (dst.cols != output_.width || dst.rows != output_.height) {
+    LOG_ERROR("Conversion destination is " + std::to_string(dst.cols) + "x" + std::to_string(dst.rows) +
+              ", expected " + std::to_string(output_.width) + "x" + std::to_string(output_.height));
+    return false;
+  }
+
+  if (slices_.size() == 1 || !pool_) {
+    for (const Slice& slice : slices_) {
+      ConvertSlice(slice, src, dst);
+    }
+    return true;
+  }
+
+  for (size_t i = 0; i + 1 < slices_.size(); ++i) {
+    const Slice& slice = slices_[i];
+    pool_->Submit([this, &slice, src, &dst]() { ConvertSlice(slice, src, dst); });
+  }
+  ConvertSlice(slices_.back(), src, dst);
+  pool_->Wait();
+  return true;
+}
+
+}  // namespace media
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "util/ThreadPool.h"
+
+struct AVFrame;
+struct SwsContext;
+
+namespace media {
+
+// swscale interpolation used for colour conversion and resizing.
+// Without resizing only chroma upsampling is affected, so the cheap
+// modes (fast-bilinear, point) are usually indistinguishable from
+// bilinear for capture purposes. For downscaling, area averages every
+// source pixel and avoids the aliasing of bilinear at ratios beyond 2:1.
+enum class ScaleAlgorithm {
+  kFastBilinear,  // SWS_FAST_BILINEAR
+  kBilinear,      // SWS_BILINEAR (historical default)
+  kBicubic,       // SWS_BICUBIC
+  kPoint,         // SWS_POINT (nearest neighbour)
+  kArea,          // SWS_AREA
+};
+
+// Parse an algorithm name ("fast-bilinear", "bilinear", "bicubic",
+// "point", "area").
+//
+// Returns: true if recognized (algorithm set), false otherwise
+bool ParseScaleAlgorithm(const std::string& name, ScaleAlgorithm* algorithm);
+
+// Convert ScaleAlgorithm to its command-line name.
+std::string ToString(ScaleAlgorithm algorithm);
+
+// Parse an output size "WxH" (e.g. "640x360"). One side may be 0 to
+// follow the aspect ratio of the source ("640x0").
+//
+// Returns: true if valid (size set), false otherwise
+bool ParseOutputSize(const std::string& text, cv::Size* size);
+
+// Parse a crop rectangle "x,y,w,h" in source pixels (e.g. "0,0,960,540").
+//
+// Returns: true if valid (crop set), false otherwise
+bool ParseCropRect(const std::string& text, cv::Rect* crop);
+
+// Configuration for ColorConverter.
+struct ColorConverterOptions {
+  // Number of horizontal slices converted in parallel.
+  // 1 converts the whole frame on the calling thread.
+  size_t threads = 1;
+
+  // swscale interpolation flag
+  ScaleAlgorithm algorithm = ScaleAlgorithm::kBilinear;
+
+  // Region of the source frame to convert, clipped to the frame. Empty
+  // converts the whole frame. The corner is rounded down to the chroma
+  // subsampling (even x and y for 4:2:0).
+  cv::Rect crop;
+
+  // Output size. 0x0 keeps the size of the (cropped) source; with one
+  // side 0 the other follows the source aspect ratio.
+  cv::Size size;
+};
+
+// Decoder frame → packed BGR24 conversion with optional crop and resize,
+// with slice parallelism.
+//
+// Crop, resize and colour conversion happen in one sws_scale pass: the
+// crop offsets the source plane pointers, so only the region is read,
+// and only the output size is written. Compared to converting the full
+// frame and resizing the BGR image afterwards, this saves a full-size
+// BGR buffer and a pass over it per frame.
+//
+// The frame is split into horizontal bands, each with its own SwsContext
+// sized to the band. Band boundaries are aligned to the chroma
+// subsampling (2 rows for 4:2:0) so every band starts on a full chroma
+// row and the output is identical to a single-context conversion. The
+// calling thread converts the last band itself while pool workers take
+// the others, then waits for all of them.
+//
+// Formats that cannot be sliced this way (packed, paletted or hardware
+// formats) fall back to a single context, and so does resizing: a band's
+// vertical filter would miss the source rows of its neighbours.
+//
+// Contexts are rebuilt when the input size or pixel format changes.
+//
+// Not thread-safe: one converter per decode thread.
+class ColorConverter {
+ public:
+  explicit ColorConverter(ColorConverterOptions options = {});
+  ~ColorConverter();
+
+  ColorConverter(const ColorConverter&) = delete;
+  ColorConverter& operator=(const ColorConverter&) = delete;
+
+  // Size Convert() produces for a source frame of the given size, after
+  // crop and resize.
+  cv::Size OutputSize(int width, int height) const;
+
+  // Convert a decoded frame into a BGR Mat.
+  //
+  // Param: src - Decoded frame (any swscale-supported input format)
+  // Param: dst - Destination, already allocated as CV_8UC3 of
+  //              OutputSize(src->width, src->height)
+  // Returns: true on success, false if no swscale context could be created
+  //          or dst has another size
+  bool Convert(const AVFrame* src, cv::Mat& dst);
+
+  // Number of bands the current configuration converts in parallel.
+  size_t slice_count() const { return slices_.size(); }
+
+ private:
+  // One horizontal band of the frame.
+  struct Slice {
+    SwsContext* ctx = nullptr;
+    int y = 0;        // First row, relative to the crop
+    int height = 0;   // Source rows in the band
+  };
+
+  // Source region of a frame of the given size: options_.crop clipped to
+  // the frame, or all of it if empty (before chroma alignment).
+  cv::Rect CropFor(int width, int height) const;
+
+  // (Re)create per-slice contexts for the given input geometry.
+  bool Configure(int width, int height, int format);
+
+  // Free all slice contexts.
+  void Reset();
+
+  // Convert one band (runs on a worker or the calling thread).
+  void ConvertSlice(const Slice& slice, const AVFrame* src, cv::Mat& dst) const;
+
+  ColorConverterOptions options_;
+  int sws_flags_;
+  std::vector<Slice> slices_;
+  int chroma_shift_ = 0;  // log2 vertical chroma subsampling of the input
+  cv::Rect crop_;         // Source region of the current configuration
+  cv::Size output_;       // Output size of the current configuration
+  int plane_offset_[4] = {0, 0, 0, 0};  // Byte offset of crop_.x in each plane
+  int width_ = 0;
+  int height_ = 0;
+  int format_ = -1;
+  std::unique_ptr<util::ThreadPool> pool_;  // Null with a single thread
+};
+
+}  // namespace media
@@ -0,0 +1,156 @@
+#include "media/FrameGate.h"
+
+#include <algorithm>
+#include <utility>
+
+#include <opencv2/imgproc.hpp>
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+namespace media {
+namespace {
+
+// Scene-detection thumbnail size (16:9, 30x30 pixel blocks at 1080p)
+constexpr int kThumbWidth = 64;
+constexpr int kThumbHeight = 36;
+
+// PTS jitter tolerated by the fps limit (capped at 1/8 of the interval),
+// so a frame a few milliseconds early is not skipped for a whole step
+constexpr int64_t kMaxJitterUs = 5000;
+
+// A PTS gap longer than this many fps intervals restarts the grid instead
+// of letting a burst of frames catch up
+constexpr int64_t kMaxCatchUpIntervals = 4;
+
+}  // namespace
+
+FrameGate::FrameGate(FrameGateOptions options)
+    : options_(std::move(options)),
+      enabled_(options_.keyframes_only || options_.every_n > 1 || options_.max_fps > 0.0 ||
+               options_.scene_threshold > 0.0) {
+  options_.every_n = std::max<uint32_t>(1, options_.every_n);
+  if (options_.max_fps > 0.0) {
+    interval_us_ = static_cast<int64_t>(1e6 / options_.max_fps);
+  }
+
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string stream = util::MetricLabel("stream", options_.name.empty() ? "default" : options_.name);
+  const std::string help = "Frames not written as images because of the frame gate";
+  skipped_keyframe_ =
+      metrics.GetCounter("capture_gate_skipped_total", help, stream + "," + util::MetricLabel("reason", "keyframe"));
+  skipped_every_n_ =
+      metrics.GetCounter("capture_gate_skipped_total", help, stream + "," + util::MetricLabel("reason", "every_n"));
+  skipped_fps_ =
+      metrics.GetCounter("capture_gate_skipped_total", help, stream + "," + util::MetricLabel("reason", "fps"));
+  skipped_unchanged_ =
+      metrics.GetCounter("capture_gate_skipped_total", help, stream + "," + util::MetricLabel("reason", "unchanged"));
+}
+
+// Apply the enabled filters, cheapest first, so the thumbnail is only
+// computed for frames that survived sampling.
+//
+// Param: frame - Decoded frame
+// Returns: true if the frame should be written
+bool FrameGate::Accept(const Frame& frame) {
+  if (!enabled_) {
+    return true;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++stats_.seen;
+
+  if (options_.keyframes_only && !frame.key_frame) {
+    ++stats_.skipped_keyframe;
+    skipped_keyframe_->Add();
+    return false;
+  }
+
+  if (options_.every_n > 1 && (candidates_++ % options_.every_n) != 0) {
+    ++stats_.skipped_every_n;
+    skipped_every_n_->Add();
+    return false;
+  }
+
+  const int64_t now_us = frame.pts_us >= 0 ? frame.pts_us : util::NowMicros();
+  if (interval_us_ > 0 && next_due_us_ >= 0) {
+    const bool restart =
+        now_us < last_kept_us_ || now_us - next_due_us_ > kMaxCatchUpIntervals * interval_us_;
+    const int64_t tolerance_us = std::min(kMaxJitterUs, interval_us_ / 8);
+    if (!restart && now_us + tolerance_us < next_due_us_) {
+      ++stats_.skipped_fps;
+      skipped_fps_->Add();
+      return false;
+    }
+    if (restart) {
+      next_due_us_ = now_us;
+    }
+  }
+
+  if (options_.scene_threshold > 0.0) {
+    cv::Mat thumbnail = Thumbnail(frame);
+    if (!thumbnail.empty() && !reference_.empty() && thumbnail.size() == reference_.size()) {
+      const double difference = cv::norm(thumbnail, reference_, cv::NORM_L1) / static_cast<double>(thumbnail.total());
+      if (difference < options_.scene_threshold) {
+        ++stats_.skipped_unchanged;
+        skipped_unchanged_->Add();
+        return false;
+      }
+    }
+    reference_ = std::move(thumbnail);
+  }
+
+  if (interval_us_ > 0) {
+    next_due_us_ = (next_due_us_ < 0 ? now_us : next_due_us_) + interval_us_;
+    // A frame late by more than one interval must not let the next ones
+    // through back to back
+    next_due_us_ = std::max(next_due_us_, now_us + interval_us_ / 2);
+  }
+  last_kept_us_ = now_us;
+  ++stats_.kept;
+  return true;
+}
+
+FrameGateStats FrameGate::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+// Area-average the frame down to kThumbWidth x kThumbHeight grayscale.
+// BGR frames are reduced first and converted afterwards, so the color
+// conversion only touches the thumbnail.
+//
+// Param: frame - Frame with bgr or an 8-bit luma plane in native
+// Returns: CV_8UC1 thumbnail, or empty if no pixels are available
+cv::Mat FrameGate::Thumbnail(const Frame& frame) {
+  const cv::Size size(kThumbWidth, kThumbHeight);
+  cv::Mat thumbnail;
+  if (!frame.bgr.empty()) {
+    cv::Mat small;
+    cv::resize(frame.bgr, small, size, 0, 0, cv::INTER_AREA);
+    cv::cvtColor(small, thumbnail, cv::COLOR_BGR2GRAY);
+    return thumbnail;
+  }
+
+  const AVFrame* native = frame.native;
+  if (!native || !native->data[0] || native->width <= 0 || native->height <= 0) {
+    return thumbnail;
+  }
+  switch (native->format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_NV12:
+    case AV_PIX_FMT_GRAY8: {
+      // Plane 0 is 8-bit luma in all of these; wrap it without copying
+      const cv::Mat luma(native->height, native->width, CV_8UC1, native->data[0],
+                         static_cast<size_t>(native->linesize[0]));
+      cv::resize(luma, thumbnail, size, 0, 0, cv::INTER_AREA);
+      break;
+    }
+    default:
+      break;
+  }
+  return thumbnail;
+}
+
+}  // namespace media
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include <opencv2/core.hpp>
+
+#include "media/FramePool.h"
+#include "util/Metrics.h"
+
+namespace media {
+
+// Which decoded frames are worth writing as images.
+// All filters are off by default (every frame passes); enabled filters
+// are applied in the order listed, and a frame must pass all of them.
+struct FrameGateOptions {
+  // Only keyframes pass (one image per GOP, typically every 1-10 s with WebRTC)
+  bool keyframes_only = false;
+
+  // Keep one frame out of every N (1 = all), counted after keyframes_only
+  uint32_t every_n = 1;
+
+  // Upper bound on kept frames per second, from the frame PTS (wall clock
+  // if the PTS is unknown); 0 = unlimited
+  double max_fps = 0.0;
+
+  // Scene-change threshold: mean absolute luma difference (0-255) between
+  // a frame and the last kept one, both downsampled to a 64x36 thumbnail.
+  // 0 disables the check. Around 2-4 ignores compression noise and cursor
+  // blinks on a screen share; 10+ only passes large content changes.
+  double scene_threshold = 0.0;
+
+  // Stream label of the gate's metrics
+  std::string name = "default";
+};
+
+// Counters describing gate decisions, see FrameGate::GetStats().
+struct FrameGateStats {
+  uint64_t seen = 0;              // Frames offered to Accept()
+  uint64_t kept = 0;              // Frames that passed
+  uint64_t skipped_keyframe = 0;  // Not a keyframe (keyframes_only)
+  uint64_t skipped_every_n = 0;   // Between two every_n samples
+  uint64_t skipped_fps = 0;       // Too soon after the last kept frame
+  uint64_t skipped_unchanged = 0; // Below scene_threshold
+};
+
+// Sampling and change-detection filter in front of FrameWriter.
+//
+// Screen shares and static cameras produce mostly identical frames;
+// writing each of them as a PNG spends encode CPU and disk bandwidth on
+// duplicates. The gate decides per frame, before anything is encoded,
+// whether it is kept.
+//
+// Scene detection downsamples the luma to a 64x36 thumbnail with area
+// averaging (cv::resize INTER_AREA, vectorized in OpenCV) and compares it
+// to the thumbnail of the last kept frame (cv::norm L1, also vectorized).
+// Averaging over 30x30 pixel blocks at 1080p suppresses encoder noise, so
+// the threshold reacts to content rather than to quantization. The
+// reference only moves on kept frames, which means slow drift is still
+// caught once it adds up to the threshold. Thumbnails are taken from
+// Frame::bgr, or from the luma plane of Frame::native (YUV420P/NV12/GRAY8)
+// when no BGR frame was produced.
+//
+// The fps limit follows a grid of 1/max_fps steps anchored at the first
+// kept frame (with a few milliseconds of tolerance), so a 30 fps stream
+// capped at 10 fps keeps exactly every third frame instead of drifting
+// with PTS jitter. The grid restarts after a gap or when the PTS jumps
+// backwards (stream restart).
+//
+// Metrics (util::Metrics, label stream="<name>"):
+//   capture_gate_skipped_total{reason="keyframe|every_n|fps|unchanged"}
+//
+// Thread-safe: Accept() serializes on a mutex, so several writer threads
+// may share one gate (decisions then follow dequeue order).
+class FrameGate {
+ public:
+  explicit FrameGate(FrameGateOptions options = FrameGateOptions());
+
+  FrameGate(const FrameGate&) = delete;
+  FrameGate& operator=(const FrameGate&) = delete;
+
+  // True if any filter is enabled (otherwise Accept() always passes).
+  bool enabled() const { return enabled_; }
+
+  // Decide whether a frame should be written.
+  //
+  // Param: frame - Decoded frame (sequence, pts_us, key_frame and pixels)
+  // Returns: true if the frame passes every enabled filter
+  // Side effects: a kept frame becomes the fps and scene reference
+  bool Accept(const Frame& frame);
+
+  FrameGateStats GetStats() const;
+
+ private:
+  // Downsampled grayscale thumbnail of the frame.
+  // Returns: empty Mat if the frame has no usable pixels
+  static cv::Mat Thumbnail(const Frame& frame);
+
+  FrameGateOptions options_;
+  bool enabled_;
+  int64_t interval_us_ = 0;  // 1e6 / max_fps, 0 = unlimited
+
+  mutable std::mutex mutex_;
+  FrameGateStats stats_;
+  uint64_t candidates_ = 0;     // Frames reaching the every_n filter
+  int64_t next_due_us_ = -1;    // Earliest timestamp of the next kept frame
+  int64_t last_kept_us_ = -1;   // Timestamp of the last kept frame
+  cv::Mat reference_;           // Thumbnail of the last kept frame
+
+  util::Counter* skipped_keyframe_;
+  util::Counter* skipped_every_n_;
+  util::Counter* skipped_fps_;
+  util::Counter* skipped_unchanged_;
+};
+
+}  // namespace media
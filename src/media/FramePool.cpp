@@ -0,0 +1,259 @@
+#include "media/FramePool.h"
+
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <algorithm>
+#include <utility>
+
+namespace media {
+
+// A pooled frame: the Frame itself, its reference count, and (while
+// checked out) a reference to the pool state it must return to.
+//
+// buffer and native_storage are allocated once per slot and survive
+// recycling; Frame::bgr / Frame::native point at them only when the
+// producer filled that representation.
+struct FrameRef::Slot {
+  ~Slot() { av_frame_free(&native_storage); }
+
+  std::atomic<uint32_t> refs{0};
+  std::shared_ptr<FramePool::State> owner;
+  cv::Mat buffer;
+  AVFrame* native_storage = nullptr;
+  Frame frame;
+};
+
+// Pool state shared between FramePool and outstanding frames.
+// Owns the cached slots; outstanding slots are owned by their FrameRefs.
+struct FramePool::State {
+  explicit State(size_t max_cached) : max_cached(max_cached) {}
+
+  ~State() {
+    for (FrameRef::Slot* slot : free) {
+      delete slot;
+    }
+  }
+
+  // Return a slot whose last reference was dropped.
+  // Drops the decoder frame reference (so the decoder can reuse its
+  // buffer), then caches the slot for reuse or frees it if the free list
+  // is full.
+  void Release(FrameRef::Slot* slot) {
+    if (slot->frame.native) {
+      av_frame_unref(slot->native_storage);
+      slot->frame.native = nullptr;
+    }
+    slot->frame.bgr.release();
+    std::lock_guard<std::mutex> lock(mutex);
+    --stats.outstanding;
+    if (free.size() < max_cached) {
+      free.push_back(slot);
+    } else {
+      delete slot;
+    }
+  }
+
+  mutable std::mutex mutex;
+  std::vector<FrameRef::Slot*> free;
+  size_t max_cached;
+  FramePoolStats stats;
+};
+
+FrameRef::FrameRef(const FrameRef& other) : slot_(other.slot_) {
+  if (slot_) {
+    slot_->refs.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+
+FrameRef::FrameRef(FrameRef&& other) noexcept : slot_(other.slot_) {
+  other.slot_ = nullptr;
+}
+
+FrameRef& FrameRef::operator=(const FrameRef& other) {
+  if (this != &other) {
+    FrameRef copy(other);
+    std::swap(slot_, copy.slot_);
+  }
+  return *this;
+}
+
+FrameRef& FrameRef::operator=(FrameRef&& other) noexcept {
+  if (this != &other) {
+    reset();
+    slot_ = other.slot_;
+    other.slot_ = nullptr;
+  }
+  return *this;
+}
+
+FrameRef::~FrameRef() {
+  reset();
+}
+
+const Frame& FrameRef::operator*() const {
+  return slot_->frame;
+}
+
+const Frame* FrameRef::operator->() const {
+  return &slot_->frame;
+}
+
+Frame& FrameRef::mutable_frame() {
+  return slot_->frame;
+}
+
+// Reference the decoder's frame from this pooled frame.
+// av_frame_ref() only bumps the reference counts of the decoder's
+// buffers; the planes are not copied.
+//
+// Param: src - Decoded frame (e.g. from avcodec_receive_frame)
+// Returns: true on success, false if allocation or referencing failed
+bool FrameRef::AttachNative(const AVFrame* src) {
+  if (!slot_->native_storage) {
+    slot_->native_storage = av_frame_alloc();
+    if (!slot_->native_storage) {
+      return false;
+    }
+  }
+  if (slot_->frame.native) {
+    av_frame_unref(slot_->native_storage);
+    slot_->frame.native = nullptr;
+  }
+  if (av_frame_ref(slot_->native_storage, src) < 0) {
+    return false;
+  }
+  slot_->frame.native = slot_->native_storage;
+  return true;
+}
+
+// Drop this reference.
+// The last reference hands the slot back to its pool. The acq_rel
+// ordering makes every consumer's reads of the pixels happen-before the
+// producer's next write into the recycled buffer.
+void FrameRef::reset() {
+  if (!slot_) {
+    return;
+  }
+  Slot* slot = slot_;
+  slot_ = nullptr;
+  if (slot->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::shared_ptr<FramePool::State> state = std::move(slot->owner);
+    state->Release(slot);
+  }
+}
+
+FramePool::FramePool(size_t max_cached) : state_(std::make_shared<State>(max_cached)) {}
+
+// Outstanding frames keep state_ alive; cached slots are freed with it.
+FramePool::~FramePool() = default;
+
+// Hand out a frame with a buffer of the requested geometry.
+//
+// Prefers a cached slot that already has the right size so that no
+// reallocation happens; otherwise reuses any cached slot (reallocating its
+// Mat, e.g. after a resolution change) or creates a new one.
+//
+// Param: rows, cols - Frame dimensions
+// Param: type - OpenCV element type (e.g. CV_8UC3)
+// Returns: FrameRef with a reference count of 1
+FrameRef FramePool::Acquire(int rows, int cols, int type) {
+  FrameRef::Slot* slot = TakeSlot(rows, cols, type);
+  bool allocated = false;
+  if (!slot) {
+    slot = new FrameRef::Slot();
+    allocated = true;
+  }
+  cv::Mat& buffer = slot->buffer;
+  if (buffer.rows != rows || buffer.cols != cols || buffer.type() != type) {
+    buffer.create(rows, cols, type);
+    allocated = true;
+  }
+  if (allocated) {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    ++state_->stats.allocations;
+  }
+  slot->frame.bgr = buffer;
+  return Checkout(slot);
+}
+
+// Hand out a frame whose bgr Mat stays empty.
+// Any cached slot will do; its BGR buffer is kept for later Acquire() calls.
+//
+// Returns: FrameRef with a reference count of 1
+FrameRef FramePool::AcquireEmpty() {
+  FrameRef::Slot* slot = TakeSlot(0, 0, -1);
+  if (!slot) {
+    slot = new FrameRef::Slot();
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    ++state_->stats.allocations;
+  }
+  return Checkout(slot);
+}
+
+// Pop a cached slot, preferring one whose buffer matches the geometry.
+// Updates the acquisition counters.
+//
+// Returns: A cached slot, or nullptr if the free list is empty
+FrameRef::Slot* FramePool::TakeSlot(int rows, int cols, int type) {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  FramePoolStats& stats = state_->stats;
+  ++stats.acquired;
+  ++stats.outstanding;
+  stats.high_water = std::max(stats.high_water, stats.outstanding);
+
+  auto& free = state_->free;
+  if (free.empty()) {
+    return nullptr;
+  }
+  auto match = std::find_if(free.rbegin(), free.rend(), [&](FrameRef::Slot* candidate) {
+    const cv::Mat& buffer = candidate->buffer;
+    return buffer.rows == rows && buffer.cols == cols && buffer.type() == type;
+  });
+  FrameRef::Slot* slot = nullptr;
+  if (match != free.rend()) {
+    slot = *match;
+    free.erase(std::next(match).base());
+  } else {
+    slot = free.back();
+    free.pop_back();
+  }
+  return slot;
+}
+
+// Reset a slot's metadata and wrap it in a FrameRef owned by the caller.
+FrameRef FramePool::Checkout(FrameRef::Slot* slot) {
+  Frame& frame = slot->frame;
+  frame.width = 0;
+  frame.height = 0;
+  frame.sequence = 0;
+  frame.pts_us = -1;
+  frame.key_frame = false;
+  slot->refs.store(1, std::memory_order_relaxed);
+  slot->owner = state_;
+  return FrameRef(slot);
+}
+
+// Preallocate up to count cached slots of the given geometry.
+//
+// Param: count - Number of slots to prepare (bounded by max_cached)
+// Param: rows, cols, type - Geometry of the buffers
+void FramePool::Reserve(size_t count, int rows, int cols, int type) {
+  std::vector<FrameRef> frames;
+  frames.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    frames.push_back(Acquire(rows, cols, type));
+  }
+  // Releasing the references puts every slot on the free list
+}
+
+// Return a snapshot of the pool counters.
+FramePoolStats FramePool::GetStats() const {
+  std::lock_guard<std::mutex> lock(state_->mutex);
+  FramePoolStats stats = state_->stats;
+  stats.cached = state_->free.size();
+  return stats;
+}
+
+}  // namespace media
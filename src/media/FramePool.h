@@ -0,0 +1,166 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct AVFrame;
+
+namespace media {
+
+// Pixel representations a sink can ask the receiver for.
+// Sinks report a bitmask of these (e.g. FrameWriter::RequiredFormats());
+// the receiver ORs the masks of all its sinks and only produces what is
+// requested, so recording-only pipelines never pay for BGR conversion.
+enum FrameFormat : uint32_t {
+  kFormatNone = 0,
+  kFormatBgr = 1u << 0,     // Frame::bgr is filled (BGR24 cv::Mat)
+  kFormatNative = 1u << 1,  // Frame::native references the decoder's planes
+};
+
+// A decoded frame plus the metadata sinks need to order and time it.
+struct Frame {
+  // Pixel data in BGR format (3 channels, 8-bit).
+  // Backed by a pooled buffer; valid for as long as a FrameRef is held.
+  // Empty unless kFormatBgr was negotiated.
+  cv::Mat bgr;
+
+  // The decoder's own frame (typically YUV420P/I420 or NV12), shared by
+  // reference with the decoder's buffer pool: no conversion, no copy.
+  // Null unless kFormatNative was negotiated. Treat as read-only.
+  AVFrame* native = nullptr;
+
+  // Frame dimensions: of bgr when it is set (after --crop / --resize),
+  // otherwise of native
+  int width = 0;
+  int height = 0;
+
+  // 1-based decode order within the stream
+  uint64_t sequence = 0;
+
+  // Presentation time in microseconds (stream-relative), -1 if unknown
+  int64_t pts_us = -1;
+
+  // True if the decoder marked this frame as a keyframe
+  bool key_frame = false;
+};
+
+class FramePool;
+
+// Reference-counted handle to a pooled Frame.
+//
+// Copying a FrameRef bumps an atomic counter; when the last copy is
+// destroyed the frame's buffer goes back to its pool's free list instead
+// of being freed. No heap allocation happens on copy, move or release.
+//
+// Sinks that need a frame after their callback returns keep a FrameRef
+// (not a copy of frame->bgr: a bare cv::Mat header does not keep the
+// buffer out of the pool).
+//
+// Thread-safe: copies may be created and destroyed on any thread; the
+// referenced Frame must be treated as read-only once it has been shared.
+class FrameRef {
+ public:
+  FrameRef() = default;
+  FrameRef(const FrameRef& other);
+  FrameRef(FrameRef&& other) noexcept;
+  FrameRef& operator=(const FrameRef& other);
+  FrameRef& operator=(FrameRef&& other) noexcept;
+  ~FrameRef();
+
+  const Frame& operator*() const;
+  const Frame* operator->() const;
+  explicit operator bool() const { return slot_ != nullptr; }
+
+  // Writable access for the producer, before the frame is shared.
+  Frame& mutable_frame();
+
+  // Producer only: make Frame::native a new reference to src's buffers.
+  // The reference is dropped when the frame returns to the pool.
+  // Returns: false if the reference could not be created
+  bool AttachNative(const AVFrame* src);
+
+  // Drop this reference (returns the buffer to the pool if it was the last).
+  void reset();
+
+ private:
+  friend class FramePool;
+  struct Slot;
+
+  explicit FrameRef(Slot* slot) : slot_(slot) {}
+
+  Slot* slot_ = nullptr;
+};
+
+// Counters describing pool behaviour, see FramePool::GetStats().
+struct FramePoolStats {
+  uint64_t acquired = 0;     // Frames handed out by Acquire()
+  uint64_t allocations = 0;  // Buffer (re)allocations (0 growth in steady state)
+  size_t outstanding = 0;    // Frames currently referenced by consumers
+  size_t high_water = 0;     // Maximum outstanding frames observed
+  size_t cached = 0;         // Frames sitting in the free list
+};
+
+// Pool of reusable frame buffers shared between the decoder and sinks.
+//
+// Each slot owns a BGR buffer and an AVFrame shell; depending on the
+// negotiated formats a frame exposes either, both, or (decode-only) none.
+//
+// RtpReceiver acquires a frame, uses its Mat as the sws_scale destination
+// and passes a FrameRef to the callback. Sinks can keep the FrameRef (for
+// a queue, an encoder pool, ...) without copying pixels. When the last
+// reference is dropped the slot returns to the free list and is reused by
+// the next Acquire() with the same dimensions, so once the pool has grown
+// to the pipeline's peak depth no further allocations happen.
+//
+// The pool state is shared with outstanding frames: destroying the
+// FramePool while sinks still hold frames is safe, the buffers are freed
+// when the last reference goes away.
+//
+// Thread-safe: Acquire() and frame release may happen on any thread.
+class FramePool {
+ public:
+  // Param: max_cached - Free-list size limit; slots returned beyond it are freed
+  explicit FramePool(size_t max_cached = 128);
+  ~FramePool();
+
+  FramePool(const FramePool&) = delete;
+  FramePool& operator=(const FramePool&) = delete;
+
+  // Get a frame whose bgr Mat is rows x cols of the given type.
+  // Reuses a cached slot when possible; its pixel contents are undefined
+  // and its metadata is reset.
+  //
+  // Param: rows, cols - Frame dimensions
+  // Param: type - OpenCV element type (e.g. CV_8UC3)
+  // Returns: A uniquely owned FrameRef ready to be filled by the producer
+  FrameRef Acquire(int rows, int cols, int type);
+
+  // Get a frame without a BGR buffer (Frame::bgr stays empty), for
+  // pipelines that only negotiated kFormatNative.
+  FrameRef AcquireEmpty();
+
+  // Preallocate slots so the first frames don't pay for allocation.
+  void Reserve(size_t count, int rows, int cols, int type);
+
+  FramePoolStats GetStats() const;
+
+ private:
+  friend class FrameRef;
+  struct State;
+
+  // Pop a cached slot (preferring matching geometry) and count the acquisition.
+  FrameRef::Slot* TakeSlot(int rows, int cols, int type);
+
+  // Reset metadata and hand the slot out with one reference.
+  FrameRef Checkout(FrameRef::Slot* slot);
+
+  std::shared_ptr<State> state_;
+};
+
+}  // namespace media
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <cstdint>
+
+#include "media/FramePool.h"
+
+struct AVCodecParameters;
+struct AVPacket;
+struct AVRational;
+
+namespace media {
+
+// Consumer of a stream's decoded frames (image writer, recorder,
+// shared-memory publisher, ...).
+//
+// A stream fans every frame out to its sinks; each sink runs behind its
+// own app::SinkExecutor (queue, threads, overflow policy), so a slow sink
+// only loses or delays its own frames. Sinks are created by name through
+// app::SinkRegistry.
+//
+// Thread-safe: OnFrame() and OnPacket() may be called from several
+// executor threads at once (threads > 1) and concurrently with
+// RequiredFormats() on the receiver thread; Close() is called once, after
+// the last OnFrame() or OnPacket().
+class FrameSink {
+ public:
+  virtual ~FrameSink() = default;
+
+  // Formats (kFormatBgr, kFormatNative) this sink reads from frames. May
+  // change after OnPacket() (e.g. a recorder deciding to stream-copy);
+  // the receiver renegotiates after every packet for sinks that want packets.
+  virtual uint32_t RequiredFormats() const = 0;
+
+  // Consume one frame; keep the FrameRef to use it after returning.
+  virtual void OnFrame(const FrameRef& frame) = 0;
+
+  // True to receive compressed packets through OnPacket().
+  virtual bool WantsPackets() const { return false; }
+
+  // Compressed packet before decoding (see ingest::EncodedPacket), queued
+  // in order with the frames; on the receiver thread only for inline
+  // sinks. Pointers are valid during the call only.
+  virtual void OnPacket(const AVPacket* /*packet*/, const AVCodecParameters* /*codecpar*/,
+                        const AVRational& /*time_base*/) {}
+
+  // Flush and finalize output; log counters.
+  virtual void Close() {}
+};
+
+}  // namespace media
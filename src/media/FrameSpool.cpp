@@ -0,0 +1,358 @@
+#include "media/FrameSpool.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+
+extern "C" {
+#include <libavutil/adler32.h>
+}
+
+#include "util/Log.h"
+
+namespace media {
+
+namespace {
+
+constexpr char kIndexMagic[8] = {'F', 'R', 'S', 'P', 'O', 'O', 'L', '1'};
+constexpr uint32_t kIndexVersion = 2;
+
+// Written data is handed to the kernel for writeback in steps of this
+// size, so a segment never accumulates gigabytes of dirty pages.
+constexpr uint64_t kWritebackBytes = 32ull << 20;
+
+uint64_t AlignUp(uint64_t value) {
+  return (value + kSpoolAlignment - 1) / kSpoolAlignment * kSpoolAlignment;
+}
+
+// "segment_000001" for segment 1 (no extension).
+std::string SegmentStem(uint32_t number) {
+  char name[32];
+  std::snprintf(name, sizeof(name), "segment_%06u", number);
+  return name;
+}
+
+// Segment number of "segment_NNNNNN.idx", or 0 if name is not an index file.
+uint32_t ParseIndexName(const std::string& name) {
+  unsigned number = 0;
+  char tail = 0;
+  if (name.size() != 18 || std::sscanf(name.c_str(), "segment_%6u.id%c", &number, &tail) != 2 || tail != 'x') {
+    return 0;
+  }
+  return number;
+}
+
+// write() all of size bytes, retrying on EINTR and short writes.
+bool WriteAll(int fd, const void* data, size_t size) {
+  const uint8_t* p = static_cast<const uint8_t*>(data);
+  while (size > 0) {
+    const ssize_t n = ::write(fd, p, size);
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    p += n;
+    size -= static_cast<size_t>(n);
+  }
+  return true;
+}
+
+// Adler-32 of a payload (the entry checksum); never 0, so a zeroed entry
+// cannot match.
+uint32_t PayloadChecksum(const uint8_t* data, size_t size) {
+  return static_cast<uint32_t>(av_adler32_update(1, data, size));
+}
+
+}  // namespace
+
+// Pick the first unused segment number; no file is created until the
+// first Append().
+FrameSpool::FrameSpool(FrameSpoolOptions options) : options_(std::move(options)) {
+  options_.segment_bytes = AlignUp(std::max<uint64_t>(options_.segment_bytes, 1ull << 20));
+  std::error_code ec;
+  for (const auto& item : std::filesystem::directory_iterator(options_.directory, ec)) {
+    const uint32_t number = ParseIndexName(item.path().filename().string());
+    next_segment_ = std::max(next_segment_, number + 1);
+  }
+}
+
+FrameSpool::~FrameSpool() {
+  Close();
+}
+
+// Open the next segment: create both files, preallocate and map the data
+// file, write the index header.
+//
+// Param: min_bytes - Payload that must fit (frames larger than
+//                    segment_bytes get a segment of their own)
+// Returns: false (after logging) if a file could not be created or mapped
+bool FrameSpool::OpenSegment(uint64_t min_bytes) {
+  std::error_code ec;
+  std::filesystem::create_directories(options_.directory, ec);
+
+  const std::string stem = options_.directory + "/" + SegmentStem(next_segment_++);
+  const uint64_t capacity = std::max(options_.segment_bytes, AlignUp(min_bytes));
+
+  data_fd_ = ::open((stem + ".dat").c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+  if (data_fd_ < 0) {
+    LOG_ERROR("Spool: cannot create " + stem + ".dat: " + std::strerror(errno));
+    return false;
+  }
+  // posix_fallocate reserves the blocks, so a full disk fails here rather
+  // than as SIGBUS on a later memcpy; not every filesystem supports it
+  int err = ::posix_fallocate(data_fd_, 0, static_cast<off_t>(capacity));
+  if (err != 0) {
+    err = ::ftruncate(data_fd_, static_cast<off_t>(capacity)) == 0 ? 0 : errno;
+  }
+  void* map = err == 0 ? ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, data_fd_, 0) : MAP_FAILED;
+  if (map == MAP_FAILED) {
+    LOG_ERROR("Spool: cannot allocate " + stem + ".dat: " + std::strerror(err != 0 ? err : errno));
+    ::close(data_fd_);
+    data_fd_ = -1;
+    return false;
+  }
+  ::madvise(map, capacity, MADV_SEQUENTIAL);
+
+  index_fd_ = ::open((stem + ".idx").c_str(), O_WRONLY | O_CREAT | O_EXCL | O_APPEND | O_CLOEXEC, 0644);
+  SpoolIndexHeader header{};
+  std::memcpy(header.magic, kIndexMagic, sizeof(header.magic));
+  header.version = kIndexVersion;
+  header.entry_size = sizeof(SpoolIndexEntry);
+  if (index_fd_ < 0 || !WriteAll(index_fd_, &header, sizeof(header))) {
+    LOG_ERROR("Spool: cannot create " + stem + ".idx: " + std::strerror(errno));
+    if (index_fd_ >= 0) {
+      ::close(index_fd_);
+      index_fd_ = -1;
+    }
+    ::munmap(map, capacity);
+    ::close(data_fd_);
+    data_fd_ = -1;
+    return false;
+  }
+
+  map_ = static_cast<uint8_t*>(map);
+  capacity_ = capacity;
+  used_ = 0;
+  flushed_ = 0;
+  ++stats_.segments;
+  LOG_INFO("Spool: writing " + stem + ".dat");
+  return true;
+}
+
+// Give the preallocated tail back and close both files. The truncation
+// is what lets SpoolReader tell a finished segment from a crashed one.
+void FrameSpool::FinishSegment() {
+  if (!map_) {
+    return;
+  }
+  ::munmap(map_, capacity_);
+  map_ = nullptr;
+  if (::ftruncate(data_fd_, static_cast<off_t>(used_)) != 0) {
+    LOG_WARN(std::string("Spool: truncate failed: ") + std::strerror(errno));
+  }
+  ::close(data_fd_);
+  ::close(index_fd_);
+  data_fd_ = -1;
+  index_fd_ = -1;
+  capacity_ = 0;
+  used_ = 0;
+  flushed_ = 0;
+}
+
+// Append one frame (see class comment for the write order).
+//
+// Param: info - Metadata for the index entry
+// Param: data, size - Payload bytes
+// Returns: false if the frame could not be stored
+// Side effects: may finish the current segment and open the next one
+bool FrameSpool::Append(const SpoolFrameInfo& info, const uint8_t* data, size_t size) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (size > UINT32_MAX) {
+    ++stats_.failures;
+    LOG_WARN("Spool: frame " + std::to_string(info.number) + " too large (" + std::to_string(size) + " bytes)");
+    return false;
+  }
+  if (map_ && AlignUp(used_) + size > capacity_) {
+    FinishSegment();
+  }
+  if (!map_ && !OpenSegment(size)) {
+    ++stats_.failures;
+    return false;
+  }
+  const uint64_t start = AlignUp(used_);
+
+  std::memcpy(map_ + start, data, size);
+  used_ = start + size;
+
+  SpoolIndexEntry entry{};
+  entry.number = info.number;
+  entry.offset = start;
+  entry.pts_us = info.pts_us;
+  entry.size = static_cast<uint32_t>(size);
+  entry.width = static_cast<uint16_t>(std::clamp(info.width, 0, 0xffff));
+  entry.height = static_cast<uint16_t>(std::clamp(info.height, 0, 0xffff));
+  entry.flags = info.key_frame ? kSpoolKeyFrame : 0;
+  entry.format = static_cast<uint8_t>(info.format);
+  entry.pixel_format = static_cast<uint16_t>(std::max(info.pixel_format, 0));
+  entry.checksum = PayloadChecksum(data, size);
+  if (!WriteAll(index_fd_, &entry, sizeof(entry))) {
+    ++stats_.failures;
+    LOG_WARN(std::string("Spool: index write failed: ") + std::strerror(errno));
+    return false;
+  }
+
+  // Start writeback of full pages behind the write position; the mapping
+  // and the file share the page cache, so this covers the memcpy above
+  const uint64_t page_end = used_ & ~(static_cast<uint64_t>(::sysconf(_SC_PAGESIZE)) - 1);
+  if (page_end >= flushed_ + kWritebackBytes) {
+    ::sync_file_range(data_fd_, static_cast<off_t>(flushed_), static_cast<off_t>(page_end - flushed_),
+                      SYNC_FILE_RANGE_WRITE);
+    flushed_ = page_end;
+  }
+
+  ++stats_.frames;
+  stats_.bytes += size;
+  return true;
+}
+
+// Finish the current segment; the spool stays usable.
+void FrameSpool::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  FinishSegment();
+}
+
+FrameSpoolStats FrameSpool::GetStats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return stats_;
+}
+
+SpoolReader::~SpoolReader() {
+  for (Segment& segment : segments_) {
+    if (segment.fd >= 0) {
+      ::close(segment.fd);
+    }
+  }
+}
+
+// Load every segment index of a spool directory, in segment order.
+//
+// Param: directory - Spool directory (FrameSpoolOptions::directory)
+// Param: error - Receives a description on failure (may be null)
+// Returns: true if at least one segment index was read
+bool SpoolReader::Open(const std::string& directory, std::string* error) {
+  auto fail = [error](const std::string& message) {
+    if (error) {
+      *error = message;
+    }
+    return false;
+  };
+
+  std::vector<uint32_t> numbers;
+  std::error_code ec;
+  for (const auto& item : std::filesystem::directory_iterator(directory, ec)) {
+    const uint32_t number = ParseIndexName(item.path().filename().string());
+    if (number > 0) {
+      numbers.push_back(number);
+    }
+  }
+  if (ec) {
+    return fail(directory + ": " + ec.message());
+  }
+  if (numbers.empty()) {
+    return fail(directory + ": no spool segments");
+  }
+  std::sort(numbers.begin(), numbers.end());
+
+  for (const uint32_t number : numbers) {
+    const std::string stem = directory + "/" + SegmentStem(number);
+    const int index_fd = ::open((stem + ".idx").c_str(), O_RDONLY | O_CLOEXEC);
+    const int data_fd = ::open((stem + ".dat").c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st {};
+    SpoolIndexHeader header{};
+    const bool ok = index_fd >= 0 && data_fd >= 0 && ::fstat(data_fd, &st) == 0 &&
+                    ::pread(index_fd, &header, sizeof(header), 0) == static_cast<ssize_t>(sizeof(header)) &&
+                    std::memcmp(header.magic, kIndexMagic, sizeof(header.magic)) == 0 &&
+                    header.version >= 1 && header.version <= kIndexVersion &&
+                    header.entry_size == sizeof(SpoolIndexEntry);
+    if (!ok) {
+      LOG_WARN("Spool: skipping unreadable segment " + stem);
+      if (index_fd >= 0) {
+        ::close(index_fd);
+      }
+      if (data_fd >= 0) {
+        ::close(data_fd);
+      }
+      continue;
+    }
+
+    const size_t segment = segments_.size();
+    segments_.push_back(Segment{stem + ".dat", data_fd});
+    const uint64_t data_size = static_cast<uint64_t>(st.st_size);
+    off_t position = sizeof(header);
+    SpoolIndexEntry entry{};
+    // A partial trailing entry (crash during the index write) is not read;
+    // frame numbers start at 1, so number 0 is a zeroed tail the
+    // filesystem extended the file with
+    while (::pread(index_fd, &entry, sizeof(entry), position) == static_cast<ssize_t>(sizeof(entry))) {
+      position += sizeof(entry);
+      if (entry.number == 0) {
+        break;
+      }
+      if (entry.offset + entry.size > data_size) {
+        continue;
+      }
+      frames_.push_back(Frame{entry, segment, header.version >= 2});
+    }
+    ::close(index_fd);
+  }
+  if (segments_.empty()) {
+    return fail(directory + ": no readable spool segments");
+  }
+  return true;
+}
+
+const SpoolIndexEntry* SpoolReader::Entry(size_t position) const {
+  if (position == 0 || position > frames_.size()) {
+    return nullptr;
+  }
+  return &frames_[position - 1].entry;
+}
+
+// Read one payload with pread() and verify its checksum.
+//
+// Param: position - 1-based position in the spool
+// Param: out - Receives the payload
+// Returns: false if position is out of range, the read came up short or
+//          the payload was not written completely before a crash
+bool SpoolReader::Read(size_t position, std::vector<uint8_t>* out) const {
+  if (position == 0 || position > frames_.size()) {
+    return false;
+  }
+  const Frame& frame = frames_[position - 1];
+  out->resize(frame.entry.size);
+  size_t done = 0;
+  while (done < out->size()) {
+    const ssize_t n = ::pread(segments_[frame.segment].fd, out->data() + done, out->size() - done,
+                              static_cast<off_t>(frame.entry.offset + done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      return false;
+    }
+    done += static_cast<size_t>(n);
+  }
+  return !frame.checked || PayloadChecksum(out->data(), out->size()) == frame.entry.checksum;
+}
+
+}  // namespace media
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "media/ImageEncoder.h"
+
+namespace media {
+
+// On-disk index entry, one per spooled frame (host byte order).
+//
+// A segment is a pair of files in the spool directory:
+//   segment_000001.dat - frame payloads back to back, each starting at a
+//                        kSpoolAlignment boundary
+//   segment_000001.idx - SpoolIndexHeader, then one SpoolIndexEntry per frame
+struct SpoolIndexEntry {
+  uint64_t number;        // Frame number assigned by the writer (1-based per run)
+  uint64_t offset;        // Payload offset in the .dat file
+  int64_t pts_us;         // Presentation time in microseconds, -1 if unknown
+  uint32_t size;          // Payload bytes
+  uint16_t width;         // Frame dimensions
+  uint16_t height;
+  uint8_t flags;          // kSpoolKeyFrame
+  uint8_t format;         // media::ImageFormat of the payload
+  uint16_t pixel_format;  // AVPixelFormat of raw yuv payloads, else 0
+  uint32_t checksum;      // Adler-32 of the payload (version 1: 0, unchecked)
+};
+static_assert(sizeof(SpoolIndexEntry) == 40, "SpoolIndexEntry layout is part of the file format");
+
+// First bytes of every .idx file.
+struct SpoolIndexHeader {
+  char magic[8];        // "FRSPOOL1"
+  uint32_t version;     // 2 (1: no payload checksums)
+  uint32_t entry_size;  // sizeof(SpoolIndexEntry)
+};
+static_assert(sizeof(SpoolIndexHeader) == 16, "SpoolIndexHeader layout is part of the file format");
+
+constexpr uint8_t kSpoolKeyFrame = 1u << 0;
+
+// Payload offsets are multiples of this, so readers can map frames with
+// aligned rows.
+constexpr uint64_t kSpoolAlignment = 64;
+
+// Metadata stored with a spooled frame.
+struct SpoolFrameInfo {
+  uint64_t number = 0;
+  int64_t pts_us = -1;
+  bool key_frame = false;
+  int width = 0;
+  int height = 0;
+  ImageFormat format = ImageFormat::kPng;
+  int pixel_format = 0;
+};
+
+// Configuration for FrameSpool.
+struct FrameSpoolOptions {
+  // Directory holding the segment files (created if needed)
+  std::string directory = "out/spool";
+
+  // Preallocated size of each .dat file. A segment is closed and truncated
+  // to its used length once the next frame does not fit; larger values
+  // mean fewer files, smaller ones less space reserved ahead.
+  uint64_t segment_bytes = 1ull << 30;
+};
+
+// Counters, see FrameSpool::GetStats().
+struct FrameSpoolStats {
+  uint64_t frames = 0;    // Frames appended
+  uint64_t bytes = 0;     // Payload bytes appended
+  uint64_t segments = 0;  // Segments opened
+  uint64_t failures = 0;  // Frames that could not be stored
+};
+
+// Append-only frame store: many frames per file instead of one file each.
+//
+// Writing one small file per frame costs a create, an inode, a dentry and
+// a directory update per frame; at 30 fps per stream that is millions of
+// files per day, and filesystems slow down on them long before the disk
+// is busy. The spool turns that into one sequential stream per segment.
+//
+// Each .dat file is preallocated (posix_fallocate) and mapped with
+// MAP_SHARED; a frame is appended with a memcpy into the mapping, with no
+// system call. Every kWritebackBytes the written range is handed to the
+// kernel with sync_file_range(SYNC_FILE_RANGE_WRITE), so dirty pages are
+// written out steadily instead of in bursts. The index entry is appended
+// to the .idx file (one small write) after the payload is in place, so if
+// the process dies the page cache holds every indexed frame.
+//
+// Nothing is fsynced, and writeback does not order the .dat pages before
+// the .idx ones: after a power loss or kernel crash an entry may point at
+// preallocated space that was never written, and the index may end in
+// zeroed entries. The entry's payload checksum and nonzero frame number
+// let SpoolReader tell those apart (see there).
+//
+// New runs never overwrite: segment numbering continues after the highest
+// segment already in the directory.
+//
+// Thread-safe: Append() and Close() serialize on a mutex.
+class FrameSpool {
+ public:
+  explicit FrameSpool(FrameSpoolOptions options);
+
+  // Closes the current segment (see Close()).
+  ~FrameSpool();
+
+  FrameSpool(const FrameSpool&) = delete;
+  FrameSpool& operator=(const FrameSpool&) = delete;
+
+  // Append one frame.
+  //
+  // Param: info - Metadata stored in the index entry
+  // Param: data, size - Payload (encoded image or raw pixels)
+  // Returns: false (after logging) if the frame could not be stored
+  // Side effects: opens a new segment when the current one is full
+  bool Append(const SpoolFrameInfo& info, const uint8_t* data, size_t size);
+
+  // Unmap and truncate the current segment to its used size.
+  // Safe to call more than once; a later Append() opens a new segment.
+  void Close();
+
+  FrameSpoolStats GetStats() const;
+
+ private:
+  // Open segment_<next>.dat/.idx with room for at least min_bytes.
+  bool OpenSegment(uint64_t min_bytes);
+
+  // Unmap, truncate and close the current segment, if any.
+  void FinishSegment();
+
+  FrameSpoolOptions options_;
+
+  mutable std::mutex mutex_;
+  uint32_t next_segment_ = 1;  // Number of the next segment to open
+  int data_fd_ = -1;
+  int index_fd_ = -1;
+  uint8_t* map_ = nullptr;     // Mapping of the current .dat file
+  uint64_t capacity_ = 0;      // Mapped (preallocated) bytes
+  uint64_t used_ = 0;          // Bytes written so far
+  uint64_t flushed_ = 0;       // Bytes handed to sync_file_range()
+  FrameSpoolStats stats_;
+};
+
+// Random access to a spool directory written by FrameSpool.
+//
+// Open() reads every .idx file; Read() then fetches any frame with one
+// pread(). Frames are addressed by their position in the spool (1-based,
+// in segment order), since frame numbers restart with every run.
+//
+// Crash damage (see FrameSpool): Open() ignores entries whose payload
+// lies past the end of their .dat file and stops a segment's index at the
+// first entry with frame number 0 (zeroed tail). Read() fails for a frame
+// whose payload does not match its checksum. Entries stay listed until
+// they are read.
+//
+// Thread-safe: const methods may be called concurrently after Open().
+class SpoolReader {
+ public:
+  SpoolReader() = default;
+  ~SpoolReader();
+
+  SpoolReader(const SpoolReader&) = delete;
+  SpoolReader& operator=(const SpoolReader&) = delete;
+
+  // Load the index of every segment in directory.
+  //
+  // Returns: false (with error set) if the directory has no readable spool
+  bool Open(const std::string& directory, std::string* error);
+
+  // Number of frames in the spool.
+  size_t size() const { return frames_.size(); }
+
+  // Index entry of the frame at position (1-based).
+  // Returns: nullptr if position is out of range
+  const SpoolIndexEntry* Entry(size_t position) const;
+
+  // Read the payload of the frame at position (1-based).
+  //
+  // Param: out - Receives the payload (resized)
+  // Returns: false if position is out of range, the read failed or the
+  //          payload does not match its checksum
+  bool Read(size_t position, std::vector<uint8_t>* out) const;
+
+ private:
+  struct Segment {
+    std::string path;  // .dat file
+    int fd = -1;
+  };
+  struct Frame {
+    SpoolIndexEntry entry;
+    size_t segment;    // Index into segments_
+    bool checked;      // entry.checksum is set (index version 2)
+  };
+
+  std::vector<Segment> segments_;
+  std::vector<Frame> frames_;
+};
+
+}  // namespace media
@@ -1,10 +1,15 @@
 #include "media/FrameWriter.h"
 
+#include <exception>
 #include <filesystem>
 #include <iomanip>
 #include <sstream>
+#include <utility>
 
-#include <opencv2/imgcodecs.hpp>
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
 
 #include "util/Log.h"
 
@@ -15,21 +20,60 @@ FrameWriter::FrameWriter(std::string output_dir,
                          bool write_video,
                          std::string mp4_path,
                          double mp4_fps)
-    : output_dir_(std::move(output_dir)),
-      write_images_(write_images),
-      write_video_(write_video),
-      mp4_path_(std::move(mp4_path)),
+    : FrameWriter(FrameWriterOptions{std::move(output_dir),
+                                     write_images,
+                                     write_video,
+                                     std::move(mp4_path),
+                                     mp4_fps}) {}
+
+FrameWriter::FrameWriter(FrameWriterOptions options)
+    : output_dir_(std::move(options.output_dir)),
+      write_images_(options.write_images),
+      encoder_(options.image),
+      write_video_(options.write_video),
+      mp4_path_(std::move(options.mp4_path)),
       video_path_(mp4_path_),
-      mp4_fps_(mp4_fps) {}
+      mp4_fps_(options.mp4_fps),
+      ordered_writes_(options.ordered_writes),
+      output_(options.files) {
+  if (write_images_ && options.shared_pool) {
+    encode_pool_ = options.shared_pool;
+  } else if (write_images_ && options.encode_threads > 0) {
+    owned_pool_ = std::make_unique<util::ThreadPool>(options.encode_threads);
+    encode_pool_ = owned_pool_.get();
+  }
+  if (encode_pool_) {
+    max_in_flight_ = options.max_in_flight > 0 ? options.max_in_flight : encode_pool_->size() * 2;
+  }
+  if (write_images_ && options.spool_images) {
+    FrameSpoolOptions spool;
+    spool.directory = output_dir_ + "/spool";
+    spool.segment_bytes = options.spool_segment_bytes;
+    spool_ = std::make_unique<FrameSpool>(spool);
+  }
+
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string labels = util::MetricLabel("stream", options.name.empty() ? "default" : options.name);
+  frames_written_ = metrics.GetCounter("capture_frames_written_total", "Frames handed to the writer", labels);
+  in_flight_gauge_ = metrics.GetGauge("capture_encode_in_flight", "Frames queued or encoding on the pool", labels);
+  video_write_ = metrics.GetHistogram("capture_video_write_seconds", "Time in VideoWriter per frame", labels);
+  image_encode_ = metrics.GetHistogram("capture_image_encode_seconds", "Time encoding one image", labels);
+  image_file_ = metrics.GetHistogram("capture_image_file_seconds", "Time writing one encoded image file", labels);
+}
+
+FrameWriter::~FrameWriter() {
+  Close();
+}
 
 // Ensure the frames output directory exists.
 // Creates "<output_dir_>/frames/" if it doesn't exist.
 // Uses dir_ready_ flag to avoid redundant filesystem checks.
+// The spool creates its own directory, so nothing is done when spooling.
 //
 // This is called lazily on the first OnFrame() call to avoid
 // filesystem operations during startup (especially in tests).
 void FrameWriter::EnsureOutputDir() {
-  if (dir_ready_) {
+  if (dir_ready_ || spool_) {
     return;
   }
   std::filesystem::create_directories(output_dir_ + "/frames");
@@ -89,53 +133,324 @@ void FrameWriter::EnsureVideoWriter(const cv::Size& size) {
   writer_.reset();
 }
 
+// Build the output path for a 1-based frame number.
+//
+// Param: number - Frame number (1 for the first frame)
+// Returns: "<output_dir_>/frames/frame_00000001.png" style path, with the
+//          image format's extension
+std::string FrameWriter::ImagePath(size_t number) const {
+  std::ostringstream name;
+  name << output_dir_ << "/frames/frame_" << std::setw(8) << std::setfill('0')
+       << number << encoder_.extension();
+  return name.str();
+}
+
+// Raw dumps carry no header, so the log is where readers find width,
+// height and pixel format. Only changes are logged; spooled frames carry
+// their geometry in the spool index and are not logged.
+//
+// Param: bgr - BGR frame (raw bgr, or raw yuv without a native frame)
+// Param: native - Decoder frame used for raw yuv, may be null
+// Param: number - Frame number from which the geometry applies
+void FrameWriter::LogRawGeometry(const cv::Mat& bgr, const AVFrame* native, size_t number) {
+  if (spool_) {
+    return;
+  }
+  const ImageFormat format = encoder_.options().format;
+  std::string geometry;
+  if (format == ImageFormat::kRawBgr) {
+    geometry = std::to_string(bgr.cols) + "x" + std::to_string(bgr.rows) + " bgr24";
+  } else if (format == ImageFormat::kRawYuv && native) {
+    const char* name = av_get_pix_fmt_name(static_cast<AVPixelFormat>(native->format));
+    geometry = std::to_string(native->width) + "x" + std::to_string(native->height) + " " +
+               (name ? name : "unknown");
+  } else if (format == ImageFormat::kRawYuv) {
+    geometry = std::to_string(bgr.cols) + "x" + std::to_string(bgr.rows) + " yuv420p";
+  } else {
+    return;
+  }
+  if (geometry != raw_geometry_) {
+    raw_geometry_ = geometry;
+    LOG_INFO("Raw frames from " + std::to_string(number) + ": " + geometry + " in " + output_dir_ + "/frames");
+  }
+}
+
+// Collect the spool index fields of one image.
+//
+// Param: bgr - BGR frame (may be empty for raw yuv)
+// Param: frame - Pooled frame with PTS, keyframe flag and native frame,
+//                or null
+// Param: number - 1-based frame number
+// Returns: metadata; pixel_format is set for raw yuv only
+SpoolFrameInfo FrameWriter::FrameInfo(const cv::Mat& bgr, const Frame* frame, size_t number) const {
+  SpoolFrameInfo info;
+  info.number = number;
+  info.format = encoder_.options().format;
+  info.width = bgr.cols;
+  info.height = bgr.rows;
+  if (frame) {
+    info.pts_us = frame->pts_us;
+    info.key_frame = frame->key_frame;
+    if (bgr.empty()) {
+      info.width = frame->width;
+      info.height = frame->height;
+    }
+  }
+  if (info.format == ImageFormat::kRawYuv) {
+    // Encode() packs the native planes (uncropped, full size), or converts
+    // BGR to I420
+    const AVFrame* native = frame ? frame->native : nullptr;
+    info.pixel_format = native && native->data[0] ? native->format : AV_PIX_FMT_YUV420P;
+    if (native && native->data[0]) {
+      info.width = native->width;
+      info.height = native->height;
+    }
+  }
+  return info;
+}
+
 // Process a frame and write to disk.
-// This method handles both PNG frame output and video encoding.
+// This method handles both image frame output and video encoding.
 //
 // For each frame:
 //   1. Create output directory if needed (lazy init)
 //   2. Initialize video writer on first frame (lazy init)
-//   3. Write frame as PNG: "frame_00000001.png" (8-digit zero-padded)
+//   3. Assign the frame number: "frame_00000001.png" (8-digit zero-padded)
 //   4. Write frame to video (if enabled)
-//   5. Increment frame counter
+//   5. Write frame as an image, either inline or on the encode pool
 //
 // Frame numbering: starts at 1 in output (frame_00000001.png)
 //                   but internal counter starts at 0
 //
-// Thread-safe: acquires mutex_ for entire operation.
+// Thread-safe: acquires mutex_ for numbering and video output. With an
+// encode pool, image encoding runs on worker threads; OnFrame() first waits
+// for a free in-flight slot so memory use stays bounded.
 //
 // Param: bgr - Frame in BGR format (3 channels, 8-bit)
 // Side effects:
-//   - Writes PNG file to disk (I/O)
+//   - Writes the image file (I/O), possibly after OnFrame() returns
 //   - Appends frame to video file (I/O)
 //   - Creates directories if needed
 void FrameWriter::OnFrame(const cv::Mat& bgr) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  if (write_images_) {
-    EnsureOutputDir();
+  WriteFrame(bgr, FrameRef());
+}
+
+// Process a pooled frame.
+// The FrameRef travels with the encode job, so the pooled buffer is not
+// recycled until the image has been encoded.
+//
+// Param: frame - Pooled frame from RtpReceiver
+void FrameWriter::OnFrame(const FrameRef& frame) {
+  if (!frame || (frame->bgr.empty() && !frame->native)) {
+    return;
+  }
+  WriteFrame(frame->bgr, frame);
+}
+
+// Report the representations this writer needs from the receiver.
+//
+// Returns: the image encoder's formats if images are written, plus
+//          kFormatBgr for video output; kFormatNone if neither is enabled
+uint32_t FrameWriter::RequiredFormats() const {
+  return (write_images_ ? encoder_.RequiredFormats() : kFormatNone) | (write_video_ ? kFormatBgr : kFormatNone);
+}
+
+// Common path for both OnFrame() overloads (see OnFrame(const cv::Mat&)).
+//
+// Param: bgr - Frame in BGR format (3 channels, 8-bit)
+// Param: keep_alive - Pool reference held until the encode job finishes
+void FrameWriter::WriteFrame(const cv::Mat& bgr, FrameRef keep_alive) {
+  if (encode_pool_) {
+    std::unique_lock<std::mutex> lock(in_flight_mutex_);
+    in_flight_cv_.wait(lock, [this] { return in_flight_ < max_in_flight_; });
+    in_flight_gauge_->Set(static_cast<int64_t>(++in_flight_));
   }
-  EnsureVideoWriter(bgr.size());
 
-  // Write frame as PNG file
-  if (write_images_) {
-    std::ostringstream name;
-    name << output_dir_ << "/frames/frame_" << std::setw(8) << std::setfill('0')
-         << (frame_index_ + 1) << ".png";
-    cv::imwrite(name.str(), bgr);
+  const AVFrame* native = keep_alive ? keep_alive->native : nullptr;
+  SpoolFrameInfo info;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (write_images_) {
+      EnsureOutputDir();
+    }
+    if (!bgr.empty()) {
+      EnsureVideoWriter(bgr.size());
+    }
+
+    // Write frame to video
+    if (writer_.has_value() && !bgr.empty()) {
+      const int64_t start_us = util::NowMicros();
+      (*writer_) << bgr;
+      video_write_->Observe(util::NowMicros() - start_us);
+    }
+    const size_t number = ++frame_index_;
+    info = FrameInfo(bgr, keep_alive ? &*keep_alive : nullptr, number);
+    if (write_images_) {
+      LogRawGeometry(bgr, native, number);
+    }
+
+    // Write frame as image file
+    if (write_images_ && !encode_pool_) {
+      EncodedFrame encoded;
+      encoded.path = ImagePath(number);
+      encoded.bytes = output_.AcquireBuffer();
+      encoded.info = info;
+      const int64_t start_us = util::NowMicros();
+      const bool ok = encoder_.Encode(bgr, native, &encoded.bytes);
+      image_encode_->Observe(util::NowMicros() - start_us);
+      if (ok) {
+        WriteFile(std::move(encoded), false);
+      } else {
+        LOG_WARN("Failed to encode " + encoded.path);
+      }
+    }
   }
+  frames_written_->Add();
 
-  // Write frame to video
-  if (writer_.has_value()) {
-    (*writer_) << bgr;
+  if (encode_pool_) {
+    encode_pool_->Submit([this, bgr, native, info, keep_alive = std::move(keep_alive)]() mutable {
+      EncodeJob(bgr, native, info);
+      keep_alive.reset();
+    });
+  }
+}
+
+// Encode one frame and hand it to the ordered or unordered writer.
+// Runs on an encode worker thread. Encoding failures, including
+// exceptions (std::bad_alloc, std::length_error for absurd geometry), are
+// logged; in ordered mode an empty placeholder is still committed so
+// later frames are not held back forever, and the in-flight count is
+// always released.
+//
+// Param: bgr - Frame to encode (shares pixel data with the caller's Mat)
+// Param: native - Decoder frame for raw yuv (kept alive by the job's FrameRef)
+// Param: info - Frame number assigned by OnFrame() and spool metadata
+void FrameWriter::EncodeJob(cv::Mat bgr, const AVFrame* native, const SpoolFrameInfo& info) {
+  const size_t number = static_cast<size_t>(info.number);
+  EncodedFrame encoded;
+  encoded.info = info;
+  try {
+    encoded.path = ImagePath(number);
+    encoded.bytes = output_.AcquireBuffer();
+    const int64_t start_us = util::NowMicros();
+    if (!encoder_.Encode(bgr, native, &encoded.bytes)) {
+      LOG_WARN("Failed to encode " + encoded.path);
+      encoded.bytes.clear();
+    }
+    image_encode_->Observe(util::NowMicros() - start_us);
+  } catch (const std::exception& e) {
+    LOG_ERROR("Failed to encode frame " + std::to_string(number) + ": " + e.what());
+    encoded.bytes.clear();
+  }
+  bgr.release();
+
+  if (ordered_writes_) {
+    CommitOrdered(number, std::move(encoded));
+  } else if (!encoded.bytes.empty()) {
+    WriteFileLogged(std::move(encoded), true);
+  }
+
+  // Notify under the lock: once Close() sees in_flight_ == 0 the writer
+  // may be destroyed, so this must be the job's last access to it
+  std::lock_guard<std::mutex> lock(in_flight_mutex_);
+  in_flight_gauge_->Set(static_cast<int64_t>(--in_flight_));
+  in_flight_cv_.notify_all();
+}
+
+// Ordered completion: park this frame, then, unless another thread is
+// already draining, write all frames contiguous with next_write_.
+//
+// Param: number - Frame number of the encoded frame
+// Param: frame - Encoded bytes (empty if encoding failed)
+void FrameWriter::CommitOrdered(size_t number, EncodedFrame frame) {
+  std::unique_lock<std::mutex> lock(commit_mutex_);
+  completed_.emplace(number, std::move(frame));
+  if (draining_) {
+    // The draining thread will pick this frame up when it gets there
+    return;
+  }
+  draining_ = true;
+  while (true) {
+    auto it = completed_.find(next_write_);
+    if (it == completed_.end()) {
+      break;
+    }
+    EncodedFrame ready = std::move(it->second);
+    completed_.erase(it);
+    ++next_write_;
+
+    lock.unlock();
+    if (!ready.bytes.empty()) {
+      WriteFileLogged(std::move(ready), false);
+    }
+    lock.lock();
+  }
+  draining_ = false;
+}
+
+// Unordered mode: record a completed frame in frames/manifest.txt.
+// Lines appear in completion order.
+//
+// Param: number - Frame number
+// Param: path - Image file that was written
+// Param: bytes - File size
+void FrameWriter::AppendManifest(size_t number, const std::string& path, size_t bytes) {
+  std::lock_guard<std::mutex> lock(commit_mutex_);
+  if (!manifest_.is_open()) {
+    manifest_.open(output_dir_ + "/frames/manifest.txt", std::ios::app);
+  }
+  manifest_ << number << ' ' << std::filesystem::path(path).filename().string() << ' ' << bytes << '\n';
+}
+
+// Append the encoded image to the spool, or hand it to the file output
+// backend (util::FileOutput), which writes frame.path and recycles the
+// buffer. With an asynchronous backend the file may still be in flight
+// when this returns; failures are logged by the backend.
+//
+// Param: frame - Destination path (or spool metadata) and encoded bytes
+// Param: manifest - Add a manifest line once the file is complete
+//                   (unordered mode; ignored when spooling)
+void FrameWriter::WriteFile(EncodedFrame frame, bool manifest) {
+  const int64_t start_us = util::NowMicros();
+  if (spool_) {
+    spool_->Append(frame.info, frame.bytes.data(), frame.bytes.size());
+    image_file_->Observe(util::NowMicros() - start_us);
+    return;
+  }
+  const size_t number = static_cast<size_t>(frame.info.number);
+  const size_t bytes = frame.bytes.size();
+  std::string path = frame.path;
+  output_.Write(std::move(frame.path), std::move(frame.bytes),
+                [this, start_us, manifest, number, bytes, path = std::move(path)](bool ok) {
+                  image_file_->Observe(util::NowMicros() - start_us);
+                  if (ok && manifest) {
+                    AppendManifest(number, path, bytes);
+                  }
+                });
+}
+
+// WriteFile() for the encode workers: an exception (std::bad_alloc while
+// queueing the write or growing the spool) is logged and the frame lost,
+// instead of unwinding through CommitOrdered() with draining_ still set.
+//
+// Param: frame, manifest - As for WriteFile()
+void FrameWriter::WriteFileLogged(EncodedFrame frame, bool manifest) {
+  const size_t number = static_cast<size_t>(frame.info.number);
+  try {
+    WriteFile(std::move(frame), manifest);
+  } catch (const std::exception& e) {
+    LOG_ERROR("Failed to write frame " + std::to_string(number) + ": " + e.what());
   }
-  ++frame_index_;
 }
 
 // Finalize video file and cleanup.
 // This method:
+//   0. Waits for this writer's encode jobs and file writes so every
+//      assigned frame is on disk
 //   1. Closes the video writer, which flushes any buffered data
 //   2. Releases the video file handle
 //   3. Resets the optional writer_ to empty
+//   4. Finishes the current spool segment (truncated to its used size)
 //
 // Important: The video file is incomplete until Close() is called.
 //            OpenCV VideoWriter requires explicit release to finalize.
@@ -146,11 +461,27 @@ void FrameWriter::OnFrame(const cv::Mat& bgr) {
 //   - Closes video file
 //   - Resets writer_ state (can be re-initialized if needed)
 void FrameWriter::Close() {
+  if (encode_pool_) {
+    // Wait for this writer's jobs only; a shared pool may be busy with
+    // other writers' frames
+    std::unique_lock<std::mutex> lock(in_flight_mutex_);
+    in_flight_cv_.wait(lock, [this] { return in_flight_ == 0; });
+  }
+  output_.Flush();
+  {
+    std::lock_guard<std::mutex> lock(commit_mutex_);
+    if (manifest_.is_open()) {
+      manifest_.close();
+    }
+  }
   std::lock_guard<std::mutex> lock(mutex_);
   if (writer_.has_value()) {
     writer_->release();
     writer_.reset();
   }
+  if (spool_) {
+    spool_->Close();
+  }
 }
 
 }  // namespace media
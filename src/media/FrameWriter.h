@@ -1,18 +1,95 @@
 #pragma once
 
+#include <condition_variable>
+#include <cstdint>
+#include <fstream>
+#include <map>
+#include <memory>
 #include <mutex>
 #include <optional>
 #include <string>
+#include <vector>
 
 #include <opencv2/core.hpp>
 #include <opencv2/videoio.hpp>
 
+#include "media/FramePool.h"
+#include "media/FrameSpool.h"
+#include "media/ImageEncoder.h"
+#include "util/FileOutput.h"
+#include "util/Metrics.h"
+#include "util/ThreadPool.h"
+
 namespace media {
 
+// Configuration for FrameWriter.
+// The first five fields mirror the original positional constructor.
+struct FrameWriterOptions {
+  // Base directory for image frames; frames go to "<output_dir>/frames/"
+  std::string output_dir = "out";
+
+  // If true, save each frame as an image (format per the image field)
+  bool write_images = true;
+
+  // If true, encode frames into a video file
+  bool write_video = false;
+
+  // Full path for video output; parent directories are created automatically
+  std::string mp4_path = "out/capture.mp4";
+
+  // Frame rate for video encoding (doesn't affect capture rate)
+  double mp4_fps = 30.0;
+
+  // Number of threads encoding image frames in parallel.
+  // 0 encodes and writes on the OnFrame() caller thread (no pool).
+  size_t encode_threads = 0;
+
+  // Only used with encode_threads > 0:
+  //   true  - files are written strictly in frame-number order; encoding
+  //           runs in parallel, completed frames wait for their predecessors
+  //           (with an asynchronous files backend this orders submission;
+  //           files may still complete out of order)
+  //   false - each worker writes its file as soon as it is encoded and
+  //           appends "<number> <file> <bytes>" to frames/manifest.txt,
+  //           so consumers can tell which frames are complete
+  bool ordered_writes = true;
+
+  // Encode pool shared with other writers (not owned). When set,
+  // encode_threads is ignored and jobs go to this pool instead of a
+  // private one, so many streams can share a fixed number of encoders.
+  util::ThreadPool* shared_pool = nullptr;
+
+  // Maximum frames this writer may have queued or encoding on the pool.
+  // 0 = 2 x pool size. With a shared pool this is what keeps one busy
+  // stream from filling the pool queue and starving the others.
+  size_t max_in_flight = 0;
+
+  // Stream label of this writer's metrics
+  std::string name = "default";
+
+  // Image file format and compression (PNG with OpenCV defaults unless set)
+  ImageEncoderOptions image{};
+
+  // Append images to segment files under "<output_dir>/spool/" (see
+  // media::FrameSpool) instead of writing one file per frame. No frames/
+  // directory or manifest is created; the spool index records frame
+  // number, PTS, size and geometry.
+  bool spool_images = false;
+
+  // Preallocated size of each spool segment
+  uint64_t spool_segment_bytes = 1ull << 30;
+
+  // How image files are written: blocking calls on the encoding thread
+  // (default), I/O threads or io_uring (see util::FileOutput)
+  util::FileOutputOptions files{};
+};
+
 // Frame writer using OpenCV.
 //
 // This class receives decoded frames (as OpenCV Mat) and writes them to:
-//   1. Individual PNG files (e.g., frame_00000001.png)
+//   1. Individual image files (e.g., frame_00000001.png; PNG, JPEG, WebP
+//      or raw BGR/YUV dumps, see ImageEncoder), or appended to a spool
+//      of segment files (FrameWriterOptions::spool_images, FrameSpool)
 //   2. A video file (MP4 or AVI fallback)
 //
 // Why OpenCV?
@@ -25,13 +102,39 @@ namespace media {
 //   2. Call OnFrame() for each decoded frame
 //   3. Call Close() to finalize video file and cleanup
 //
+// Image encoding pool:
+//   With encode_threads > 0, image encoding runs on an internal
+//   util::ThreadPool. OnFrame() only assigns the frame number, appends to
+//   the video (which must stay sequential) and hands the image to a worker,
+//   so throughput scales with cores until the disk is the bottleneck.
+//   At most max_in_flight (default 2 * pool size) frames are in flight;
+//   OnFrame() waits when that limit is reached, which pushes backpressure
+//   to the caller's queue. The pool may also be shared between several
+//   writers (FrameWriterOptions::shared_pool).
+//
+// File output:
+//   Encoded images are written through a util::FileOutput. Encoders fill
+//   buffers taken from its pool, so steady-state encoding allocates
+//   nothing. The default sync backend writes on the encoding thread;
+//   the threads and uring backends return at once and write in the
+//   background (io_uring: one linked open/write/close submission per
+//   file, fixed buffers). Close() waits for every file.
+//
 // Thread safety:
 //   - OnFrame() and Close() are thread-safe
 //   - Uses a mutex to protect internal state
 //
+// Metrics (util::Metrics, label stream="<name>"):
+//   capture_video_write_seconds  - VideoWriter append per frame
+//   capture_image_encode_seconds - encoding one image (ImageEncoder)
+//   capture_image_file_seconds   - writing one encoded image file
+//   capture_frames_written_total, capture_encode_in_flight
+//
 // Frame numbering:
 //   - Starts at 1, not 0 (human-friendly)
-//   - 8-digit zero-padded (frame_00000001.png)
+//   - 8-digit zero-padded (frame_00000001.png), extension per format
+//   - Assigned in OnFrame() call order, independent of which worker
+//     encodes the frame or when it finishes
 class FrameWriter {
  public:
   // Create a frame writer with the specified configuration.
@@ -49,28 +152,53 @@ class FrameWriter {
               std::string mp4_path,
               double mp4_fps);
 
+  // Create a frame writer from an options struct (see FrameWriterOptions).
+  explicit FrameWriter(FrameWriterOptions options);
+
+  // Waits for pending encodes and closes the video file.
+  ~FrameWriter();
+
   // Process a decoded frame and write to disk.
   // This method:
   //   1. Ensures output directory exists
   //   2. Initializes video writer on first call
-  //   3. Writes frame as PNG (if enabled)
+  //   3. Assigns the frame number
   //   4. Writes frame to video (if enabled)
-  //   5. Increments frame counter
+  //   5. Writes frame as an image (if enabled), inline or on the encode pool
   //
-  // Thread-safe: acquires mutex for entire operation.
+  // Thread-safe: state updates and video writes hold mutex_; image
+  // encoding happens outside it.
   //
   // Param: bgr - Frame in BGR format (3 channels, 8-bit)
+  //              With an encode pool the pixel data is referenced (not
+  //              copied) until the frame is encoded; callers must not
+  //              write into the buffer afterwards (pass a clone if the
+  //              Mat is reused).
   // Side effects:
   //   - Creates directories if they don't exist
   //   - Initializes video writer on first frame
-  //   - Writes to disk (may block on I/O)
+  //   - Writes to disk (may block on I/O or on the in-flight limit)
   void OnFrame(const cv::Mat& bgr);
 
+  // Process a pooled frame (see media::FramePool).
+  // Same as OnFrame(const cv::Mat&), but a pending encode keeps the
+  // FrameRef alive instead of relying on the caller not to reuse the
+  // buffer, so no pixel copy is ever made. Raw yuv output reads
+  // Frame::native and needs no BGR frame.
+  void OnFrame(const FrameRef& frame);
+
+  // Pixel formats this writer consumes (media::FrameFormat bitmask).
+  // Compressed and raw BGR images and OpenCV video need BGR, raw yuv
+  // images the native frame; with both outputs disabled the writer needs
+  // nothing and the receiver can skip conversion.
+  uint32_t RequiredFormats() const;
+
   // Finalize video file and cleanup resources.
   // This method:
-  //   1. Closes the video writer (if open)
-  //   2. Flushes any buffered video data
-  //   3. Resets the video writer
+  //   1. Waits until every pending image of this writer has been written
+  //   2. Closes the video writer (if open)
+  //   3. Flushes any buffered video data
+  //   4. Resets the video writer
   //
   // Important: Must be called to properly close the video file.
   //            Video file is invalid until Close() is called.
@@ -79,6 +207,13 @@ class FrameWriter {
   void Close();
 
  private:
+  // An encoded image waiting to be written (ordered mode).
+  struct EncodedFrame {
+    std::string path;          // Image file (unused when spooling)
+    std::vector<uchar> bytes;
+    SpoolFrameInfo info;       // Number, PTS and geometry for the spool index
+  };
+
   // Ensure the output directory exists.
   // Creates "<output_dir_>/frames/" if it doesn't exist.
   // Uses a flag (dir_ready_) to avoid redundant filesystem checks.
@@ -104,21 +239,87 @@ class FrameWriter {
   //   - May update video_path_ if fallback to AVI occurs
   void EnsureVideoWriter(const cv::Size& size);
 
+  // Shared implementation of both OnFrame() overloads.
+  // keep_alive (possibly empty) is held by the encode job until it
+  // finishes; its native frame is used for raw yuv output.
+  void WriteFrame(const cv::Mat& bgr, FrameRef keep_alive);
+
+  // Build "<output_dir_>/frames/frame_%08d<ext>" for a 1-based frame number.
+  std::string ImagePath(size_t number) const;
+
+  // Log the geometry of raw frames whenever it changes (raw files have no
+  // header). Called with mutex_ held.
+  void LogRawGeometry(const cv::Mat& bgr, const AVFrame* native, size_t number);
+
+  // Metadata of one image for the spool index.
+  // frame may be null (cv::Mat overload: PTS unknown, not a keyframe).
+  SpoolFrameInfo FrameInfo(const cv::Mat& bgr, const Frame* frame, size_t number) const;
+
+  // Encode one image and write it (runs on an encode worker).
+  // Routes the result through CommitOrdered() or WriteFile() depending
+  // on ordered_writes_, then releases the in-flight slot.
+  void EncodeJob(cv::Mat bgr, const AVFrame* native, const SpoolFrameInfo& info);
+
+  // Ordered mode: park the encoded frame and write every frame that is now
+  // contiguous with next_write_. Only one thread drains at a time; file I/O
+  // happens outside commit_mutex_.
+  void CommitOrdered(size_t number, EncodedFrame frame);
+
+  // Unordered mode: append "<number> <file> <bytes>" to the manifest.
+  void AppendManifest(size_t number, const std::string& path, size_t bytes);
+
+  // Write an encoded image to its file (through output_), or append it to
+  // the spool. manifest adds a manifest line once the file is complete.
+  void WriteFile(EncodedFrame frame, bool manifest);
+
+  // WriteFile() from an encode worker, logging instead of throwing.
+  void WriteFileLogged(EncodedFrame frame, bool manifest);
+
+  // Metrics looked up once at construction (owned by util::Metrics)
+  util::Counter* frames_written_;
+  util::Gauge* in_flight_gauge_;
+  util::Histogram* video_write_;
+  util::Histogram* image_encode_;
+  util::Histogram* image_file_;
+
   // Mutex protecting all internal state and I/O operations
   std::mutex mutex_;
 
   // Configuration
-  std::string output_dir_;    // Base directory for PNG frames
-  bool write_images_;         // Enable PNG frame output
+  std::string output_dir_;    // Base directory for image frames
+  bool write_images_;         // Enable image frame output
+  ImageEncoder encoder_;      // Image format and compression
   bool write_video_;          // Enable video output
   std::string mp4_path_;      // Configured video path (may be MP4 or AVI)
   std::string video_path_;    // Actual video path (may change on fallback)
   double mp4_fps_;            // Video frame rate for encoding
+  bool ordered_writes_;       // Ordered commit vs write-anywhere + manifest
+  std::unique_ptr<FrameSpool> spool_;  // Image destination when spooling (else null)
+  util::FileOutput output_;   // Image file writes and pooled encode buffers
 
   // State
   size_t frame_index_ = 0;    // Counter for frame numbering (starts at 1 in output)
   std::optional<cv::VideoWriter> writer_;  // Video writer (optional if disabled)
   bool dir_ready_ = false;    // Flag: true if output directory exists
+  std::string raw_geometry_;  // Last logged raw frame geometry
+
+  // Encode pool state (unused when encode_pool_ is null)
+  size_t max_in_flight_ = 0;             // Backpressure limit for OnFrame()
+  std::mutex in_flight_mutex_;
+  std::condition_variable in_flight_cv_;  // Signalled when a job finishes
+  size_t in_flight_ = 0;                  // Jobs submitted but not finished
+
+  std::mutex commit_mutex_;               // Guards the ordered/manifest state below
+  std::map<size_t, EncodedFrame> completed_;  // Encoded, waiting for predecessors
+  size_t next_write_ = 1;                 // Next frame number to write (ordered)
+  bool draining_ = false;                 // A thread is writing completed_ frames
+  std::ofstream manifest_;                // frames/manifest.txt (unordered)
+
+  // Pool used for encoding: shared_pool or owned_pool_ (null = inline)
+  util::ThreadPool* encode_pool_ = nullptr;
+
+  // Declared last so workers are joined before the state above is destroyed
+  std::unique_ptr<util::ThreadPool> owned_pool_;
 };
 
 }  // namespace media
@@ -0,0 +1,141 @@
+#include "media/ImageEncoder.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <opencv2/imgcodecs.hpp>
+#include <opencv2/imgproc.hpp>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/imgutils.h>
+}
+
+#include "media/FramePool.h"
+
+namespace media {
+
+// Parse an image format name as accepted by --image-format.
+//
+// Param: name - "png", "jpeg" (or "jpg"), "webp", "bgr" or "yuv"
+// Param: format - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseImageFormat(const std::string& name, ImageFormat* format) {
+  if (name == "png") {
+    *format = ImageFormat::kPng;
+  } else if (name == "jpeg" || name == "jpg") {
+    *format = ImageFormat::kJpeg;
+  } else if (name == "webp") {
+    *format = ImageFormat::kWebp;
+  } else if (name == "bgr") {
+    *format = ImageFormat::kRawBgr;
+  } else if (name == "yuv") {
+    *format = ImageFormat::kRawYuv;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Clamp the options and build the cv::imencode parameter list once, so
+// Encode() does not allocate it per frame.
+ImageEncoder::ImageEncoder(ImageEncoderOptions options) : options_(options) {
+  switch (options_.format) {
+    case ImageFormat::kPng:
+      if (options_.png_compression >= 0) {
+        options_.png_compression = std::min(options_.png_compression, 9);
+        params_ = {cv::IMWRITE_PNG_COMPRESSION, options_.png_compression};
+      }
+      break;
+    case ImageFormat::kJpeg:
+      options_.quality = std::clamp(options_.quality, 1, 100);
+      params_ = {cv::IMWRITE_JPEG_QUALITY, options_.quality};
+      break;
+    case ImageFormat::kWebp:
+      options_.quality = std::clamp(options_.quality, 1, 101);
+      params_ = {cv::IMWRITE_WEBP_QUALITY, options_.quality};
+      break;
+    case ImageFormat::kRawBgr:
+    case ImageFormat::kRawYuv:
+      break;
+  }
+}
+
+const char* ImageEncoder::extension() const {
+  switch (options_.format) {
+    case ImageFormat::kPng:
+      return ".png";
+    case ImageFormat::kJpeg:
+      return ".jpg";
+    case ImageFormat::kWebp:
+      return ".webp";
+    case ImageFormat::kRawBgr:
+      return ".bgr";
+    case ImageFormat::kRawYuv:
+      return ".yuv";
+  }
+  return ".png";
+}
+
+uint32_t ImageEncoder::RequiredFormats() const {
+  return options_.format == ImageFormat::kRawYuv ? kFormatNative : kFormatBgr;
+}
+
+// Produce the file contents for one frame (see class comment).
+//
+// Param: bgr - BGR24 frame, may be empty when native is used
+// Param: native - Decoder frame (raw yuv only), may be null
+// Param: out - Output buffer; resized, its capacity is reused
+// Returns: false if the needed representation is missing, the codec is
+//          not available in this OpenCV build or encoding failed
+bool ImageEncoder::Encode(const cv::Mat& bgr, const AVFrame* native, std::vector<uchar>* out) const {
+  switch (options_.format) {
+    case ImageFormat::kPng:
+    case ImageFormat::kJpeg:
+    case ImageFormat::kWebp:
+      if (bgr.empty()) {
+        return false;
+      }
+      try {
+        return cv::imencode(extension(), bgr, *out, params_);
+      } catch (const cv::Exception&) {
+        // OpenCV built without this codec
+        return false;
+      }
+
+    case ImageFormat::kRawBgr: {
+      if (bgr.empty()) {
+        return false;
+      }
+      const size_t row_bytes = static_cast<size_t>(bgr.cols) * bgr.elemSize();
+      out->resize(row_bytes * static_cast<size_t>(bgr.rows));
+      for (int y = 0; y < bgr.rows; ++y) {
+        std::memcpy(out->data() + row_bytes * static_cast<size_t>(y), bgr.ptr(y), row_bytes);
+      }
+      return true;
+    }
+
+    case ImageFormat::kRawYuv: {
+      if (native && native->data[0]) {
+        const AVPixelFormat format = static_cast<AVPixelFormat>(native->format);
+        const int size = av_image_get_buffer_size(format, native->width, native->height, 1);
+        if (size <= 0) {
+          return false;
+        }
+        out->resize(static_cast<size_t>(size));
+        return av_image_copy_to_buffer(out->data(), size, native->data, native->linesize, format, native->width,
+                                       native->height, 1) >= 0;
+      }
+      if (bgr.empty() || bgr.cols % 2 != 0 || bgr.rows % 2 != 0) {
+        return false;
+      }
+      cv::Mat i420;
+      cv::cvtColor(bgr, i420, cv::COLOR_BGR2YUV_I420);
+      out->assign(i420.data, i420.data + i420.total() * i420.elemSize());
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace media
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+struct AVFrame;
+
+namespace media {
+
+// File format of the images FrameWriter produces.
+enum class ImageFormat {
+  kPng,     // Lossless; encode time grows quickly with the compression level
+  kJpeg,    // Lossy, fast (libjpeg-turbo in most OpenCV builds), small for photos
+  kWebp,    // Lossy (quality <= 100) or lossless (quality > 100); smallest, slowest
+  kRawBgr,  // Packed BGR24 pixels, no header: a memcpy, 6 MB per 1080p frame
+  kRawYuv,  // The decoder's planes packed tightly (usually I420), no header
+};
+
+// Parse an image format name ("png", "jpeg"/"jpg", "webp", "bgr", "yuv").
+//
+// Returns: true if recognized (format set), false otherwise
+bool ParseImageFormat(const std::string& name, ImageFormat* format);
+
+// Encoder settings (see util::Args for the command-line side).
+struct ImageEncoderOptions {
+  ImageFormat format = ImageFormat::kPng;
+
+  // PNG zlib level 0-9 (0 = store, 9 = smallest); -1 keeps OpenCV's default
+  int png_compression = -1;
+
+  // JPEG and WebP quality 1-100 (WebP above 100 is lossless)
+  int quality = 90;
+};
+
+// Turns one frame into the bytes of an image file.
+//
+// Compressed formats go through cv::imencode with the configured
+// parameters. Raw formats skip the codec entirely:
+//   bgr - the BGR rows, without stride padding
+//   yuv - Frame::native's planes in its own pixel format, packed with
+//         av_image_copy_to_buffer (no conversion); if only a BGR frame is
+//         available it is converted to I420 with cv::cvtColor
+// Raw files carry no header: the reader must know width, height and pixel
+// format (FrameWriter logs them whenever they change).
+//
+// Thread-safe: const after construction; Encode() may run on many threads.
+class ImageEncoder {
+ public:
+  explicit ImageEncoder(ImageEncoderOptions options = ImageEncoderOptions());
+
+  // File name extension including the dot (".png", ".jpg", ".webp", ".bgr", ".yuv").
+  const char* extension() const;
+
+  // Pixel representations Encode() needs (media::FrameFormat bitmask):
+  // kFormatNative for raw yuv, kFormatBgr otherwise.
+  uint32_t RequiredFormats() const;
+
+  const ImageEncoderOptions& options() const { return options_; }
+
+  // Encode one frame.
+  //
+  // Param: bgr - BGR24 pixels (may be empty for raw yuv if native is set)
+  // Param: native - Decoder frame for raw yuv (may be null)
+  // Param: out - Receives the file contents (reuses its capacity)
+  // Returns: false if the frame could not be encoded
+  bool Encode(const cv::Mat& bgr, const AVFrame* native, std::vector<uchar>* out) const;
+
+ private:
+  ImageEncoderOptions options_;
+
+  // cv::imencode parameters built once from options_
+  std::vector<int> params_;
+};
+
+}  // namespace media
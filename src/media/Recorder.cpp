@@ -0,0 +1,429 @@
+#include "media/Recorder.h"
+
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+#include <libavutil/opt.h>
+#include <libavutil/pixdesc.h>
+#include <libswscale/swscale.h>
+}
+
+#include <filesystem>
+
+#include "util/Log.h"
+
+namespace media {
+namespace {
+
+// Encoder time base: milliseconds suit every encoder (mpeg4 caps the
+// denominator at 65535) and are finer than any RTP frame interval.
+const AVRational kEncoderTimeBase{1, 1000};
+
+std::string AvErrorToString(int err) {
+  char buffer[AV_ERROR_MAX_STRING_SIZE];
+  av_strerror(err, buffer, sizeof(buffer));
+  return buffer;
+}
+
+// Pick the encoder input format: the decoder's own if the encoder takes
+// it (no conversion at all), else the encoder's first choice.
+AVPixelFormat ChooseEncoderFormat(const AVCodec* codec, AVPixelFormat input) {
+  const AVPixelFormat* formats = nullptr;
+#if LIBAVCODEC_VERSION_INT >= AV_VERSION_INT(61, 13, 100)
+  avcodec_get_supported_config(nullptr, codec, AV_CODEC_CONFIG_PIX_FORMAT, 0,
+                               reinterpret_cast<const void**>(&formats), nullptr);
+#else
+  formats = codec->pix_fmts;
+#endif
+  if (!formats) {
+    return input;
+  }
+  for (const AVPixelFormat* format = formats; *format != AV_PIX_FMT_NONE; ++format) {
+    if (*format == input) {
+      return input;
+    }
+  }
+  return formats[0];
+}
+
+}  // namespace
+
+// Parse a --record value.
+//
+// Param: name - "auto", "copy", "transcode" or "opencv"
+// Param: mode - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseRecordMode(const std::string& name, RecordMode* mode) {
+  if (name == "auto") {
+    *mode = RecordMode::kAuto;
+  } else if (name == "copy") {
+    *mode = RecordMode::kCopy;
+  } else if (name == "transcode") {
+    *mode = RecordMode::kTranscode;
+  } else if (name == "opencv") {
+    *mode = RecordMode::kOpenCv;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+Recorder::Recorder(RecorderOptions options) : options_(std::move(options)) {
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string labels = util::MetricLabel("stream", options_.name);
+  written_metric_ = metrics.GetCounter("capture_record_packets_total", "Packets muxed into the recording", labels);
+  encode_metric_ =
+      metrics.GetHistogram("capture_record_encode_seconds", "Time encoding one frame when transcoding", labels);
+}
+
+Recorder::~Recorder() {
+  Close();
+}
+
+uint32_t Recorder::RequiredFormats() const {
+  const State state = state_.load(std::memory_order_relaxed);
+  if (state == State::kTranscode || (state == State::kUndecided && options_.mode != RecordMode::kCopy)) {
+    return kFormatNative;
+  }
+  return kFormatNone;
+}
+
+// Caller holds mutex_.
+void Recorder::Fail(const std::string& message) {
+  LOG_ERROR("[" + options_.name + "] Recording disabled: " + message);
+  Release();
+  state_ = State::kFailed;
+}
+
+// Caller holds mutex_.
+void Recorder::Release() {
+  if (output_ && !(output_->oformat->flags & AVFMT_NOFILE)) {
+    avio_closep(&output_->pb);
+  }
+  avformat_free_context(output_);
+  output_ = nullptr;
+  stream_ = nullptr;
+  avcodec_free_context(&encoder_);
+  av_frame_free(&scaled_);
+  av_frame_free(&input_);
+  av_packet_free(&packet_);
+  sws_freeContext(sws_);
+  sws_ = nullptr;
+}
+
+// Caller holds mutex_.
+bool Recorder::CreateOutput() {
+  const std::filesystem::path parent = std::filesystem::path(options_.path).parent_path();
+  if (!parent.empty()) {
+    std::error_code error;
+    std::filesystem::create_directories(parent, error);
+  }
+  const int ret = avformat_alloc_output_context2(&output_, nullptr, nullptr, options_.path.c_str());
+  if (ret < 0 || !output_) {
+    Fail("no container for " + options_.path + ": " + AvErrorToString(ret));
+    return false;
+  }
+  stream_ = avformat_new_stream(output_, nullptr);
+  packet_ = av_packet_alloc();
+  if (!stream_ || !packet_) {
+    Fail("out of memory");
+    return false;
+  }
+  return true;
+}
+
+// Caller holds mutex_.
+bool Recorder::WriteHeader() {
+  int ret = 0;
+  if (!(output_->oformat->flags & AVFMT_NOFILE)) {
+    ret = avio_open(&output_->pb, options_.path.c_str(), AVIO_FLAG_WRITE);
+    if (ret < 0) {
+      Fail("cannot open " + options_.path + ": " + AvErrorToString(ret));
+      return false;
+    }
+  }
+  ret = avformat_write_header(output_, nullptr);
+  if (ret < 0) {
+    Fail("cannot write header: " + AvErrorToString(ret));
+    return false;
+  }
+  header_written_ = true;
+  return true;
+}
+
+// Stream copy needs the container to accept the codec as is.
+// avformat_query_codec() returns < 0 when the muxer does not say; copy is
+// attempted then and avformat_write_header() has the final word.
+//
+// Caller holds mutex_.
+void Recorder::Decide(const AVCodecParameters* codecpar) {
+  if (!CreateOutput()) {
+    return;
+  }
+  const bool accepted = avformat_query_codec(output_->oformat, codecpar->codec_id, FF_COMPLIANCE_NORMAL) != 0;
+  const std::string codec = avcodec_get_name(codecpar->codec_id);
+  const std::string container = output_->oformat->name;
+
+  if (options_.mode == RecordMode::kTranscode || (options_.mode == RecordMode::kAuto && !accepted)) {
+    state_ = State::kTranscode;
+    LOG_INFO("[" + options_.name + "] Recording " + options_.path + ": transcoding " + codec +
+             (accepted ? " (--record transcode)" : " (" + container + " cannot hold it as is)"));
+    return;
+  }
+  if (!accepted) {
+    Fail(container + " cannot hold " + codec + " without transcoding (use --record auto or another extension)");
+    return;
+  }
+  state_ = State::kCopy;
+  LOG_INFO("[" + options_.name + "] Recording " + options_.path + ": stream copy of " + codec + " into " + container);
+}
+
+// Stream copy path. The file is opened at the first keyframe whose
+// dimensions are known (muxers require them in the header); everything
+// before is dropped. The input packet is muxed through a shallow view, so
+// its data is not copied.
+void Recorder::OnPacket(const AVPacket* packet, const AVCodecParameters* codecpar, AVRational time_base) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (state_ == State::kUndecided) {
+    Decide(codecpar);
+  }
+  if (state_ != State::kCopy) {
+    return;
+  }
+
+  if (!header_written_) {
+    if (!(packet->flags & AV_PKT_FLAG_KEY) || codecpar->width <= 0 || codecpar->height <= 0) {
+      ++dropped_;
+      return;
+    }
+    int ret = avcodec_parameters_copy(stream_->codecpar, codecpar);
+    if (ret < 0) {
+      Fail("cannot copy codec parameters: " + AvErrorToString(ret));
+      return;
+    }
+    stream_->codecpar->codec_tag = 0;
+    stream_->time_base = time_base;
+    if (!WriteHeader()) {
+      return;
+    }
+    first_ts_ = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+  }
+
+  // Native ingest has no dts; without B-frames (WebRTC never sends them)
+  // decode order is presentation order
+  const int64_t dts = packet->dts != AV_NOPTS_VALUE ? packet->dts : packet->pts;
+  packet_->data = packet->data;
+  packet_->size = packet->size;
+  packet_->flags = packet->flags;
+  packet_->stream_index = 0;
+  packet_->pts = packet->pts != AV_NOPTS_VALUE ? packet->pts - first_ts_ : AV_NOPTS_VALUE;
+  packet_->dts = dts != AV_NOPTS_VALUE ? dts - first_ts_ : AV_NOPTS_VALUE;
+  packet_->duration = 0;
+  av_packet_rescale_ts(packet_, time_base, stream_->time_base);
+  Write(packet_);
+  packet_->data = nullptr;
+  packet_->size = 0;
+}
+
+// Muxers reject a dts that does not increase. Encoder output may start
+// below 0 (B-frame delay); muxers handle that themselves.
+//
+// Caller holds mutex_.
+void Recorder::Write(AVPacket* packet) {
+  if (packet->dts != AV_NOPTS_VALUE) {
+    if (last_dts_ != INT64_MIN && packet->dts <= last_dts_) {
+      ++dropped_;
+      return;
+    }
+    last_dts_ = packet->dts;
+  }
+  const int ret = av_write_frame(output_, packet);
+  if (ret < 0) {
+    LOG_WARN("[" + options_.name + "] Failed to write recording packet: " + AvErrorToString(ret));
+    ++dropped_;
+    return;
+  }
+  ++written_;
+  written_metric_->Add();
+}
+
+// Caller holds mutex_.
+bool Recorder::OpenEncoder(const AVFrame* frame) {
+  const AVCodec* codec = options_.encoder.empty() ? avcodec_find_encoder(output_->oformat->video_codec)
+                                                  : avcodec_find_encoder_by_name(options_.encoder.c_str());
+  if (!codec) {
+    Fail("encoder '" + (options_.encoder.empty() ? std::string("default") : options_.encoder) + "' not available");
+    return false;
+  }
+  encoder_ = avcodec_alloc_context3(codec);
+  if (!encoder_) {
+    Fail("out of memory");
+    return false;
+  }
+  encoder_->width = frame->width;
+  encoder_->height = frame->height;
+  encoder_->pix_fmt = ChooseEncoderFormat(codec, static_cast<AVPixelFormat>(frame->format));
+  encoder_->time_base = kEncoderTimeBase;
+  encoder_->framerate = av_d2q(options_.fps > 0 ? options_.fps : 30.0, 1000);
+  encoder_->gop_size = static_cast<int>(options_.fps > 0 ? options_.fps * 2 : 60);
+  if (options_.bit_rate > 0) {
+    encoder_->bit_rate = options_.bit_rate;
+  }
+  if (output_->oformat->flags & AVFMT_GLOBALHEADER) {
+    encoder_->flags |= AV_CODEC_FLAG_GLOBAL_HEADER;
+  }
+  // Favour speed on the x264 family; ignored by encoders without a preset
+  av_opt_set(encoder_->priv_data, "preset", "veryfast", 0);
+
+  int ret = avcodec_open2(encoder_, codec, nullptr);
+  if (ret < 0) {
+    Fail(std::string("cannot open encoder ") + codec->name + ": " + AvErrorToString(ret));
+    return false;
+  }
+  ret = avcodec_parameters_from_context(stream_->codecpar, encoder_);
+  if (ret < 0) {
+    Fail("cannot set stream parameters: " + AvErrorToString(ret));
+    return false;
+  }
+  stream_->time_base = encoder_->time_base;
+
+  input_ = av_frame_alloc();
+  if (!input_) {
+    Fail("out of memory");
+    return false;
+  }
+  if (encoder_->pix_fmt != frame->format) {
+    scaled_ = av_frame_alloc();
+    if (!scaled_) {
+      Fail("out of memory");
+      return false;
+    }
+    scaled_->format = encoder_->pix_fmt;
+    scaled_->width = encoder_->width;
+    scaled_->height = encoder_->height;
+    if (av_frame_get_buffer(scaled_, 0) < 0) {
+      Fail("out of memory");
+      return false;
+    }
+  }
+  LOG_INFO("[" + options_.name + "] Encoding " + std::to_string(frame->width) + "x" + std::to_string(frame->height) +
+           " with " + codec->name + " (" + av_get_pix_fmt_name(encoder_->pix_fmt) + ")");
+  return WriteHeader();
+}
+
+// Transcode path. The encoder is opened on the first frame; later frames
+// are converted only if their format or size differs from the encoder's
+// (the recording keeps the first frame's size).
+void Recorder::OnFrame(const FrameRef& frame) {
+  if (!frame || !frame->native) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (state_ != State::kTranscode) {
+    return;
+  }
+  const AVFrame* source = frame->native;
+  if (!encoder_ && !OpenEncoder(source)) {
+    return;
+  }
+
+  // Stream time when known, otherwise the nominal frame rate
+  int64_t pts = 0;
+  if (frame->pts_us >= 0) {
+    if (first_pts_us_ < 0) {
+      first_pts_us_ = frame->pts_us;
+    }
+    pts = (frame->pts_us - first_pts_us_) / 1000;
+  } else {
+    pts = static_cast<int64_t>(static_cast<double>(frames_) * 1000.0 / (options_.fps > 0 ? options_.fps : 30.0));
+  }
+  if (pts <= last_pts_) {
+    ++dropped_;
+    return;
+  }
+  last_pts_ = pts;
+  ++frames_;
+
+  AVFrame* input = input_;
+  const bool convert = scaled_ || source->width != encoder_->width || source->height != encoder_->height;
+  if (convert) {
+    if (!scaled_) {
+      // Resolution changed mid-stream with a matching format: scale into
+      // an encoder-sized frame from now on
+      scaled_ = av_frame_alloc();
+      if (!scaled_) {
+        return;
+      }
+      scaled_->format = encoder_->pix_fmt;
+      scaled_->width = encoder_->width;
+      scaled_->height = encoder_->height;
+      if (av_frame_get_buffer(scaled_, 0) < 0) {
+        av_frame_free(&scaled_);
+        return;
+      }
+    }
+    sws_ = sws_getCachedContext(sws_, source->width, source->height, static_cast<AVPixelFormat>(source->format),
+                                encoder_->width, encoder_->height, encoder_->pix_fmt, SWS_BILINEAR, nullptr,
+                                nullptr, nullptr);
+    if (!sws_ || av_frame_make_writable(scaled_) < 0) {
+      ++dropped_;
+      return;
+    }
+    sws_scale(sws_, source->data, source->linesize, 0, source->height, scaled_->data, scaled_->linesize);
+    input = scaled_;
+  } else if (av_frame_ref(input_, source) < 0) {
+    ++dropped_;
+    return;
+  }
+  input->pts = pts;
+  input->pict_type = AV_PICTURE_TYPE_NONE;
+  Encode(input);
+  if (!convert) {
+    av_frame_unref(input_);
+  }
+}
+
+// Caller holds mutex_.
+void Recorder::Encode(AVFrame* frame) {
+  const int64_t start_us = util::NowMicros();
+  int ret = avcodec_send_frame(encoder_, frame);
+  if (ret < 0 && frame) {
+    LOG_WARN("[" + options_.name + "] Failed to encode frame: " + AvErrorToString(ret));
+    ++dropped_;
+    return;
+  }
+  while (avcodec_receive_packet(encoder_, packet_) >= 0) {
+    packet_->stream_index = 0;
+    av_packet_rescale_ts(packet_, encoder_->time_base, stream_->time_base);
+    Write(packet_);
+    av_packet_unref(packet_);
+  }
+  if (frame) {
+    encode_metric_->Observe(util::NowMicros() - start_us);
+  }
+}
+
+// Finalize the file: flush the encoder's delayed frames, write the
+// trailer (MP4 is unreadable without it) and log what was recorded.
+void Recorder::Close() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const State state = state_;
+  if (state == State::kClosed) {
+    return;
+  }
+  if (header_written_) {
+    if (encoder_) {
+      Encode(nullptr);
+    }
+    const int ret = av_write_trailer(output_);
+    if (ret < 0) {
+      LOG_WARN("[" + options_.name + "] Failed to finish " + options_.path + ": " + AvErrorToString(ret));
+    }
+    LOG_INFO("[" + options_.name + "] Recorded " + options_.path + ": packets=" + std::to_string(written_) +
+             " dropped=" + std::to_string(dropped_) + (state == State::kCopy ? " (stream copy)" : " (transcoded)"));
+  }
+  Release();
+  state_ = State::kClosed;
+}
+
+}  // namespace media
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+#include "media/FramePool.h"
+#include "util/Metrics.h"
+
+struct AVCodecContext;
+struct AVCodecParameters;
+struct AVFormatContext;
+struct AVFrame;
+struct AVPacket;
+struct AVRational;
+struct AVStream;
+struct SwsContext;
+
+namespace media {
+
+// How Recorder produces the video file.
+enum class RecordMode {
+  kAuto,       // Stream copy if the container accepts the codec, else transcode
+  kCopy,       // Always stream copy; give up if the container rejects the codec
+  kTranscode,  // Always re-encode decoded frames with the configured encoder
+  kOpenCv,     // Legacy: FrameWriter's cv::VideoWriter (mp4v, MJPG AVI fallback)
+};
+
+// Parse a record mode name ("auto", "copy", "transcode", "opencv").
+//
+// Returns: true if recognized (mode set), false otherwise
+bool ParseRecordMode(const std::string& name, RecordMode* mode);
+
+// Configuration for Recorder.
+struct RecorderOptions {
+  // Output file; the container is chosen from the extension
+  // (.webm, .mp4, .mkv, ...). Parent directories are created.
+  std::string path = "out/capture.mkv";
+
+  // Copy vs transcode, see RecordMode (kOpenCv is not handled here)
+  RecordMode mode = RecordMode::kAuto;
+
+  // libavcodec encoder name used when transcoding ("libx264", "libvpx",
+  // "mpeg4", ...). Empty picks the container's default video encoder.
+  std::string encoder;
+
+  // Encoder bit rate in bits/s; 0 keeps the encoder's default (CRF 23 for
+  // libx264)
+  int64_t bit_rate = 0;
+
+  // Nominal frame rate written to the encoder (timestamps come from the
+  // stream, so variable frame rate is preserved)
+  double fps = 30.0;
+
+  // Stream label of this recorder's metrics
+  std::string name = "default";
+};
+
+// Video recorder writing straight through libavformat.
+//
+// Stream copy: the receiver hands over each compressed VP8/H.264 packet
+// (OnPacket()) and it is muxed as is, starting at the first keyframe.
+// Nothing is decoded, converted or encoded for the recording, so an
+// archive-only stream costs little more than the disk writes.
+//
+// Transcode: used when the container cannot hold the incoming codec (VP8
+// in MP4) or when asked for. Decoded frames arrive through OnFrame() in
+// the decoder's native pixel format (kFormatNative, no BGR conversion),
+// are converted with swscale only if the encoder needs another format or
+// the resolution changed, and are encoded with libavcodec.
+//
+// The first packet decides between the two (see RequiredFormats(): the
+// receiver should keep decoding until then).
+//
+// Timestamps are taken from the stream and shifted to start at 0.
+// Packets or frames whose timestamp does not advance are dropped, since
+// muxers reject them.
+//
+// Thread-safe: OnPacket(), OnFrame() (sink threads) and Close() serialize
+// on one mutex. With several sink threads packets and frames may arrive
+// out of order; late ones are dropped.
+class Recorder {
+ public:
+  explicit Recorder(RecorderOptions options);
+
+  // Finishes the file (see Close()).
+  ~Recorder();
+
+  Recorder(const Recorder&) = delete;
+  Recorder& operator=(const Recorder&) = delete;
+
+  // Hand over one compressed packet as received.
+  //
+  // Param: packet - Encoded frame with pts (and optionally dts) in time_base;
+  //                 keyframes must carry AV_PKT_FLAG_KEY (RtpReceiver sets
+  //                 it from the bitstream where the demuxer does not)
+  // Param: codecpar - Stream parameters; width/height must be set once
+  //                   the first frame has been decoded
+  // Param: time_base - Time base of packet timestamps
+  // Side effects: the first call decides copy vs transcode; in copy mode
+  //               opens the file at the first keyframe
+  void OnPacket(const AVPacket* packet, const AVCodecParameters* codecpar, AVRational time_base);
+
+  // Hand over one decoded frame (used when transcoding, ignored otherwise).
+  //
+  // Param: frame - Frame with Frame::native set
+  void OnFrame(const FrameRef& frame);
+
+  // Pixel formats the recorder needs from the receiver:
+  //   kFormatNative while transcoding (or before the first packet, unless
+  //   the mode is kCopy), kFormatNone when copying or failed.
+  // Thread-safe: may be polled from the receiver thread.
+  uint32_t RequiredFormats() const;
+
+  // Flush the encoder, write the trailer and close the file.
+  // Safe to call more than once.
+  void Close();
+
+ private:
+  enum class State { kUndecided, kCopy, kTranscode, kFailed, kClosed };
+
+  // Choose copy or transcode for this codec and container.
+  void Decide(const AVCodecParameters* codecpar);
+
+  // Allocate the output context, create parent directories.
+  // Returns: false (after logging) on failure
+  bool CreateOutput();
+
+  // Open the file and write the header. Returns: false on failure.
+  bool WriteHeader();
+
+  // Open the encoder for the first frame's size. Returns: false on failure.
+  bool OpenEncoder(const AVFrame* frame);
+
+  // Encode one frame (null flushes) and mux what the encoder returns.
+  void Encode(AVFrame* frame);
+
+  // Mux one packet whose timestamps are in the output stream's time base.
+  void Write(AVPacket* packet);
+
+  // Log the error, release the output and stop recording.
+  void Fail(const std::string& message);
+
+  // Free every libav* object (the file is not finalized).
+  void Release();
+
+  RecorderOptions options_;
+
+  std::mutex mutex_;
+  std::atomic<State> state_{State::kUndecided};
+
+  AVFormatContext* output_ = nullptr;
+  AVStream* stream_ = nullptr;
+  bool header_written_ = false;
+
+  // Stream copy
+  AVPacket* packet_ = nullptr;         // Scratch: shallow view of the input packet
+  int64_t first_ts_ = 0;               // Input timestamp mapped to 0
+  int64_t last_dts_ = INT64_MIN;       // Last muxed dts (output time base)
+
+  // Transcode
+  AVCodecContext* encoder_ = nullptr;
+  AVFrame* scaled_ = nullptr;          // Encoder-format frame (only if converting)
+  AVFrame* input_ = nullptr;           // Scratch reference with the encoder pts
+  SwsContext* sws_ = nullptr;
+  int64_t first_pts_us_ = -1;
+  int64_t last_pts_ = INT64_MIN;       // Last encoded pts (encoder time base)
+  uint64_t frames_ = 0;
+
+  // Counters for the Close() log line and util::Metrics
+  uint64_t written_ = 0;
+  uint64_t dropped_ = 0;
+  util::Counter* written_metric_;
+  util::Histogram* encode_metric_;
+};
+
+}  // namespace media
@@ -0,0 +1,226 @@
+#include "media/ShmFrameClient.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace media {
+namespace {
+
+// Poll interval while no live ring exists (producer not started or stopped)
+constexpr int kReopenIntervalMs = 10;
+
+ShmRingHeader* Writable(const ShmRingHeader* header) {
+  // Consumers only write the waiter count (and the futex word is passed to
+  // the kernel); the mapping itself is read-write for that
+  return const_cast<ShmRingHeader*>(header);
+}
+
+}  // namespace
+
+ShmFrameClient::~ShmFrameClient() {
+  Unmap();
+}
+
+bool ShmFrameClient::Open(const std::string& name, std::string* error) {
+  Unmap();
+  path_ = ShmObjectName(name);
+  last_position_ = 0;
+  return Remap(error);
+}
+
+// Wait for the newest unread frame.
+//
+// 1. Without a live ring (not created yet, replaced, closed), look the
+//    name up again; poll every kReopenIntervalMs until the deadline
+// 2. Read the futex word, then last_seq: if there is a newer frame,
+//    return it (retrying if the producer overwrote it meanwhile)
+// 3. Otherwise sleep on the futex word read in step 2. A frame published
+//    after step 2 changed the word, so FUTEX_WAIT returns at once and no
+//    wake-up is lost
+// 4. After a timeout, check whether the name now refers to another
+//    object (the producer restarted)
+//
+// Param: view - Receives the frame
+// Param: timeout_ms - Longest wait (0 = poll, -1 = forever)
+// Returns: false on timeout
+bool ShmFrameClient::Next(ShmFrameView* view, int timeout_ms) {
+  const int64_t deadline_us = timeout_ms < 0 ? INT64_MAX : ShmNowUs() + static_cast<int64_t>(timeout_ms) * 1000;
+  for (;;) {
+    const int64_t remaining_us = deadline_us - ShmNowUs();
+    const int remaining_ms =
+        timeout_ms < 0 ? -1 : static_cast<int>(std::max<int64_t>(0, (remaining_us + 999) / 1000));
+
+    if (!header_ || header_->state.load(std::memory_order_acquire) != kShmLive) {
+      if (Remap(nullptr)) {
+        continue;
+      }
+      if (remaining_ms == 0) {
+        return false;
+      }
+      const int sleep_ms = remaining_ms < 0 ? kReopenIntervalMs : std::min(remaining_ms, kReopenIntervalMs);
+      ::usleep(static_cast<useconds_t>(sleep_ms) * 1000);
+      continue;
+    }
+
+    ShmRingHeader* header = Writable(header_);
+    const uint32_t futex = header->futex.load();
+    const uint64_t position = header->last_seq.load(std::memory_order_acquire);
+    if (position > last_position_) {
+      if (ReadSlot(position, view)) {
+        view->skipped = last_position_ ? position - last_position_ - 1 : 0;
+        last_position_ = position;
+        return true;
+      }
+      continue;  // Overwritten while reading; a newer frame is complete
+    }
+    if (remaining_ms == 0) {
+      return false;
+    }
+
+    header->waiters.fetch_add(1);
+    const int ret = ShmFutexWait(&header->futex, futex, remaining_ms);
+    const int wait_errno = errno;
+    header->waiters.fetch_sub(1);
+    if (ret < 0 && wait_errno == ETIMEDOUT) {
+      Remap(nullptr);
+    }
+  }
+}
+
+bool ShmFrameClient::Valid(const ShmFrameView& view) const {
+  if (!view.slot) {
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  return view.slot->generation.load(std::memory_order_relaxed) == view.generation;
+}
+
+// Read a slot under its seqlock: generation before (must be even), copy
+// the header fields, generation after (must be unchanged). The pixel
+// pointers are not copied from; Valid() repeats the check later.
+//
+// Param: position - Ring position expected in the slot
+// Param: view - Filled on success
+// Returns: false if the slot is being written or holds another position
+bool ShmFrameClient::ReadSlot(uint64_t position, ShmFrameView* view) const {
+  const uint8_t* base = reinterpret_cast<const uint8_t*>(header_);
+  const ShmSlotHeader* slot = reinterpret_cast<const ShmSlotHeader*>(
+      base + header_->data_offset + (position % header_->slot_count) * header_->slot_bytes);
+  const uint32_t generation = slot->generation.load(std::memory_order_acquire);
+  if (generation & 1) {
+    return false;
+  }
+
+  const uint64_t slot_position = slot->position;
+  const uint32_t planes = slot->plane_count;
+  const uint64_t capacity = header_->slot_bytes - sizeof(ShmSlotHeader);
+  view->sequence = slot->sequence;
+  view->pts_us = slot->pts_us;
+  view->publish_us = slot->publish_us;
+  view->key_frame = (slot->flags & kShmKeyFrame) != 0;
+  view->width = slot->width;
+  view->height = slot->height;
+  view->pixel_format = slot->pixel_format;
+  char name[sizeof(slot->pixel_format_name) + 1] = {};
+  std::memcpy(name, slot->pixel_format_name, sizeof(slot->pixel_format_name));
+  bool in_bounds = planes <= static_cast<uint32_t>(kShmMaxPlanes);
+  for (int i = 0; i < kShmMaxPlanes; ++i) {
+    const uint64_t offset = slot->plane_offsets[i];
+    const uint64_t bytes = slot->plane_bytes[i];
+    in_bounds = in_bounds && offset + bytes <= capacity;
+    view->data[i] = i < static_cast<int>(planes) ? reinterpret_cast<const uint8_t*>(slot + 1) + offset : nullptr;
+    view->strides[i] = slot->strides[i];
+  }
+
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot->generation.load(std::memory_order_relaxed) != generation || slot_position != position || !in_bounds) {
+    return false;
+  }
+  view->planes = static_cast<int>(planes);
+  view->pixel_format_name = name;
+  view->slot = slot;
+  view->generation = generation;
+  return true;
+}
+
+// Open path_ and map it unless it is the object already mapped.
+//
+// The producer creates the object, sizes it and then writes the header,
+// so a missing, empty or not yet initialized object is reported as an
+// error and retried by Next().
+//
+// Param: error - Receives a description on failure (may be null)
+// Returns: true if a new ring is mapped
+bool ShmFrameClient::Remap(std::string* error) {
+  std::string ignored;
+  if (!error) {
+    error = &ignored;
+  }
+  const int fd = ::shm_open(path_.c_str(), O_RDWR | O_CLOEXEC, 0);
+  if (fd < 0) {
+    *error = "shm_open " + path_ + ": " + std::strerror(errno);
+    return false;
+  }
+  struct stat st;
+  if (::fstat(fd, &st) != 0) {
+    *error = "fstat " + path_ + ": " + std::strerror(errno);
+    ::close(fd);
+    return false;
+  }
+  if (header_ && st.st_ino == inode_) {
+    ::close(fd);
+    *error = path_ + " was not replaced";
+    return false;
+  }
+  const size_t bytes = static_cast<size_t>(st.st_size);
+  if (bytes < sizeof(ShmRingHeader)) {
+    ::close(fd);
+    *error = path_ + " is not initialized";
+    return false;
+  }
+  void* mapping = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  const int saved_errno = errno;
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    *error = "mmap " + path_ + ": " + std::strerror(saved_errno);
+    return false;
+  }
+
+  const ShmRingHeader* header = static_cast<const ShmRingHeader*>(mapping);
+  const bool valid = std::memcmp(header->magic, kShmMagic, sizeof(kShmMagic)) == 0 &&
+                     header->version == kShmVersion && header->slot_count > 0 &&
+                     header->slot_bytes >= sizeof(ShmSlotHeader) &&
+                     header->data_offset >= sizeof(ShmRingHeader) &&
+                     header->data_offset + header->slot_count * header->slot_bytes <= bytes;
+  if (!valid) {
+    ::munmap(mapping, bytes);
+    *error = path_ + " is not a frame ring (or not initialized yet)";
+    return false;
+  }
+
+  Unmap();
+  header_ = header;
+  mapped_bytes_ = bytes;
+  inode_ = st.st_ino;
+  // A replacement continues the producer's positions; a restarted
+  // producer starts again from 0
+  last_position_ = std::min(last_position_, header_->last_seq.load(std::memory_order_acquire));
+  return true;
+}
+
+void ShmFrameClient::Unmap() {
+  if (header_) {
+    ::munmap(const_cast<ShmRingHeader*>(header_), mapped_bytes_);
+    header_ = nullptr;
+    mapped_bytes_ = 0;
+    inode_ = 0;
+  }
+}
+
+}  // namespace media
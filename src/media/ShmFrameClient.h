@@ -0,0 +1,115 @@
+#pragma once
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "media/ShmFrameRing.h"
+
+namespace media {
+
+// A frame in the shared-memory ring, seen in place (no copy).
+//
+// data[] points into the mapping. The pixels may be overwritten by the
+// producer once it has published slot_count - 1 newer frames; call
+// ShmFrameClient::Valid() after using them (or after copying them out)
+// to learn whether they were still intact.
+struct ShmFrameView {
+  uint64_t sequence = 0;     // Stream decode order (gaps = frames not read)
+  int64_t pts_us = -1;       // Presentation time in microseconds, -1 if unknown
+  int64_t publish_us = 0;    // CLOCK_MONOTONIC when published (see ShmNowUs())
+  bool key_frame = false;
+  int width = 0;
+  int height = 0;
+  int pixel_format = 0;      // AVPixelFormat value of the producer's FFmpeg
+  std::string pixel_format_name;  // "bgr24", "yuv420p", "nv12", ...
+  int planes = 0;
+  const uint8_t* data[kShmMaxPlanes] = {};
+  int strides[kShmMaxPlanes] = {};
+  uint64_t skipped = 0;      // Frames published since the previous view and not returned
+
+  // Seqlock state checked by Valid()
+  const ShmSlotHeader* slot = nullptr;
+  uint32_t generation = 0;
+};
+
+// Reads frames published by media::ShmPublisher from another process.
+//
+// Depends on nothing but the C library: consumers link the small
+// capture_shm_client library and include this header, without OpenCV or
+// FFmpeg. The object is mapped read-write, because a blocked consumer
+// registers in ShmRingHeader::waiters; frames are never written. The
+// producer creates it with mode 0660, so consumers run as the capture
+// user or in its group.
+//
+// Next() returns the newest frame not returned yet ("latest wins"): a
+// consumer slower than the stream skips frames instead of building up
+// latency, and ShmFrameView::skipped says how many. It blocks on the
+// ring's futex while there is nothing new, so an idle consumer uses no
+// CPU and wakes within microseconds of a publish.
+//
+// The producer replaces the object when the frame size grows and closes
+// it when it stops; Next() follows the name to the new object (also after
+// a producer restart). Views from the old mapping become invalid then, so
+// a view must not be used after the next Next() call.
+//
+// Typical loop:
+//   media::ShmFrameClient client;
+//   client.Open("webrtc_capture", &error);
+//   media::ShmFrameView frame;
+//   while (client.Next(&frame, 1000)) {
+//     Infer(frame.data[0], frame.strides[0], frame.width, frame.height);
+//     if (!client.Valid(frame)) { /* overwritten while in use: discard */ }
+//   }
+//
+// Thread-safe: no; use one client per consumer thread.
+class ShmFrameClient {
+ public:
+  ShmFrameClient() = default;
+  ~ShmFrameClient();
+
+  ShmFrameClient(const ShmFrameClient&) = delete;
+  ShmFrameClient& operator=(const ShmFrameClient&) = delete;
+
+  // Map the ring published under name.
+  //
+  // Param: name - ShmPublisherOptions::name (leading '/' optional)
+  // Param: error - Receives a description on failure
+  // Returns: false if the object does not exist (yet) or is not a ring
+  bool Open(const std::string& name, std::string* error);
+
+  bool is_open() const { return header_ != nullptr; }
+
+  // Wait for a frame newer than the last one returned.
+  //
+  // Param: view - Receives the frame on success
+  // Param: timeout_ms - Longest wait; 0 polls, -1 waits forever
+  // Returns: false on timeout (or when no ring can be mapped)
+  bool Next(ShmFrameView* view, int timeout_ms);
+
+  // True if the view's pixels have not been touched by the producer since
+  // Next() returned it.
+  bool Valid(const ShmFrameView& view) const;
+
+ private:
+  // Map path_ if it names an object other than the current mapping.
+  // Returns: true if a new mapping is in place
+  bool Remap(std::string* error);
+
+  // Unmap the current object.
+  void Unmap();
+
+  // Fill view from the slot holding ring position, if it is complete and
+  // still holds that position.
+  bool ReadSlot(uint64_t position, ShmFrameView* view) const;
+
+  std::string path_;
+  const ShmRingHeader* header_ = nullptr;
+  size_t mapped_bytes_ = 0;
+  ino_t inode_ = 0;          // Identity of the mapped object
+  uint64_t last_position_ = 0;
+};
+
+}  // namespace media
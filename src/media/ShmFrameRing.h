@@ -0,0 +1,124 @@
+#pragma once
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Layout of the shared-memory frame ring, shared by the producer
+// (media::ShmPublisher) and consumers (media::ShmFrameClient).
+//
+// One POSIX shared-memory object per stream ("/dev/shm/<name>"):
+//
+//   offset 0            ShmRingHeader
+//   data_offset         slot 0: ShmSlotHeader, then the planes
+//   + slot_bytes        slot 1
+//   ...                 slot_count slots
+//
+// The frame at ring position n (1-based, counted by the producer) goes to
+// slot n % slot_count, so a consumer can fall up to slot_count - 1 frames
+// behind before the frame it reads is overwritten. Every slot is guarded by a seqlock: its generation is
+// odd while the producer writes the slot, and a consumer that sees the
+// same even generation before and after using the pixels knows they were
+// not modified underneath it.
+//
+// Notification is a futex on ShmRingHeader::futex (shared, not
+// FUTEX_PRIVATE, since waiters live in other processes): the producer
+// bumps it after every frame and only enters the kernel (FUTEX_WAKE) when
+// ShmRingHeader::waiters says a consumer is blocked.
+//
+// Only fixed-size fields and lock-free atomics: the header contains no
+// pointers and is identical in every process mapping it. Both sides must
+// be built for the same architecture (host byte order).
+namespace media {
+
+constexpr char kShmMagic[8] = {'F', 'C', 'S', 'H', 'M', 'R', 'G', '1'};
+constexpr uint32_t kShmVersion = 1;
+
+// Planes per frame (BGR: 1, I420: 3, NV12: 2, YUVA: 4)
+constexpr int kShmMaxPlanes = 4;
+
+// Slots and planes start at multiples of this (SIMD-friendly rows)
+constexpr uint64_t kShmAlignment = 64;
+
+// ShmRingHeader::state
+constexpr uint32_t kShmLive = 0;      // Producer is publishing here
+constexpr uint32_t kShmReplaced = 1;  // A new object with the same name exists (e.g. larger frames)
+constexpr uint32_t kShmClosed = 2;    // Producer stopped
+
+// ShmSlotHeader::flags
+constexpr uint32_t kShmKeyFrame = 1u << 0;
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "futex words must be lock-free");
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared counters must be lock-free");
+
+// First bytes of the shared-memory object.
+struct ShmRingHeader {
+  char magic[8];                    // kShmMagic
+  uint32_t version;                 // kShmVersion
+  uint32_t slot_count;              // Number of slots
+  uint64_t slot_bytes;              // Bytes per slot, including its ShmSlotHeader
+  uint64_t data_offset;             // Offset of slot 0
+  std::atomic<uint32_t> futex;      // Incremented after every frame and state change
+  std::atomic<uint32_t> waiters;    // Consumers blocked in FUTEX_WAIT
+  std::atomic<uint64_t> last_seq;   // Ring position of the newest complete frame, 0 before the first
+  std::atomic<uint32_t> state;      // kShmLive, kShmReplaced or kShmClosed
+  int32_t producer_pid;
+  uint64_t reserved;
+};
+static_assert(sizeof(ShmRingHeader) == 64, "ShmRingHeader layout is shared between processes");
+
+// Metadata of the frame held by one slot; the planes follow it.
+struct ShmSlotHeader {
+  std::atomic<uint32_t> generation;  // Seqlock: odd while the producer writes this slot
+  uint32_t plane_count;
+  uint64_t sequence;                 // 1-based decode order within the stream
+  int64_t pts_us;                    // Presentation time in microseconds, -1 if unknown
+  int64_t publish_us;                // CLOCK_MONOTONIC when the frame was complete
+  int32_t width;
+  int32_t height;
+  int32_t pixel_format;              // AVPixelFormat value of the producer's FFmpeg
+  uint32_t flags;                    // kShmKeyFrame
+  char pixel_format_name[16];        // FFmpeg pixel format name ("bgr24", "yuv420p", ...)
+  int32_t strides[kShmMaxPlanes];    // Bytes per row of each plane
+  uint32_t plane_offsets[kShmMaxPlanes];  // From the end of this header
+  uint32_t plane_bytes[kShmMaxPlanes];    // stride * rows of each plane
+  uint64_t payload_bytes;            // Bytes used after this header
+  uint64_t position;                 // ShmRingHeader::last_seq value of this frame
+};
+static_assert(sizeof(ShmSlotHeader) == 128, "ShmSlotHeader layout is shared between processes");
+static_assert(sizeof(ShmSlotHeader) % kShmAlignment == 0, "planes must stay aligned");
+
+// shm_open() name for a publish name: a single leading '/'.
+inline std::string ShmObjectName(const std::string& name) {
+  return name.empty() || name[0] != '/' ? "/" + name : name;
+}
+
+// CLOCK_MONOTONIC in microseconds, the clock of ShmSlotHeader::publish_us.
+inline int64_t ShmNowUs() {
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<int64_t>(now.tv_sec) * 1000000 + now.tv_nsec / 1000;
+}
+
+// Sleep until *word != expected, a wake-up, or timeout_ms (-1 = forever).
+// Returns: 0, or -1 with errno (ETIMEDOUT, EAGAIN if the value changed, EINTR)
+inline int ShmFutexWait(std::atomic<uint32_t>* word, uint32_t expected, int timeout_ms) {
+  timespec timeout;
+  timeout.tv_sec = timeout_ms / 1000;
+  timeout.tv_nsec = static_cast<long>(timeout_ms % 1000) * 1000000;
+  return static_cast<int>(::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAIT, expected,
+                                    timeout_ms < 0 ? nullptr : &timeout, nullptr, 0));
+}
+
+// Wake every process waiting on *word.
+inline void ShmFutexWakeAll(std::atomic<uint32_t>* word) {
+  ::syscall(SYS_futex, reinterpret_cast<uint32_t*>(word), FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+}
+
+}  // namespace media
@@ -0,0 +1,257 @@
+#include "media/ShmPublisher.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+extern "C" {
+#include <libavutil/frame.h>
+#include <libavutil/pixdesc.h>
+}
+
+#include "util/Log.h"
+
+namespace media {
+namespace {
+
+uint64_t AlignUp(uint64_t value) {
+  return (value + kShmAlignment - 1) / kShmAlignment * kShmAlignment;
+}
+
+// Planes of an AVFrame in its own layout (strides kept, so rows stay as
+// aligned as the decoder made them).
+//
+// Returns: number of planes, 0 if the frame has no CPU-accessible pixels
+int NativePlanes(const AVFrame* native, ShmPlane* planes) {
+  const AVPixFmtDescriptor* desc = av_pix_fmt_desc_get(static_cast<AVPixelFormat>(native->format));
+  if (!desc || (desc->flags & (AV_PIX_FMT_FLAG_HWACCEL | AV_PIX_FMT_FLAG_PAL))) {
+    return 0;
+  }
+  const int count = av_pix_fmt_count_planes(static_cast<AVPixelFormat>(native->format));
+  if (count <= 0 || count > kShmMaxPlanes) {
+    return 0;
+  }
+  for (int i = 0; i < count; ++i) {
+    if (!native->data[i] || native->linesize[i] <= 0) {
+      return 0;  // Bottom-up (negative stride) frames are not supported
+    }
+    // Planes 1 and 2 carry chroma; plane 0 (luma) and 3 (alpha) are full height
+    const int shift = (i == 1 || i == 2) ? desc->log2_chroma_h : 0;
+    planes[i].data = native->data[i];
+    planes[i].stride = native->linesize[i];
+    planes[i].rows = (native->height + (1 << shift) - 1) >> shift;
+  }
+  return count;
+}
+
+}  // namespace
+
+ShmPublisher::ShmPublisher(ShmPublisherOptions options)
+    : options_(std::move(options)), object_name_(ShmObjectName(options_.name)) {
+  options_.slots = std::max<size_t>(options_.slots, 2);
+  if (options_.format != kFormatNative) {
+    options_.format = kFormatBgr;
+  }
+  util::Metrics& metrics = util::Metrics::Instance();
+  const std::string labels = util::MetricLabel("stream", options_.stream);
+  published_ = metrics.GetCounter("capture_shm_published_total", "Frames published to shared memory", labels);
+  skipped_ = metrics.GetCounter("capture_shm_skipped_total", "Frames not published to shared memory", labels);
+}
+
+ShmPublisher::~ShmPublisher() {
+  if (header_) {
+    ReleaseRing(kShmClosed);
+    ::shm_unlink(object_name_.c_str());
+  }
+}
+
+// Publish one pooled frame: bgr as one packed plane, native as the
+// decoder's planes.
+//
+// Param: frame - Decoded frame (read-only)
+// Returns: false if the frame was skipped (counted in capture_shm_skipped_total)
+bool ShmPublisher::OnFrame(const Frame& frame) {
+  ShmFrameInfo info;
+  info.sequence = frame.sequence;
+  info.pts_us = frame.pts_us;
+  info.key_frame = frame.key_frame;
+  info.width = frame.width;
+  info.height = frame.height;
+
+  ShmPlane planes[kShmMaxPlanes];
+  int count = 0;
+  if (options_.format == kFormatBgr && !frame.bgr.empty()) {
+    info.pixel_format = AV_PIX_FMT_BGR24;
+    info.pixel_format_name = "bgr24";
+    planes[0].data = frame.bgr.data;
+    planes[0].stride = static_cast<int>(frame.bgr.step[0]);
+    planes[0].rows = frame.bgr.rows;
+    info.width = frame.bgr.cols;
+    info.height = frame.bgr.rows;
+    count = 1;
+  } else if (options_.format == kFormatNative && frame.native) {
+    info.pixel_format = frame.native->format;
+    const char* name = av_get_pix_fmt_name(static_cast<AVPixelFormat>(frame.native->format));
+    info.pixel_format_name = name ? name : "";
+    info.width = frame.native->width;
+    info.height = frame.native->height;
+    count = NativePlanes(frame.native, planes);
+  }
+  if (count == 0) {
+    skipped_->Add();
+    return false;
+  }
+  return Publish(info, planes, count);
+}
+
+// Copy a frame into the slot of the next ring position.
+//
+// 1. Lay out the planes (each at a kShmAlignment offset) and (re)create
+//    the object if they do not fit a slot
+// 2. Make the slot generation odd, copy header fields and planes, make it
+//    even again (seqlock; consumers discard what they read meanwhile)
+// 3. Publish last_seq, bump the futex word and wake consumers only if one
+//    is waiting
+//
+// Param: info - Metadata copied into the slot header
+// Param: planes, count - Pixel planes
+// Returns: false if the frame could not be published
+bool ShmPublisher::Publish(const ShmFrameInfo& info, const ShmPlane* planes, int count) {
+  if (count <= 0 || count > kShmMaxPlanes) {
+    skipped_->Add();
+    return false;
+  }
+  uint32_t offsets[kShmMaxPlanes] = {};
+  uint32_t sizes[kShmMaxPlanes] = {};
+  uint64_t payload = 0;
+  for (int i = 0; i < count; ++i) {
+    offsets[i] = static_cast<uint32_t>(payload);
+    sizes[i] = static_cast<uint32_t>(static_cast<uint64_t>(planes[i].stride) * planes[i].rows);
+    payload = AlignUp(payload + sizes[i]);
+  }
+  if (payload > payload_capacity_ && !CreateRing(payload)) {
+    skipped_->Add();
+    return false;
+  }
+
+  uint8_t* base = reinterpret_cast<uint8_t*>(header_);
+  const uint64_t position = header_->last_seq.load(std::memory_order_relaxed) + 1;
+  ShmSlotHeader* slot = reinterpret_cast<ShmSlotHeader*>(
+      base + header_->data_offset + (position % header_->slot_count) * header_->slot_bytes);
+  uint8_t* data = reinterpret_cast<uint8_t*>(slot + 1);
+
+  const uint32_t generation = slot->generation.load(std::memory_order_relaxed);
+  slot->generation.store(generation + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+
+  slot->plane_count = static_cast<uint32_t>(count);
+  slot->sequence = info.sequence ? info.sequence : position;
+  slot->pts_us = info.pts_us;
+  slot->width = info.width;
+  slot->height = info.height;
+  slot->pixel_format = info.pixel_format;
+  slot->flags = info.key_frame ? kShmKeyFrame : 0;
+  std::memset(slot->pixel_format_name, 0, sizeof(slot->pixel_format_name));
+  std::strncpy(slot->pixel_format_name, info.pixel_format_name, sizeof(slot->pixel_format_name) - 1);
+  for (int i = 0; i < kShmMaxPlanes; ++i) {
+    slot->strides[i] = i < count ? planes[i].stride : 0;
+    slot->plane_offsets[i] = offsets[i];
+    slot->plane_bytes[i] = sizes[i];
+  }
+  slot->payload_bytes = payload;
+  slot->position = position;
+  for (int i = 0; i < count; ++i) {
+    std::memcpy(data + offsets[i], planes[i].data, sizes[i]);
+  }
+  slot->publish_us = ShmNowUs();
+
+  slot->generation.store(generation + 2, std::memory_order_release);
+
+  // seq_cst on futex and waiters pairs with the consumer's waiters
+  // increment: either we see the waiter or it sees the new value
+  header_->last_seq.store(position, std::memory_order_release);
+  header_->futex.fetch_add(1);
+  if (header_->waiters.load() > 0) {
+    ShmFutexWakeAll(&header_->futex);
+  }
+  published_->Add();
+  return true;
+}
+
+// Create a fresh object sized for payload_bytes per slot.
+//
+// The name is unlinked first: a stale object (from a crashed run) or the
+// current one (now too small) keeps existing for consumers that still
+// map it, and they move over when they see kShmReplaced or a new inode.
+//
+// Returns: false (logged once) if shm_open/ftruncate/mmap fail
+bool ShmPublisher::CreateRing(uint64_t payload_bytes) {
+  if (failed_) {
+    return false;
+  }
+  const uint64_t position = header_ ? header_->last_seq.load(std::memory_order_relaxed) : 0;
+  if (header_) {
+    ReleaseRing(kShmReplaced);
+  }
+  ::shm_unlink(object_name_.c_str());
+
+  const uint64_t slot_bytes = sizeof(ShmSlotHeader) + AlignUp(payload_bytes);
+  const uint64_t data_offset = AlignUp(sizeof(ShmRingHeader));
+  const size_t total = static_cast<size_t>(data_offset + slot_bytes * options_.slots);
+  const int fd = ::shm_open(object_name_.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0660);
+  if (fd < 0) {
+    LOG_ERROR("Shared memory " + object_name_ + ": shm_open failed: " + std::strerror(errno));
+    failed_ = true;
+    return false;
+  }
+  void* mapping = MAP_FAILED;
+  if (::ftruncate(fd, static_cast<off_t>(total)) == 0) {
+    mapping = ::mmap(nullptr, total, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  }
+  const int saved_errno = errno;
+  ::close(fd);
+  if (mapping == MAP_FAILED) {
+    LOG_ERROR("Shared memory " + object_name_ + ": cannot size or map " + std::to_string(total) +
+              " bytes: " + std::strerror(saved_errno));
+    ::shm_unlink(object_name_.c_str());
+    failed_ = true;
+    return false;
+  }
+
+  // ftruncate() zero-fills, so every slot starts with generation 0 and the
+  // atomics start at 0; placement-new makes that explicit
+  header_ = new (mapping) ShmRingHeader{};
+  std::memcpy(header_->magic, kShmMagic, sizeof(kShmMagic));
+  header_->version = kShmVersion;
+  header_->slot_count = static_cast<uint32_t>(options_.slots);
+  header_->slot_bytes = slot_bytes;
+  header_->data_offset = data_offset;
+  header_->producer_pid = static_cast<int32_t>(::getpid());
+  // Continue the ring positions so consumers moving over see no rewind
+  header_->last_seq.store(position, std::memory_order_release);
+  mapped_bytes_ = total;
+  payload_capacity_ = slot_bytes - sizeof(ShmSlotHeader);
+
+  LOG_INFO("Publishing frames to shared memory " + object_name_ + ": " + std::to_string(options_.slots) +
+           " slots of " + std::to_string(slot_bytes) + " bytes");
+  return true;
+}
+
+// Tell consumers this object is no longer written and drop the mapping.
+void ShmPublisher::ReleaseRing(uint32_t state) {
+  header_->state.store(state, std::memory_order_release);
+  header_->futex.fetch_add(1);
+  ShmFutexWakeAll(&header_->futex);
+  ::munmap(header_, mapped_bytes_);
+  header_ = nullptr;
+  mapped_bytes_ = 0;
+  payload_capacity_ = 0;
+}
+
+}  // namespace media
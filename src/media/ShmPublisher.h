@@ -0,0 +1,119 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "media/FramePool.h"
+#include "media/ShmFrameRing.h"
+#include "util/Metrics.h"
+
+namespace media {
+
+// Configuration for ShmPublisher.
+struct ShmPublisherOptions {
+  // Shared-memory object name ("/dev/shm/<name>"); a leading '/' is added
+  std::string name = "webrtc_capture";
+
+  // Frames kept in the ring; a consumer may lag slots - 1 frames behind
+  size_t slots = 4;
+
+  // What is published: kFormatBgr (packed bgr24) or kFormatNative (the
+  // decoder's planes, e.g. yuv420p: half the bytes, no conversion)
+  FrameFormat format = kFormatBgr;
+
+  // Stream label of the metrics
+  std::string stream = "default";
+};
+
+// Metadata of a frame passed to ShmPublisher::Publish().
+struct ShmFrameInfo {
+  uint64_t sequence = 0;
+  int64_t pts_us = -1;
+  bool key_frame = false;
+  int width = 0;
+  int height = 0;
+  int pixel_format = 0;         // AVPixelFormat value
+  const char* pixel_format_name = "";
+};
+
+// One plane of a frame passed to ShmPublisher::Publish().
+struct ShmPlane {
+  const uint8_t* data = nullptr;
+  int stride = 0;  // Bytes per row (positive)
+  int rows = 0;
+};
+
+// Publishes decoded frames into a shared-memory ring (layout in
+// media/ShmFrameRing.h) so local consumers, e.g. inference processes,
+// get them microseconds after decoding instead of re-reading images from
+// disk. Consumers use media::ShmFrameClient and map the pixels without
+// copying.
+//
+// The producer never waits for consumers: it copies each frame into the
+// next slot (one memcpy per plane) and moves on, so a stalled or crashed
+// consumer cannot slow down capture; it only misses frames.
+//
+// The object is created on the first frame, sized for its planes. When a
+// later frame does not fit (larger resolution, other format), the old
+// object is marked kShmReplaced and unlinked, and a new one is created
+// under the same name; consumers notice the state and reopen. The
+// destructor marks the object kShmClosed and unlinks it.
+//
+// Metrics (util::Metrics, label stream="<stream>"):
+//   capture_shm_published_total - frames published
+//   capture_shm_skipped_total   - frames not published (no pixels in the
+//                                 negotiated format, unsupported layout,
+//                                 shared memory unavailable)
+//
+// Thread-safe: no; all calls must come from one thread (the receiver).
+class ShmPublisher {
+ public:
+  explicit ShmPublisher(ShmPublisherOptions options);
+
+  // Marks the ring closed, wakes consumers, unmaps and unlinks it.
+  ~ShmPublisher();
+
+  ShmPublisher(const ShmPublisher&) = delete;
+  ShmPublisher& operator=(const ShmPublisher&) = delete;
+
+  // Formats OnFrame() needs from the receiver (ShmPublisherOptions::format).
+  uint32_t RequiredFormats() const { return options_.format; }
+
+  // Publish a decoded frame in the configured format.
+  // Returns: false if the frame was skipped
+  bool OnFrame(const Frame& frame);
+
+  // Publish a frame given as planes.
+  //
+  // Param: info - Metadata copied into the slot header
+  // Param: planes, count - Pixel planes (count <= kShmMaxPlanes)
+  // Returns: false (after logging once) if shared memory is unavailable
+  // Side effects: creates or replaces the shared-memory object as needed
+  bool Publish(const ShmFrameInfo& info, const ShmPlane* planes, int count);
+
+  // shm_open() name in use.
+  const std::string& object_name() const { return object_name_; }
+
+ private:
+  // Create the object with slots of at least payload_bytes, marking and
+  // unlinking the current one first.
+  bool CreateRing(uint64_t payload_bytes);
+
+  // Mark the current object with state (kShmReplaced / kShmClosed), wake
+  // consumers and unmap it.
+  void ReleaseRing(uint32_t state);
+
+  ShmPublisherOptions options_;
+  std::string object_name_;
+
+  ShmRingHeader* header_ = nullptr;  // Mapping of the whole object
+  size_t mapped_bytes_ = 0;
+  uint64_t payload_capacity_ = 0;    // Bytes per slot after its ShmSlotHeader
+  bool failed_ = false;              // Creation failed once; logged
+
+  util::Counter* published_;
+  util::Counter* skipped_;
+};
+
+}  // namespace media
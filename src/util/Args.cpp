@@ -1,5 +1,6 @@
 #include "util/Args.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 #include "util/Log.h"
@@ -15,6 +16,11 @@ namespace util {
 // Argument handling:
 //   --out also updates --mp4_path to "<dir>/capture.mp4" for convenience
 //   --mp4 enables write_video automatically
+//   --queue-size, --writer-threads, --convert-threads and --frame-every are
+//   clamped to at least 1
+//   --sws-flags, --resize, --crop, --decode-thread-type, --ingest, --record,
+//   --image-format, --image-output and --file-output are validated by CaptureStream (unknown names fall back to the defaults)
+//   --sinks and --sink-option are validated by app::SinkRegistry
 //   Unknown arguments are logged as warnings (not errors)
 //   --help prints usage and returns with default args
 //
@@ -32,6 +38,34 @@ Args ParseArgs(int argc, char** argv) {
       args.mp4_path = args.output_dir + "/capture.mp4";
     } else if (key == "--write-images" && i + 1 < argc) {
       args.write_images = std::atoi(argv[++i]) != 0;
+    } else if (key == "--image-format" && i + 1 < argc) {
+      args.image_format = argv[++i];
+    } else if (key == "--image-quality" && i + 1 < argc) {
+      args.image_quality = std::atoi(argv[++i]);
+    } else if (key == "--png-compression" && i + 1 < argc) {
+      args.png_compression = std::max(-1, std::atoi(argv[++i]));
+    } else if (key == "--image-output" && i + 1 < argc) {
+      args.image_output = argv[++i];
+    } else if (key == "--spool-segment-mb" && i + 1 < argc) {
+      args.spool_segment_mb = std::max(1, std::atoi(argv[++i]));
+    } else if (key == "--file-output" && i + 1 < argc) {
+      args.file_output = argv[++i];
+    } else if (key == "--file-output-depth" && i + 1 < argc) {
+      args.file_output_depth = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--file-output-threads" && i + 1 < argc) {
+      args.file_output_threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--file-fsync" && i + 1 < argc) {
+      args.file_fsync = std::atoi(argv[++i]) != 0;
+    } else if (key == "--sinks" && i + 1 < argc) {
+      args.sinks = argv[++i];
+    } else if (key == "--sink-option" && i + 1 < argc) {
+      args.sink_options.push_back(argv[++i]);
+    } else if (key == "--shm-publish" && i + 1 < argc) {
+      args.shm_publish = argv[++i];
+    } else if (key == "--shm-slots" && i + 1 < argc) {
+      args.shm_slots = static_cast<size_t>(std::max(2, std::atoi(argv[++i])));
+    } else if (key == "--shm-format" && i + 1 < argc) {
+      args.shm_format = argv[++i];
     } else if (key == "--write-video" && i + 1 < argc) {
       args.write_video = std::atoi(argv[++i]) != 0;
     } else if (key == "--fps" && i + 1 < argc) {
@@ -39,8 +73,101 @@ Args ParseArgs(int argc, char** argv) {
     } else if (key == "--mp4" && i + 1 < argc) {
       args.mp4_path = argv[++i];
       args.write_video = true;
+    } else if (key == "--record" && i + 1 < argc) {
+      args.record_mode = argv[++i];
+    } else if (key == "--record-encoder" && i + 1 < argc) {
+      args.record_encoder = argv[++i];
+    } else if (key == "--record-bitrate" && i + 1 < argc) {
+      args.record_bitrate = std::max<int64_t>(0, std::atoll(argv[++i]));
+    } else if (key == "--frame-keyframes-only" && i + 1 < argc) {
+      args.frame_keyframes_only = std::atoi(argv[++i]) != 0;
+    } else if (key == "--frame-every" && i + 1 < argc) {
+      args.frame_every = static_cast<uint32_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--frame-max-fps" && i + 1 < argc) {
+      args.frame_max_fps = std::max(0.0, std::atof(argv[++i]));
+    } else if (key == "--frame-scene-threshold" && i + 1 < argc) {
+      args.frame_scene_threshold = std::max(0.0, std::atof(argv[++i]));
+    } else if (key == "--queue-size" && i + 1 < argc) {
+      args.queue_size = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--queue-policy" && i + 1 < argc) {
+      std::string value = argv[++i];
+      if (!ParseOverflowPolicy(value, &args.queue_policy)) {
+        LOG_WARN("Unknown queue policy: " + value);
+      }
+    } else if (key == "--writer-threads" && i + 1 < argc) {
+      args.writer_threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--encode-threads" && i + 1 < argc) {
+      args.encode_threads = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (key == "--ordered-writes" && i + 1 < argc) {
+      args.ordered_writes = std::atoi(argv[++i]) != 0;
+    } else if (key == "--convert-threads" && i + 1 < argc) {
+      args.convert_threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--sws-flags" && i + 1 < argc) {
+      args.sws_flags = argv[++i];
+    } else if (key == "--resize" && i + 1 < argc) {
+      args.resize = argv[++i];
+    } else if (key == "--crop" && i + 1 < argc) {
+      args.crop = argv[++i];
+    } else if (key == "--decode-threads" && i + 1 < argc) {
+      args.decode_threads = std::max(0, std::atoi(argv[++i]));
+    } else if (key == "--decode-thread-type" && i + 1 < argc) {
+      args.decode_thread_type = argv[++i];
+    } else if (key == "--low-delay" && i + 1 < argc) {
+      args.low_delay = std::atoi(argv[++i]) != 0;
+    } else if (key == "--decode-keyframes-only" && i + 1 < argc) {
+      args.decode_keyframes_only = std::atoi(argv[++i]) != 0;
+    } else if (key == "--decode-keyframe-interval" && i + 1 < argc) {
+      args.decode_keyframe_interval_ms = std::max(0, std::atoi(argv[++i]));
+    } else if (key == "--streams" && i + 1 < argc) {
+      args.streams_file = argv[++i];
+    } else if (key == "--ingest" && i + 1 < argc) {
+      args.ingest = argv[++i];
+    } else if (key == "--reactor-threads" && i + 1 < argc) {
+      args.reactor_threads = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--decode-pool-threads" && i + 1 < argc) {
+      args.decode_pool_threads = static_cast<size_t>(std::max(0, std::atoi(argv[++i])));
+    } else if (key == "--decode-pool-cpus" && i + 1 < argc) {
+      args.decode_pool_cpus = argv[++i];
+    } else if (key == "--decode-pool-numa-node" && i + 1 < argc) {
+      args.decode_pool_numa_node = std::max(-1, std::atoi(argv[++i]));
+    } else if (key == "--jitter-depth" && i + 1 < argc) {
+      args.jitter_depth = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--jitter-delay-ms" && i + 1 < argc) {
+      args.jitter_delay_ms = std::max(0, std::atoi(argv[++i]));
+    } else if (key == "--udp-batch" && i + 1 < argc) {
+      args.udp_batch = static_cast<size_t>(std::max(1, std::atoi(argv[++i])));
+    } else if (key == "--udp-buffer" && i + 1 < argc) {
+      args.udp_buffer = std::max(0, std::atoi(argv[++i]));
+    } else if (key == "--reconnect" && i + 1 < argc) {
+      args.reconnect = std::atoi(argv[++i]) != 0;
+    } else if (key == "--read-timeout-ms" && i + 1 < argc) {
+      args.read_timeout_ms = std::max(0, std::atoi(argv[++i]));
+    } else if (key == "--metrics-port" && i + 1 < argc) {
+      args.metrics_port = std::max(0, std::atoi(argv[++i]));
+    } else if (key == "--metrics-address" && i + 1 < argc) {
+      args.metrics_address = argv[++i];
+    } else if (key == "--log-rate-limit" && i + 1 < argc) {
+      args.log_rate_limit = static_cast<uint32_t>(std::max(0, std::atoi(argv[++i])));
     } else if (key == "--help") {
-      LOG_INFO("Usage: --rtp-url <url|sdp> --out <dir> --write-images 1|0 --write-video 1|0 --fps <fps> --mp4 <path>");
+      LOG_INFO("Usage: --rtp-url <url|sdp> --out <dir> --write-images 1|0 --write-video 1|0 --fps <fps> --mp4 <path>"
+               " --image-format png|jpeg|webp|bgr|yuv --image-quality <q> --png-compression <n>"
+               " --image-output files|spool --spool-segment-mb <n>"
+               " --file-output sync|threads|uring|auto --file-output-depth <n> --file-output-threads <n>"
+               " --file-fsync 1|0 --sinks images,video,shm --sink-option <sink>.<key>=<value>"
+               " --shm-publish <name> --shm-slots <n> --shm-format bgr|native"
+               " --record auto|copy|transcode|opencv --record-encoder <name> --record-bitrate <bps>"
+               " --frame-keyframes-only 1|0 --frame-every <n> --frame-max-fps <fps> --frame-scene-threshold <t>"
+               " --queue-size <n> --queue-policy drop-oldest|drop-newest|block --writer-threads <n>"
+               " --encode-threads <n> --ordered-writes 1|0"
+               " --convert-threads <n> --sws-flags fast-bilinear|bilinear|bicubic|point|area"
+               " --resize <WxH> --crop <x,y,w,h>"
+               " --decode-threads <n> --decode-thread-type auto|frame|slice --low-delay 1|0"
+               " --decode-keyframes-only 1|0 --decode-keyframe-interval <ms>"
+               " --streams <file> --ingest avformat|native|reactor --reactor-threads <n> --decode-pool-threads <n>"
+               " --decode-pool-cpus <list> --decode-pool-numa-node <n>"
+               " --jitter-depth <packets> --jitter-delay-ms <ms>"
+               " --udp-batch <n> --udp-buffer <bytes> --reconnect 1|0 --read-timeout-ms <ms> --metrics-port <port> --metrics-address <ip>"
+               " --log-rate-limit <n>");
     } else {
       LOG_WARN("Unknown arg: " + key);
     }
@@ -1,6 +1,11 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <vector>
+
+#include "util/BoundedQueue.h"
 
 namespace util {
 
@@ -34,19 +39,254 @@ struct Args {
   // Useful for frame-by-frame analysis or machine learning datasets.
   bool write_images = true;
 
-  // If true, encodes frames into a video file.
-  // Tries MP4 first (H.264), falls back to AVI (MJPG) if MP4 encoding unavailable.
+  // Image file format: png|jpeg|webp|bgr|yuv (see media::ImageEncoder).
+  // bgr and yuv are headerless raw dumps: no encode cost, but 3 (bgr) or
+  // 1.5 (yuv) bytes per pixel on disk.
+  std::string image_format = "png";
+
+  // JPEG/WebP quality 1-100 (WebP 101 = lossless).
+  int image_quality = 90;
+
+  // PNG compression level 0-9; -1 keeps OpenCV's default. Levels above 3
+  // cost much more CPU for a few percent smaller files.
+  int png_compression = -1;
+
+  // Where images go: files|spool.
+  //   files - one file per frame in "<output_dir>/frames/"
+  //   spool - appended to preallocated segment files with an index in
+  //           "<output_dir>/spool/" (media::FrameSpool); read them back
+  //           with the capture_spool tool
+  std::string image_output = "files";
+
+  // Size of each spool segment in MiB.
+  int spool_segment_mb = 1024;
+
+  // How image files are written: sync|threads|uring|auto (see
+  // util::FileOutput).
+  //   sync    - open/write/close on the encoding thread
+  //   threads - handed to file_output_threads I/O threads
+  //   uring   - one linked open/write/close io_uring submission per file,
+  //             from fixed buffers; falls back to threads if unsupported
+  //   auto    - uring if available, else threads
+  std::string file_output = "sync";
+
+  // Image files in flight at once with threads/uring; encoders wait when
+  // this many are pending.
+  size_t file_output_depth = 64;
+
+  // I/O threads of the threads backend.
+  size_t file_output_threads = 2;
+
+  // fsync() each image file before closing it.
+  bool file_fsync = false;
+
+  // Frame sinks of every stream, comma-separated (see app::SinkRegistry):
+  //   images - image files or spool
+  //   video  - video recording (--record)
+  //   shm    - shared-memory ring (--shm-*)
+  // Empty derives the list from --write-images, --write-video and
+  // --shm-publish; when set, it overrides those three.
+  std::string sinks;
+
+  // Per-sink executor settings "<sink>.<key>=<value>" (repeatable):
+  //   queue   - frames queued ahead of the sink (default --queue-size)
+  //   policy  - drop-oldest|drop-newest|block (default --queue-policy)
+  //   threads - threads running the sink, 0 = inline on the receiver
+  //             thread (defaults: images --writer-threads, video 1, shm 0)
+  std::vector<std::string> sink_options;
+
+  // Publish decoded frames to the POSIX shared-memory ring
+  // "/dev/shm/<name>" for local consumers (media::ShmPublisher; read with
+  // media::ShmFrameClient or the capture_shm_tail tool). Empty disables
+  // it. With --streams each stream publishes to "<name>-<stream>".
+  std::string shm_publish;
+
+  // Frames kept in the shared-memory ring (consumer slack).
+  size_t shm_slots = 4;
+
+  // Pixels published: bgr (packed bgr24) or native (the decoder's planes,
+  // typically yuv420p: half the bytes and no BGR conversion).
+  std::string shm_format = "bgr";
+
+  // If true, records the stream into a video file (see record_mode).
   bool write_video = true;
 
   // Path to the output video file.
   // Can be absolute or relative to the working directory.
   // If relative, parent directories are created automatically.
+  // The extension picks the container: .mp4, .webm, .mkv, ...
   std::string mp4_path = "out/capture.mp4";
 
+  // How the video file is produced: auto|copy|transcode|opencv.
+  //   auto      - stream copy (no decode or encode) if the container can
+  //               hold the incoming codec, else transcode (e.g. VP8 → .mp4)
+  //   copy      - always stream copy; fails on an incompatible container
+  //   transcode - always re-encode with record_encoder
+  //   opencv    - legacy cv::VideoWriter from BGR frames (mp4v/MJPG)
+  std::string record_mode = "auto";
+
+  // libavcodec encoder for transcoding ("libx264", "libvpx", "mpeg4", ...);
+  // empty uses the container's default.
+  std::string record_encoder;
+
+  // Transcoding bit rate in bits/s; 0 keeps the encoder default.
+  int64_t record_bitrate = 0;
+
   // Frame rate for video output (frames per second).
   // This affects video file encoding, not the actual capture rate
   // (capture rate is determined by incoming RTP stream).
   double fps = 30.0;
+
+  // Frame gate in front of the image writer (see media::FrameGate); the
+  // defaults write every decoded frame.
+  //   frame_keyframes_only  - only keyframes become images
+  //   frame_every           - keep one frame in N
+  //   frame_max_fps         - at most this many images per second (PTS based)
+  //   frame_scene_threshold - skip frames whose downsampled luma differs from
+  //                           the last written one by less than this mean
+  //                           absolute value (0-255); 0 disables
+  bool frame_keyframes_only = false;
+  uint32_t frame_every = 1;
+  double frame_max_fps = 0.0;
+  double frame_scene_threshold = 0.0;
+
+  // Capacity of each sink's frame queue between the RTP receiver thread
+  // and the sink's threads (see sink_options). Larger values absorb longer
+  // disk stalls at the cost of memory (one BGR frame per slot, ~6 MB at
+  // 1080p).
+  size_t queue_size = 64;
+
+  // What to do when a sink's frame queue is full.
+  //   drop-oldest - evict the oldest queued frame (default, keeps latest data)
+  //   drop-newest - discard the incoming frame
+  //   block       - stall the receiver until the sink catches up (lossless
+  //                 for that sink, but every other sink of the stream waits
+  //                 and the UDP socket may overflow instead)
+  OverflowPolicy queue_policy = OverflowPolicy::kDropOldest;
+
+  // Threads of the images sink popping frames from its queue and writing
+  // them. With more than one thread, frames are numbered in dequeue order.
+  size_t writer_threads = 1;
+
+  // Threads encoding PNG frames inside FrameWriter.
+  // 0 encodes on the writer thread. At 1080p30 PNG encoding needs more
+  // than one core, so set this to the number of cores available for output.
+  size_t encode_threads = 0;
+
+  // With encode_threads > 0: write frame files strictly in frame order (1),
+  // or as soon as each is encoded with a frames/manifest.txt record (0).
+  bool ordered_writes = true;
+
+  // Threads converting each decoded frame to BGR (horizontal slices).
+  // 1 converts on the receiver thread; more cuts per-frame conversion
+  // latency at 1080p/4K. See bench_convert for measurements.
+  size_t convert_threads = 1;
+
+  // swscale interpolation for BGR conversion:
+  // fast-bilinear|bilinear|bicubic|point|area. Without resizing this
+  // only affects chroma upsampling; fast-bilinear and point are cheapest.
+  // With --resize, area gives the cleanest large downscales.
+  std::string sws_flags = "bilinear";
+
+  // BGR output size "WxH", e.g. "640x360"; "640x0" keeps the aspect ratio.
+  // Empty keeps the decoded (or cropped) size. Scaling happens in the
+  // same sws_scale pass as colour conversion.
+  std::string resize;
+
+  // Region of the decoded frame converted to BGR, "x,y,w,h" in source
+  // pixels, applied before --resize. Empty converts the whole frame.
+  std::string crop;
+
+  // Decoder threads (AVCodecContext::thread_count). 0 = one per core,
+  // 1 = single-threaded (libavcodec default).
+  int decode_threads = 1;
+
+  // Decoder threading model: auto|frame|slice.
+  //   frame - highest throughput, adds (decode_threads - 1) frames of delay
+  //   slice - no added delay, only effective on multi-slice streams
+  std::string decode_thread_type = "auto";
+
+  // Low-delay decoding: sets AV_CODEC_FLAG_LOW_DELAY and disables frame
+  // threading so each packet yields its frame immediately.
+  bool low_delay = false;
+
+  // Decode keyframes only (inter frames are skipped before the decoder,
+  // from the VP8 frame tag or H.264 NAL type), for thumbnails at a fraction
+  // of the decode CPU. Images are then only written for keyframes.
+  bool decode_keyframes_only = false;
+
+  // With decode_keyframes_only: at most one keyframe decoded per this many
+  // milliseconds of stream time; 0 decodes every keyframe.
+  int decode_keyframe_interval_ms = 0;
+
+  // Optional stream list for multi-participant capture (see
+  // app::LoadStreamConfig for the format). When set, --rtp-url and --mp4
+  // are ignored; each stream writes to its own directory (default
+  // "<output_dir>/<name>") and all streams share the --encode-threads pool.
+  std::string streams_file;
+
+  // Packet source: avformat|native|reactor.
+  //   avformat - libavformat RTP demuxer (probes the stream first, which
+  //              can take seconds before the first frame)
+  //   native   - own UDP socket + jitter buffer + VP8/H.264 depacketizer;
+  //              codec and port come from the SDP, first frame at the
+  //              first keyframe
+  //   reactor  - native, but all streams share reactor_threads epoll I/O
+  //              threads and a decode pool of decode_pool_threads,
+  //              instead of a receiver thread each
+  std::string ingest = "avformat";
+
+  // Reactor ingest: epoll I/O threads shared by all streams.
+  size_t reactor_threads = 2;
+
+  // Reactor ingest: decode workers shared by all streams; 0 = one per
+  // core (or per CPU of decode_pool_cpus / decode_pool_numa_node).
+  size_t decode_pool_threads = 0;
+
+  // Reactor ingest: CPUs to pin decode workers to, e.g. "0-7,16-23";
+  // empty leaves placement to the kernel.
+  std::string decode_pool_cpus;
+
+  // Reactor ingest: pin decode workers to this NUMA node's CPUs (the one
+  // the NIC is attached to keeps packet buffers node-local); -1 = any.
+  int decode_pool_numa_node = -1;
+
+  // Native ingest: packets held behind a missing one before it is
+  // declared lost.
+  size_t jitter_depth = 64;
+
+  // Native ingest: how long a missing packet may hold back later ones.
+  // This is the latency added on loss or reordering.
+  int jitter_delay_ms = 40;
+
+  // Native ingest: datagrams read per recvmmsg() system call.
+  size_t udp_batch = 32;
+
+  // UDP receive buffer (SO_RCVBUF) in bytes for both ingest modes; 0 keeps
+  // the kernel default. Above net.core.rmem_max this needs CAP_NET_ADMIN
+  // (SO_RCVBUFFORCE) or a raised sysctl; a warning says what was granted.
+  int udp_buffer = 8 * 1024 * 1024;
+
+  // Reopen the stream after a stall or error, reusing the open decoder
+  // (see ingest::ReconnectOptions); 0 ends the stream's receiver instead.
+  bool reconnect = true;
+
+  // Milliseconds without data before a stream counts as stalled; 0 waits
+  // forever.
+  int read_timeout_ms = 5000;
+
+  // TCP port serving Prometheus metrics on /metrics; 0 disables the
+  // endpoint (metrics are still recorded, at a few atomics per stage).
+  int metrics_port = 0;
+
+  // Address the metrics endpoint binds to. Loopback by default; use
+  // 0.0.0.0 to let a Prometheus server on another host scrape it.
+  std::string metrics_address = "127.0.0.1";
+
+  // Lines per second each LOG_WARN/LOG_ERROR call site may write before
+  // further lines are counted and summarized ("N similar suppressed");
+  // 0 logs everything. Keeps packet-loss storms from flooding the log.
+  uint32_t log_rate_limit = 20;
 };
 
 // Parse command-line arguments into an Args struct.
@@ -56,8 +296,58 @@ struct Args {
 //   --out, --output <dir>  Output directory (sets mp4_path to <dir>/capture.mp4)
 //   --write-images 1|0     Enable/disable PNG frame output
 //   --write-video 1|0      Enable/disable video output
+//   --image-format <f>     png|jpeg|webp|bgr|yuv image files
+//   --image-quality <q>    JPEG/WebP quality (1-100)
+//   --png-compression <n>  PNG compression level (0-9, -1 = OpenCV default)
+//   --image-output <o>     files|spool image destination
+//   --spool-segment-mb <n> Spool segment size in MiB
+//   --file-output <b>      sync|threads|uring|auto image file writes
+//   --file-output-depth <n>  Image files in flight (threads/uring)
+//   --file-output-threads <n>  I/O threads of the threads backend
+//   --file-fsync 1|0       fsync() each image file
+//   --sinks <list>         images,video,shm frame sinks per stream
+//   --sink-option <s>.<k>=<v>  Sink queue|policy|threads (repeatable)
+//   --shm-publish <name>   Publish frames to shared memory /dev/shm/<name>
+//   --shm-slots <n>        Frames kept in the shared-memory ring
+//   --shm-format <f>       bgr|native pixels in shared memory
 //   --fps <fps>            Video frame rate
-//   --mp4 <path>           Override MP4 output path (enables video)
+//   --mp4 <path>           Override video output path (enables video)
+//   --record <mode>        auto|copy|transcode|opencv video recording
+//   --record-encoder <name> libavcodec encoder used when transcoding
+//   --record-bitrate <bps> Transcoding bit rate (0 = encoder default)
+//   --frame-keyframes-only 1|0  Write only keyframes as images
+//   --frame-every <n>      Write every Nth frame as an image
+//   --frame-max-fps <fps>  Cap on images written per second (0 = off)
+//   --frame-scene-threshold <t>  Skip images without a scene change (0 = off)
+//   --queue-size <n>       Frame queue capacity of each sink
+//   --queue-policy <p>     drop-oldest|drop-newest|block
+//   --writer-threads <n>   Threads of the images sink
+//   --encode-threads <n>   PNG encoder threads inside FrameWriter (0 = inline)
+//   --ordered-writes 1|0   Write frames in order, or out of order + manifest
+//   --convert-threads <n>  Parallel slices for BGR conversion
+//   --sws-flags <algo>     fast-bilinear|bilinear|bicubic|point|area
+//   --resize <WxH>         BGR output size (one side 0 = keep aspect)
+//   --crop <x,y,w,h>       BGR region of the decoded frame
+//   --decode-threads <n>   Decoder threads (0 = auto)
+//   --decode-thread-type <t>  auto|frame|slice
+//   --low-delay 1|0        Low-delay decoding (no frame threading)
+//   --decode-keyframes-only 1|0  Decode keyframes only
+//   --decode-keyframe-interval <ms>  Minimum stream time between decoded keyframes
+//   --streams <file>       Capture every stream listed in <file>
+//   --ingest <mode>        avformat|native|reactor packet source
+//   --reactor-threads <n>  Reactor ingest I/O threads
+//   --decode-pool-threads <n>  Reactor ingest decode workers (0 = one per core)
+//   --decode-pool-cpus <list>  Pin decode workers to these CPUs ("0-7,16")
+//   --decode-pool-numa-node <n>  Pin decode workers to a NUMA node (-1 = any)
+//   --jitter-depth <n>     Native ingest reorder window in packets
+//   --jitter-delay-ms <ms> Native ingest wait for a missing packet
+//   --udp-batch <n>        Native ingest datagrams per recvmmsg() call (1-1024)
+//   --udp-buffer <bytes>   UDP socket receive buffer (0 = kernel default)
+//   --reconnect 1|0        Reconnect after a stall or stream error
+//   --read-timeout-ms <ms> Silence before a stream counts as stalled (0 = never)
+//   --metrics-port <port>  Serve Prometheus metrics on /metrics (0 = off)
+//   --metrics-address <ip> Bind address of the metrics endpoint
+//   --log-rate-limit <n>   Lines per second per warning/error call site (0 = off)
 //   --help                 Show usage message
 //
 // Args parsing uses a simple loop, not a library like getopt, to avoid
@@ -0,0 +1,39 @@
+#include "util/BoundedQueue.h"
+
+namespace util {
+
+// Parse an overflow policy name as accepted by --queue-policy.
+//
+// Param: name - "drop-oldest", "drop-newest" or "block"
+// Param: policy - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseOverflowPolicy(const std::string& name, OverflowPolicy* policy) {
+  if (name == "drop-oldest") {
+    *policy = OverflowPolicy::kDropOldest;
+  } else if (name == "drop-newest") {
+    *policy = OverflowPolicy::kDropNewest;
+  } else if (name == "block") {
+    *policy = OverflowPolicy::kBlock;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+// Convert OverflowPolicy enum to its command-line name.
+//
+// Param: policy - Policy to convert
+// Returns: "drop-oldest", "drop-newest", "block", or "unknown"
+std::string ToString(OverflowPolicy policy) {
+  switch (policy) {
+    case OverflowPolicy::kDropOldest:
+      return "drop-oldest";
+    case OverflowPolicy::kDropNewest:
+      return "drop-newest";
+    case OverflowPolicy::kBlock:
+      return "block";
+  }
+  return "unknown";
+}
+
+}  // namespace util
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace util {
+
+// What a BoundedQueue does when Push() finds the ring full.
+enum class OverflowPolicy {
+  kDropOldest,  // Evict the oldest queued item to make room (freshest data wins)
+  kDropNewest,  // Discard the item being pushed (queued data wins)
+  kBlock,       // Wait until a consumer makes room (lossless, may stall producer)
+};
+
+// Parse an overflow policy name ("drop-oldest", "drop-newest", "block").
+//
+// Param: name - Policy name as given on the command line
+// Param: policy - Receives the parsed policy on success
+// Returns: true if the name was recognized, false otherwise (policy untouched)
+bool ParseOverflowPolicy(const std::string& name, OverflowPolicy* policy);
+
+// Convert an OverflowPolicy to its command-line name.
+std::string ToString(OverflowPolicy policy);
+
+// Snapshot of queue counters, see BoundedQueue::GetStats().
+struct QueueStats {
+  uint64_t pushed = 0;        // Items accepted into the ring
+  uint64_t popped = 0;        // Items handed to consumers
+  uint64_t dropped_oldest = 0;  // Items evicted by kDropOldest
+  uint64_t dropped_newest = 0;  // Items rejected by kDropNewest (or after Close())
+  size_t depth = 0;           // Items currently queued
+  size_t high_water = 0;      // Maximum depth observed
+};
+
+// Bounded ring buffer handing items from producer threads to consumer threads.
+//
+// This is the decoupling point between the RTP decode thread and the
+// threads that write frames to disk: the decode thread pushes, one or more
+// writer threads pop. With kDropOldest/kDropNewest the producer never waits
+// on consumers, so a stalled disk turns into counted drops instead of lost
+// UDP packets.
+//
+// Why a mutex and not a lock-free SPSC ring?
+//   - kDropOldest needs the producer to evict from the consumer end
+//   - Multiple writer threads may pop concurrently
+//   - Critical sections are a few pointer moves; the expensive work
+//     (encoding, I/O) happens outside the lock
+//
+// Storage is preallocated at construction; Push()/Pop() move items in and
+// out of fixed slots and never allocate.
+//
+// Lifecycle:
+//   1. Producers call Push(), consumers call Pop() (blocking)
+//   2. Close() wakes everyone; Pop() keeps returning queued items until
+//      the ring is empty, then returns false
+//
+// Thread-safe: all methods may be called from any thread.
+template <typename T>
+class BoundedQueue {
+ public:
+  // Param: capacity - Maximum number of queued items (clamped to >= 1)
+  // Param: policy - Behaviour when Push() finds the ring full
+  BoundedQueue(size_t capacity, OverflowPolicy policy)
+      : slots_(capacity > 0 ? capacity : 1), policy_(policy) {}
+
+  BoundedQueue(const BoundedQueue&) = delete;
+  BoundedQueue& operator=(const BoundedQueue&) = delete;
+
+  // Enqueue an item, applying the overflow policy if the ring is full.
+  //
+  // Returns: true if the item was queued, false if it was dropped
+  //          (kDropNewest on a full ring, or the queue is closed)
+  // Side effects: with kBlock, waits until space is available or Close()
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (count_ == slots_.size() && !closed_) {
+      switch (policy_) {
+        case OverflowPolicy::kDropOldest:
+          slots_[head_] = T();
+          head_ = (head_ + 1) % slots_.size();
+          --count_;
+          ++stats_.dropped_oldest;
+          break;
+        case OverflowPolicy::kDropNewest:
+          ++stats_.dropped_newest;
+          return false;
+        case OverflowPolicy::kBlock:
+          not_full_.wait(lock, [this] { return count_ < slots_.size() || closed_; });
+          break;
+      }
+    }
+    if (closed_) {
+      ++stats_.dropped_newest;
+      return false;
+    }
+    slots_[(head_ + count_) % slots_.size()] = std::move(item);
+    ++count_;
+    ++stats_.pushed;
+    if (count_ > stats_.high_water) {
+      stats_.high_water = count_;
+    }
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  }
+
+  // Dequeue the oldest item, waiting until one is available.
+  //
+  // Param: out - Receives the dequeued item
+  // Returns: true if an item was dequeued, false if the queue is closed and empty
+  bool Pop(T& out) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this] { return count_ > 0 || closed_; });
+    if (count_ == 0) {
+      return false;
+    }
+    out = std::move(slots_[head_]);
+    slots_[head_] = T();
+    head_ = (head_ + 1) % slots_.size();
+    --count_;
+    ++stats_.popped;
+    lock.unlock();
+    not_full_.notify_one();
+    return true;
+  }
+
+  // Stop accepting items and wake all waiting producers and consumers.
+  // Items already queued remain available to Pop().
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_empty_.notify_all();
+    not_full_.notify_all();
+  }
+
+  // Return a consistent snapshot of the queue counters.
+  QueueStats GetStats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    QueueStats stats = stats_;
+    stats.depth = count_;
+    return stats;
+  }
+
+  size_t capacity() const { return slots_.size(); }
+  OverflowPolicy policy() const { return policy_; }
+
+ private:
+  mutable std::mutex mutex_;
+  std::condition_variable not_empty_;  // Signalled on Push() and Close()
+  std::condition_variable not_full_;   // Signalled on Pop() and Close()
+
+  std::vector<T> slots_;     // Fixed ring storage
+  size_t head_ = 0;          // Index of the oldest item
+  size_t count_ = 0;         // Number of queued items
+  bool closed_ = false;      // Set by Close()
+  OverflowPolicy policy_;
+  QueueStats stats_;
+};
+
+}  // namespace util
@@ -0,0 +1,498 @@
+#include "util/FileOutput.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <utility>
+
+#include "util/Log.h"
+
+namespace util {
+namespace {
+
+// user_data of a chain request: (direct descriptor slot << 2) | step
+enum ChainStep : uint64_t { kOpen = 0, kWrite = 1, kFsync = 2, kClose = 3 };
+constexpr uint64_t kStopUserData = ~0ull;
+
+const char* StepName(uint64_t step) {
+  switch (step) {
+    case kOpen:
+      return "open";
+    case kWrite:
+      return "write";
+    case kFsync:
+      return "fsync";
+    default:
+      return "close";
+  }
+}
+
+constexpr int kOpenFlags = O_WRONLY | O_CREAT | O_TRUNC;
+
+// Fill an OPENAT of path into direct descriptor slot. Direct descriptors
+// never enter the process fd table, and the kernel rejects O_CLOEXEC
+// for them.
+void PrepOpen(io_uring_sqe* sqe, const char* path, unsigned slot) {
+  sqe->opcode = IORING_OP_OPENAT;
+  sqe->fd = AT_FDCWD;
+  sqe->addr = reinterpret_cast<uint64_t>(path);
+  sqe->len = 0644;
+  sqe->open_flags = kOpenFlags;
+  sqe->file_index = slot + 1;
+  sqe->user_data = (static_cast<uint64_t>(slot) << 2) | kOpen;
+}
+
+// Fill a WRITE (fixed_buffer < 0) or WRITE_FIXED at offset 0 to slot.
+void PrepWrite(io_uring_sqe* sqe, unsigned slot, const uint8_t* data, size_t size, int fixed_buffer) {
+  sqe->opcode = fixed_buffer >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->fd = static_cast<int>(slot);
+  sqe->addr = reinterpret_cast<uint64_t>(data);
+  sqe->len = static_cast<uint32_t>(size);
+  sqe->off = 0;
+  sqe->buf_index = static_cast<uint16_t>(std::max(fixed_buffer, 0));
+  sqe->user_data = (static_cast<uint64_t>(slot) << 2) | kWrite;
+}
+
+void PrepFsync(io_uring_sqe* sqe, unsigned slot) {
+  sqe->opcode = IORING_OP_FSYNC;
+  sqe->flags = IOSQE_FIXED_FILE;
+  sqe->fd = static_cast<int>(slot);
+  sqe->user_data = (static_cast<uint64_t>(slot) << 2) | kFsync;
+}
+
+// CLOSE of a direct descriptor: fd must be 0, the slot goes in file_index.
+void PrepClose(io_uring_sqe* sqe, unsigned slot) {
+  sqe->opcode = IORING_OP_CLOSE;
+  sqe->fd = 0;
+  sqe->file_index = slot + 1;
+  sqe->user_data = (static_cast<uint64_t>(slot) << 2) | kClose;
+}
+
+}  // namespace
+
+// Parse a --file-output value.
+//
+// Param: name - "sync", "threads", "uring" or "auto"
+// Param: backend - Receives the parsed value on success
+// Returns: true if recognized, false otherwise
+bool ParseFileBackend(const std::string& name, FileBackend* backend) {
+  if (name == "sync") {
+    *backend = FileBackend::kSync;
+  } else if (name == "threads") {
+    *backend = FileBackend::kThreads;
+  } else if (name == "uring") {
+    *backend = FileBackend::kUring;
+  } else if (name == "auto") {
+    *backend = FileBackend::kAuto;
+  } else {
+    return false;
+  }
+  return true;
+}
+
+const char* FileBackendName(FileBackend backend) {
+  switch (backend) {
+    case FileBackend::kSync:
+      return "sync";
+    case FileBackend::kThreads:
+      return "threads";
+    case FileBackend::kUring:
+      return "uring";
+    case FileBackend::kAuto:
+      return "auto";
+  }
+  return "sync";
+}
+
+// Resolve the backend (uring falls back to threads) and start its threads.
+FileOutput::FileOutput(FileOutputOptions options) : options_(std::move(options)), backend_(options_.backend) {
+  options_.queue_depth = std::clamp<size_t>(options_.queue_depth, 1, 1024);
+  options_.threads = std::max<size_t>(options_.threads, 1);
+  in_flight_gauge_ = Metrics::Instance().GetGauge("capture_file_output_in_flight",
+                                                  "Image files submitted but not yet complete",
+                                                  MetricLabel("stream", options_.name));
+
+  if (backend_ == FileBackend::kUring || backend_ == FileBackend::kAuto) {
+    std::string error;
+    if (InitUring(&error)) {
+      backend_ = FileBackend::kUring;
+      reaper_ = std::thread([this]() { ReapLoop(); });
+      LOG_INFO("File output: io_uring, depth " + std::to_string(options_.queue_depth) +
+               (fixed_buffers_ ? ", fixed buffers" : ""));
+    } else {
+      const std::string message = "File output: io_uring unavailable (" + error + "), using I/O threads";
+      if (backend_ == FileBackend::kUring) {
+        LOG_WARN(message);
+      } else {
+        LOG_INFO(message);
+      }
+      ring_.reset();
+      backend_ = FileBackend::kThreads;
+    }
+  }
+  if (backend_ == FileBackend::kThreads) {
+    for (size_t i = 0; i < options_.threads; ++i) {
+      workers_.emplace_back([this]() { WorkerLoop(); });
+    }
+  }
+}
+
+// Drain, then stop the worker or reaper threads.
+FileOutput::~FileOutput() {
+  Flush();
+  {
+    std::lock_guard<std::mutex> lock(queue_mutex_);
+    stopping_ = true;
+  }
+  queue_cv_.notify_all();
+  for (std::thread& worker : workers_) {
+    worker.join();
+  }
+  if (reaper_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(ring_mutex_);
+      io_uring_sqe* sqe = ring_->GetSqe();
+      if (sqe) {
+        sqe->opcode = IORING_OP_NOP;
+        sqe->user_data = kStopUserData;
+        ring_->Submit();
+      }
+    }
+    reaper_.join();
+  }
+}
+
+// Create the ring with room for queue_depth chains, register the direct
+// descriptor and fixed buffer tables, then probe both with a write to
+// /dev/null. The probe runs before the reaper starts, so completions are
+// read here directly.
+//
+// Param: error - Receives the reason if the backend cannot be used
+// Returns: true if the uring backend is ready
+bool FileOutput::InitUring(std::string* error) {
+  const unsigned depth = static_cast<unsigned>(options_.queue_depth);
+  ring_ = std::make_unique<IoUring>();
+  if (!ring_->Init(depth * 4, error)) {
+    return false;
+  }
+  int ret = ring_->RegisterFileSlots(depth);
+  if (ret < 0) {
+    *error = std::string("register files: ") + std::strerror(-ret);
+    return false;
+  }
+  chains_.resize(depth);
+  for (unsigned slot = depth; slot > 0; --slot) {
+    free_slots_.push_back(slot - 1);
+  }
+
+  // Twice the depth: every in-flight file holds one, and pooled buffers
+  // keep theirs until they are handed out again
+  registrations_.resize(depth * 2);
+  fixed_buffers_ = ring_->RegisterBufferSlots(static_cast<unsigned>(registrations_.size())) == 0;
+
+  // Registration pins pages for writing, so the byte must not be const
+  static uint8_t probe_byte = 0;
+  auto probe = [this](bool fixed) {
+    if (fixed && ring_->UpdateBuffer(0, iovec{&probe_byte, 1}) < 0) {
+      return false;
+    }
+    io_uring_sqe* sqe = ring_->GetSqe();
+    PrepOpen(sqe, "/dev/null", 0);
+    sqe->flags |= IOSQE_IO_HARDLINK;
+    sqe = ring_->GetSqe();
+    PrepWrite(sqe, 0, &probe_byte, 1, fixed ? 0 : -1);
+    sqe->flags |= IOSQE_IO_HARDLINK;
+    PrepClose(ring_->GetSqe(), 0);
+    if (ring_->Submit() != 3) {
+      return false;
+    }
+    bool ok = true;
+    for (int i = 0; i < 3; ++i) {
+      io_uring_cqe cqe{};
+      if (ring_->WaitCqe(&cqe) < 0) {
+        return false;
+      }
+      ok = ok && cqe.res == ((cqe.user_data & 3) == kWrite ? 1 : 0);
+    }
+    return ok;
+  };
+  if (fixed_buffers_ && !probe(true)) {
+    fixed_buffers_ = false;
+  }
+  if (!fixed_buffers_ && !probe(false)) {
+    *error = "direct descriptors not supported";
+    return false;
+  }
+  registrations_[0] = Registration{fixed_buffers_ ? &probe_byte : nullptr, fixed_buffers_ ? 1u : 0u, false};
+  return true;
+}
+
+// Take a buffer from the pool, or a new empty one. The caller may
+// reallocate it, so its fixed buffer registration ends here.
+std::vector<uint8_t> FileOutput::AcquireBuffer() {
+  std::vector<uint8_t> buffer;
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (pool_.empty()) {
+      return buffer;
+    }
+    buffer = std::move(pool_.back());
+    pool_.pop_back();
+  }
+  ForgetBuffer(buffer.data());
+  return buffer;
+}
+
+// Hand one file to the backend (see class comment).
+void FileOutput::Write(std::string path, std::vector<uint8_t> bytes, Done done) {
+  {
+    std::unique_lock<std::mutex> lock(flight_mutex_);
+    flight_cv_.wait(lock, [this] { return in_flight_ < options_.queue_depth; });
+    in_flight_gauge_->Set(static_cast<int64_t>(++in_flight_));
+  }
+  Request request{std::move(path), std::move(bytes), std::move(done)};
+  switch (backend_) {
+    case FileBackend::kThreads: {
+      {
+        std::lock_guard<std::mutex> lock(queue_mutex_);
+        queue_.push_back(std::move(request));
+      }
+      queue_cv_.notify_one();
+      break;
+    }
+    case FileBackend::kUring:
+      SubmitChain(std::move(request));
+      break;
+    default: {
+      const bool ok = WriteSync(request);
+      Complete(std::move(request), ok);
+      break;
+    }
+  }
+}
+
+void FileOutput::Flush() {
+  std::unique_lock<std::mutex> lock(flight_mutex_);
+  flight_cv_.wait(lock, [this] { return in_flight_ == 0; });
+}
+
+// open/pwrite/fsync/close on the calling thread.
+//
+// Param: request - Path and contents
+// Returns: true if every step succeeded (failures are logged)
+bool FileOutput::WriteSync(const Request& request) const {
+  const int fd = ::open(request.path.c_str(), kOpenFlags | O_CLOEXEC, 0644);
+  if (fd < 0) {
+    LOG_WARN("Failed to open " + request.path + ": " + std::strerror(errno));
+    return false;
+  }
+  const char* failed = nullptr;
+  size_t done = 0;
+  while (done < request.bytes.size()) {
+    const ssize_t n = ::pwrite(fd, request.bytes.data() + done, request.bytes.size() - done,
+                               static_cast<off_t>(done));
+    if (n < 0 && errno == EINTR) {
+      continue;
+    }
+    if (n <= 0) {
+      failed = "write";
+      break;
+    }
+    done += static_cast<size_t>(n);
+  }
+  if (!failed && options_.fsync && ::fsync(fd) != 0) {
+    failed = "fsync";
+  }
+  if (::close(fd) != 0 && !failed) {
+    failed = "close";
+  }
+  if (failed) {
+    LOG_WARN(std::string("Failed to ") + failed + " " + request.path + ": " + std::strerror(errno));
+    return false;
+  }
+  return true;
+}
+
+// Register a payload in a fixed buffer slot (see class comment). Slots
+// whose buffer left FileOutput are empty; otherwise the idle
+// registration of a pooled buffer is replaced.
+//
+// Param: bytes - Payload about to be written
+// Returns: slot index, or -1 for a plain WRITE
+int FileOutput::FixedBuffer(const std::vector<uint8_t>& bytes) {
+  if (!fixed_buffers_ || bytes.empty()) {
+    return -1;
+  }
+  int slot = -1;
+  for (size_t i = 0; i < registrations_.size(); ++i) {
+    const Registration& registration = registrations_[i];
+    if (registration.busy) {
+      continue;
+    }
+    if (!registration.base) {
+      slot = static_cast<int>(i);
+      break;
+    }
+    if (slot < 0) {
+      slot = static_cast<int>(i);
+    }
+  }
+  if (slot < 0) {
+    return -1;
+  }
+  const int ret = ring_->UpdateBuffer(static_cast<unsigned>(slot),
+                                      iovec{const_cast<uint8_t*>(bytes.data()), bytes.capacity()});
+  if (ret < 0) {
+    fixed_buffers_ = false;
+    LOG_WARN(std::string("File output: io_uring fixed buffers disabled (") + std::strerror(-ret) +
+             "; raise RLIMIT_MEMLOCK to keep them)");
+    return -1;
+  }
+  registrations_[slot] = Registration{bytes.data(), bytes.capacity(), true};
+  return slot;
+}
+
+// Clear the idle slot registered for base and unpin its pages (a sparse
+// slot accepts an empty range). A buffer in the pool is never part of a
+// chain, so its slot is not busy.
+void FileOutput::ForgetBuffer(const uint8_t* base) {
+  if (!fixed_buffers_ || !base) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  for (size_t i = 0; i < registrations_.size(); ++i) {
+    Registration& registration = registrations_[i];
+    if (!registration.busy && registration.base == base) {
+      ring_->UpdateBuffer(static_cast<unsigned>(i), iovec{nullptr, 0});
+      registration = Registration{};
+    }
+  }
+}
+
+// Queue the linked open/write/(fsync)/close chain for one file and
+// submit it with a single io_uring_enter().
+//
+// Param: request - File to write; kept in chains_ until its last completion
+void FileOutput::SubmitChain(Request request) {
+  std::lock_guard<std::mutex> lock(ring_mutex_);
+  // Never empty: Write() admits at most queue_depth files, one slot each
+  const unsigned slot = free_slots_.back();
+  free_slots_.pop_back();
+  Chain& chain = chains_[slot];
+  chain.request = std::move(request);
+  chain.ok = true;
+  chain.fixed_buffer = FixedBuffer(chain.request.bytes);
+  chain.pending = options_.fsync ? 4 : 3;
+
+  // The ring holds 4 entries per slot, so GetSqe() cannot fail here
+  io_uring_sqe* sqe = ring_->GetSqe();
+  PrepOpen(sqe, chain.request.path.c_str(), slot);
+  sqe->flags |= IOSQE_IO_HARDLINK;
+  sqe = ring_->GetSqe();
+  PrepWrite(sqe, slot, chain.request.bytes.data(), chain.request.bytes.size(), chain.fixed_buffer);
+  sqe->flags |= IOSQE_IO_HARDLINK;
+  if (options_.fsync) {
+    sqe = ring_->GetSqe();
+    PrepFsync(sqe, slot);
+    sqe->flags |= IOSQE_IO_HARDLINK;
+  }
+  PrepClose(ring_->GetSqe(), slot);
+
+  int ret = ring_->Submit();
+  while (ret == -EAGAIN || ret == -EBUSY) {
+    // Kernel short of memory or completion queue full: let the reaper catch up
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    ret = ring_->Submit();
+  }
+  if (ret < 0) {
+    // The entries stay queued and go out with the next submission
+    LOG_ERROR(std::string("File output: io_uring submit failed: ") + std::strerror(-ret));
+  }
+}
+
+// Consume completions; a chain is done once all of its requests
+// completed. Only the first failing step of a chain is logged (later
+// steps then fail with EBADF).
+void FileOutput::ReapLoop() {
+  while (true) {
+    io_uring_cqe cqe{};
+    const int ret = ring_->WaitCqe(&cqe);
+    if (ret < 0) {
+      LOG_ERROR(std::string("File output: io_uring wait failed: ") + std::strerror(-ret));
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+    if (cqe.user_data == kStopUserData) {
+      return;
+    }
+    const unsigned slot = static_cast<unsigned>(cqe.user_data >> 2);
+    const uint64_t step = cqe.user_data & 3;
+
+    std::unique_lock<std::mutex> lock(ring_mutex_);
+    Chain& chain = chains_[slot];
+    const bool step_ok = step == kWrite ? cqe.res == static_cast<int>(chain.request.bytes.size()) : cqe.res >= 0;
+    if (!step_ok && chain.ok) {
+      chain.ok = false;
+      LOG_WARN(std::string("Failed to ") + StepName(step) + " " + chain.request.path + ": " +
+               (cqe.res < 0 ? std::strerror(-cqe.res) : "short write"));
+    }
+    if (--chain.pending > 0) {
+      continue;
+    }
+    if (chain.fixed_buffer >= 0) {
+      registrations_[chain.fixed_buffer].busy = false;
+    }
+    Request request = std::move(chain.request);
+    const bool ok = chain.ok;
+    free_slots_.push_back(slot);
+    lock.unlock();
+    Complete(std::move(request), ok);
+  }
+}
+
+void FileOutput::WorkerLoop() {
+  while (true) {
+    Request request;
+    {
+      std::unique_lock<std::mutex> lock(queue_mutex_);
+      queue_cv_.wait(lock, [this] { return stopping_ || !queue_.empty(); });
+      if (queue_.empty()) {
+        return;
+      }
+      request = std::move(queue_.front());
+      queue_.pop_front();
+    }
+    const bool ok = WriteSync(request);
+    Complete(std::move(request), ok);
+  }
+}
+
+// Finish one file: callback first, then the buffer goes back to the pool
+// (capacity kept, at most queue_depth buffers; a buffer that does not fit
+// is unregistered and freed) and the slot is released.
+void FileOutput::Complete(Request request, bool ok) {
+  if (request.done) {
+    request.done(ok);
+  }
+  request.bytes.clear();
+  {
+    std::lock_guard<std::mutex> lock(pool_mutex_);
+    if (pool_.size() < options_.queue_depth) {
+      pool_.push_back(std::move(request.bytes));
+    }
+  }
+  // Not pooled: freed below, so it must not stay registered
+  if (request.bytes.capacity() > 0) {
+    ForgetBuffer(request.bytes.data());
+  }
+  std::lock_guard<std::mutex> lock(flight_mutex_);
+  in_flight_gauge_->Set(static_cast<int64_t>(--in_flight_));
+  flight_cv_.notify_all();
+}
+
+}  // namespace util
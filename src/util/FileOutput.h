@@ -0,0 +1,208 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "util/IoUring.h"
+#include "util/Metrics.h"
+
+namespace util {
+
+// How FileOutput performs the open/write/close of each file.
+enum class FileBackend {
+  kSync,     // On the Write() caller's thread (blocking system calls)
+  kThreads,  // On a pool of I/O threads (open/pwrite/close)
+  kUring,    // Linked open/write/close requests on one io_uring
+  kAuto,     // kUring if the kernel supports it, else kThreads
+};
+
+// Parse a backend name ("sync", "threads", "uring", "auto").
+//
+// Returns: true if recognized (backend set), false otherwise
+bool ParseFileBackend(const std::string& name, FileBackend* backend);
+
+// Returns: the name ParseFileBackend() accepts for backend
+const char* FileBackendName(FileBackend backend);
+
+// Configuration for FileOutput.
+struct FileOutputOptions {
+  FileBackend backend = FileBackend::kSync;
+
+  // Files being written at once (threads and uring); Write() blocks
+  // while this many are in flight
+  size_t queue_depth = 64;
+
+  // I/O threads of the threads backend
+  size_t threads = 2;
+
+  // fsync() each file before closing it (durable, much slower)
+  bool fsync = false;
+
+  // Stream label of the metrics
+  std::string name = "default";
+};
+
+// Writes whole files from memory buffers, synchronously or asynchronously.
+//
+// Buffers are pooled: AcquireBuffer() hands out a vector whose capacity
+// survives from earlier files, the caller fills it (e.g. ImageEncoder)
+// and passes it to Write(), and the buffer returns to the pool when the
+// file is complete. In steady state no buffer is allocated.
+//
+// io_uring backend:
+//   Each Write() becomes one chain of linked requests, submitted with a
+//   single io_uring_enter():
+//     OPENAT (into a registered "direct" descriptor slot, no fd table entry)
+//     WRITE_FIXED / WRITE
+//     FSYNC (with FileOutputOptions::fsync)
+//     CLOSE (of the direct slot)
+//   instead of three or four blocking system calls per file. The links
+//   are hard links, so the close runs even if the write failed. Each
+//   payload is registered as a fixed buffer when it is written, and the
+//   registration is dropped as soon as the buffer leaves FileOutput
+//   (handed out again by AcquireBuffer(), or freed because the pool is
+//   full): the caller may free or reallocate it, and a registration
+//   matched by address alone would then write a later allocation at the
+//   same address from the old pinned pages. When RLIMIT_MEMLOCK does not
+//   allow registering, plain WRITE is used. One reaper
+//   thread consumes completions, runs the done callback and recycles the
+//   buffer. Init probes the kernel with a write to /dev/null and falls
+//   back to the threads backend if direct descriptors (Linux 5.15) are
+//   not supported, or to plain writes without sparse fixed buffers
+//   (5.19).
+//
+// Threads backend: a queue drained by FileOutputOptions::threads workers
+// doing open/pwrite/close, so slow writes never stall the caller.
+//
+// Ordering: completions (and done callbacks) of the threads and uring
+// backends may come in any order; the sync backend calls done before
+// Write() returns.
+//
+// Metrics (util::Metrics, label stream="<name>"):
+//   capture_file_output_in_flight - files submitted but not complete
+//
+// Thread-safe: every public method may be called from any thread.
+class FileOutput {
+ public:
+  // Called once per Write() with the outcome; runs on an I/O thread for
+  // the asynchronous backends and must not call back into this object.
+  using Done = std::function<void(bool ok)>;
+
+  explicit FileOutput(FileOutputOptions options = FileOutputOptions());
+
+  // Waits for pending files (see Flush()) and stops the I/O threads.
+  ~FileOutput();
+
+  FileOutput(const FileOutput&) = delete;
+  FileOutput& operator=(const FileOutput&) = delete;
+
+  // Backend in use (kAuto resolved, after any fallback).
+  FileBackend backend() const { return backend_; }
+
+  // True if the uring backend uses fixed buffers.
+  bool fixed_buffers() const { return fixed_buffers_.load(); }
+
+  // An empty buffer from the pool (capacity kept from earlier use).
+  std::vector<uint8_t> AcquireBuffer();
+
+  // Create or truncate path and write bytes to it.
+  //
+  // Param: path - Destination file (parent directory must exist)
+  // Param: bytes - File contents; ownership moves to the writer
+  // Param: done - Completion callback (may be empty)
+  // Side effects: blocks while queue_depth files are in flight
+  void Write(std::string path, std::vector<uint8_t> bytes, Done done);
+
+  // Block until every file written so far is complete.
+  void Flush();
+
+ private:
+  struct Request {
+    std::string path;
+    std::vector<uint8_t> bytes;
+    Done done;
+  };
+
+  // State of one uring chain, indexed by its direct descriptor slot.
+  struct Chain {
+    Request request;
+    int pending = 0;       // Completions still expected
+    bool ok = true;
+    int fixed_buffer = -1; // Fixed buffer slot in use, -1 for plain WRITE
+  };
+
+  // Memory range registered in one fixed buffer slot.
+  struct Registration {
+    const uint8_t* base = nullptr;
+    size_t bytes = 0;
+    bool busy = false;
+  };
+
+  // Set up the ring, register slots and run the probe write.
+  // Returns: false (with error set) if the uring backend is unusable
+  bool InitUring(std::string* error);
+
+  // Blocking open/write/(fsync)/close; returns false on any failure.
+  bool WriteSync(const Request& request) const;
+
+  // Queue a chain for request (uring backend, caller holds an in-flight slot).
+  void SubmitChain(Request request);
+
+  // Register bytes in a free fixed buffer slot. Called with ring_mutex_
+  // held. Returns: slot index, or -1 to use a plain write
+  int FixedBuffer(const std::vector<uint8_t>& bytes);
+
+  // Drop the registration of a buffer that leaves FileOutput (see class
+  // comment). Takes ring_mutex_; no-op without fixed buffers.
+  void ForgetBuffer(const uint8_t* base);
+
+  // Reaper thread: consume completions until the stop request arrives.
+  void ReapLoop();
+
+  // Threads backend worker loop.
+  void WorkerLoop();
+
+  // Run the callback, recycle the buffer and release the in-flight slot.
+  void Complete(Request request, bool ok);
+
+  FileOutputOptions options_;
+  FileBackend backend_;
+  std::atomic<bool> fixed_buffers_{false};
+  Gauge* in_flight_gauge_;
+
+  // In-flight accounting (all backends)
+  std::mutex flight_mutex_;
+  std::condition_variable flight_cv_;  // Signalled when a file completes
+  size_t in_flight_ = 0;
+
+  // Buffer pool
+  std::mutex pool_mutex_;
+  std::vector<std::vector<uint8_t>> pool_;
+
+  // Threads backend
+  std::mutex queue_mutex_;
+  std::condition_variable queue_cv_;
+  std::deque<Request> queue_;
+  bool stopping_ = false;
+  std::vector<std::thread> workers_;
+
+  // Uring backend; ring_mutex_ serializes the submission side and the
+  // tables below, the reaper thread owns the completion side
+  std::unique_ptr<IoUring> ring_;
+  std::mutex ring_mutex_;
+  std::vector<Chain> chains_;            // One per direct descriptor slot
+  std::vector<unsigned> free_slots_;
+  std::vector<Registration> registrations_;
+  std::thread reaper_;
+};
+
+}  // namespace util
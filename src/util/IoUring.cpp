@@ -0,0 +1,187 @@
+#include "util/IoUring.h"
+
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <vector>
+
+namespace util {
+namespace {
+
+// The kernel reads and writes the ring indices concurrently; these match
+// liburing's io_uring_smp_load_acquire()/io_uring_smp_store_release().
+unsigned LoadAcquire(const unsigned* p) {
+  return __atomic_load_n(p, __ATOMIC_ACQUIRE);
+}
+
+void StoreRelease(unsigned* p, unsigned value) {
+  __atomic_store_n(p, value, __ATOMIC_RELEASE);
+}
+
+int Enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags) {
+  return static_cast<int>(::syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+int Register(int fd, unsigned opcode, const void* arg, unsigned nr_args) {
+  const int ret = static_cast<int>(::syscall(__NR_io_uring_register, fd, opcode, arg, nr_args));
+  return ret < 0 ? -errno : ret;
+}
+
+}  // namespace
+
+IoUring::~IoUring() {
+  if (sqes_) {
+    ::munmap(sqes_, sqes_bytes_);
+  }
+  if (cq_ring_ && cq_ring_ != sq_ring_) {
+    ::munmap(cq_ring_, cq_ring_bytes_);
+  }
+  if (sq_ring_) {
+    ::munmap(sq_ring_, sq_ring_bytes_);
+  }
+  if (fd_ >= 0) {
+    ::close(fd_);
+  }
+}
+
+// Set up the rings and map them (see class comment).
+//
+// Param: entries - Requested submission queue size
+// Param: error - Receives the failing step and errno
+// Returns: true if the instance is ready
+bool IoUring::Init(unsigned entries, std::string* error) {
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  const int fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+  if (fd < 0) {
+    *error = std::string("io_uring_setup: ") + std::strerror(errno);
+    return false;
+  }
+  fd_ = fd;
+
+  sq_ring_bytes_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_bytes_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  const bool single_mmap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+  if (single_mmap) {
+    sq_ring_bytes_ = cq_ring_bytes_ = std::max(sq_ring_bytes_, cq_ring_bytes_);
+  }
+  sq_ring_ = ::mmap(nullptr, sq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                    IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    *error = std::string("io_uring mmap: ") + std::strerror(errno);
+    return false;
+  }
+  if (single_mmap) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = ::mmap(nullptr, cq_ring_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                      IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      *error = std::string("io_uring mmap: ") + std::strerror(errno);
+      return false;
+    }
+  }
+  sqes_bytes_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = ::mmap(nullptr, sqes_bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    *error = std::string("io_uring mmap: ") + std::strerror(errno);
+    return false;
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  uint8_t* sq = static_cast<uint8_t*>(sq_ring_);
+  sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+  sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sq_mask_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sq_entries_ = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+  sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  uint8_t* cq = static_cast<uint8_t*>(cq_ring_);
+  cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cq_mask_ = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  // The index array maps ring slots 1:1 to sqes_, set up once
+  for (unsigned i = 0; i < params.sq_entries; ++i) {
+    sq_array_[i] = i;
+  }
+  sqe_tail_ = *sq_tail_;
+  return true;
+}
+
+io_uring_sqe* IoUring::GetSqe() {
+  const unsigned head = LoadAcquire(sq_head_);
+  if (sqe_tail_ - head >= *sq_entries_) {
+    return nullptr;
+  }
+  io_uring_sqe* sqe = &sqes_[sqe_tail_ & *sq_mask_];
+  ++sqe_tail_;
+  std::memset(sqe, 0, sizeof(*sqe));
+  return sqe;
+}
+
+// Publish the local tail and enter the kernel once for every entry it
+// has not consumed yet (including leftovers of an earlier partial submit).
+int IoUring::Submit() {
+  StoreRelease(sq_tail_, sqe_tail_);
+  const unsigned to_submit = sqe_tail_ - LoadAcquire(sq_head_);
+  if (to_submit == 0) {
+    return 0;
+  }
+  int ret;
+  do {
+    ret = Enter(fd_, to_submit, 0, 0);
+  } while (ret < 0 && errno == EINTR);
+  return ret < 0 ? -errno : ret;
+}
+
+bool IoUring::PeekCqe(io_uring_cqe* cqe) {
+  const unsigned head = *cq_head_;
+  if (head == LoadAcquire(cq_tail_)) {
+    return false;
+  }
+  *cqe = cqes_[head & *cq_mask_];
+  StoreRelease(cq_head_, head + 1);
+  return true;
+}
+
+int IoUring::WaitCqe(io_uring_cqe* cqe) {
+  while (!PeekCqe(cqe)) {
+    if (Enter(fd_, 0, 1, IORING_ENTER_GETEVENTS) < 0 && errno != EINTR) {
+      return -errno;
+    }
+  }
+  return 0;
+}
+
+int IoUring::RegisterFileSlots(unsigned count) {
+  // -1 entries are empty slots, filled by requests with a file_index
+  const std::vector<int> fds(count, -1);
+  return Register(fd_, IORING_REGISTER_FILES, fds.data(), count);
+}
+
+int IoUring::RegisterBufferSlots(unsigned count) {
+  io_uring_rsrc_register reg;
+  std::memset(&reg, 0, sizeof(reg));
+  reg.nr = count;
+  reg.flags = IORING_RSRC_REGISTER_SPARSE;
+  return Register(fd_, IORING_REGISTER_BUFFERS2, &reg, sizeof(reg));
+}
+
+int IoUring::UpdateBuffer(unsigned index, const iovec& buffer) {
+  io_uring_rsrc_update2 update;
+  std::memset(&update, 0, sizeof(update));
+  update.offset = index;
+  update.data = reinterpret_cast<uint64_t>(&buffer);
+  update.nr = 1;
+  const int ret = Register(fd_, IORING_REGISTER_BUFFERS_UPDATE, &update, sizeof(update));
+  return ret < 0 ? ret : 0;
+}
+
+}  // namespace util
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <sys/uio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <linux/io_uring.h>
+
+namespace util {
+
+// Minimal io_uring instance on top of the raw system calls.
+//
+// Only what the file output backend needs: one submission and one
+// completion ring, sparse tables of registered ("direct") file
+// descriptors and fixed buffers. liburing is deliberately not required;
+// the kernel UAPI header is enough, and Init() reports an error on
+// kernels or sandboxes (seccomp, io_uring_disabled) without io_uring, so
+// callers can fall back to plain system calls.
+//
+// Thread-safe: no. The submission side (GetSqe(), Submit(),
+// Register*()) and the completion side (WaitCqe(), PeekCqe()) may be used
+// from two different threads, but each side must be serialized by the
+// caller.
+class IoUring {
+ public:
+  IoUring() = default;
+
+  // Unmaps the rings and closes the instance (in-flight requests are
+  // cancelled by the kernel).
+  ~IoUring();
+
+  IoUring(const IoUring&) = delete;
+  IoUring& operator=(const IoUring&) = delete;
+
+  // Create the rings.
+  //
+  // Param: entries - Submission queue size (rounded up to a power of two
+  //                  by the kernel); the completion queue is twice that
+  // Param: error - Receives a description on failure
+  // Returns: false if io_uring is unavailable or the rings cannot be mapped
+  bool Init(unsigned entries, std::string* error);
+
+  bool initialized() const { return fd_ >= 0; }
+
+  // Next free submission entry, zeroed; nullptr if the queue is full.
+  // The entry is handed to the kernel by the next Submit().
+  io_uring_sqe* GetSqe();
+
+  // Submit every entry obtained since the last call.
+  // Returns: number of entries consumed by the kernel, or -errno
+  int Submit();
+
+  // Wait for one completion and consume it.
+  // Returns: 0 with *cqe filled, or -errno (EINTR is retried)
+  int WaitCqe(io_uring_cqe* cqe);
+
+  // Consume one completion if available, without a system call.
+  bool PeekCqe(io_uring_cqe* cqe);
+
+  // Register a table of count empty direct descriptor slots.
+  // Returns: 0 or -errno
+  int RegisterFileSlots(unsigned count);
+
+  // Register a table of count empty fixed buffer slots.
+  // Returns: 0 or -errno
+  int RegisterBufferSlots(unsigned count);
+
+  // Point fixed buffer slot index at a new memory range (pins its pages;
+  // the previous range is released once no request uses it).
+  // Returns: 0 or -errno (ENOMEM when RLIMIT_MEMLOCK is exhausted)
+  int UpdateBuffer(unsigned index, const iovec& buffer);
+
+ private:
+  int fd_ = -1;
+
+  // Mapped ring memory
+  void* sq_ring_ = nullptr;
+  size_t sq_ring_bytes_ = 0;
+  void* cq_ring_ = nullptr;   // Same as sq_ring_ with IORING_FEAT_SINGLE_MMAP
+  size_t cq_ring_bytes_ = 0;
+  io_uring_sqe* sqes_ = nullptr;
+  size_t sqes_bytes_ = 0;
+
+  // Pointers into the rings
+  unsigned* sq_head_ = nullptr;
+  unsigned* sq_tail_ = nullptr;
+  unsigned* sq_mask_ = nullptr;
+  unsigned* sq_entries_ = nullptr;
+  unsigned* sq_array_ = nullptr;
+  unsigned* cq_head_ = nullptr;
+  unsigned* cq_tail_ = nullptr;
+  unsigned* cq_mask_ = nullptr;
+  io_uring_cqe* cqes_ = nullptr;
+
+  unsigned sqe_tail_ = 0;     // Local tail: entries handed out by GetSqe()
+};
+
+}  // namespace util
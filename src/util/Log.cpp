@@ -1,12 +1,40 @@
 #include "util/Log.h"
 
 #include <chrono>
+#include <cstdint>
 #include <ctime>
-#include <iomanip>
-#include <iostream>
+#include <limits>
 
 namespace util {
 
+namespace {
+
+// Lines formatted per write() of the writer thread.
+constexpr size_t kBatchLines = 1024;
+
+// Longest the writer sleeps without a wakeup (covers a missed notify).
+constexpr std::chrono::milliseconds kIdleWait(50);
+
+const char* LevelName(LogLevel level) {
+  switch (level) {
+    case LogLevel::kInfo:
+      return "INFO";
+    case LogLevel::kWarn:
+      return "WARN";
+    case LogLevel::kError:
+      return "ERROR";
+  }
+  return "UNKNOWN";
+}
+
+int64_t NowUs() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::system_clock::now().time_since_epoch())
+      .count();
+}
+
+}  // namespace
+
 // Get the singleton Log instance.
 // The instance is created on first call and persists for program lifetime.
 // Thread-safe: static local variable initialization is guaranteed by C++11.
@@ -17,44 +45,240 @@ Log& Log::Instance() {
   return instance;
 }
 
+// Allocate the ring (every cell free for its own position) and start the
+// writer thread.
+Log::Log() : cells_(new Cell[kRingSize]), mask_(kRingSize - 1) {
+  static_assert((kRingSize & (kRingSize - 1)) == 0, "kRingSize must be a power of two");
+  for (size_t i = 0; i < kRingSize; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+  thread_ = std::thread([this]() { Run(); });
+}
+
+// Stop the writer thread after it has written everything queued.
+// Lines queued by other threads after this point are lost.
+Log::~Log() {
+  {
+    std::lock_guard<std::mutex> lock(wake_mutex_);
+    stop_ = true;
+  }
+  wake_.notify_one();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
 // Set the prefix for all log messages.
 // The prefix is prepended after the level and before the message.
 // Common usage: SetPrefix("service-name") for log aggregation.
 //
-// Thread-safe: acquires mutex_ to prevent race conditions with Write().
+// Thread-safe: acquires output_mutex_, which only the writer thread
+// contends for.
 //
 // Param: prefix - String to prepend to all messages (empty to clear)
 void Log::SetPrefix(const std::string& prefix) {
-  std::lock_guard<std::mutex> lock(mutex_);
+  std::lock_guard<std::mutex> lock(output_mutex_);
   prefix_ = prefix;
 }
 
-// Write a log message with timestamp and severity level.
-// This is the core logging function that formats and outputs messages.
-// It's thread-safe; concurrent calls from multiple threads won't interleave.
+// Flush what the old stream has pending, then swap streams.
+void Log::SetOutput(std::FILE* out) {
+  Flush();
+  std::lock_guard<std::mutex> lock(output_mutex_);
+  out_ = out;
+}
+
+// Queue a line for the writer thread.
 //
-// Format: "YYYY-MM-DD HH:MM:SS [LEVEL] <prefix>: <message>\n"
+// 1. Capture the time here, so lines show when they were logged
+// 2. Claim the next ring position with a CAS on tail_; a cell whose
+//    sequence is still behind the position is unread, i.e. the ring is
+//    full, and the line is dropped and counted
+// 3. Move the message into the cell and publish it by storing
+//    position + 1 in its sequence (release)
+// 4. Wake the writer only if it is sleeping
+//
+// Thread-safe: lock-free; never blocks and never writes to the output.
+void Log::Write(LogLevel level, std::string message, uint64_t suppressed) {
+  const int64_t time_us = NowUs();
+  size_t position = tail_.load(std::memory_order_relaxed);
+  Cell* cell = nullptr;
+  for (;;) {
+    cell = &cells_[position & mask_];
+    const size_t sequence = cell->sequence.load(std::memory_order_acquire);
+    const intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+    if (diff == 0) {
+      if (tail_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      dropped_.fetch_add(1, std::memory_order_relaxed);
+      return;
+    } else {
+      position = tail_.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->level = level;
+  cell->time_us = time_us;
+  cell->suppressed = suppressed;
+  cell->message = std::move(message);
+  cell->sequence.store(position + 1, std::memory_order_release);
+  suppressed_.fetch_add(suppressed, std::memory_order_relaxed);
+
+  if (sleeping_.load()) {
+    wake_.notify_one();
+  }
+}
+
+// Wait for the writer to pass the current tail. Positions claimed but not
+// yet filled are included; their producers finish them without blocking.
+void Log::Flush() {
+  const size_t target = tail_.load(std::memory_order_acquire);
+  std::unique_lock<std::mutex> lock(wake_mutex_);
+  wake_.notify_one();
+  flushed_.wait(lock, [this, target]() { return consumed_.load(std::memory_order_acquire) >= target || stop_; });
+}
+
+LogStats Log::GetStats() const {
+  LogStats stats;
+  stats.written = written_.load(std::memory_order_relaxed);
+  stats.dropped = dropped_.load(std::memory_order_relaxed);
+  stats.suppressed = suppressed_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// Writer thread loop.
 //
-// Thread-safe: acquires mutex_ for the entire formatting and output.
-// Time is captured after acquiring the lock to ensure accuracy.
+// Format up to kBatchLines queued lines into one buffer and write it with
+// a single fwrite + fflush, so a burst costs one syscall rather than one
+// per line. When the ring is empty, announce sleeping_ and wait (bounded
+// by kIdleWait); on stop, keep draining until the ring is empty.
+void Log::Run() {
+  std::string batch;
+  for (;;) {
+    batch.clear();
+    size_t taken = 0;
+    {
+      std::lock_guard<std::mutex> lock(output_mutex_);
+      taken = Drain(&batch);
+      if (!batch.empty()) {
+        std::fwrite(batch.data(), 1, batch.size(), out_);
+        std::fflush(out_);
+      }
+    }
+    if (taken > 0 || !batch.empty()) {
+      written_.fetch_add(taken, std::memory_order_relaxed);
+      consumed_.store(head_, std::memory_order_release);
+      std::lock_guard<std::mutex> lock(wake_mutex_);
+      flushed_.notify_all();
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(wake_mutex_);
+    if (stop_) {
+      flushed_.notify_all();
+      return;
+    }
+    sleeping_.store(true);
+    // Recheck after announcing: a line published before sleeping_ was set
+    // did not notify
+    const Cell& next = cells_[head_ & mask_];
+    if (next.sequence.load(std::memory_order_acquire) != head_ + 1) {
+      wake_.wait_for(lock, kIdleWait);
+    }
+    sleeping_.store(false);
+  }
+}
+
+// Pop and format filled cells in order, stopping at the first one not yet
+// published. Each cell is handed back to producers (sequence = position +
+// ring size) as soon as it is formatted.
 //
-// Param: level - Severity level (kInfo, kWarn, kError)
-// Param: message - The message content
-void Log::Write(LogLevel level, const std::string& message) {
-  std::lock_guard<std::mutex> lock(mutex_);
-  auto now = std::chrono::system_clock::now();
-  auto now_time = std::chrono::system_clock::to_time_t(now);
-  std::tm tm{};
-  localtime_r(&now_time, &tm);
-
-  std::ostringstream out;
-  out << std::put_time(&tm, "%Y-%m-%d %H:%M:%S")
-      << " [" << ToString(level) << "] ";
-  if (!prefix_.empty()) {
-    out << prefix_ << ": ";
+// Also reports lines dropped since the last report.
+// Called with output_mutex_ held (reads prefix_).
+size_t Log::Drain(std::string* batch) {
+  size_t taken = 0;
+  while (taken < kBatchLines) {
+    Cell& cell = cells_[head_ & mask_];
+    if (cell.sequence.load(std::memory_order_acquire) != head_ + 1) {
+      break;
+    }
+    AppendTimestamp(cell.time_us, batch);
+    batch->append(" [");
+    batch->append(LevelName(cell.level));
+    batch->append("] ");
+    if (!prefix_.empty()) {
+      batch->append(prefix_);
+      batch->append(": ");
+    }
+    batch->append(cell.message);
+    if (cell.suppressed > 0) {
+      batch->append(" (" + std::to_string(cell.suppressed) + " similar suppressed)");
+    }
+    batch->push_back('\n');
+    cell.message.clear();
+    cell.sequence.store(head_ + mask_ + 1, std::memory_order_release);
+    ++head_;
+    ++taken;
+  }
+
+  const uint64_t dropped = dropped_.load(std::memory_order_relaxed);
+  if (dropped > dropped_reported_) {
+    AppendTimestamp(NowUs(), batch);
+    batch->append(" [WARN] ");
+    if (!prefix_.empty()) {
+      batch->append(prefix_);
+      batch->append(": ");
+    }
+    batch->append(std::to_string(dropped - dropped_reported_) + " log lines dropped (log ring full)\n");
+    dropped_reported_ = dropped;
   }
-  out << message;
-  std::cout << out.str() << std::endl;
+  return taken;
+}
+
+// Format the local time once per second; lines within the same second
+// reuse the cached text.
+void Log::AppendTimestamp(int64_t time_us, std::string* out) {
+  const int64_t second = time_us >= 0 ? time_us / 1000000 : (time_us - 999999) / 1000000;
+  if (second != cached_second_) {
+    const std::time_t time = static_cast<std::time_t>(second);
+    std::tm tm{};
+    localtime_r(&time, &tm);
+    if (std::strftime(cached_timestamp_, sizeof(cached_timestamp_), "%Y-%m-%d %H:%M:%S", &tm) == 0) {
+      cached_timestamp_[0] = '\0';
+    }
+    cached_second_ = second;
+  }
+  out->append(cached_timestamp_);
+}
+
+// Let the line through if the call site has written fewer than
+// Log::rate_limit() lines in the current second.
+bool LogRateLimiter::Allow(uint64_t* suppressed) {
+  uint32_t limit = Log::Instance().rate_limit();
+  if (limit == 0) {
+    limit = std::numeric_limits<uint32_t>::max();
+  }
+  const int64_t now_s = std::chrono::duration_cast<std::chrono::seconds>(
+                            std::chrono::steady_clock::now().time_since_epoch())
+                            .count();
+  return AllowAt(now_s, limit, suppressed);
+}
+
+// The first caller in a new second resets the count; the suppressed count
+// is handed to exactly one caller by the exchange.
+bool LogRateLimiter::AllowAt(int64_t now_s, uint32_t limit, uint64_t* suppressed) {
+  int64_t window = window_.load(std::memory_order_relaxed);
+  if (window != now_s && window_.compare_exchange_strong(window, now_s, std::memory_order_relaxed)) {
+    count_.store(0, std::memory_order_relaxed);
+  }
+  if (count_.fetch_add(1, std::memory_order_relaxed) < limit) {
+    *suppressed = suppressed_.exchange(0, std::memory_order_relaxed);
+    return true;
+  }
+  suppressed_.fetch_add(1, std::memory_order_relaxed);
+  return false;
 }
 
 // Convert LogLevel enum to human-readable string.
@@ -63,15 +287,7 @@ void Log::Write(LogLevel level, const std::string& message) {
 // Param: level - Log level to convert
 // Returns: String representation ("INFO", "WARN", "ERROR", or "UNKNOWN")
 std::string ToString(LogLevel level) {
-  switch (level) {
-    case LogLevel::kInfo:
-      return "INFO";
-    case LogLevel::kWarn:
-      return "WARN";
-    case LogLevel::kError:
-      return "ERROR";
-  }
-  return "UNKNOWN";
+  return LevelName(level);
 }
 
 }  // namespace util
@@ -1,8 +1,14 @@
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <mutex>
-#include <sstream>
 #include <string>
+#include <thread>
 
 namespace util {
 
@@ -14,20 +20,43 @@ enum class LogLevel {
   kError,  // Errors that may affect functionality
 };
 
-// Thread-safe logging utility.
+// Counters of the logger, see Log::GetStats().
+struct LogStats {
+  uint64_t written = 0;     // Lines written to the output
+  uint64_t dropped = 0;     // Lines lost because the ring was full
+  uint64_t suppressed = 0;  // Lines skipped by per-callsite rate limiting
+};
+
+// Asynchronous, thread-safe logging utility.
 //
 // This is a singleton logger that writes timestamped messages to stdout.
 // It's designed to be simple and dependency-free (no external logging libraries).
 //
+// Write() never takes a lock and never touches the output: the message is
+// moved into a bounded lock-free ring (multi-producer, single-consumer) and
+// a background thread formats and writes lines in batches. A thread
+// logging every bad packet of a loss storm therefore costs one string and
+// one compare-and-swap, not a mutex plus a flushed write to stdout. When
+// the ring is full the line is dropped, counted, and reported by the
+// writer thread ("N log lines dropped") instead of blocking the caller.
+//
 // Features:
-// - Thread-safe: uses a mutex to prevent interleaved messages from multiple threads
-// - Timestamps: each log line includes date and time
+// - Thread-safe: per-thread order is kept; lines of different threads never interleave
+// - Timestamps: each log line includes date and time, captured in Write()
 // - Prefix: optional prefix for filtering (e.g., "rtp-capture")
 // - Macros: LOG_INFO, LOG_WARN, LOG_ERROR for convenient usage
+// - Rate limiting: LOG_WARN/LOG_ERROR call sites log at most
+//   SetRateLimit() lines per second each (see LogRateLimiter)
+// - Compile-time filtering: -DLOG_MIN_LEVEL=1 removes LOG_INFO, =2 LOG_WARN too
 //
 // Example output:
 //   2024-01-15 14:30:45 [INFO] rtp-capture: Service running
 //   2024-01-15 14:30:47 [WARN] rtp-capture: Packet lost
+//   2024-01-15 14:30:48 [WARN] rtp-capture: Packet lost (312 similar suppressed)
+//
+// Lines still queued at exit are written by the destructor of the
+// singleton; call Flush() before anything that skips static destructors
+// (abort, _exit).
 //
 // The logger is used throughout the codebase to track:
 //   - Service startup/shutdown
@@ -36,39 +65,147 @@ enum class LogLevel {
 //   - File writing operations
 class Log {
  public:
+  // Lines the ring holds before Write() starts dropping.
+  static constexpr size_t kRingSize = 8192;
+
+  // Default of SetRateLimit().
+  static constexpr uint32_t kDefaultRateLimit = 20;
+
   // Get the singleton instance.
-  // The instance is constructed on first call and lives for the program lifetime.
+  // The instance (and its writer thread) is constructed on first call and
+  // lives for the program lifetime.
   // Returns: Reference to the global Log instance
   static Log& Instance();
 
+  // Drains the ring and stops the writer thread.
+  ~Log();
+
+  Log(const Log&) = delete;
+  Log& operator=(const Log&) = delete;
+
   // Set a prefix prepended to all log messages.
   // Useful for distinguishing between multiple services or filtering logs.
-  // Thread-safe: acquires mutex internally.
+  // Applies to lines written after the call, including queued ones.
   // Example: SetPrefix("rtp-capture") → "[INFO] rtp-capture: message"
   //
   // Param: prefix - String to prefix all messages with (empty string to clear)
+  // Thread-safe: yes
   void SetPrefix(const std::string& prefix);
 
-  // Write a log message with the specified severity level.
-  // This method is thread-safe; multiple threads can log concurrently.
+  // Redirect output, e.g. to a file in tests. Queued lines are flushed to
+  // the previous stream first.
+  //
+  // Param: out - Open stream (not owned); stdout by default
+  // Thread-safe: yes
+  void SetOutput(std::FILE* out);
+
+  // Lines per second each LOG_WARN/LOG_ERROR call site may write; 0
+  // disables rate limiting.
+  //
+  // Thread-safe: yes
+  void SetRateLimit(uint32_t lines_per_second) { rate_limit_.store(lines_per_second, std::memory_order_relaxed); }
+  uint32_t rate_limit() const { return rate_limit_.load(std::memory_order_relaxed); }
+
+  // Queue a log message with the specified severity level.
   // Format: "YYYY-MM-DD HH:MM:SS [LEVEL] <prefix>: <message>"
   //
   // Param: level - Severity of the message (kInfo, kWarn, kError)
   // Param: message - The message content
-  void Write(LogLevel level, const std::string& message);
+  // Param: suppressed - Lines of the same call site skipped by rate
+  //   limiting since its last line; appended as "(N similar suppressed)"
+  // Thread-safe: yes, lock-free; never blocks
+  void Write(LogLevel level, std::string message, uint64_t suppressed = 0);
+
+  // Block until every line queued before the call has been written and the
+  // output flushed.
+  //
+  // Thread-safe: yes
+  void Flush();
+
+  // Counters since start.
+  LogStats GetStats() const;
 
  private:
+  // One queued line. sequence tells producers and the writer whose turn
+  // the cell is (Vyukov's bounded queue): equal to the enqueue position
+  // when free, position + 1 when filled.
+  struct Cell {
+    std::atomic<size_t> sequence{0};
+    LogLevel level = LogLevel::kInfo;
+    int64_t time_us = 0;
+    uint64_t suppressed = 0;
+    std::string message;
+  };
+
   // Private constructor for singleton pattern.
   // Use Instance() to access the logger.
-  Log() = default;
+  Log();
+
+  // Writer thread: drain the ring in batches until stopped.
+  void Run();
 
-  // Mutex to ensure thread-safe logging.
-  // Prevents interleaved output from concurrent Write() calls.
-  std::mutex mutex_;
+  // Take and format every queued line into batch; returns lines taken.
+  size_t Drain(std::string* batch);
 
-  // Optional prefix for all log messages.
-  // Commonly set to service name for log aggregation.
+  // Append "YYYY-MM-DD HH:MM:SS" for time_us, reformatting only when the
+  // second changes. Writer thread only.
+  void AppendTimestamp(int64_t time_us, std::string* out);
+
+  std::unique_ptr<Cell[]> cells_;
+  const size_t mask_;
+  alignas(64) std::atomic<size_t> tail_{0};  // Next enqueue position (producers)
+  alignas(64) size_t head_ = 0;              // Next dequeue position (writer)
+  std::atomic<size_t> consumed_{0};          // Positions written, for Flush()
+
+  std::atomic<uint64_t> written_{0};
+  std::atomic<uint64_t> dropped_{0};
+  uint64_t dropped_reported_ = 0;  // Writer thread only
+  std::atomic<uint64_t> suppressed_{0};
+  std::atomic<uint32_t> rate_limit_{kDefaultRateLimit};
+
+  // Wakes the writer. Producers only notify while it sleeps, without the
+  // mutex; the writer's wait is bounded, so a missed wakeup only delays it.
+  std::mutex wake_mutex_;
+  std::condition_variable wake_;
+  std::condition_variable flushed_;
+  std::atomic<bool> sleeping_{false};
+  bool stop_ = false;
+
+  // Output state, guarded by output_mutex_ (writer thread and setters).
+  std::mutex output_mutex_;
   std::string prefix_;
+  std::FILE* out_ = stdout;
+
+  // Timestamp cache, writer thread only.
+  int64_t cached_second_ = -1;
+  char cached_timestamp_[32] = {};
+
+  std::thread thread_;
+};
+
+// Per-callsite rate limit of the LOG_WARN/LOG_ERROR macros: a window of
+// one second that lets Log::rate_limit() lines through, then counts what
+// it skips and hands the count to the next line that gets through. A
+// packet-loss storm logs a few lines per second and "(N similar
+// suppressed)" instead of one line per packet; the message is not even
+// built for skipped lines.
+//
+// Thread-safe: yes, lock-free. The window reset may race, letting a few
+// extra lines through at a second boundary.
+class LogRateLimiter {
+ public:
+  // Param: suppressed - Receives the lines skipped since the last line
+  //   that was let through (only when returning true)
+  // Returns: true if the line should be written
+  bool Allow(uint64_t* suppressed);
+
+  // Allow() at a given time in seconds (for tests).
+  bool AllowAt(int64_t now_s, uint32_t limit, uint64_t* suppressed);
+
+ private:
+  std::atomic<int64_t> window_{-1};
+  std::atomic<uint32_t> count_{0};
+  std::atomic<uint64_t> suppressed_{0};
 };
 
 // Convert LogLevel enum to human-readable string.
@@ -80,12 +217,37 @@ std::string ToString(LogLevel level);
 
 }  // namespace util
 
+// Lowest level compiled in: 0 = info, 1 = warn, 2 = error (CMake
+// -DLOG_MIN_LEVEL=<n>). Filtered calls become dead code; their arguments
+// still compile but are never evaluated.
+#ifndef LOG_MIN_LEVEL
+#define LOG_MIN_LEVEL 0
+#endif
+
 // Convenience macros for logging at specific severity levels.
-// These macros capture file/line context and call the Log::Write method.
+// The message expression is evaluated only when the line is logged.
+// LOG_WARN and LOG_ERROR keep a LogRateLimiter per call site.
 // Usage throughout the codebase:
 //   LOG_INFO("Service started");
 //   LOG_WARN("Frame decode failed, skipping");
 //   LOG_ERROR("Failed to open RTP stream: " + error_msg);
-#define LOG_INFO(msg) ::util::Log::Instance().Write(::util::LogLevel::kInfo, (msg))
-#define LOG_WARN(msg) ::util::Log::Instance().Write(::util::LogLevel::kWarn, (msg))
-#define LOG_ERROR(msg) ::util::Log::Instance().Write(::util::LogLevel::kError, (msg))
+#define LOG_INFO(msg)                                                      \
+  do {                                                                     \
+    if (0 >= LOG_MIN_LEVEL) {                                              \
+      ::util::Log::Instance().Write(::util::LogLevel::kInfo, (msg));       \
+    }                                                                      \
+  } while (0)
+
+#define UTIL_LOG_LIMITED(level_value, level, msg)                                     \
+  do {                                                                                \
+    if (level_value >= LOG_MIN_LEVEL) {                                               \
+      static ::util::LogRateLimiter util_log_limiter;                                 \
+      uint64_t util_log_suppressed = 0;                                               \
+      if (util_log_limiter.Allow(&util_log_suppressed)) {                             \
+        ::util::Log::Instance().Write(::util::LogLevel::level, (msg), util_log_suppressed); \
+      }                                                                               \
+    }                                                                                 \
+  } while (0)
+
+#define LOG_WARN(msg) UTIL_LOG_LIMITED(1, kWarn, msg)
+#define LOG_ERROR(msg) UTIL_LOG_LIMITED(2, kError, msg)
@@ -0,0 +1,188 @@
+#include "util/Metrics.h"
+
+#include <cstdio>
+#include <sstream>
+
+#include "util/Log.h"
+
+namespace util {
+namespace {
+
+// Format microseconds as seconds without trailing zeros ("0.0025", "5")
+std::string Seconds(uint64_t us) {
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), "%.6f", static_cast<double>(us) / 1e6);
+  std::string text = buffer;
+  text.erase(text.find_last_not_of('0') + 1);
+  if (text.back() == '.') {
+    text.pop_back();
+  }
+  return text;
+}
+
+// "name{labels}" or "name" when there are no labels
+std::string Series(const std::string& name, const std::string& labels) {
+  return labels.empty() ? name : name + "{" + labels + "}";
+}
+
+// Histogram series take an extra le label after the metric's own
+std::string BucketSeries(const std::string& name, const std::string& labels, const std::string& le) {
+  return name + "_bucket{" + (labels.empty() ? "" : labels + ",") + "le=\"" + le + "\"}";
+}
+
+}  // namespace
+
+constexpr std::array<int64_t, Histogram::kBuckets - 1> Histogram::kBoundsUs;
+
+// Bucket lookup is a linear scan: with 16 bounds and most samples in the
+// first few buckets this beats a binary search.
+void Histogram::Observe(int64_t value_us) {
+  const uint64_t value = value_us > 0 ? static_cast<uint64_t>(value_us) : 0;
+  size_t index = 0;
+  while (index < kBoundsUs.size() && value_us > kBoundsUs[index]) {
+    ++index;
+  }
+  buckets_[index].fetch_add(1, std::memory_order_relaxed);
+  sum_us_.fetch_add(value, std::memory_order_relaxed);
+}
+
+// There is no separate count: it would cost Observe() a third atomic.
+uint64_t Histogram::count() const {
+  uint64_t total = 0;
+  for (size_t i = 0; i < kBuckets; ++i) {
+    total += bucket(i);
+  }
+  return total;
+}
+
+// Get the process-wide registry.
+// Thread-safe: static local initialization is guaranteed by C++11.
+Metrics& Metrics::Instance() {
+  static Metrics instance;
+  return instance;
+}
+
+// Caller holds mutex_.
+Metrics::Family* Metrics::GetFamily(const std::string& name, const std::string& help, Type type) {
+  auto it = families_.find(name);
+  if (it == families_.end()) {
+    it = families_.emplace(name, Family{type, help, {}, {}, {}}).first;
+  } else if (it->second.type != type) {
+    LOG_ERROR("Metric " + name + " registered with two different types");
+  }
+  return &it->second;
+}
+
+Counter* Metrics::GetCounter(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Counter>& metric = GetFamily(name, help, Type::kCounter)->counters[labels];
+  if (!metric) {
+    metric = std::make_unique<Counter>();
+  }
+  return metric.get();
+}
+
+Gauge* Metrics::GetGauge(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Gauge>& metric = GetFamily(name, help, Type::kGauge)->gauges[labels];
+  if (!metric) {
+    metric = std::make_unique<Gauge>();
+  }
+  return metric.get();
+}
+
+Histogram* Metrics::GetHistogram(const std::string& name, const std::string& help, const std::string& labels) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<Histogram>& metric = GetFamily(name, help, Type::kHistogram)->histograms[labels];
+  if (!metric) {
+    metric = std::make_unique<Histogram>();
+  }
+  return metric.get();
+}
+
+uint64_t Metrics::AddCollector(std::function<void()> collect) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const uint64_t id = next_collector_++;
+  collectors_.emplace(id, std::move(collect));
+  return id;
+}
+
+// Collectors only run under mutex_, so holding it here is what guarantees
+// none is running once this returns.
+void Metrics::RemoveCollector(uint64_t id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  collectors_.erase(id);
+}
+
+// Render all families in name order, series in label order:
+//
+//   # HELP capture_decode_seconds Time in avcodec_send_packet/receive_frame per packet
+//   # TYPE capture_decode_seconds histogram
+//   capture_decode_seconds_bucket{stream="alice",le="0.00005"} 0
+//   ...
+//   capture_decode_seconds_bucket{stream="alice",le="+Inf"} 812
+//   capture_decode_seconds_sum{stream="alice"} 1.93
+//   capture_decode_seconds_count{stream="alice"} 812
+//
+// Returns: Response body for GET /metrics
+std::string Metrics::Render() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  for (auto& collector : collectors_) {
+    collector.second();
+  }
+
+  std::ostringstream out;
+  for (const auto& entry : families_) {
+    const std::string& name = entry.first;
+    const Family& family = entry.second;
+    out << "# HELP " << name << ' ' << family.help << '\n';
+    switch (family.type) {
+      case Type::kCounter:
+        out << "# TYPE " << name << " counter\n";
+        for (const auto& series : family.counters) {
+          out << Series(name, series.first) << ' ' << series.second->value() << '\n';
+        }
+        break;
+      case Type::kGauge:
+        out << "# TYPE " << name << " gauge\n";
+        for (const auto& series : family.gauges) {
+          out << Series(name, series.first) << ' ' << series.second->value() << '\n';
+        }
+        break;
+      case Type::kHistogram:
+        out << "# TYPE " << name << " histogram\n";
+        for (const auto& series : family.histograms) {
+          // Each bucket is read once, so the +Inf bucket and _count agree
+          const Histogram& histogram = *series.second;
+          uint64_t cumulative = 0;
+          for (size_t i = 0; i < Histogram::kBuckets; ++i) {
+            cumulative += histogram.bucket(i);
+            const std::string le = i < Histogram::kBoundsUs.size() ? Seconds(Histogram::kBoundsUs[i]) : "+Inf";
+            out << BucketSeries(name, series.first, le) << ' ' << cumulative << '\n';
+          }
+          out << Series(name + "_sum", series.first) << ' ' << Seconds(histogram.sum_us()) << '\n';
+          out << Series(name + "_count", series.first) << ' ' << cumulative << '\n';
+        }
+        break;
+    }
+  }
+  return out.str();
+}
+
+// Escape per the exposition format: backslash, double quote and newline.
+std::string MetricLabel(const std::string& key, const std::string& value) {
+  std::string quoted = key + "=\"";
+  for (char c : value) {
+    if (c == '\\' || c == '"') {
+      quoted += '\\';
+      quoted += c;
+    } else if (c == '\n') {
+      quoted += "\\n";
+    } else {
+      quoted += c;
+    }
+  }
+  return quoted + "\"";
+}
+
+}  // namespace util
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+
+namespace util {
+
+// Monotonically increasing count (packets, frames, bytes, drops).
+//
+// Thread-safe: Add() is a single relaxed atomic increment; readers may
+// see a slightly stale value, which is fine for monitoring.
+class Counter {
+ public:
+  void Add(uint64_t n = 1) { value_.fetch_add(n, std::memory_order_relaxed); }
+
+  // Overwrite with a total kept elsewhere (e.g. a QueueStats snapshot
+  // copied by a collector). Only use when this is the sole writer.
+  void Set(uint64_t value) { value_.store(value, std::memory_order_relaxed); }
+
+  uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<uint64_t> value_{0};
+};
+
+// Value that goes up and down (queue depth, frames in flight).
+//
+// Thread-safe: relaxed atomic store/load.
+class Gauge {
+ public:
+  void Set(int64_t value) { value_.store(value, std::memory_order_relaxed); }
+  int64_t value() const { return value_.load(std::memory_order_relaxed); }
+
+ private:
+  std::atomic<int64_t> value_{0};
+};
+
+// Latency distribution over fixed buckets, in microseconds.
+//
+// Buckets follow a 1-2.5-5 series from 50 us to 5 s, which covers a
+// single sws_scale slice as well as a PNG written to a stalled disk.
+// Observe() finds the bucket with a short linear scan and does two
+// relaxed increments (bucket, sum); there is no lock and no allocation.
+// Rendered as a Prometheus histogram in seconds.
+//
+// Thread-safe: Observe() may be called from any number of threads. A
+// concurrent render may see the sum and the buckets from slightly
+// different instants; each value is individually exact.
+class Histogram {
+ public:
+  static constexpr size_t kBuckets = 17;
+
+  // Upper bounds (inclusive) in microseconds; the last bucket is +Inf
+  static constexpr std::array<int64_t, kBuckets - 1> kBoundsUs = {
+      50,     100,    250,    500,     1000,    2500,    5000,    10000,
+      25000,  50000,  100000, 250000,  500000,  1000000, 2500000, 5000000};
+
+  // Record one sample.
+  // Param: value_us - Duration in microseconds (negative counts as 0)
+  void Observe(int64_t value_us);
+
+  // Samples in bucket index, i.e. above kBoundsUs[index - 1] and at most
+  // kBoundsUs[index] (index kBuckets - 1 is the +Inf bucket)
+  uint64_t bucket(size_t index) const { return buckets_[index].load(std::memory_order_relaxed); }
+
+  // Total number of samples
+  uint64_t count() const;
+  uint64_t sum_us() const { return sum_us_.load(std::memory_order_relaxed); }
+
+ private:
+  std::array<std::atomic<uint64_t>, kBuckets> buckets_{};
+  std::atomic<uint64_t> sum_us_{0};
+};
+
+// Microseconds on the monotonic clock, for timing a stage:
+//   const int64_t start = util::NowMicros();
+//   ...
+//   histogram->Observe(util::NowMicros() - start);
+inline int64_t NowMicros() {
+  return std::chrono::duration_cast<std::chrono::microseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Process-wide registry of named metrics, rendered in the Prometheus text
+// exposition format (see MetricsServer).
+//
+// Metrics are identified by name plus a label set such as
+// `stream="alice"`. Get*() creates the metric on first use and returns
+// the same object for the same name and labels afterwards, so a component
+// looks its metrics up once (at construction) and then only touches the
+// returned atomics. Metrics are never destroyed; pointers stay valid for
+// the life of the process.
+//
+// Values that another component already tracks under its own lock (queue
+// and pool stats) are copied in by collectors, which run only when the
+// metrics are rendered, so the hot path pays nothing for them.
+//
+// Thread-safe: all methods. Get*() and collector changes lock the
+// registry; recording into a returned metric never does.
+class Metrics {
+ public:
+  // Get the process-wide registry.
+  static Metrics& Instance();
+
+  // Find or create a metric.
+  //
+  // Param: name - Metric family name, e.g. "capture_decode_seconds"
+  // Param: help - One-line description (first registration wins)
+  // Param: labels - Prometheus label list without braces, e.g.
+  //                 `stream="alice"` (empty for none)
+  // Returns: Metric owned by the registry (never null)
+  Counter* GetCounter(const std::string& name, const std::string& help, const std::string& labels = "");
+  Gauge* GetGauge(const std::string& name, const std::string& help, const std::string& labels = "");
+  Histogram* GetHistogram(const std::string& name, const std::string& help, const std::string& labels = "");
+
+  // Register a function that refreshes gauges/counters from another
+  // component's snapshot. Runs under the registry lock on every Render().
+  //
+  // Returns: Id for RemoveCollector()
+  uint64_t AddCollector(std::function<void()> collect);
+
+  // Unregister a collector. Once this returns the collector is not running
+  // and will not run again, so the state it captures may be destroyed.
+  void RemoveCollector(uint64_t id);
+
+  // Run collectors and render every metric as Prometheus text (version 0.0.4).
+  std::string Render();
+
+ private:
+  enum class Type { kCounter, kGauge, kHistogram };
+
+  // All series sharing one name
+  struct Family {
+    Type type;
+    std::string help;
+    std::map<std::string, std::unique_ptr<Counter>> counters;
+    std::map<std::string, std::unique_ptr<Gauge>> gauges;
+    std::map<std::string, std::unique_ptr<Histogram>> histograms;
+  };
+
+  Metrics() = default;
+
+  // Find or create a family. A name reused with another type is a bug: it
+  // is logged, and the metric returned for it is never rendered.
+  Family* GetFamily(const std::string& name, const std::string& help, Type type);
+
+  std::mutex mutex_;
+  std::map<std::string, Family> families_;
+  std::map<uint64_t, std::function<void()>> collectors_;
+  uint64_t next_collector_ = 1;
+};
+
+// Quote a value for use in a Prometheus label list (escapes \, " and newlines).
+//
+// Example: MetricLabel("stream", "alice") → `stream="alice"`
+std::string MetricLabel(const std::string& key, const std::string& value);
+
+}  // namespace util
@@ -0,0 +1,168 @@
+#include "util/MetricsServer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "util/Log.h"
+#include "util/Metrics.h"
+
+namespace util {
+namespace {
+
+// Longest a client may take to send its request line and read the
+// response, all told
+constexpr int kClientTimeoutMs = 2000;
+
+// Accept loop wake-up interval, only if the stop eventfd is unavailable
+constexpr int kFallbackPollMs = 200;
+
+// Build a complete HTTP/1.0 response; the connection is closed after it.
+std::string Response(const std::string& status, const std::string& content_type, const std::string& body) {
+  return "HTTP/1.0 " + status + "\r\nContent-Type: " + content_type +
+         "\r\nContent-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+}
+
+}  // namespace
+
+MetricsServer::~MetricsServer() {
+  Stop();
+}
+
+// Bind a listening TCP socket and start the server thread.
+// SO_REUSEADDR lets a restarted process rebind the port immediately.
+bool MetricsServer::Start(const std::string& address, int port) {
+  sockaddr_in local{};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(static_cast<uint16_t>(port));
+  if (inet_pton(AF_INET, address.c_str(), &local.sin_addr) != 1) {
+    LOG_ERROR("Invalid metrics address '" + address + "'");
+    return false;
+  }
+
+  fd_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd_ < 0) {
+    LOG_ERROR(std::string("Metrics socket: ") + std::strerror(errno));
+    return false;
+  }
+  const int one = 1;
+  setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+  if (bind(fd_, reinterpret_cast<const sockaddr*>(&local), sizeof(local)) < 0 || listen(fd_, 8) < 0) {
+    LOG_ERROR("Metrics bind " + address + ":" + std::to_string(port) + ": " + std::strerror(errno));
+    close(fd_);
+    fd_ = -1;
+    return false;
+  }
+
+  thread_ = std::thread([this]() { Serve(); });
+  LOG_INFO("Metrics on http://" + address + ":" + std::to_string(port) + "/metrics");
+  return true;
+}
+
+void MetricsServer::Stop() {
+  stop_.Set();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+  if (fd_ >= 0) {
+    close(fd_);
+    fd_ = -1;
+  }
+}
+
+// Accept and answer one client at a time until Stop(). Idle, the thread
+// sleeps in poll() until a connection or the stop event arrives.
+void MetricsServer::Serve() {
+  const int timeout_ms = stop_.fd() >= 0 ? -1 : kFallbackPollMs;
+  while (!stop_.IsSet()) {
+    pollfd fds[2] = {{fd_, POLLIN, 0}, {stop_.fd(), POLLIN, 0}};
+    if (poll(fds, 2, timeout_ms) <= 0 || !(fds[0].revents & POLLIN)) {
+      continue;
+    }
+    const int client = accept4(fd_, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK);
+    if (client < 0) {
+      continue;
+    }
+    HandleClient(client);
+    close(client);
+  }
+}
+
+// Read until the end of the request line (headers and body are ignored)
+// and answer "GET /metrics" with the registry contents, anything else
+// with 404. The client is dropped once kClientTimeoutMs have passed since
+// it was accepted, however it spreads its reads and writes.
+void MetricsServer::HandleClient(int client) {
+  const int64_t deadline_us = NowMicros() + static_cast<int64_t>(kClientTimeoutMs) * 1000;
+  std::string request;
+  char buffer[1024];
+  while (request.find("\r\n") == std::string::npos && request.size() < 4096) {
+    const ssize_t n = recv(client, buffer, sizeof(buffer), 0);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      if (!WaitClient(client, POLLIN, deadline_us)) {
+        return;
+      }
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    request.append(buffer, static_cast<size_t>(n));
+  }
+
+  const std::string line = request.substr(0, request.find("\r\n"));
+  if (line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET /metrics?", 0) == 0) {
+    SendAll(client, Response("200 OK", "text/plain; version=0.0.4", Metrics::Instance().Render()), deadline_us);
+  } else {
+    SendAll(client, Response("404 Not Found", "text/plain", "not found\n"), deadline_us);
+  }
+}
+
+// Also wakes on Stop(), which then ends the exchange.
+bool MetricsServer::WaitClient(int client, short events, int64_t deadline_us) const {
+  while (!stop_.IsSet()) {
+    const int64_t remaining_us = deadline_us - NowMicros();
+    if (remaining_us <= 0) {
+      return false;
+    }
+    int timeout_ms = static_cast<int>((remaining_us + 999) / 1000);
+    if (stop_.fd() < 0) {
+      timeout_ms = std::min(timeout_ms, kFallbackPollMs);
+    }
+    pollfd fds[2] = {{client, events, 0}, {stop_.fd(), POLLIN, 0}};
+    const int ready = poll(fds, 2, timeout_ms);
+    if (ready < 0 && errno != EINTR) {
+      return false;
+    }
+    if (ready > 0 && fds[0].revents != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Retry short writes; give up at the deadline, on Stop() or on error.
+void MetricsServer::SendAll(int client, const std::string& data, int64_t deadline_us) const {
+  size_t sent = 0;
+  while (sent < data.size()) {
+    const ssize_t n = send(client, data.data() + sent, data.size() - sent, MSG_NOSIGNAL);
+    if (n < 0 && (errno == EAGAIN || errno == EINTR)) {
+      if (!WaitClient(client, POLLOUT, deadline_us)) {
+        return;
+      }
+      continue;
+    }
+    if (n <= 0) {
+      return;
+    }
+    sent += static_cast<size_t>(n);
+  }
+}
+
+}  // namespace util
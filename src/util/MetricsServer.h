@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "util/StopEvent.h"
+
+namespace util {
+
+// Minimal HTTP endpoint serving Metrics::Instance().Render() on /metrics.
+//
+// One thread accepts a connection, reads the request line, writes the
+// response and closes the connection; scrapes are rare (every few
+// seconds) and small, so nothing more is needed. Any other path gets 404.
+// Each client has one deadline for its whole exchange (request and
+// response), so a client that trickles its request or stops reading
+// cannot hold the thread, nor delay Stop().
+// The server binds to loopback by default: the metrics reveal stream
+// names and are meant for a local Prometheus or node exporter.
+//
+// Lifecycle:
+//   1. Start() binds and spawns the server thread
+//   2. Stop() (or the destructor) wakes the thread, joins and closes
+//      the socket; a stopped server cannot be started again
+//
+// Thread-safe: Start() and Stop() from one controlling thread.
+class MetricsServer {
+ public:
+  MetricsServer() = default;
+  ~MetricsServer();
+
+  MetricsServer(const MetricsServer&) = delete;
+  MetricsServer& operator=(const MetricsServer&) = delete;
+
+  // Bind and start serving.
+  //
+  // Param: address - Local IPv4 address, "127.0.0.1" for local scrapes only
+  // Param: port - TCP port
+  // Returns: false (after logging) if the socket could not be bound
+  bool Start(const std::string& address, int port);
+
+  // Stop serving and join the server thread. Safe to call twice.
+  void Stop();
+
+ private:
+  // Accept loop; sleeps in poll() on the socket and stop_.
+  void Serve();
+
+  // Read one request from a connected (non-blocking) client and answer it.
+  void HandleClient(int client);
+
+  // Wait until client is ready for events, the deadline passes or Stop().
+  // Returns: true if the client is ready
+  bool WaitClient(int client, short events, int64_t deadline_us) const;
+
+  // Write the whole buffer before the deadline.
+  void SendAll(int client, const std::string& data, int64_t deadline_us) const;
+
+  int fd_ = -1;
+  StopEvent stop_;
+  std::thread thread_;
+};
+
+}  // namespace util
@@ -0,0 +1,246 @@
+#include "util/Scheduler.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <sstream>
+
+#include "util/Log.h"
+
+namespace util {
+
+namespace {
+
+// The scheduler and worker index of the calling thread, so Submit() from
+// a task queues locally.
+thread_local const Scheduler* current_scheduler = nullptr;
+thread_local size_t current_worker = 0;
+
+// Parse a non-negative decimal number spanning all of text.
+bool ParseCpu(const std::string& text, int* cpu) {
+  if (text.empty() || text.size() > 6 ||
+      !std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c) != 0; })) {
+    return false;
+  }
+  *cpu = std::stoi(text);
+  return true;
+}
+
+// The CPUs workers should be pinned to, per options; empty for none.
+std::vector<int> ResolveCpus(const SchedulerOptions& options) {
+  std::vector<int> cpus;
+  if (!options.cpus.empty() && !ParseCpuList(options.cpus, &cpus)) {
+    LOG_WARN("Invalid CPU list '" + options.cpus + "', not pinning decode workers");
+    return {};
+  }
+  if (options.numa_node >= 0) {
+    std::vector<int> node_cpus;
+    if (!NumaNodeCpus(options.numa_node, &node_cpus)) {
+      LOG_WARN("NUMA node " + std::to_string(options.numa_node) + " not found, not pinning decode workers");
+      return {};
+    }
+    if (cpus.empty()) {
+      cpus = node_cpus;
+    } else {
+      cpus.erase(std::remove_if(cpus.begin(), cpus.end(),
+                                [&node_cpus](int cpu) {
+                                  return std::find(node_cpus.begin(), node_cpus.end(), cpu) == node_cpus.end();
+                                }),
+                 cpus.end());
+      if (cpus.empty()) {
+        LOG_WARN("No CPU of '" + options.cpus + "' is on NUMA node " + std::to_string(options.numa_node) +
+                 ", not pinning decode workers");
+      }
+    }
+  }
+  return cpus;
+}
+
+}  // namespace
+
+// Start the workers, pinning worker i to the i-th configured CPU. A
+// failed pin is logged and the worker runs unpinned.
+Scheduler::Scheduler(SchedulerOptions options) {
+  const std::vector<int> cpus = ResolveCpus(options);
+  size_t threads = options.threads;
+  if (threads == 0) {
+    threads = !cpus.empty() ? cpus.size() : std::max(1u, std::thread::hardware_concurrency());
+  }
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.push_back(std::make_unique<Worker>());
+  }
+  for (size_t i = 0; i < threads; ++i) {
+    workers_[i]->thread = std::thread([this, i]() { Run(i); });
+    if (cpus.empty()) {
+      continue;
+    }
+    const int cpu = cpus[i % cpus.size()];
+    if (cpu >= CPU_SETSIZE) {
+      LOG_WARN("CPU " + std::to_string(cpu) + " out of range, decode worker not pinned");
+      continue;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const int err = pthread_setaffinity_np(workers_[i]->thread.native_handle(), sizeof(set), &set);
+    if (err != 0) {
+      LOG_WARN("Could not pin decode worker to CPU " + std::to_string(cpu) + ": " + std::strerror(err));
+      continue;
+    }
+    worker_cpus_.push_back(cpu);
+  }
+  if (worker_cpus_.size() != threads) {
+    worker_cpus_.clear();
+  }
+}
+
+// Workers keep running until every queue is empty, including tasks that
+// queued tasks submit, then exit.
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  wake_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker->thread.joinable()) {
+      worker->thread.join();
+    }
+  }
+}
+
+// Queue on the calling worker's own queue, or round-robin from outside.
+// queued_ is raised under the queue's lock, before the task is visible,
+// so it never undercounts. A sleeping worker is woken to run or steal it.
+void Scheduler::Submit(Task task) {
+  const size_t target =
+      current_scheduler == this ? current_worker : next_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+  {
+    Worker& worker = *workers_[target];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    queued_.fetch_add(1);
+    worker.tasks.push_back(std::move(task));
+  }
+  if (sleepers_.load() > 0) {
+    // Taking the mutex orders the notify after a worker that saw
+    // queued_ == 0 has started waiting
+    { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+    wake_.notify_one();
+  }
+}
+
+SchedulerStats Scheduler::GetStats() const {
+  SchedulerStats stats;
+  stats.executed = executed_.load(std::memory_order_relaxed);
+  stats.stolen = stolen_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+// Worker loop: own queue first, then the others', then sleep until
+// something is queued. Exits on shutdown once nothing is queued anywhere.
+void Scheduler::Run(size_t index) {
+  current_scheduler = this;
+  current_worker = index;
+  for (;;) {
+    Task task;
+    bool found = Pop(index, &task);
+    if (!found && Steal(index, &task)) {
+      found = true;
+      stolen_.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (found) {
+      try {
+        task();
+      } catch (const std::exception& e) {
+        LOG_ERROR(std::string("Scheduler task failed: ") + e.what());
+      } catch (...) {
+        LOG_ERROR("Scheduler task failed with unknown exception");
+      }
+      executed_.fetch_add(1, std::memory_order_relaxed);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    sleepers_.fetch_add(1);
+    wake_.wait(lock, [this] { return queued_.load() > 0 || stopping_; });
+    sleepers_.fetch_sub(1);
+    if (stopping_ && queued_.load() == 0) {
+      return;
+    }
+  }
+}
+
+bool Scheduler::Pop(size_t index, Task* task) {
+  Worker& worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.tasks.empty()) {
+    return false;
+  }
+  *task = std::move(worker.tasks.front());
+  worker.tasks.pop_front();
+  queued_.fetch_sub(1);
+  return true;
+}
+
+// Victims are scanned starting after index, so idle workers spread over
+// different victims instead of all contending for worker 0.
+bool Scheduler::Steal(size_t index, Task* task) {
+  for (size_t offset = 1; offset < workers_.size(); ++offset) {
+    if (Pop((index + offset) % workers_.size(), task)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Ranges are inclusive ("2-4" is 2, 3, 4); surrounding whitespace (the
+// newline of a sysfs file) is ignored and an empty list is valid.
+bool ParseCpuList(const std::string& text, std::vector<int>* cpus) {
+  const size_t first = text.find_first_not_of(" \t\n");
+  if (first == std::string::npos) {
+    cpus->clear();
+    return true;
+  }
+  const std::string trimmed = text.substr(first, text.find_last_not_of(" \t\n") - first + 1);
+  std::vector<int> parsed;
+  std::stringstream stream(trimmed);
+  std::string item;
+  while (std::getline(stream, item, ',')) {
+    const size_t dash = item.find('-');
+    int low = 0;
+    int high = 0;
+    if (dash == std::string::npos) {
+      if (!ParseCpu(item, &low)) {
+        return false;
+      }
+      high = low;
+    } else if (!ParseCpu(item.substr(0, dash), &low) || !ParseCpu(item.substr(dash + 1), &high) || high < low) {
+      return false;
+    }
+    for (int cpu = low; cpu <= high; ++cpu) {
+      parsed.push_back(cpu);
+    }
+  }
+  if (parsed.empty() || trimmed.back() == ',') {
+    return false;
+  }
+  *cpus = std::move(parsed);
+  return true;
+}
+
+bool NumaNodeCpus(int node, std::vector<int>* cpus) {
+  std::ifstream in("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+  std::string text;
+  if (!in || !std::getline(in, text)) {
+    return false;
+  }
+  return ParseCpuList(text, cpus);
+}
+
+}  // namespace util
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Where a Scheduler's workers run (see util::Args for the command-line side).
+struct SchedulerOptions {
+  // Worker threads; 0 = one per CPU allowed by cpus / numa_node (or per
+  // core if neither is set)
+  size_t threads = 0;
+
+  // CPUs to pin workers to, e.g. "0-7,16-23"; worker i runs on the i-th
+  // CPU of the list (wrapping). Empty leaves placement to the kernel.
+  std::string cpus;
+
+  // NUMA node whose CPUs the workers are pinned to (read from sysfs);
+  // combined with cpus, only CPUs in both are used. -1 for any node.
+  int numa_node = -1;
+};
+
+// Counters of a Scheduler, see Scheduler::GetStats().
+struct SchedulerStats {
+  uint64_t executed = 0;  // Tasks run
+  uint64_t stolen = 0;    // Tasks run by a worker other than the one they were queued on
+};
+
+// Work-stealing pool of worker threads.
+//
+// Each worker has its own task queue. Tasks submitted by a worker (a
+// util::Strand requeueing itself) go to that worker's queue, and tasks
+// from other threads (reactor I/O threads) are spread round-robin. A
+// worker runs its own queue oldest first and, when it is empty, steals
+// the oldest task of another worker before going to sleep. Compared to
+// util::ThreadPool's single queue, workers rarely contend for the same
+// lock, and a strand keeps running on the core whose caches hold its
+// decoder state until another core runs out of work.
+//
+// Tasks have no ordering guarantee; per-stream order comes from
+// util::Strand on top.
+//
+// Lifecycle:
+//   1. Construct (workers start immediately, pinned if configured)
+//   2. Submit() tasks from any thread, including from tasks
+//   3. Destruction runs every queued task, then joins
+//
+// Thread-safe: yes.
+class Scheduler {
+ public:
+  using Task = std::function<void()>;
+
+  explicit Scheduler(SchedulerOptions options = {});
+
+  // Runs the tasks still queued and joins all workers.
+  ~Scheduler();
+
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+
+  // Queue a task. Exceptions escaping a task are caught and logged.
+  void Submit(Task task);
+
+  // Number of worker threads.
+  size_t size() const { return workers_.size(); }
+
+  // CPU each worker is pinned to, in worker order (empty unless every
+  // worker could be pinned).
+  const std::vector<int>& cpus() const { return worker_cpus_; }
+
+  SchedulerStats GetStats() const;
+
+ private:
+  // One worker: its queue and thread.
+  struct Worker {
+    std::mutex mutex;  // Guards tasks
+    std::deque<Task> tasks;
+    std::thread thread;
+  };
+
+  // Worker loop: run own tasks, else steal, else sleep.
+  void Run(size_t index);
+
+  // Take the oldest task of worker index's queue.
+  bool Pop(size_t index, Task* task);
+
+  // Take the oldest task of another worker, scanning from index + 1.
+  bool Steal(size_t index, Task* task);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<int> worker_cpus_;
+  std::atomic<size_t> next_{0};  // Round-robin target of external Submit()
+
+  // Sleeping workers. queued_ and sleepers_ are both sequentially
+  // consistent: a worker announces itself in sleepers_ before rechecking
+  // queued_, Submit() bumps queued_ before reading sleepers_, so one of
+  // them always sees the other.
+  std::mutex sleep_mutex_;
+  std::condition_variable wake_;
+  std::atomic<size_t> queued_{0};
+  std::atomic<size_t> sleepers_{0};
+  bool stopping_ = false;  // Guarded by sleep_mutex_
+
+  std::atomic<uint64_t> executed_{0};
+  std::atomic<uint64_t> stolen_{0};
+};
+
+// Parse a CPU list in the kernel's format ("0-3,8,10-11").
+//
+// Returns: false on malformed input (cpus unchanged)
+bool ParseCpuList(const std::string& text, std::vector<int>* cpus);
+
+// CPUs of a NUMA node, from /sys/devices/system/node/node<N>/cpulist.
+//
+// Returns: false if the node does not exist (or sysfs is unavailable)
+bool NumaNodeCpus(int node, std::vector<int>* cpus);
+
+}  // namespace util
@@ -0,0 +1,60 @@
+#include "util/StopEvent.h"
+
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include "util/Log.h"
+
+namespace util {
+
+// Create the eventfd. Without one (descriptor limit reached) the event
+// still works: IsSet() reads the flag and Wait() sleeps in short steps.
+StopEvent::StopEvent() : fd_(eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK)) {
+  if (fd_ < 0) {
+    LOG_ERROR(std::string("eventfd failed: ") + std::strerror(errno));
+  }
+}
+
+StopEvent::~StopEvent() {
+  if (fd_ >= 0) {
+    close(fd_);
+  }
+}
+
+// Set the flag, then add 1 to the eventfd counter. Nobody reads it back,
+// so the descriptor stays readable; repeated calls only grow the counter.
+void StopEvent::Set() {
+  set_.store(true);
+  const uint64_t one = 1;
+  if (fd_ >= 0) {
+    ssize_t ignored = write(fd_, &one, sizeof(one));
+    (void)ignored;
+  }
+}
+
+bool StopEvent::IsSet() const {
+  return set_.load();
+}
+
+// poll() the eventfd; EINTR ends the wait early (callers loop on their
+// own conditions anyway).
+bool StopEvent::Wait(int timeout_ms) const {
+  constexpr int kFallbackStepMs = 10;
+  if (set_.load()) {
+    return true;
+  }
+  if (fd_ < 0 && (timeout_ms < 0 || timeout_ms > kFallbackStepMs)) {
+    timeout_ms = kFallbackStepMs;
+  }
+  pollfd pfd{fd_, POLLIN, 0};
+  poll(&pfd, 1, timeout_ms);
+  return set_.load();
+}
+
+}  // namespace util
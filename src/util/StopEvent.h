@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+
+namespace util {
+
+// One-shot stop request that threads can sleep on: an eventfd that
+// becomes (and stays) readable once Set() is called.
+//
+// Loops that wait in poll()/epoll add fd() to their descriptor set, so a
+// stop wakes them at once instead of being noticed at the next timeout;
+// such loops can then block indefinitely while idle and use no CPU.
+//
+// Lifecycle:
+//   1. Construct (creates the eventfd)
+//   2. Waiters poll fd(), or call Wait()
+//   3. Set() from any thread; every current and future wait returns
+//
+// Thread-safe: yes.
+class StopEvent {
+ public:
+  StopEvent();
+  ~StopEvent();
+
+  StopEvent(const StopEvent&) = delete;
+  StopEvent& operator=(const StopEvent&) = delete;
+
+  // Request the stop. Async-signal-safe (one write()).
+  void Set();
+
+  // Whether Set() was called.
+  bool IsSet() const;
+
+  // Sleep until Set() or the timeout. May return early (EINTR, or in
+  // short steps without an eventfd); callers recheck their conditions.
+  //
+  // Param: timeout_ms - Longest wait; -1 waits until Set()
+  // Returns: true if set
+  bool Wait(int timeout_ms) const;
+
+  // Descriptor readable once set (POLLIN / EPOLLIN), or -1 if the
+  // eventfd could not be created (poll() then ignores it; bound the wait).
+  // Do not read from it: the event stays set for every waiter.
+  int fd() const { return fd_; }
+
+ private:
+  std::atomic<bool> set_{false};
+  int fd_ = -1;
+};
+
+}  // namespace util
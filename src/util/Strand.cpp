@@ -0,0 +1,85 @@
+#include "util/Strand.h"
+
+#include <exception>
+#include <string>
+
+#include "util/Log.h"
+#include "util/Metrics.h"
+
+namespace util {
+
+Strand::Strand(Scheduler* scheduler, size_t batch, int64_t budget_us)
+    : scheduler_(scheduler), batch_(batch == 0 ? 1 : batch), budget_us_(budget_us) {}
+
+Strand::~Strand() {
+  Drain();
+}
+
+// Queue the task; schedule a turn on the pool unless one is already
+// queued or running (it will pick the task up).
+void Strand::Post(Task task) {
+  bool schedule = false;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    ++pending_;
+    if (!scheduled_) {
+      scheduled_ = true;
+      schedule = true;
+    }
+  }
+  if (schedule) {
+    scheduler_->Submit([this]() { RunBatch(); });
+  }
+}
+
+void Strand::Drain() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return pending_ == 0 && !scheduled_; });
+}
+
+size_t Strand::pending() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return pending_;
+}
+
+// Run queued tasks one at a time outside the lock. After batch_ tasks or
+// budget_us_, submit a new turn if work remains; it goes to the back of
+// this worker's queue, so other strands' turns queued in the meantime run
+// first (or another worker steals it). Exceptions are logged like the
+// Scheduler's and do not stop the strand.
+void Strand::RunBatch() {
+  const int64_t start_us = budget_us_ > 0 ? NowMicros() : 0;
+  for (size_t run = 0;; ++run) {
+    Task task;
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (tasks_.empty()) {
+        scheduled_ = false;
+        idle_.notify_all();
+        return;
+      }
+      if (run == batch_ || (budget_us_ > 0 && run > 0 && NowMicros() - start_us >= budget_us_)) {
+        break;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    try {
+      task();
+    } catch (const std::exception& e) {
+      LOG_ERROR(std::string("Strand task failed: ") + e.what());
+    } catch (...) {
+      LOG_ERROR("Strand task failed with unknown exception");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) {
+      idle_.notify_all();
+    }
+  }
+  scheduler_->Submit([this]() { RunBatch(); });
+}
+
+}  // namespace util
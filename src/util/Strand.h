@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <mutex>
+
+#include "util/Scheduler.h"
+
+namespace util {
+
+// Serial task queue on a shared Scheduler.
+//
+// Tasks posted to one strand run one at a time and in posting order, on
+// whichever scheduler worker picks the strand up; tasks of different
+// strands run in parallel. A decoder is stateful and single-threaded, so
+// each stream's decode work goes to its own strand while all streams
+// share the scheduler's workers.
+//
+// A strand never holds a worker for long: a turn ends after `batch` tasks
+// or once it has run for `budget_us`, whichever comes first, and the
+// strand requeues itself behind the other strands' work. The budget is
+// what keeps a 4K stream fair to many 360p streams: its frames cost ten
+// times more, so it gets one or two frames per turn while a small stream
+// gets its whole batch.
+//
+// Lifecycle:
+//   1. Construct with the scheduler (must outlive the strand)
+//   2. Post() tasks from any thread
+//   3. Drain() (or destruction) waits for posted tasks to finish
+//
+// Thread-safe: yes. Drain() must not be called from a task of the strand
+// or of the same scheduler.
+class Strand {
+ public:
+  using Task = std::function<void()>;
+
+  // Param: scheduler - Workers that run the tasks
+  // Param: batch - Most tasks run per turn (clamped to >= 1)
+  // Param: budget_us - Time after which a turn ends early (the task
+  //   running then finishes first); 0 for no limit
+  explicit Strand(Scheduler* scheduler, size_t batch = 8, int64_t budget_us = 2000);
+
+  // Waits for posted tasks (Drain()).
+  ~Strand();
+
+  Strand(const Strand&) = delete;
+  Strand& operator=(const Strand&) = delete;
+
+  // Queue a task behind the strand's earlier tasks.
+  void Post(Task task);
+
+  // Block until every task posted so far has run.
+  void Drain();
+
+  // Tasks posted and not yet finished.
+  size_t pending() const;
+
+ private:
+  // One turn on a scheduler worker: run up to batch_ tasks within
+  // budget_us_, then requeue or go idle.
+  void RunBatch();
+
+  Scheduler* scheduler_;
+  const size_t batch_;
+  const int64_t budget_us_;
+  mutable std::mutex mutex_;
+  std::condition_variable idle_;  // Signalled when pending_ reaches 0
+  std::deque<Task> tasks_;
+  size_t pending_ = 0;      // Posted, not yet finished
+  bool scheduled_ = false;  // A RunBatch() is queued on or running in the scheduler
+};
+
+}  // namespace util
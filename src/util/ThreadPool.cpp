@@ -0,0 +1,85 @@
+#include "util/ThreadPool.h"
+
+#include <exception>
+#include <string>
+
+#include "util/Log.h"
+
+namespace util {
+
+ThreadPool::ThreadPool(size_t threads) {
+  if (threads == 0) {
+    threads = 1;
+  }
+  workers_.reserve(threads);
+  for (size_t i = 0; i < threads; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+// Drain queued tasks and join all workers.
+// Tasks submitted before destruction are still executed.
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  task_ready_.notify_all();
+  for (auto& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+// Queue a task and wake one idle worker.
+//
+// Param: task - Callable to run on a worker thread
+void ThreadPool::Submit(Task task) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    tasks_.push_back(std::move(task));
+    ++pending_;
+  }
+  task_ready_.notify_one();
+}
+
+// Block until all submitted tasks (queued and running) have finished.
+void ThreadPool::Wait() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  idle_.wait(lock, [this] { return pending_ == 0; });
+}
+
+// Worker thread main loop.
+// Waits for tasks, runs them outside the lock, and signals idle_ when the
+// last pending task completes. Exits once stopping_ is set and the queue
+// is empty, so shutdown never discards work.
+void ThreadPool::WorkerLoop() {
+  while (true) {
+    Task task;
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      task_ready_.wait(lock, [this] { return stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) {
+        return;
+      }
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+
+    try {
+      task();
+    } catch (const std::exception& e) {
+      LOG_ERROR(std::string("Thread pool task failed: ") + e.what());
+    } catch (...) {
+      LOG_ERROR("Thread pool task failed with unknown exception");
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (--pending_ == 0) {
+      idle_.notify_all();
+    }
+  }
+}
+
+}  // namespace util
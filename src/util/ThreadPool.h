@@ -0,0 +1,63 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace util {
+
+// Fixed-size pool of worker threads executing queued tasks.
+//
+// Tasks are run in submission order by whichever worker is free first;
+// there is no ordering guarantee between tasks running on different
+// workers. Callers that need ordered results (e.g. FrameWriter's ordered
+// writes) must reorder completions themselves.
+//
+// Lifecycle:
+//   1. Construct with the number of workers (threads start immediately)
+//   2. Submit() tasks from any thread
+//   3. Destruction waits for all queued tasks to finish, then joins
+//
+// Thread-safe: Submit() and Wait() may be called from any thread, but not
+// from inside a task running on the same pool (Wait() would deadlock).
+class ThreadPool {
+ public:
+  using Task = std::function<void()>;
+
+  // Param: threads - Number of worker threads (clamped to >= 1)
+  explicit ThreadPool(size_t threads);
+
+  // Drains the queue and joins all workers.
+  ~ThreadPool();
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  // Queue a task for execution on a worker thread.
+  // Exceptions escaping a task are caught and logged.
+  void Submit(Task task);
+
+  // Block until every task submitted so far has finished.
+  void Wait();
+
+  // Number of worker threads.
+  size_t size() const { return workers_.size(); }
+
+ private:
+  // Worker loop: pop and run tasks until shutdown and the queue is empty.
+  void WorkerLoop();
+
+  std::mutex mutex_;
+  std::condition_variable task_ready_;  // Signalled on Submit() and shutdown
+  std::condition_variable idle_;        // Signalled when pending_ reaches 0
+  std::deque<Task> tasks_;              // Queued, not yet started
+  size_t pending_ = 0;                  // Queued + running tasks
+  bool stopping_ = false;               // Set by destructor
+  std::vector<std::thread> workers_;
+};
+
+}  // namespace util
@@ -0,0 +1,57 @@
+#include <cassert>
+#include <thread>
+
+#include "util/BoundedQueue.h"
+
+int main() {
+  // drop-oldest keeps the newest items and counts evictions
+  {
+    util::BoundedQueue<int> queue(2, util::OverflowPolicy::kDropOldest);
+    assert(queue.Push(1));
+    assert(queue.Push(2));
+    assert(queue.Push(3));
+    int value = 0;
+    assert(queue.Pop(value) && value == 2);
+    assert(queue.Pop(value) && value == 3);
+    assert(queue.GetStats().dropped_oldest == 1);
+  }
+
+  // drop-newest rejects the incoming item
+  {
+    util::BoundedQueue<int> queue(2, util::OverflowPolicy::kDropNewest);
+    assert(queue.Push(1));
+    assert(queue.Push(2));
+    assert(!queue.Push(3));
+    int value = 0;
+    assert(queue.Pop(value) && value == 1);
+    assert(queue.GetStats().dropped_newest == 1);
+  }
+
+  // block waits for a consumer; Close() drains remaining items
+  {
+    util::BoundedQueue<int> queue(1, util::OverflowPolicy::kBlock);
+    std::thread producer([&queue]() {
+      for (int i = 0; i < 100; ++i) {
+        queue.Push(i);
+      }
+      queue.Close();
+    });
+    int expected = 0;
+    int value = 0;
+    while (queue.Pop(value)) {
+      assert(value == expected);
+      ++expected;
+    }
+    producer.join();
+    assert(expected == 100);
+    assert(queue.GetStats().dropped_oldest == 0);
+    assert(queue.GetStats().dropped_newest == 0);
+  }
+
+  util::OverflowPolicy policy = util::OverflowPolicy::kBlock;
+  assert(util::ParseOverflowPolicy("drop-newest", &policy));
+  assert(policy == util::OverflowPolicy::kDropNewest);
+  assert(!util::ParseOverflowPolicy("bogus", &policy));
+
+  return 0;
+}
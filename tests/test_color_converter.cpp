@@ -0,0 +1,161 @@
+extern "C" {
+#include <libavutil/frame.h>
+}
+
+#include <cassert>
+#include <cstring>
+
+#include <opencv2/core.hpp>
+
+#include "media/ColorConverter.h"
+
+namespace {
+
+// YUV420P frame, black left half and white right half, neutral chroma.
+AVFrame* MakeFrame(int width, int height) {
+  AVFrame* frame = av_frame_alloc();
+  frame->width = width;
+  frame->height = height;
+  frame->format = AV_PIX_FMT_YUV420P;
+  assert(av_frame_get_buffer(frame, 32) == 0);
+  for (int y = 0; y < height; ++y) {
+    uint8_t* row = frame->data[0] + y * frame->linesize[0];
+    for (int x = 0; x < width; ++x) {
+      row[x] = x < width / 2 ? 16 : 235;
+    }
+  }
+  for (int plane = 1; plane < 3; ++plane) {
+    for (int y = 0; y < height / 2; ++y) {
+      std::memset(frame->data[plane] + y * frame->linesize[plane], 128, width / 2);
+    }
+  }
+  return frame;
+}
+
+// YUV420P frame with vertical gradients: luma and both chroma planes
+// change on every row, so a slice boundary that cut a chroma row in two
+// (or was off by one) would show in the output.
+AVFrame* MakeGradientFrame(int width, int height) {
+  AVFrame* frame = av_frame_alloc();
+  frame->width = width;
+  frame->height = height;
+  frame->format = AV_PIX_FMT_YUV420P;
+  assert(av_frame_get_buffer(frame, 32) == 0);
+  for (int y = 0; y < height; ++y) {
+    std::memset(frame->data[0] + y * frame->linesize[0], 16 + y * 219 / (height - 1), width);
+  }
+  const int chroma_width = (width + 1) / 2;
+  const int chroma_height = (height + 1) / 2;
+  for (int y = 0; y < chroma_height; ++y) {
+    const int step = y * 224 / (chroma_height - 1);
+    std::memset(frame->data[1] + y * frame->linesize[1], 16 + step, chroma_width);
+    std::memset(frame->data[2] + y * frame->linesize[2], 240 - step, chroma_width);
+  }
+  return frame;
+}
+
+media::ColorConverterOptions Options(cv::Rect crop, cv::Size size, size_t threads = 1) {
+  media::ColorConverterOptions options;
+  options.threads = threads;
+  options.crop = crop;
+  options.size = size;
+  return options;
+}
+
+// Every byte of image within [low, high].
+bool AllWithin(const cv::Mat& image, int low, int high) {
+  for (int y = 0; y < image.rows; ++y) {
+    const uchar* row = image.ptr<uchar>(y);
+    for (int x = 0; x < image.cols * 3; ++x) {
+      if (row[x] < low || row[x] > high) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  // Command-line syntax
+  cv::Size size;
+  assert(media::ParseOutputSize("640x360", &size) && size == cv::Size(640, 360));
+  assert(media::ParseOutputSize("640x0", &size) && size == cv::Size(640, 0));
+  assert(!media::ParseOutputSize("0x0", &size));
+  assert(!media::ParseOutputSize("640", &size));
+  assert(!media::ParseOutputSize("640x-1", &size));
+  assert(!media::ParseOutputSize("640x360x1", &size));
+  cv::Rect crop;
+  assert(media::ParseCropRect("10,20,300,200", &crop) && crop == cv::Rect(10, 20, 300, 200));
+  assert(!media::ParseCropRect("10,20,0,200", &crop));
+  assert(!media::ParseCropRect("10,20,300", &crop));
+  assert(!media::ParseCropRect("10,20,300,200,", &crop));
+
+  // Output geometry: crop clipped to the frame, a 0 side keeps the aspect
+  assert(media::ColorConverter().OutputSize(1920, 1080) == cv::Size(1920, 1080));
+  assert(media::ColorConverter(Options({}, {640, 0})).OutputSize(1920, 1080) == cv::Size(640, 360));
+  assert(media::ColorConverter(Options({0, 0, 960, 540}, {0, 180})).OutputSize(1920, 1080) == cv::Size(320, 180));
+  assert(media::ColorConverter(Options({1800, 1000, 400, 400}, {})).OutputSize(1920, 1080) == cv::Size(120, 80));
+
+  AVFrame* frame = MakeFrame(320, 256);
+
+  // Crop only the white half, at an odd corner (aligned down to even)
+  {
+    media::ColorConverter converter(Options({161, 11, 150, 100}, {}));
+    cv::Mat dst(100, 150, CV_8UC3);
+    assert(converter.Convert(frame, dst));
+    assert(AllWithin(dst, 240, 255));
+  }
+
+  // Crop and resize in one pass
+  {
+    media::ColorConverter converter(Options({0, 0, 160, 256}, {40, 64}));
+    cv::Mat dst(64, 40, CV_8UC3);
+    assert(converter.Convert(frame, dst));
+    assert(converter.slice_count() == 1);
+    assert(AllWithin(dst, 0, 15));
+
+    // A destination of another size is rejected
+    cv::Mat wrong(256, 320, CV_8UC3);
+    assert(!converter.Convert(frame, wrong));
+  }
+
+  // Sliced conversion of a crop matches the single-threaded one
+  {
+    media::ColorConverter single(Options({100, 0, 200, 256}, {}));
+    media::ColorConverter sliced(Options({100, 0, 200, 256}, {}, 4));
+    cv::Mat expected(256, 200, CV_8UC3);
+    cv::Mat actual(256, 200, CV_8UC3);
+    assert(single.Convert(frame, expected));
+    assert(sliced.Convert(frame, actual));
+    assert(sliced.slice_count() == 4);
+    for (int y = 0; y < expected.rows; ++y) {
+      assert(std::memcmp(expected.ptr<uchar>(y), actual.ptr<uchar>(y), expected.cols * 3) == 0);
+    }
+  }
+
+  av_frame_free(&frame);
+
+  // Sliced conversion of a whole frame is byte-identical to the
+  // single-threaded one, for any slice count. 270 rows: the chroma plane
+  // has an odd row count and no band size divides the frame evenly.
+  frame = MakeGradientFrame(320, 270);
+  {
+    media::ColorConverter single(Options({}, {}));
+    cv::Mat expected(270, 320, CV_8UC3);
+    assert(single.Convert(frame, expected));
+    assert(single.slice_count() == 1);
+    for (size_t threads : {2, 3, 4}) {
+      media::ColorConverter sliced(Options({}, {}, threads));
+      cv::Mat actual(270, 320, CV_8UC3);
+      assert(sliced.Convert(frame, actual));
+      assert(sliced.slice_count() == threads);
+      for (int y = 0; y < expected.rows; ++y) {
+        assert(std::memcmp(expected.ptr<uchar>(y), actual.ptr<uchar>(y), expected.cols * 3) == 0);
+      }
+    }
+  }
+  av_frame_free(&frame);
+  return 0;
+}
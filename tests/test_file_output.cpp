@@ -0,0 +1,110 @@
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include "util/FileOutput.h"
+
+namespace {
+
+std::vector<uint8_t> ReadFile(const std::filesystem::path& path) {
+  std::ifstream in(path, std::ios::binary);
+  return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+}  // namespace
+
+int main() {
+  const std::filesystem::path dir = std::filesystem::temp_directory_path() / "webrtc_file_output_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  // Every backend writes the same files; uring falls back to threads where
+  // the kernel or sandbox does not allow it
+  for (const char* name : {"sync", "threads", "uring", "auto"}) {
+    util::FileOutputOptions options;
+    assert(util::ParseFileBackend(name, &options.backend));
+    options.queue_depth = 4;
+    options.fsync = std::string(name) == "threads";
+    util::FileOutput output(options);
+    assert(output.backend() != util::FileBackend::kAuto);
+
+    std::atomic<int> succeeded{0};
+    std::atomic<int> failed{0};
+    for (int i = 0; i < 40; ++i) {
+      std::vector<uint8_t> bytes = output.AcquireBuffer();
+      assert(bytes.empty());
+      bytes.assign(1000 + i * 37, static_cast<uint8_t>(i));
+      const std::string path = (dir / (std::string(name) + "_" + std::to_string(i))).string();
+      output.Write(path, std::move(bytes), [&](bool ok) { (ok ? succeeded : failed)++; });
+    }
+    // Missing directory: reported through the callback, nothing else breaks
+    output.Write((dir / "missing" / "file").string(), std::vector<uint8_t>(10, 1),
+                 [&](bool ok) { (ok ? succeeded : failed)++; });
+    output.Flush();
+    assert(succeeded == 40);
+    assert(failed == 1);
+
+    for (int i = 0; i < 40; ++i) {
+      const std::vector<uint8_t> bytes = ReadFile(dir / (std::string(name) + "_" + std::to_string(i)));
+      assert(bytes == std::vector<uint8_t>(1000 + i * 37, static_cast<uint8_t>(i)));
+    }
+
+    // Completed buffers come back to the pool with their capacity
+    assert(output.AcquireBuffer().capacity() > 0);
+
+    // Rewriting a file truncates it
+    output.Write((dir / (std::string(name) + "_0")).string(), std::vector<uint8_t>(3, 9), nullptr);
+    output.Flush();
+    assert(ReadFile(dir / (std::string(name) + "_0")) == std::vector<uint8_t>(3, 9));
+  }
+
+  // Buffers freed or reallocated outside FileOutput: a new allocation at
+  // a freed buffer's address (large buffers are mmapped, so the address
+  // is usually reused) must be written from its own pages, not from a
+  // stale fixed buffer registration
+  {
+    util::FileOutputOptions options;
+    options.backend = util::FileBackend::kUring;
+    options.queue_depth = 1;
+    util::FileOutput output(options);
+    const size_t size = 40u << 20;
+    const std::string path = (dir / "large").string();
+    auto write_and_check = [&](std::vector<uint8_t> bytes, uint8_t value) {
+      output.Write(path, std::move(bytes), nullptr);
+      output.Flush();
+      assert(ReadFile(path) == std::vector<uint8_t>(size, value));
+    };
+
+    // Pooled after the write, then taken from the pool and freed
+    write_and_check(std::vector<uint8_t>(size, 2), 2);
+    output.AcquireBuffer() = std::vector<uint8_t>();
+    write_and_check(std::vector<uint8_t>(size, 3), 3);
+
+    // Freed by FileOutput because the pool is full
+    std::vector<uint8_t> pooled = output.AcquireBuffer();
+    pooled.assign(size, 4);
+    output.Write(path, std::vector<uint8_t>(size, 5), nullptr);
+    output.Flush();
+    output.Write(path, std::move(pooled), nullptr);
+    output.Flush();
+    write_and_check(std::vector<uint8_t>(size, 6), 6);
+
+    // Reallocated by the caller after AcquireBuffer()
+    std::vector<uint8_t> grown = output.AcquireBuffer();
+    grown.assign(2 * size, 7);
+    grown.resize(size);
+    write_and_check(std::move(grown), 7);
+    write_and_check(std::vector<uint8_t>(size, 8), 8);
+  }
+
+  util::FileBackend backend;
+  assert(!util::ParseFileBackend("aio", &backend));
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include <cassert>
+
+#include <opencv2/core.hpp>
+
+#include "media/FrameGate.h"
+
+namespace {
+
+// A 1080p-sized BGR frame filled with one gray level.
+media::Frame MakeFrame(int64_t pts_us, int gray, bool key_frame = false) {
+  media::Frame frame;
+  frame.bgr = cv::Mat(1080, 1920, CV_8UC3, cv::Scalar(gray, gray, gray));
+  frame.width = 1920;
+  frame.height = 1080;
+  frame.pts_us = pts_us;
+  frame.key_frame = key_frame;
+  return frame;
+}
+
+}  // namespace
+
+int main() {
+  // Disabled gate passes everything
+  {
+    media::FrameGate gate;
+    assert(!gate.enabled());
+    assert(gate.Accept(MakeFrame(0, 0)));
+  }
+
+  // Every Nth frame, starting with the first
+  {
+    media::FrameGateOptions options;
+    options.every_n = 3;
+    media::FrameGate gate(options);
+    int kept = 0;
+    for (int i = 0; i < 9; ++i) {
+      const bool accepted = gate.Accept(MakeFrame(i * 33333, 0));
+      assert(accepted == (i % 3 == 0));
+      kept += accepted ? 1 : 0;
+    }
+    assert(kept == 3);
+    assert(gate.GetStats().skipped_every_n == 6);
+  }
+
+  // 30 fps with jittered PTS capped at 10 fps keeps every third frame
+  {
+    media::FrameGateOptions options;
+    options.max_fps = 10.0;
+    media::FrameGate gate(options);
+    int kept = 0;
+    for (int i = 0; i < 30; ++i) {
+      const int64_t jitter = (i % 2 == 0) ? 2000 : -2000;
+      kept += gate.Accept(MakeFrame(i * 33333 + jitter, 0)) ? 1 : 0;
+    }
+    assert(kept == 10);
+
+    // A backwards jump (stream restart) passes immediately
+    assert(gate.Accept(MakeFrame(0, 0)));
+  }
+
+  // Keyframes only
+  {
+    media::FrameGateOptions options;
+    options.keyframes_only = true;
+    media::FrameGate gate(options);
+    assert(gate.Accept(MakeFrame(0, 0, true)));
+    assert(!gate.Accept(MakeFrame(33333, 0, false)));
+    assert(gate.GetStats().skipped_keyframe == 1);
+  }
+
+  // Scene change: small differences are skipped, the reference only moves
+  // on kept frames, so slow drift is caught once it adds up
+  {
+    media::FrameGateOptions options;
+    options.scene_threshold = 4.0;
+    media::FrameGate gate(options);
+    assert(gate.Accept(MakeFrame(0, 100)));      // First frame always passes
+    assert(!gate.Accept(MakeFrame(1, 100)));     // Identical
+    assert(!gate.Accept(MakeFrame(2, 102)));     // Below threshold
+    assert(gate.Accept(MakeFrame(3, 105)));      // 5 from the reference
+    assert(!gate.Accept(MakeFrame(4, 107)));     // 2 from the new reference
+
+    // A small changed region: 1/8 of the frame changes by 64 (mean 8)
+    media::Frame changed = MakeFrame(5, 105);
+    changed.bgr(cv::Rect(0, 0, 240, 1080)).setTo(cv::Scalar(169, 169, 169));
+    assert(gate.Accept(changed));
+
+    const media::FrameGateStats stats = gate.GetStats();
+    assert(stats.seen == 6);
+    assert(stats.kept == 3);
+    assert(stats.skipped_unchanged == 3);
+  }
+  return 0;
+}
@@ -0,0 +1,55 @@
+#include <cassert>
+#include <vector>
+
+#include <opencv2/core.hpp>
+
+#include "media/FramePool.h"
+
+int main() {
+  media::FramePool pool(4);
+
+  // Buffers are recycled once the last reference is dropped
+  const uchar* first_data = nullptr;
+  {
+    media::FrameRef frame = pool.Acquire(8, 8, CV_8UC3);
+    first_data = frame->bgr.data;
+    media::FrameRef copy = frame;
+    frame.reset();
+    assert(pool.GetStats().outstanding == 1);
+  }
+  assert(pool.GetStats().outstanding == 0);
+  {
+    media::FrameRef frame = pool.Acquire(8, 8, CV_8UC3);
+    assert(frame->bgr.data == first_data);
+  }
+
+  // Steady state: cycling frames through a fixed depth allocates nothing new
+  std::vector<media::FrameRef> in_flight;
+  for (int i = 0; i < 3; ++i) {
+    in_flight.push_back(pool.Acquire(8, 8, CV_8UC3));
+  }
+  const uint64_t allocations = pool.GetStats().allocations;
+  for (int i = 0; i < 100; ++i) {
+    in_flight.erase(in_flight.begin());
+    in_flight.push_back(pool.Acquire(8, 8, CV_8UC3));
+  }
+  assert(pool.GetStats().allocations == allocations);
+
+  // Native-only frames carry no BGR buffer
+  {
+    media::FrameRef frame = pool.AcquireEmpty();
+    assert(frame->bgr.empty());
+    assert(frame->native == nullptr);
+  }
+
+  // Frames may outlive their pool
+  media::FrameRef survivor;
+  {
+    media::FramePool scoped(2);
+    survivor = scoped.Acquire(2, 2, CV_8UC3);
+  }
+  assert(survivor->bgr.rows == 2);
+  survivor.reset();
+
+  return 0;
+}
@@ -0,0 +1,214 @@
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "app/SinkExecutor.h"
+#include "app/SinkRegistry.h"
+#include "media/FramePool.h"
+
+namespace {
+
+// Counts frames; optionally slow, to stand in for a PNG encoder.
+class CountingSink : public media::FrameSink {
+ public:
+  explicit CountingSink(std::chrono::milliseconds delay = std::chrono::milliseconds(0)) : delay_(delay) {}
+
+  uint32_t RequiredFormats() const override { return media::kFormatNative; }
+
+  void OnFrame(const media::FrameRef& frame) override {
+    assert(frame);
+    last_thread = std::this_thread::get_id();
+    std::this_thread::sleep_for(delay_);
+    ++frames;
+  }
+
+  void Close() override { ++closed; }
+
+  std::atomic<int> frames{0};
+  std::atomic<int> closed{0};
+  std::thread::id last_thread;
+
+ private:
+  std::chrono::milliseconds delay_;
+};
+
+// Records packets and frames in arrival order, as a muxer would see them.
+class PacketSink : public media::FrameSink {
+ public:
+  uint32_t RequiredFormats() const override { return media::kFormatNone; }
+  void OnFrame(const media::FrameRef&) override { events.push_back("frame"); }
+  bool WantsPackets() const override { return true; }
+
+  void OnPacket(const AVPacket* packet, const AVCodecParameters* codecpar, const AVRational& time_base) override {
+    assert(time_base.num == 1 && time_base.den == 90000);
+    thread = std::this_thread::get_id();
+    events.push_back("packet " + std::to_string(packet->pts) + " " +
+                     std::string(reinterpret_cast<const char*>(packet->data), packet->size) + " " +
+                     std::to_string(codecpar->width));
+  }
+
+  void Close() override {}
+
+  std::vector<std::string> events;  // Sink thread only, read after Stop()
+  std::thread::id thread;
+};
+
+app::SinkExecutorOptions Options(size_t threads, size_t queue, util::OverflowPolicy policy) {
+  app::SinkExecutorOptions options;
+  options.threads = threads;
+  options.queue_size = queue;
+  options.policy = policy;
+  return options;
+}
+
+}  // namespace
+
+int main() {
+  media::FramePool pool;
+
+  // Inline sinks run on the submitting thread, before Submit() returns
+  {
+    auto sink = std::make_unique<CountingSink>();
+    CountingSink* counts = sink.get();
+    app::SinkExecutor executor("inline", "test", std::move(sink), Options(0, 64, util::OverflowPolicy::kBlock));
+    assert(executor.inline_sink());
+    executor.Start();
+    executor.Submit(pool.AcquireEmpty());
+    assert(counts->frames == 1);
+    assert(counts->last_thread == std::this_thread::get_id());
+    executor.Stop();
+    executor.Stop();
+    assert(counts->closed == 1);
+  }
+
+  // A slow sink drops its own frames and does not hold back a fast one
+  {
+    auto slow_sink = std::make_unique<CountingSink>(std::chrono::milliseconds(20));
+    auto fast_sink = std::make_unique<CountingSink>();
+    CountingSink* slow_counts = slow_sink.get();
+    CountingSink* fast_counts = fast_sink.get();
+    app::SinkExecutor slow("slow", "test", std::move(slow_sink), Options(1, 2, util::OverflowPolicy::kDropOldest));
+    app::SinkExecutor fast("fast", "test", std::move(fast_sink), Options(1, 64, util::OverflowPolicy::kBlock));
+    slow.Start();
+    fast.Start();
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < 30; ++i) {
+      media::FrameRef frame = pool.AcquireEmpty();
+      slow.Submit(frame);
+      fast.Submit(frame);
+    }
+    // 30 frames at 20 ms would take 600 ms if the slow sink set the pace
+    assert(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(300));
+    for (int i = 0; i < 200 && fast_counts->frames < 30; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(fast_counts->frames == 30);
+    assert(slow_counts->frames < 30);
+
+    slow.Stop();
+    fast.Stop();
+    const util::QueueStats stats = slow.GetStats();
+    assert(stats.dropped_oldest > 0);
+    assert(slow_counts->frames + static_cast<int>(stats.dropped_oldest) == 30);
+    assert(slow_counts->closed == 1 && fast_counts->closed == 1);
+    assert(pool.GetStats().outstanding == 0);  // Dropped and consumed frames went back to the pool
+  }
+
+  // A blocking queue delivers everything, across several threads
+  {
+    auto sink = std::make_unique<CountingSink>(std::chrono::milliseconds(1));
+    CountingSink* counts = sink.get();
+    app::SinkExecutor executor("block", "test", std::move(sink), Options(3, 2, util::OverflowPolicy::kBlock));
+    executor.Start();
+    for (int i = 0; i < 50; ++i) {
+      executor.Submit(pool.AcquireEmpty());
+    }
+    executor.Stop();
+    assert(counts->frames == 50);
+  }
+
+  // Packets are queued in order with the frames and reach the sink on its
+  // own thread, with their own reference to the data and parameters
+  {
+    auto sink = std::make_unique<PacketSink>();
+    PacketSink* packets = sink.get();
+    app::SinkExecutor executor("video", "test", std::move(sink), Options(1, 16, util::OverflowPolicy::kBlock));
+    executor.Start();
+    AVCodecParameters* codecpar = avcodec_parameters_alloc();
+    codecpar->codec_id = AV_CODEC_ID_VP8;
+    AVPacket* packet = av_packet_alloc();
+    for (int i = 0; i < 3; ++i) {
+      codecpar->width = i < 2 ? 0 : 320;  // Known once the first frame is decoded
+      assert(av_new_packet(packet, 3) == 0);
+      packet->data[0] = 'a';
+      packet->data[1] = static_cast<uint8_t>('0' + i);
+      packet->data[2] = 'z';
+      packet->pts = i * 3000;
+      executor.SubmitPacket(packet, codecpar, AVRational{1, 90000});
+      av_packet_unref(packet);  // The queued copy keeps the data
+      executor.Submit(pool.AcquireEmpty());
+    }
+    av_packet_free(&packet);
+    avcodec_parameters_free(&codecpar);
+    executor.Stop();
+    assert(packets->events == std::vector<std::string>({"packet 0 a0z 0", "frame", "packet 3000 a1z 0", "frame",
+                                                        "packet 6000 a2z 320", "frame"}));
+    assert(packets->thread != std::this_thread::get_id());
+  }
+
+  // Sink selection: derived from the output flags, or --sinks
+  util::Args args;
+  args.write_images = true;
+  args.write_video = false;
+  assert(app::SelectSinks(args) == std::vector<std::string>({"images"}));
+  args.write_video = true;
+  args.shm_publish = "cam";
+  assert(app::SelectSinks(args) == std::vector<std::string>({"images", "video", "shm"}));
+  args.sinks = " shm, video ,shm,,";
+  assert(app::SelectSinks(args) == std::vector<std::string>({"shm", "video"}));
+
+  // --sink-option overrides apply to the named sink only
+  args.sink_options = {"count.threads=0", "count.policy=block", "count.queue=7", "counter.threads=5",
+                       "count.bogus=1", "malformed", "count.policy=sometimes"};
+  app::SinkExecutorOptions options;
+  app::ApplySinkOptions(args, "count", &options);
+  assert(options.threads == 0 && options.queue_size == 7 && options.policy == util::OverflowPolicy::kBlock);
+
+  // The video sink keeps its order on one thread (or inline)
+  util::Args video_args;
+  video_args.sink_options = {"video.threads=4"};
+  app::SinkExecutorOptions video_options;
+  app::ApplySinkOptions(video_args, "video", &video_options);
+  assert(video_options.threads == 1);
+  video_args.sink_options = {"video.threads=0"};
+  app::ApplySinkOptions(video_args, "video", &video_options);
+  assert(video_options.threads == 0);
+
+  // Registered sinks are created by name with their defaults plus overrides
+  app::SinkRegistry& registry = app::SinkRegistry::Instance();
+  assert(registry.Contains("images") && registry.Contains("video") && registry.Contains("shm"));
+  registry.Register("count", app::SinkRegistration{
+      [](const app::SinkContext&) -> std::unique_ptr<media::FrameSink> { return std::make_unique<CountingSink>(); },
+      [](const util::Args&) { return Options(4, 32, util::OverflowPolicy::kDropNewest); },
+      "test sink"});
+  assert(registry.Contains("count"));
+  const app::StreamConfig config{"test", "rtp://127.0.0.1:5004", "out/test", "out/test/capture.mp4"};
+  const app::SinkContext context{config, args, nullptr, 0};
+  std::unique_ptr<media::FrameSink> sink = registry.Create("count", context, &options);
+  assert(sink && sink->RequiredFormats() == media::kFormatNative && !sink->WantsPackets());
+  assert(options.threads == 0 && options.queue_size == 7 && options.policy == util::OverflowPolicy::kBlock);
+  args.sink_options.clear();
+  sink = registry.Create("count", context, &options);
+  assert(options.threads == 4 && options.queue_size == 32 && options.policy == util::OverflowPolicy::kDropNewest);
+  assert(!registry.Create("missing", context, &options));
+  return 0;
+}
@@ -0,0 +1,169 @@
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "media/FrameSpool.h"
+
+namespace {
+
+// Payload of frame n: n repeated, with a size that varies per frame.
+std::vector<uint8_t> Payload(uint64_t n) {
+  return std::vector<uint8_t>(100000 + n * 1000, static_cast<uint8_t>(n));
+}
+
+media::SpoolFrameInfo Info(uint64_t n) {
+  media::SpoolFrameInfo info;
+  info.number = n;
+  info.pts_us = static_cast<int64_t>(n) * 33333;
+  info.key_frame = n % 10 == 1;
+  info.width = 640;
+  info.height = 360;
+  info.format = media::ImageFormat::kJpeg;
+  return info;
+}
+
+}  // namespace
+
+int main() {
+  std::filesystem::path dir = std::filesystem::temp_directory_path() / "webrtc_frame_spool_test";
+  std::filesystem::remove_all(dir);
+
+  // 1 MiB segments (the minimum) hold about nine frames each, so 30
+  // frames roll over several times
+  media::FrameSpoolOptions options;
+  options.directory = dir.string();
+  options.segment_bytes = 1 << 20;
+  {
+    media::FrameSpool spool(options);
+    for (uint64_t n = 1; n <= 30; ++n) {
+      const std::vector<uint8_t> payload = Payload(n);
+      assert(spool.Append(Info(n), payload.data(), payload.size()));
+    }
+    const media::FrameSpoolStats stats = spool.GetStats();
+    assert(stats.frames == 30);
+    assert(stats.segments >= 3);
+    assert(stats.failures == 0);
+  }
+  assert(std::filesystem::exists(dir / "segment_000001.dat"));
+  assert(std::filesystem::exists(dir / "segment_000001.idx"));
+  // Finished segments are truncated to their used size
+  assert(std::filesystem::file_size(dir / "segment_000001.dat") < (1u << 20));
+
+  // Random access in any order
+  {
+    media::SpoolReader reader;
+    std::string error;
+    assert(reader.Open(dir.string(), &error));
+    assert(reader.size() == 30);
+    std::vector<uint8_t> bytes;
+    for (size_t position : {size_t{17}, size_t{1}, size_t{30}, size_t{9}}) {
+      assert(reader.Read(position, &bytes));
+      assert(bytes == Payload(position));
+      const media::SpoolIndexEntry* entry = reader.Entry(position);
+      assert(entry && entry->number == position);
+      assert(entry->offset % media::kSpoolAlignment == 0);
+      assert(entry->pts_us == static_cast<int64_t>(position) * 33333);
+      assert(((entry->flags & media::kSpoolKeyFrame) != 0) == (position % 10 == 1));
+      assert(entry->width == 640 && entry->height == 360);
+    }
+    assert(!reader.Read(0, &bytes));
+    assert(!reader.Read(31, &bytes));
+    assert(reader.Entry(31) == nullptr);
+  }
+
+  // A second run appends new segments instead of overwriting
+  {
+    media::FrameSpool spool(options);
+    const std::vector<uint8_t> payload = Payload(1);
+    assert(spool.Append(Info(1), payload.data(), payload.size()));
+  }
+  {
+    media::SpoolReader reader;
+    assert(reader.Open(dir.string(), nullptr));
+    assert(reader.size() == 31);
+    assert(reader.Entry(31)->number == 1);
+  }
+
+  // A frame larger than a segment gets a segment of its own
+  {
+    media::FrameSpool spool(options);
+    const std::vector<uint8_t> big(3u << 20, 7);
+    assert(spool.Append(Info(1), big.data(), big.size()));
+    spool.Close();
+    media::SpoolReader reader;
+    assert(reader.Open(dir.string(), nullptr));
+    std::vector<uint8_t> bytes;
+    assert(reader.Read(reader.size(), &bytes));
+    assert(bytes == big);
+  }
+
+  // Truncated data file and partial index entry (crash): the damaged
+  // frames are dropped, earlier ones stay readable
+  {
+    const std::filesystem::path data = dir / "segment_000001.dat";
+    const std::filesystem::path index = dir / "segment_000001.idx";
+    media::SpoolReader before;
+    assert(before.Open(dir.string(), nullptr));
+    const media::SpoolIndexEntry* second = before.Entry(2);
+    std::filesystem::resize_file(data, second->offset + second->size - 1);
+    std::filesystem::resize_file(index, std::filesystem::file_size(index) - 1);
+
+    media::SpoolReader reader;
+    assert(reader.Open(dir.string(), nullptr));
+    assert(reader.size() < before.size());
+    std::vector<uint8_t> bytes;
+    assert(reader.Read(1, &bytes));
+    assert(bytes == Payload(1));
+    assert(reader.Entry(2)->number != 2);
+  }
+
+  // Power loss: preallocated payload space never written behind an
+  // entry (zeros) fails the checksum, and zeroed entries the filesystem
+  // extended the index with are not listed
+  {
+    media::FrameSpoolOptions damaged_options;
+    damaged_options.directory = (dir / "damaged").string();
+    {
+      media::FrameSpool spool(damaged_options);
+      for (uint64_t n = 1; n <= 3; ++n) {
+        const std::vector<uint8_t> payload = Payload(n);
+        assert(spool.Append(Info(n), payload.data(), payload.size()));
+      }
+    }
+    media::SpoolReader before;
+    assert(before.Open(damaged_options.directory, nullptr));
+    const media::SpoolIndexEntry second = *before.Entry(2);
+    {
+      std::fstream data(dir / "damaged" / "segment_000001.dat", std::ios::binary | std::ios::in | std::ios::out);
+      data.seekp(static_cast<std::streamoff>(second.offset));
+      const std::vector<char> zeros(second.size, 0);
+      data.write(zeros.data(), static_cast<std::streamsize>(zeros.size()));
+      std::ofstream index(dir / "damaged" / "segment_000001.idx", std::ios::binary | std::ios::app);
+      const std::vector<char> zeroed_entries(2 * sizeof(media::SpoolIndexEntry), 0);
+      index.write(zeroed_entries.data(), static_cast<std::streamsize>(zeroed_entries.size()));
+    }
+
+    media::SpoolReader reader;
+    assert(reader.Open(damaged_options.directory, nullptr));
+    assert(reader.size() == 3);
+    std::vector<uint8_t> bytes;
+    assert(reader.Read(1, &bytes) && bytes == Payload(1));
+    assert(!reader.Read(2, &bytes));
+    assert(reader.Read(3, &bytes) && bytes == Payload(3));
+  }
+
+  // Empty directory
+  {
+    std::filesystem::create_directories(dir / "empty");
+    media::SpoolReader reader;
+    std::string error;
+    assert(!reader.Open((dir / "empty").string(), &error));
+    assert(!error.empty());
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -1,5 +1,8 @@
 #include <cassert>
+#include <cstdint>
 #include <filesystem>
+#include <fstream>
+#include <string>
 
 #include <opencv2/core.hpp>
 
@@ -16,5 +19,105 @@ int main() {
   std::filesystem::path output = temp_dir / "frames" / "frame_00000001.png";
   assert(std::filesystem::exists(output));
 
+  // Encode pool, ordered and unordered: every frame number is written once
+  for (bool ordered : {true, false}) {
+    std::filesystem::path pool_dir = temp_dir / (ordered ? "ordered" : "unordered");
+    media::FrameWriterOptions options;
+    options.output_dir = pool_dir.string();
+    options.write_video = false;
+    options.encode_threads = 4;
+    options.ordered_writes = ordered;
+    media::FrameWriter pooled(options);
+    for (int i = 0; i < 20; ++i) {
+      pooled.OnFrame(cv::Mat(4, 4, CV_8UC3, cv::Scalar(i, i, i)));
+    }
+    pooled.Close();
+
+    assert(std::filesystem::exists(pool_dir / "frames" / "frame_00000001.png"));
+    assert(std::filesystem::exists(pool_dir / "frames" / "frame_00000020.png"));
+    assert(!std::filesystem::exists(pool_dir / "frames" / "frame_00000021.png"));
+    if (!ordered) {
+      std::ifstream manifest(pool_dir / "frames" / "manifest.txt");
+      int lines = 0;
+      for (std::string line; std::getline(manifest, line);) {
+        ++lines;
+      }
+      assert(lines == 20);
+    }
+  }
+
+  // An encode job that throws (a frame header claiming 2^31 x 2^31 pixels:
+  // the raw dump size exceeds vector::max_size()) is skipped; the frames
+  // after it are still committed in order and Close() returns
+  {
+    std::filesystem::path failing_dir = temp_dir / "failing";
+    media::FrameWriterOptions options;
+    options.output_dir = failing_dir.string();
+    options.image.format = media::ImageFormat::kRawBgr;
+    options.encode_threads = 2;
+    options.ordered_writes = true;
+    media::FrameWriter failing(options);
+    uint8_t pixel[3] = {};
+    failing.OnFrame(cv::Mat(4, 4, CV_8UC3, cv::Scalar(1, 1, 1)));
+    failing.OnFrame(cv::Mat(INT32_MAX, INT32_MAX, CV_8UC3, pixel));
+    failing.OnFrame(cv::Mat(4, 4, CV_8UC3, cv::Scalar(3, 3, 3)));
+    failing.Close();
+    assert(std::filesystem::exists(failing_dir / "frames" / "frame_00000001.bgr"));
+    assert(!std::filesystem::exists(failing_dir / "frames" / "frame_00000002.bgr"));
+    assert(std::filesystem::exists(failing_dir / "frames" / "frame_00000003.bgr"));
+  }
+
+  // Image formats: extension per format, raw dumps are bare pixels
+  {
+    const struct {
+      media::ImageFormat format;
+      const char* file;
+      uintmax_t size;  // 0 = compressed, size not checked
+    } cases[] = {
+        {media::ImageFormat::kJpeg, "frame_00000001.jpg", 0},
+        {media::ImageFormat::kRawBgr, "frame_00000001.bgr", 4 * 4 * 3},
+        {media::ImageFormat::kRawYuv, "frame_00000001.yuv", 4 * 4 * 3 / 2},
+    };
+    for (const auto& test : cases) {
+      std::filesystem::path format_dir = temp_dir / test.file;
+      media::FrameWriterOptions options;
+      options.output_dir = format_dir.string();
+      options.image.format = test.format;
+      options.image.quality = 80;
+      media::FrameWriter formatted(options);
+      assert(formatted.RequiredFormats() ==
+             (test.format == media::ImageFormat::kRawYuv ? media::kFormatNative : media::kFormatBgr));
+      formatted.OnFrame(cv::Mat(4, 4, CV_8UC3, cv::Scalar(10, 20, 30)));
+      formatted.Close();
+      const std::filesystem::path file = format_dir / "frames" / test.file;
+      assert(std::filesystem::exists(file));
+      assert(test.size == 0 || std::filesystem::file_size(file) == test.size);
+    }
+  }
+
+  // Spool output: frames appended to a segment, no frames/ directory
+  {
+    std::filesystem::path spool_dir = temp_dir / "spool";
+    media::FrameWriterOptions options;
+    options.output_dir = spool_dir.string();
+    options.image.format = media::ImageFormat::kRawBgr;
+    options.encode_threads = 2;
+    options.spool_images = true;
+    media::FrameWriter spooled(options);
+    for (int i = 0; i < 10; ++i) {
+      spooled.OnFrame(cv::Mat(4, 4, CV_8UC3, cv::Scalar(i, i, i)));
+    }
+    spooled.Close();
+    assert(!std::filesystem::exists(spool_dir / "frames"));
+    media::SpoolReader reader;
+    assert(reader.Open((spool_dir / "spool").string(), nullptr));
+    assert(reader.size() == 10);
+    for (size_t position = 1; position <= 10; ++position) {
+      const media::SpoolIndexEntry* entry = reader.Entry(position);
+      assert(entry->number == position && entry->size == 4 * 4 * 3);
+      assert(entry->width == 4 && entry->height == 4);
+    }
+  }
+
   return 0;
 }
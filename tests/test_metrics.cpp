@@ -0,0 +1,150 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <string>
+#include <thread>
+
+#include "util/Metrics.h"
+#include "util/MetricsServer.h"
+
+namespace {
+
+// Connect to the metrics server and send the start of a request only.
+int ConnectStalled(int port) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  assert(fd >= 0);
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(static_cast<uint16_t>(port));
+  inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+  assert(connect(fd, reinterpret_cast<const sockaddr*>(&server), sizeof(server)) == 0);
+  assert(send(fd, "G", 1, 0) == 1);
+  return fd;
+}
+
+// Send a request to the metrics server and return the whole response.
+std::string HttpGet(int port, const std::string& path) {
+  const int fd = socket(AF_INET, SOCK_STREAM, 0);
+  assert(fd >= 0);
+  sockaddr_in server{};
+  server.sin_family = AF_INET;
+  server.sin_port = htons(static_cast<uint16_t>(port));
+  inet_pton(AF_INET, "127.0.0.1", &server.sin_addr);
+  assert(connect(fd, reinterpret_cast<const sockaddr*>(&server), sizeof(server)) == 0);
+  const std::string request = "GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+  assert(send(fd, request.data(), request.size(), 0) == static_cast<ssize_t>(request.size()));
+  std::string response;
+  char buffer[4096];
+  ssize_t n = 0;
+  while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+    response.append(buffer, static_cast<size_t>(n));
+  }
+  close(fd);
+  return response;
+}
+
+bool Contains(const std::string& text, const std::string& part) {
+  return text.find(part) != std::string::npos;
+}
+
+}  // namespace
+
+int main() {
+  util::Metrics& metrics = util::Metrics::Instance();
+
+  // Same name and labels return the same metric
+  {
+    util::Counter* a = metrics.GetCounter("test_frames_total", "Frames", util::MetricLabel("stream", "a"));
+    util::Counter* b = metrics.GetCounter("test_frames_total", "Frames", util::MetricLabel("stream", "a"));
+    util::Counter* c = metrics.GetCounter("test_frames_total", "Frames", util::MetricLabel("stream", "c"));
+    assert(a == b);
+    assert(a != c);
+    a->Add();
+    a->Add(2);
+    assert(b->value() == 3);
+  }
+
+  // Samples land in the first bucket whose bound they do not exceed
+  {
+    util::Histogram* histogram = metrics.GetHistogram("test_stage_seconds", "Stage time");
+    histogram->Observe(-5);       // clamps to 0
+    histogram->Observe(50);       // le 50 us
+    histogram->Observe(51);       // le 100 us
+    histogram->Observe(9000000);  // +Inf
+    assert(histogram->bucket(0) == 2);
+    assert(histogram->bucket(1) == 1);
+    assert(histogram->bucket(util::Histogram::kBuckets - 1) == 1);
+    assert(histogram->count() == 4);
+    assert(histogram->sum_us() == 9000101);
+  }
+
+  // Label values are escaped
+  assert(util::MetricLabel("stream", "a\"b\\c") == "stream=\"a\\\"b\\\\c\"");
+
+  // Collectors run on every render and stop after removal
+  {
+    util::Gauge* depth = metrics.GetGauge("test_queue_depth", "Queue depth");
+    int calls = 0;
+    const uint64_t id = metrics.AddCollector([&calls, depth]() { depth->Set(++calls); });
+    const std::string text = metrics.Render();
+    assert(calls == 1);
+    assert(Contains(text, "test_queue_depth 1\n"));
+    metrics.RemoveCollector(id);
+    metrics.Render();
+    assert(calls == 1);
+  }
+
+  // Prometheus text format
+  {
+    const std::string text = metrics.Render();
+    assert(Contains(text, "# HELP test_frames_total Frames\n# TYPE test_frames_total counter\n"));
+    assert(Contains(text, "test_frames_total{stream=\"a\"} 3\n"));
+    assert(Contains(text, "# TYPE test_stage_seconds histogram\n"));
+    assert(Contains(text, "test_stage_seconds_bucket{le=\"0.00005\"} 2\n"));
+    assert(Contains(text, "test_stage_seconds_bucket{le=\"0.0001\"} 3\n"));
+    assert(Contains(text, "test_stage_seconds_bucket{le=\"5\"} 3\n"));
+    assert(Contains(text, "test_stage_seconds_bucket{le=\"+Inf\"} 4\n"));
+    assert(Contains(text, "test_stage_seconds_sum 9.000101\n"));
+    assert(Contains(text, "test_stage_seconds_count 4\n"));
+  }
+
+  // HTTP endpoint on loopback
+  {
+    util::MetricsServer server;
+    int port = 0;
+    for (int candidate = 39100; candidate < 39200 && port == 0; ++candidate) {
+      if (server.Start("127.0.0.1", candidate)) {
+        port = candidate;
+      }
+    }
+    assert(port != 0);
+    const std::string ok = HttpGet(port, "/metrics");
+    assert(ok.rfind("HTTP/1.0 200 OK\r\n", 0) == 0);
+    assert(Contains(ok, "text/plain; version=0.0.4"));
+    assert(Contains(ok, "test_frames_total{stream=\"a\"} 3\n"));
+    assert(HttpGet(port, "/").rfind("HTTP/1.0 404", 0) == 0);
+
+    // A client that never finishes its request is dropped at the client
+    // deadline (2 s); the next scrape is served after it
+    using Clock = std::chrono::steady_clock;
+    const int stalled = ConnectStalled(port);
+    auto start = Clock::now();
+    assert(HttpGet(port, "/metrics").rfind("HTTP/1.0 200 OK\r\n", 0) == 0);
+    assert(Clock::now() - start < std::chrono::seconds(4));
+    close(stalled);
+
+    // Stop() does not wait out a stalled client
+    const int idle = ConnectStalled(port);
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    start = Clock::now();
+    server.Stop();
+    assert(Clock::now() - start < std::chrono::milliseconds(500));
+    server.Stop();
+    close(idle);
+  }
+  return 0;
+}
@@ -0,0 +1,141 @@
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ingest/Reactor.h"
+#include "ingest/UdpSource.h"
+#include "util/Metrics.h"
+
+namespace {
+
+// Counts the datagrams of one loopback socket; optionally with a timer
+// that fires once, or asking to be removed after the first batch.
+class CountingHandler : public ingest::ReactorHandler {
+ public:
+  explicit CountingHandler(int64_t deadline_us = -1, bool remove_after_read = false)
+      : deadline_us_(deadline_us), remove_after_read_(remove_after_read) {
+    std::string error;
+    assert(socket_.Open("127.0.0.1", 0, &error));
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    assert(getsockname(socket_.fd(), reinterpret_cast<sockaddr*>(&address), &length) == 0);
+    port = ntohs(address.sin_port);
+  }
+
+  int fd() const override { return socket_.fd(); }
+
+  bool OnReadable() override {
+    const int received = socket_.Read();
+    assert(received >= 0);
+    datagrams += received;
+    return !remove_after_read_;
+  }
+
+  int64_t NextDeadlineUs() const override { return deadline_us_; }
+
+  void OnTimer() override {
+    deadline_us_ = -1;
+    ++timers;
+  }
+
+  int port = 0;
+  std::atomic<int> datagrams{0};
+  std::atomic<int> timers{0};
+
+ private:
+  ingest::UdpSource socket_;
+  int64_t deadline_us_;  // Reactor thread only once added
+  bool remove_after_read_;
+};
+
+void Send(int sender, int port, int count) {
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_port = htons(static_cast<uint16_t>(port));
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  const char payload[] = "datagram";
+  for (int i = 0; i < count; ++i) {
+    assert(sendto(sender, payload, sizeof(payload), 0, reinterpret_cast<sockaddr*>(&address), sizeof(address)) ==
+           static_cast<ssize_t>(sizeof(payload)));
+  }
+}
+
+// Poll until condition holds or a generous timeout passes.
+template <typename Condition>
+bool WaitFor(Condition condition) {
+  for (int i = 0; i < 2000 && !condition(); ++i) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return condition();
+}
+
+}  // namespace
+
+int main() {
+  const int sender = socket(AF_INET, SOCK_DGRAM, 0);
+  assert(sender >= 0);
+
+  // Few threads, many sockets: every handler is serviced
+  {
+    ingest::Reactor reactor(2);
+    assert(reactor.threads() == 2);
+    std::vector<std::unique_ptr<CountingHandler>> handlers;
+    for (int i = 0; i < 6; ++i) {
+      handlers.push_back(std::make_unique<CountingHandler>());
+      assert(reactor.Add(handlers.back().get()));
+    }
+    assert(reactor.size() == 6);
+    for (auto& handler : handlers) {
+      Send(sender, handler->port, 100);
+    }
+    for (auto& handler : handlers) {
+      CountingHandler* counted = handler.get();
+      assert(WaitFor([counted]() { return counted->datagrams == 100; }));
+    }
+
+    // Removed handlers get no more callbacks
+    reactor.Remove(handlers[0].get());
+    reactor.Remove(handlers[0].get());
+    assert(reactor.size() == 5);
+    Send(sender, handlers[0]->port, 10);
+    Send(sender, handlers[1]->port, 10);
+    CountingHandler* still_added = handlers[1].get();
+    assert(WaitFor([still_added]() { return still_added->datagrams == 110; }));
+    assert(handlers[0]->datagrams == 100);
+    for (auto& handler : handlers) {
+      reactor.Remove(handler.get());
+    }
+    assert(reactor.size() == 0);
+  }
+
+  // Deadlines end the wait: an idle handler's timer fires on time
+  {
+    ingest::Reactor reactor(1);
+    const int64_t start = util::NowMicros();
+    CountingHandler timed(start + 20000);
+    assert(reactor.Add(&timed));
+    assert(WaitFor([&timed]() { return timed.timers == 1; }));
+    assert(util::NowMicros() - start >= 20000);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    assert(timed.timers == 1);
+
+    // A handler returning false from OnReadable() is dropped
+    CountingHandler once(-1, true);
+    assert(reactor.Add(&once));
+    Send(sender, once.port, 1);
+    assert(WaitFor([&reactor]() { return reactor.size() == 1; }));
+    reactor.Remove(&timed);
+  }
+
+  close(sender);
+  return 0;
+}
@@ -0,0 +1,223 @@
+extern "C" {
+#include <libavcodec/avcodec.h>
+}
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench/RtpReplay.h"
+#include "bench/SyntheticStream.h"
+#include "ingest/RtpReceiver.h"
+
+namespace {
+
+constexpr int kFps = 30;
+
+// A free loopback UDP port (bound once by the kernel, then released).
+int FreeUdpPort() {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  assert(fd >= 0);
+  sockaddr_in address{};
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  assert(bind(fd, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0);
+  socklen_t length = sizeof(address);
+  assert(getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length) == 0);
+  close(fd);
+  return ntohs(address.sin_port);
+}
+
+// Send the datagrams of frames [first, last) to 127.0.0.1:port, one
+// frame per millisecond.
+void SendFrames(const std::vector<bench::RtpDatagram>& datagrams, int port, int first, int last) {
+  const int fd = socket(AF_INET, SOCK_DGRAM, 0);
+  assert(fd >= 0);
+  sockaddr_in destination{};
+  destination.sin_family = AF_INET;
+  destination.sin_port = htons(static_cast<uint16_t>(port));
+  destination.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  int previous = -1;
+  for (const bench::RtpDatagram& datagram : datagrams) {
+    const int frame = static_cast<int>((datagram.offset_us * kFps + 500000) / 1000000);
+    if (frame < first || frame >= last) {
+      continue;
+    }
+    if (frame != previous) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      previous = frame;
+    }
+    sendto(fd, datagram.data.data(), datagram.data.size(), 0, reinterpret_cast<const sockaddr*>(&destination),
+           sizeof(destination));
+  }
+  close(fd);
+}
+
+// Wait up to 5 s for a condition.
+bool WaitFor(const std::function<bool()>& condition) {
+  const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline) {
+      return false;
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+  return true;
+}
+
+void TestBackoff() {
+  // Doubling from 100 ms, capped at 5 s
+  ingest::ReconnectOptions options;
+  ingest::ReconnectBackoff backoff(options);
+  for (int expected : {100, 200, 400, 800, 1600, 3200, 5000, 5000}) {
+    assert(backoff.NextDelayMs(false) == expected);
+  }
+  assert(backoff.failures() == 8);
+
+  // A session that received packets reconnects at once and resets the count
+  assert(backoff.NextDelayMs(true) == 0);
+  assert(backoff.failures() == 0);
+  assert(backoff.NextDelayMs(false) == 100);
+
+  // Long outages stay at the cap (no shift overflow)
+  for (int i = 0; i < 100; ++i) {
+    backoff.NextDelayMs(false);
+  }
+  assert(backoff.NextDelayMs(false) == 5000);
+
+  // Non-positive bounds are treated as 1 ms
+  options.backoff_min_ms = 0;
+  options.backoff_max_ms = 3;
+  ingest::ReconnectBackoff tight(options);
+  for (int expected : {1, 2, 3, 3}) {
+    assert(tight.NextDelayMs(false) == expected);
+  }
+}
+
+void TestTimeline() {
+  const AVRational rtp{1, 90000};
+  AVPacket* packet = av_packet_alloc();
+  auto next = [packet](int64_t pts, int64_t dts) {
+    packet->pts = pts;
+    packet->dts = dts;
+    return packet;
+  };
+
+  // The first session keeps its timestamps, even after a Rebase()
+  ingest::PtsTimeline timeline;
+  timeline.Rebase();
+  timeline.Continue(next(1000, AV_NOPTS_VALUE), rtp, 0);
+  assert(packet->pts == 1000 && packet->dts == AV_NOPTS_VALUE);
+  timeline.Continue(next(4000, AV_NOPTS_VALUE), rtp, 33333);
+  assert(packet->pts == 4000 && timeline.last_pts() == 4000);
+
+  // A new sender restarting at 50, half a second later: placed 0.5 s after
+  // the last packet, and later packets keep the same offset
+  timeline.Rebase();
+  timeline.Continue(next(50, 50), rtp, 533333);
+  assert(packet->pts == 4000 + 45000 && packet->dts == packet->pts);
+  timeline.Continue(next(3050, 3050), rtp, 566666);
+  assert(packet->pts == 52000 && packet->dts == 52000);
+
+  // No wall time in between still moves forward by one tick
+  timeline.Rebase();
+  timeline.Continue(next(0, AV_NOPTS_VALUE), rtp, 566666);
+  assert(packet->pts == 52001);
+
+  // Packets without pts are left alone
+  timeline.Continue(next(AV_NOPTS_VALUE, AV_NOPTS_VALUE), rtp, 600000);
+  assert(packet->pts == AV_NOPTS_VALUE && timeline.last_pts() == 52001);
+
+  // A session with another time base continues in it
+  const AVRational ms{1, 1000};
+  timeline.Rescale(rtp, ms);
+  assert(timeline.last_pts() == 578);
+  timeline.Rebase();
+  timeline.Continue(next(0, AV_NOPTS_VALUE), ms, 566666 + 10000);
+  assert(packet->pts == 588);
+
+  av_packet_free(&packet);
+}
+
+// Native ingest on loopback: the sender goes silent past read_timeout_ms
+// and resumes with the next packets in sequence. The stall resets the
+// depacketizer, so the inter frames that follow are skipped until the
+// next keyframe, and the timeline is rebased, so pts keep increasing.
+void TestNativeStall() {
+  auto stream = bench::EncodeSynthetic(AV_CODEC_ID_VP8, 320, 240, 3 * kFps, kFps);
+  if (!stream) {
+    std::cerr << "Skipping native stall test: no VP8 encoder\n";
+    return;
+  }
+  // GOP of 2 s: keyframes at 0 and 60
+  assert(stream->packets[0]->flags & AV_PKT_FLAG_KEY);
+  assert(!(stream->packets[kFps]->flags & AV_PKT_FLAG_KEY));
+  assert(stream->packets[2 * kFps]->flags & AV_PKT_FLAG_KEY);
+  const std::vector<bench::RtpDatagram> datagrams = bench::PacketizeRtp(*stream, ingest::RtpCodec::kVp8, kFps);
+
+  ingest::ReceiverOptions options;
+  options.ingest = ingest::IngestMode::kNative;
+  options.reconnect.read_timeout_ms = 200;
+  std::mutex mutex;
+  struct Seen {
+    int64_t pts_us;
+    bool key;
+  };
+  std::vector<Seen> frames;
+  const int port = FreeUdpPort();
+  ingest::RtpReceiver receiver(
+      "rtp://127.0.0.1:" + std::to_string(port) + "?codec=vp8",
+      [&](const media::FrameRef& frame) {
+        std::lock_guard<std::mutex> lock(mutex);
+        frames.push_back(Seen{frame->pts_us, frame->key_frame});
+      },
+      options);
+  receiver.SetOutputFormats(media::kFormatNative);
+  bool ok = false;
+  std::thread receive_thread([&]() { ok = receiver.Run(); });
+  auto count = [&]() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return frames.size();
+  };
+
+  // Open() binds after opening the decoder; give it time
+  std::this_thread::sleep_for(std::chrono::milliseconds(300));
+  SendFrames(datagrams, port, 0, kFps);
+  assert(WaitFor([&]() { return count() >= static_cast<size_t>(kFps); }));
+
+  // Silence past the read timeout, then the rest of the stream in sequence
+  std::this_thread::sleep_for(std::chrono::milliseconds(600));
+  SendFrames(datagrams, port, kFps, 3 * kFps);
+  assert(WaitFor([&]() { return count() >= static_cast<size_t>(2 * kFps); }));
+  std::this_thread::sleep_for(std::chrono::milliseconds(100));
+  receiver.Stop();
+  receive_thread.join();
+  assert(ok);
+
+  // Frames 30-59 (inter) were skipped; decoding resumed at keyframe 60
+  assert(frames.size() == static_cast<size_t>(2 * kFps));
+  assert(frames[kFps].key);
+  for (size_t i = 1; i < frames.size(); ++i) {
+    assert(frames[i].pts_us > frames[i - 1].pts_us);
+  }
+}
+
+}  // namespace
+
+int main() {
+  TestBackoff();
+  TestTimeline();
+  TestNativeStall();
+  return 0;
+}
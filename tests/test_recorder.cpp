@@ -0,0 +1,186 @@
+extern "C" {
+#include <libavcodec/avcodec.h>
+#include <libavformat/avformat.h>
+}
+
+#include <cassert>
+#include <cstdint>
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+#include "bench/SyntheticStream.h"
+#include "media/FramePool.h"
+#include "media/Recorder.h"
+
+namespace {
+
+constexpr int kWidth = 320;
+constexpr int kHeight = 240;
+constexpr int kFrames = 60;
+
+// What a finished recording holds, read back with libavformat.
+struct FileInfo {
+  AVCodecID codec_id = AV_CODEC_ID_NONE;
+  int width = 0;
+  int height = 0;
+  int packets = 0;
+  int64_t first_pts = AV_NOPTS_VALUE;
+  bool monotonic = true;  // dts strictly increasing, pts never negative
+};
+
+FileInfo Inspect(const std::string& path) {
+  FileInfo info;
+  AVFormatContext* input = nullptr;
+  assert(avformat_open_input(&input, path.c_str(), nullptr, nullptr) == 0);
+  assert(avformat_find_stream_info(input, nullptr) >= 0);
+  assert(input->nb_streams == 1);
+  const AVCodecParameters* codecpar = input->streams[0]->codecpar;
+  info.codec_id = codecpar->codec_id;
+  info.width = codecpar->width;
+  info.height = codecpar->height;
+
+  AVPacket* packet = av_packet_alloc();
+  int64_t last_dts = INT64_MIN;
+  while (av_read_frame(input, packet) >= 0) {
+    ++info.packets;
+    if (packet->dts != AV_NOPTS_VALUE) {
+      info.monotonic = info.monotonic && packet->dts > last_dts;
+      last_dts = packet->dts;
+    }
+    if (info.packets == 1) {
+      info.first_pts = packet->pts;
+    }
+    if (packet->pts != AV_NOPTS_VALUE) {
+      info.monotonic = info.monotonic && packet->pts >= 0;
+    }
+    av_packet_unref(packet);
+  }
+  av_packet_free(&packet);
+  avformat_close_input(&input);
+  return info;
+}
+
+// Stream copy: packets before the first keyframe are dropped, the rest
+// are muxed as is.
+void TestCopy(const bench::EncodedStream& stream, const std::filesystem::path& dir) {
+  const std::string path =
+      (dir / (std::string("copy_") + avcodec_get_name(stream.codecpar->codec_id) + ".mkv")).string();
+  {
+    media::RecorderOptions options;
+    options.path = path;
+    options.mode = media::RecordMode::kCopy;
+    media::Recorder recorder(options);
+    assert(recorder.RequiredFormats() == media::kFormatNone);
+
+    // Inter frames of a stream joined mid-GOP: no header yet, nothing written
+    for (size_t i = 1; i < 4; ++i) {
+      AVPacket* packet = stream.packets[i];
+      assert(!(packet->flags & AV_PKT_FLAG_KEY));
+      recorder.OnPacket(packet, stream.codecpar, stream.time_base);
+    }
+    assert(!std::filesystem::exists(path));
+
+    // From the keyframe on every packet is muxed; timestamps restart at 0
+    // since the dropped packets never reached the file
+    for (AVPacket* packet : stream.packets) {
+      AVPacket* shifted = av_packet_clone(packet);
+      shifted->pts += 1000;
+      shifted->dts = shifted->dts != AV_NOPTS_VALUE ? shifted->dts + 1000 : AV_NOPTS_VALUE;
+      recorder.OnPacket(shifted, stream.codecpar, stream.time_base);
+      av_packet_free(&shifted);
+    }
+    recorder.Close();
+  }
+  const FileInfo info = Inspect(path);
+  assert(info.codec_id == stream.codecpar->codec_id);
+  assert(info.width == kWidth && info.height == kHeight);
+  assert(info.packets == static_cast<int>(stream.packets.size()));
+  assert(info.first_pts == 0);
+  assert(info.monotonic);
+}
+
+// Transcode: frames are decoded here, as the receiver would, and
+// re-encoded with the always-available mpeg4 encoder.
+void TestTranscode(const bench::EncodedStream& stream, const std::filesystem::path& dir) {
+  const std::string path =
+      (dir / (std::string("transcode_") + avcodec_get_name(stream.codecpar->codec_id) + ".mp4")).string();
+  int frames = 0;
+  {
+    media::RecorderOptions options;
+    options.path = path;
+    options.mode = media::RecordMode::kTranscode;
+    options.encoder = "mpeg4";
+    media::Recorder recorder(options);
+    assert(recorder.RequiredFormats() == media::kFormatNative);
+
+    const AVCodec* codec = avcodec_find_decoder(stream.codecpar->codec_id);
+    assert(codec);
+    AVCodecContext* decoder = avcodec_alloc_context3(codec);
+    assert(avcodec_parameters_to_context(decoder, stream.codecpar) >= 0);
+    assert(avcodec_open2(decoder, codec, nullptr) >= 0);
+    AVFrame* decoded = av_frame_alloc();
+    media::FramePool pool;
+    auto deliver = [&]() {
+      while (avcodec_receive_frame(decoder, decoded) >= 0) {
+        media::FrameRef frame = pool.AcquireEmpty();
+        assert(frame.AttachNative(decoded));
+        media::Frame& out = frame.mutable_frame();
+        out.width = decoded->width;
+        out.height = decoded->height;
+        out.pts_us = av_rescale_q(decoded->best_effort_timestamp, stream.time_base, AVRational{1, 1000000});
+        recorder.OnFrame(frame);
+        ++frames;
+        av_frame_unref(decoded);
+      }
+    };
+
+    for (AVPacket* packet : stream.packets) {
+      recorder.OnPacket(packet, stream.codecpar, stream.time_base);
+      assert(recorder.RequiredFormats() == media::kFormatNative);
+      assert(avcodec_send_packet(decoder, packet) >= 0);
+      deliver();
+    }
+    assert(avcodec_send_packet(decoder, nullptr) >= 0);
+    deliver();
+    recorder.Close();
+    av_frame_free(&decoded);
+    avcodec_free_context(&decoder);
+  }
+  assert(frames == static_cast<int>(stream.packets.size()));
+  const FileInfo info = Inspect(path);
+  assert(info.codec_id == AV_CODEC_ID_MPEG4);
+  assert(info.width == kWidth && info.height == kHeight);
+  assert(info.packets == frames);
+  assert(info.monotonic);
+}
+
+}  // namespace
+
+int main() {
+  const std::filesystem::path dir = std::filesystem::temp_directory_path() / "webrtc_recorder_test";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+
+  // Mode names
+  media::RecordMode mode = media::RecordMode::kAuto;
+  assert(media::ParseRecordMode("copy", &mode) && mode == media::RecordMode::kCopy);
+  assert(media::ParseRecordMode("transcode", &mode) && mode == media::RecordMode::kTranscode);
+  assert(!media::ParseRecordMode("remux", &mode));
+
+  for (AVCodecID codec_id : {AV_CODEC_ID_VP8, AV_CODEC_ID_H264}) {
+    auto stream = bench::EncodeSynthetic(codec_id, kWidth, kHeight, kFrames);
+    if (!stream) {
+      // libvpx / libx264 / libopenh264 not built into this FFmpeg
+      std::cerr << "Skipping " << avcodec_get_name(codec_id) << ": no encoder\n";
+      continue;
+    }
+    assert(stream->packets.size() > 4);
+    assert(stream->packets[0]->flags & AV_PKT_FLAG_KEY);
+    TestCopy(*stream, dir);
+    TestTranscode(*stream, dir);
+  }
+
+  std::filesystem::remove_all(dir);
+  return 0;
+}
@@ -0,0 +1,310 @@
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ingest/Depacketizer.h"
+#include "ingest/JitterBuffer.h"
+#include "ingest/RtpPacket.h"
+#include "ingest/RtpSession.h"
+#include "ingest/UdpSource.h"
+#include "util/StopEvent.h"
+
+namespace {
+
+// Build an RTP datagram (no CSRC, no extension).
+std::vector<uint8_t> MakeRtp(uint16_t sequence, uint32_t timestamp, bool marker, const std::vector<uint8_t>& payload) {
+  std::vector<uint8_t> data = {0x80,
+                               static_cast<uint8_t>((marker ? 0x80 : 0) | 96),
+                               static_cast<uint8_t>(sequence >> 8),
+                               static_cast<uint8_t>(sequence),
+                               static_cast<uint8_t>(timestamp >> 24),
+                               static_cast<uint8_t>(timestamp >> 16),
+                               static_cast<uint8_t>(timestamp >> 8),
+                               static_cast<uint8_t>(timestamp),
+                               0x12,
+                               0x34,
+                               0x56,
+                               0x78};
+  data.insert(data.end(), payload.begin(), payload.end());
+  return data;
+}
+
+// Build an RTCP sender report (RFC 3550 section 6.4.1) without report
+// blocks, as a WebRTC sender multiplexes it on the RTP port.
+std::vector<uint8_t> MakeRtcpSr(uint32_t ssrc) {
+  std::vector<uint8_t> data = {0x80, 200, 0x00, 0x06,
+                               static_cast<uint8_t>(ssrc >> 24), static_cast<uint8_t>(ssrc >> 16),
+                               static_cast<uint8_t>(ssrc >> 8), static_cast<uint8_t>(ssrc)};
+  data.resize(28, 0xE5);  // NTP and RTP timestamps, packet and octet counts
+  return data;
+}
+
+ingest::RtpPacket Parse(const std::vector<uint8_t>& data) {
+  ingest::RtpPacket packet;
+  bool ok = ingest::ParseRtpPacket(data.data(), data.size(), &packet);
+  assert(ok);
+  (void)ok;
+  return packet;
+}
+
+}  // namespace
+
+int main() {
+  // RTP header parsing: CSRC list, extension and padding are skipped
+  {
+    std::vector<uint8_t> data = {0xB1, 0xE0, 0x00, 0x07, 0, 0, 0x03, 0xE8, 0, 0, 0, 1,
+                                 0, 0, 0, 9,                      // CSRC
+                                 0xBE, 0xDE, 0x00, 0x01, 1, 2, 3, 4,  // one-word extension
+                                 0xAA, 0xBB, 0, 0, 3};            // payload + 3 bytes padding
+    ingest::RtpPacket packet;
+    assert(ingest::ParseRtpPacket(data.data(), data.size(), &packet));
+    assert(packet.marker && packet.payload_type == 96);
+    assert(packet.sequence == 7 && packet.timestamp == 1000 && packet.ssrc == 1);
+    assert(packet.payload_size == 2 && packet.payload[0] == 0xAA);
+
+    data[0] = 0x40;  // version 1
+    assert(!ingest::ParseRtpPacket(data.data(), data.size(), &packet));
+    assert(!ingest::ParseRtpPacket(data.data(), 8, &packet));
+  }
+
+  // RTCP multiplexed with RTP is not taken for RTP: sender reports between
+  // the packets of a frame neither reach the depacketizer nor look like
+  // another SSRC
+  {
+    ingest::RtpPacket packet;
+    std::vector<uint8_t> rtcp = MakeRtcpSr(0x12345678);
+    for (uint8_t type : {200, 201, 202, 203, 204, 192, 223}) {
+      rtcp[1] = type;
+      assert(!ingest::ParseRtpPacket(rtcp.data(), rtcp.size(), &packet));
+    }
+    std::vector<uint8_t> rtp = MakeRtp(1, 100, true, {0x10, 0x00, 0xAA});
+    rtp[1] = 0x80 | 63;  // marker + PT 63 and PT 96 (second byte 224) stay RTP
+    assert(ingest::ParseRtpPacket(rtp.data(), rtp.size(), &packet) && packet.payload_type == 63);
+    rtp[1] = 0x80 | 96;
+    assert(ingest::ParseRtpPacket(rtp.data(), rtp.size(), &packet) && packet.payload_type == 96);
+
+    const std::vector<std::vector<uint8_t>> datagrams = {
+        MakeRtcpSr(0x0BADF00D),
+        MakeRtp(1, 100, false, {0x90, 0x80, 0x81, 0x02, 0x00, 0xAA}),  // keyframe, first packet
+        MakeRtcpSr(0x0BADF00D),
+        MakeRtp(2, 100, true, {0x00, 0xBB}),
+        MakeRtcpSr(0x0BADF00D),
+        MakeRtp(3, 200, true, {0x10, 0x01, 0xCC}),  // inter frame
+    };
+    auto depacketizer = ingest::CreateDepacketizer(ingest::RtpCodec::kVp8);
+    int rejected = 0;
+    int frames = 0;
+    for (const std::vector<uint8_t>& datagram : datagrams) {
+      if (!ingest::ParseRtpPacket(datagram.data(), datagram.size(), &packet)) {
+        ++rejected;
+        continue;
+      }
+      assert(packet.ssrc == 0x12345678);
+      frames += depacketizer->Push(packet, false) ? 1 : 0;
+    }
+    assert(rejected == 3 && frames == 2);
+    assert(depacketizer->GetStats().skipped_frames == 0);
+  }
+
+  // Jitter buffer reorders, drops duplicates and late packets, wraps at 2^16
+  {
+    ingest::JitterBuffer jitter(ingest::JitterBufferOptions{8, 1000});
+    std::vector<std::vector<uint8_t>> datagrams;
+    for (uint16_t sequence : {65534, 0, 65535, 0, 1}) {
+      datagrams.push_back(MakeRtp(sequence, 0, false, {static_cast<uint8_t>(sequence)}));
+    }
+    for (const auto& data : datagrams) {
+      jitter.Insert(Parse(data));
+    }
+    uint16_t expected = 65534;
+    for (int i = 0; i < 4; ++i, ++expected) {
+      const ingest::JitterBuffer::Entry* entry = jitter.Pop(0);
+      assert(entry && entry->packet.sequence == expected && !entry->after_loss);
+    }
+    assert(!jitter.Pop(0));
+    assert(!jitter.Insert(Parse(datagrams[0])));
+    assert(jitter.GetStats().duplicates == 1 && jitter.GetStats().late == 1);
+  }
+
+  // A gap is held until max_delay_ms, then skipped and flagged
+  {
+    ingest::JitterBuffer jitter(ingest::JitterBufferOptions{64, 40});
+    auto first = MakeRtp(10, 0, false, {1});
+    auto third = MakeRtp(12, 0, false, {3});
+    jitter.Insert(Parse(first));
+    jitter.Insert(Parse(third));
+    assert(jitter.NextDeadlineUs() == -1);
+    assert(jitter.Pop(0)->packet.sequence == 10);
+    assert(!jitter.Pop(0));
+    assert(jitter.NextDeadlineUs() == 40000);
+    assert(!jitter.Pop(39000));
+    const ingest::JitterBuffer::Entry* entry = jitter.Pop(40000);
+    assert(entry && entry->packet.sequence == 12 && entry->after_loss);
+    assert(jitter.GetStats().lost == 1);
+    assert(jitter.NextDeadlineUs() == -1);
+  }
+
+  // A gap is also skipped once more than `depth` packets wait behind it
+  {
+    ingest::JitterBuffer jitter(ingest::JitterBufferOptions{2, 1000});
+    std::vector<std::vector<uint8_t>> datagrams;
+    for (uint16_t sequence : {1, 3, 4, 5}) {
+      datagrams.push_back(MakeRtp(sequence, 0, false, {}));
+    }
+    for (const auto& data : datagrams) {
+      jitter.Insert(Parse(data));
+    }
+    assert(jitter.Pop(0)->packet.sequence == 1);
+    const ingest::JitterBuffer::Entry* entry = jitter.Pop(0);
+    assert(entry && entry->packet.sequence == 3 && entry->after_loss);
+  }
+
+  // VP8: descriptor stripped, frame emitted on the marker, inter frames
+  // skipped until a keyframe (at the start and after any loss), damaged
+  // frames dropped
+  {
+    auto depacketizer = ingest::CreateDepacketizer(ingest::RtpCodec::kVp8);
+    // Inter frame (P bit set) before any keyframe
+    assert(!depacketizer->Push(Parse(MakeRtp(1, 100, true, {0x10, 0x01, 0xAA})), false));
+    // Keyframe in two packets; first has X=1, I=1, M=1 (two-byte picture id)
+    assert(!depacketizer->Push(Parse(MakeRtp(2, 200, false, {0x90, 0x80, 0x81, 0x02, 0x00, 0xAA})), false));
+    assert(depacketizer->Push(Parse(MakeRtp(3, 200, true, {0x00, 0xBB, 0xCC})), false));
+    assert(depacketizer->frame_key() && depacketizer->frame_timestamp() == 200);
+    assert(depacketizer->frame_size() == 4);
+    const uint8_t expected[] = {0x00, 0xAA, 0xBB, 0xCC};
+    assert(std::memcmp(depacketizer->frame_data(), expected, 4) == 0);
+    // Inter frame whose second packet follows a loss is dropped
+    assert(!depacketizer->Push(Parse(MakeRtp(4, 300, false, {0x10, 0x01})), false));
+    assert(!depacketizer->Push(Parse(MakeRtp(6, 300, true, {0x00, 0x02})), true));
+    // Continuation without a start is dropped; the next full inter frame
+    // references the dropped one and is skipped until a keyframe
+    assert(!depacketizer->Push(Parse(MakeRtp(8, 400, true, {0x00, 0x03})), true));
+    assert(!depacketizer->Push(Parse(MakeRtp(9, 500, true, {0x10, 0x01, 0x04})), false));
+    assert(depacketizer->Push(Parse(MakeRtp(10, 600, true, {0x10, 0x00, 0x05})), false));
+    assert(depacketizer->frame_key());
+    assert(depacketizer->Push(Parse(MakeRtp(11, 700, true, {0x10, 0x01, 0x06})), false));
+    assert(!depacketizer->frame_key());
+    // A frame lost whole between two markers: intact inter frame skipped
+    assert(!depacketizer->Push(Parse(MakeRtp(13, 800, true, {0x10, 0x01, 0x07})), true));
+    assert(depacketizer->Push(Parse(MakeRtp(14, 900, true, {0x10, 0x00, 0x08})), false));
+    const ingest::DepacketizerStats stats = depacketizer->GetStats();
+    assert(stats.frames == 4 && stats.skipped_frames == 3 && stats.dropped_frames == 1);
+  }
+
+  // H.264: single NAL, STAP-A and FU-A become Annex B
+  {
+    auto depacketizer = ingest::CreateDepacketizer(ingest::RtpCodec::kH264);
+    // STAP-A carrying SPS (0x67) and PPS (0x68)
+    assert(!depacketizer->Push(Parse(MakeRtp(1, 900, false, {0x18, 0x00, 0x02, 0x67, 0x01, 0x00, 0x02, 0x68, 0x02})),
+                               false));
+    // IDR (type 5) fragmented: FU indicator 0x7C (NRI 3, type 28)
+    assert(!depacketizer->Push(Parse(MakeRtp(2, 900, false, {0x7C, 0x85, 0x10})), false));
+    assert(depacketizer->Push(Parse(MakeRtp(3, 900, true, {0x7C, 0x45, 0x20})), false));
+    assert(depacketizer->frame_key());
+    const std::vector<uint8_t> expected = {0, 0, 0, 1, 0x67, 0x01, 0, 0, 0, 1, 0x68, 0x02,
+                                           0, 0, 0, 1, 0x65, 0x10, 0x20};
+    assert(depacketizer->frame_size() == expected.size());
+    assert(std::memcmp(depacketizer->frame_data(), expected.data(), expected.size()) == 0);
+
+    // Single NAL inter frame
+    assert(depacketizer->Push(Parse(MakeRtp(4, 1800, true, {0x41, 0x9A})), false));
+    assert(!depacketizer->frame_key() && depacketizer->frame_size() == 6);
+
+    // FU-A continuation after a loss is dropped with its frame
+    assert(!depacketizer->Push(Parse(MakeRtp(6, 2700, true, {0x5C, 0x41, 0x30})), true));
+    assert(depacketizer->GetStats().dropped_frames == 1);
+
+    // The next inter frame waits for an IDR
+    assert(!depacketizer->Push(Parse(MakeRtp(7, 3600, true, {0x41, 0x9B})), false));
+    assert(depacketizer->GetStats().skipped_frames == 1);
+    assert(depacketizer->Push(Parse(MakeRtp(8, 4500, true, {0x65, 0x88})), false));
+    assert(depacketizer->frame_key());
+  }
+
+  // Keyframe detection from the bitstream alone
+  {
+    const uint8_t vp8_key[] = {0x50, 0x42, 0x00, 0x9d, 0x01, 0x2a, 0x80, 0x02, 0xe0, 0x01};
+    const uint8_t vp8_inter[] = {0x51, 0x42, 0x00, 0x9d, 0x01, 0x2a, 0x80, 0x02, 0xe0, 0x01};
+    assert(ingest::IsKeyframe(ingest::RtpCodec::kVp8, vp8_key, sizeof(vp8_key)));
+    assert(!ingest::IsKeyframe(ingest::RtpCodec::kVp8, vp8_inter, sizeof(vp8_inter)));
+    assert(!ingest::IsKeyframe(ingest::RtpCodec::kVp8, vp8_key, 4));
+
+    // SPS, PPS, then IDR (3-byte start code before the slice)
+    const uint8_t idr[] = {0, 0, 0, 1, 0x67, 0x42, 0, 0, 0, 1, 0x68, 0xCE, 0, 0, 1, 0x65, 0x88};
+    const uint8_t inter[] = {0, 0, 0, 1, 0x06, 0x05, 0, 0, 0, 1, 0x41, 0x9A};
+    assert(ingest::IsKeyframe(ingest::RtpCodec::kH264, idr, sizeof(idr)));
+    assert(!ingest::IsKeyframe(ingest::RtpCodec::kH264, inter, sizeof(inter)));
+    assert(!ingest::IsKeyframe(ingest::RtpCodec::kH264, idr, 12));
+  }
+
+  // SDP: first video section, rtpmap codec and clock, parameter sets
+  {
+    const std::string sdp =
+        "v=0\r\n"
+        "c=IN IP4 127.0.0.1\r\n"
+        "m=audio 5002 RTP/AVP 111\r\n"
+        "a=rtpmap:111 opus/48000/2\r\n"
+        "m=video 5006 RTP/AVP 96\r\n"
+        "a=rtpmap:96 VP8/90000\r\n";
+    ingest::RtpSession session;
+    std::string error;
+    assert(ingest::ParseSdp(sdp, &session, &error));
+    assert(session.port == 5006 && session.payload_type == 96);
+    assert(session.codec == ingest::RtpCodec::kVp8 && session.clock_rate == 90000);
+    assert(session.address == "127.0.0.1");
+
+    ingest::RtpSession h264;
+    assert(ingest::ParseSdp("m=video 5008 RTP/AVP 97\n"
+                            "a=rtpmap:97 H264/90000\n"
+                            "a=fmtp:97 packetization-mode=1;sprop-parameter-sets=Z0IAHg==,aM4G4g==\n",
+                            &h264,
+                            &error));
+    assert(h264.codec == ingest::RtpCodec::kH264);
+    const std::vector<uint8_t> parameter_sets = {0, 0, 0, 1, 0x67, 0x42, 0x00, 0x1E, 0, 0, 0, 1, 0x68, 0xCE, 0x06, 0xE2};
+    assert(h264.parameter_sets == parameter_sets);
+
+    ingest::RtpSession no_video;
+    assert(!ingest::ParseSdp("v=0\nm=audio 5002 RTP/AVP 0\n", &no_video, &error));
+
+    ingest::RtpSession url;
+    assert(ingest::LoadRtpSession("rtp://0.0.0.0:5004?protocol_whitelist=file,udp,rtp&codec=h264", &url, &error));
+    assert(url.port == 5004 && url.codec == ingest::RtpCodec::kH264 && url.payload_type == -1);
+  }
+
+  // Batch sizes are clamped to what recvmmsg() accepts
+  {
+    ingest::UdpSourceOptions options;
+    options.batch_size = 0;
+    assert(ingest::UdpSource(options).batch_size() == 1);
+    options.batch_size = 100000;
+    assert(ingest::UdpSource(options).batch_size() == ingest::UdpSource::kMaxBatchSize);
+    options.batch_size = 64;
+    assert(ingest::UdpSource(options).batch_size() == 64);
+  }
+
+  // An idle socket wait blocks without a timeout until the stop event
+  {
+    ingest::UdpSource socket;
+    std::string error;
+    assert(socket.Open("127.0.0.1", 0, &error));
+    util::StopEvent stop;
+    assert(!stop.IsSet() && !stop.Wait(0));
+    assert(socket.Receive(0, stop.fd()) == 0);
+
+    const auto start = std::chrono::steady_clock::now();
+    std::thread stopper([&stop]() {
+      std::this_thread::sleep_for(std::chrono::milliseconds(30));
+      stop.Set();
+    });
+    assert(socket.Receive(-1, stop.fd()) == 0);
+    stopper.join();
+    assert(stop.IsSet() && stop.Wait(-1));
+    assert(std::chrono::steady_clock::now() - start < std::chrono::seconds(5));
+  }
+
+  return 0;
+}
@@ -0,0 +1,180 @@
+#include <sched.h>
+
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "util/Scheduler.h"
+#include "util/Strand.h"
+
+namespace {
+
+// Busy-wait, standing in for decoding a frame.
+void Spin(std::chrono::microseconds duration) {
+  const auto until = std::chrono::steady_clock::now() + duration;
+  while (std::chrono::steady_clock::now() < until) {
+  }
+}
+
+util::SchedulerOptions Threads(size_t threads) {
+  util::SchedulerOptions options;
+  options.threads = threads;
+  return options;
+}
+
+}  // namespace
+
+int main() {
+  // CPU lists use the kernel's syntax
+  std::vector<int> cpus;
+  assert(util::ParseCpuList("0-3,8,10-11\n", &cpus));
+  assert(cpus == std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  assert(util::ParseCpuList("", &cpus) && cpus.empty());
+  assert(!util::ParseCpuList("3-1", &cpus));
+  assert(!util::ParseCpuList("1,,2", &cpus));
+  assert(!util::ParseCpuList("1,", &cpus));
+  assert(!util::ParseCpuList("a", &cpus));
+  assert(!util::NumaNodeCpus(100000, &cpus));
+
+  // Every task runs, including tasks submitted by tasks and tasks still
+  // queued at destruction
+  {
+    std::atomic<int> ran{0};
+    {
+      util::Scheduler scheduler(Threads(4));
+      assert(scheduler.size() == 4);
+      for (int i = 0; i < 1000; ++i) {
+        scheduler.Submit([&scheduler, &ran]() {
+          ++ran;
+          scheduler.Submit([&ran]() { ++ran; });
+        });
+      }
+    }
+    assert(ran == 2000);
+  }
+
+  // Work queued on one worker is stolen by the idle ones
+  {
+    util::Scheduler scheduler(Threads(4));
+    std::mutex mutex;
+    std::set<std::thread::id> threads;
+    std::atomic<int> ran{0};
+    scheduler.Submit([&]() {
+      for (int i = 0; i < 64; ++i) {
+        scheduler.Submit([&]() {
+          Spin(std::chrono::microseconds(500));
+          std::lock_guard<std::mutex> lock(mutex);
+          threads.insert(std::this_thread::get_id());
+          ++ran;
+        });
+      }
+    });
+    for (int i = 0; i < 5000 && ran < 64; ++i) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(ran == 64);
+    assert(scheduler.GetStats().stolen > 0);
+    assert(threads.size() > 1);
+  }
+
+  // Pinning: either every worker is on the requested CPU, or (affinity
+  // not permitted here) none is reported pinned
+  {
+    util::SchedulerOptions options = Threads(2);
+    options.cpus = "0";
+    util::Scheduler scheduler(options);
+    assert(scheduler.cpus().empty() || scheduler.cpus() == std::vector<int>({0, 0}));
+    if (!scheduler.cpus().empty()) {
+      std::atomic<int> cpu{-1};
+      scheduler.Submit([&cpu]() { cpu = sched_getcpu(); });
+      for (int i = 0; i < 2000 && cpu < 0; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+      assert(cpu == 0);
+    }
+  }
+
+  // Strands: each runs its tasks in order and one at a time, while the
+  // scheduler runs different strands in parallel
+  {
+    util::Scheduler scheduler(Threads(4));
+    const int kStrands = 3;
+    const int kTasks = 500;
+    std::vector<std::unique_ptr<util::Strand>> strands;
+    std::vector<std::vector<int>> order(kStrands);
+    std::vector<std::unique_ptr<std::atomic<int>>> active;
+    std::atomic<bool> overlapped{false};
+    for (int s = 0; s < kStrands; ++s) {
+      strands.push_back(std::make_unique<util::Strand>(&scheduler, 4));
+      active.push_back(std::make_unique<std::atomic<int>>(0));
+    }
+    for (int i = 0; i < kTasks; ++i) {
+      for (int s = 0; s < kStrands; ++s) {
+        std::atomic<int>* running = active[s].get();
+        std::vector<int>* seen = &order[s];
+        strands[s]->Post([i, running, seen, &overlapped]() {
+          if (running->fetch_add(1) != 0) {
+            overlapped = true;
+          }
+          seen->push_back(i);
+          running->fetch_sub(1);
+        });
+      }
+    }
+    for (auto& strand : strands) {
+      strand->Drain();
+      assert(strand->pending() == 0);
+    }
+    assert(!overlapped);
+    for (const auto& seen : order) {
+      assert(static_cast<int>(seen.size()) == kTasks);
+      for (int i = 0; i < kTasks; ++i) {
+        assert(seen[i] == i);
+      }
+    }
+  }
+
+  // Fairness: one expensive stream, queued first, does not hold back many
+  // cheap ones. Its turns end after one task (over budget), theirs after
+  // a full batch, so they finish while it has done a fraction of its work.
+  {
+    util::Scheduler scheduler(Threads(1));
+    const int kTasks = 50;
+    const int kLight = 8;
+    std::atomic<int> heavy_done{0};
+    std::vector<int> heavy_done_when_finished(kLight, -1);
+    util::Strand heavy(&scheduler, 8, 2000);
+    std::vector<std::unique_ptr<util::Strand>> light;
+    for (int i = 0; i < kTasks; ++i) {
+      heavy.Post([&heavy_done]() {
+        Spin(std::chrono::microseconds(5000));
+        ++heavy_done;
+      });
+    }
+    for (int s = 0; s < kLight; ++s) {
+      light.push_back(std::make_unique<util::Strand>(&scheduler, 8, 2000));
+      for (int i = 0; i < kTasks; ++i) {
+        light.back()->Post([i, s, &heavy_done, &heavy_done_when_finished]() {
+          if (i == kTasks - 1) {
+            heavy_done_when_finished[s] = heavy_done;
+          }
+        });
+      }
+    }
+    for (auto& strand : light) {
+      strand->Drain();
+    }
+    heavy.Drain();
+    assert(heavy_done == kTasks);
+    for (int done : heavy_done_when_finished) {
+      // One heavy task per round of light batches: about kTasks / 8
+      assert(done >= 0 && done <= kTasks / 2);
+    }
+  }
+  return 0;
+}
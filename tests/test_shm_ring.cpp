@@ -0,0 +1,144 @@
+#include <unistd.h>
+
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "media/ShmFrameClient.h"
+#include "media/ShmPublisher.h"
+
+namespace {
+
+// An I420-shaped frame: full-size luma, quarter-size chroma planes, every
+// byte derived from value so readers can check what they got.
+struct TestFrame {
+  std::vector<uint8_t> planes[3];
+  int strides[3];
+  int rows[3];
+
+  TestFrame(int width, int height, uint8_t value) {
+    strides[0] = width;
+    rows[0] = height;
+    strides[1] = strides[2] = width / 2;
+    rows[1] = rows[2] = height / 2;
+    for (int i = 0; i < 3; ++i) {
+      planes[i].assign(static_cast<size_t>(strides[i]) * rows[i], static_cast<uint8_t>(value + i));
+    }
+  }
+
+  bool Publish(media::ShmPublisher* publisher, uint64_t sequence, int width, int height) const {
+    media::ShmPlane shm[3];
+    for (int i = 0; i < 3; ++i) {
+      shm[i].data = planes[i].data();
+      shm[i].stride = strides[i];
+      shm[i].rows = rows[i];
+    }
+    media::ShmFrameInfo info;
+    info.sequence = sequence;
+    info.pts_us = static_cast<int64_t>(sequence) * 33333;
+    info.key_frame = sequence == 1;
+    info.width = width;
+    info.height = height;
+    info.pixel_format = 0;
+    info.pixel_format_name = "yuv420p";
+    return publisher->Publish(info, shm, 3);
+  }
+};
+
+bool PlaneIs(const media::ShmFrameView& view, int plane, size_t bytes, uint8_t value) {
+  for (size_t i = 0; i < bytes; ++i) {
+    if (view.data[plane][i] != value) {
+      return false;
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+int main() {
+  const std::string name = "webrtc_shm_ring_test_" + std::to_string(::getpid());
+  std::string error;
+
+  media::ShmFrameClient client;
+  assert(!client.Open(name, &error));  // Nothing published yet
+  assert(!error.empty());
+
+  media::ShmPublisherOptions options;
+  options.name = name;
+  options.slots = 4;
+  options.format = media::kFormatNative;
+  auto publisher = std::make_unique<media::ShmPublisher>(options);
+  assert(publisher->RequiredFormats() == media::kFormatNative);
+  assert(publisher->object_name() == "/" + name);
+
+  // First frame creates the ring; metadata, strides and pixels arrive as published
+  const TestFrame small(64, 48, 10);
+  assert(small.Publish(publisher.get(), 1, 64, 48));
+  assert(client.Open(name, &error));
+  media::ShmFrameView first;
+  assert(client.Next(&first, 0));
+  assert(first.sequence == 1 && first.pts_us == 33333 && first.key_frame);
+  assert(first.width == 64 && first.height == 48 && first.pixel_format_name == "yuv420p");
+  assert(first.planes == 3 && first.strides[0] == 64 && first.strides[1] == 32);
+  assert(first.skipped == 0);
+  assert(PlaneIs(first, 0, 64 * 48, 10) && PlaneIs(first, 1, 32 * 24, 11) && PlaneIs(first, 2, 32 * 24, 12));
+  for (int i = 0; i < first.planes; ++i) {
+    assert(reinterpret_cast<uintptr_t>(first.data[i]) % media::kShmAlignment == 0);
+  }
+  assert(first.publish_us <= media::ShmNowUs());
+  assert(client.Valid(first));
+
+  // Nothing new: polling returns at once, a short wait times out
+  media::ShmFrameView view;
+  assert(!client.Next(&view, 0));
+  assert(!client.Next(&view, 20));
+
+  // A blocked consumer is woken by the next publish
+  media::ShmFrameView woken;
+  bool got = false;
+  std::thread consumer([&]() { got = client.Next(&woken, 5000); });
+  std::this_thread::sleep_for(std::chrono::milliseconds(50));
+  assert(TestFrame(64, 48, 20).Publish(publisher.get(), 2, 64, 48));
+  consumer.join();
+  assert(got && woken.sequence == 2 && PlaneIs(woken, 0, 64 * 48, 20));
+
+  // A slow consumer gets the newest frame and the count of frames it
+  // missed; views of overwritten slots are reported invalid
+  for (uint64_t sequence = 3; sequence <= 12; ++sequence) {
+    assert(TestFrame(64, 48, static_cast<uint8_t>(sequence)).Publish(publisher.get(), sequence, 64, 48));
+  }
+  assert(!client.Valid(first));
+  assert(client.Next(&view, 0));
+  assert(view.sequence == 12 && view.skipped == 9 && PlaneIs(view, 0, 64 * 48, 12));
+  assert(client.Valid(view));
+
+  // A larger frame replaces the object; the client follows the name
+  const TestFrame large(128, 96, 50);
+  assert(large.Publish(publisher.get(), 13, 128, 96));
+  assert(client.Next(&view, 1000));
+  assert(view.sequence == 13 && view.width == 128 && view.strides[0] == 128);
+  assert(PlaneIs(view, 0, 128 * 96, 50) && PlaneIs(view, 2, 64 * 48, 52));
+  assert(view.skipped == 0);
+
+  // Smaller frames fit the larger slots
+  assert(small.Publish(publisher.get(), 14, 64, 48));
+  assert(client.Next(&view, 1000));
+  assert(view.sequence == 14 && view.width == 64);
+
+  // Too many planes are rejected
+  media::ShmPlane planes[media::kShmMaxPlanes + 1];
+  assert(!publisher->Publish(media::ShmFrameInfo(), planes, media::kShmMaxPlanes + 1));
+
+  // Closing unlinks the object: the client times out, new clients cannot open it
+  publisher.reset();
+  assert(!client.Next(&view, 30));
+  media::ShmFrameClient late;
+  assert(!late.Open(name, &error));
+  return 0;
+}
@@ -0,0 +1,49 @@
+#include <cassert>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "app/StreamConfig.h"
+
+int main() {
+  std::filesystem::path temp_dir = std::filesystem::temp_directory_path() / "webrtc_stream_config_test";
+  std::filesystem::remove_all(temp_dir);
+  std::filesystem::create_directories(temp_dir);
+
+  std::filesystem::path good = temp_dir / "streams.txt";
+  {
+    std::ofstream out(good);
+    out << "# participants\n"
+        << "alice /app/config/alice.sdp\n"
+        << "\n"
+        << "bob rtp://0.0.0.0:5006 /data/bob  # explicit output\n";
+  }
+  std::vector<app::StreamConfig> streams;
+  std::string error;
+  assert(app::LoadStreamConfig(good.string(), "out", &streams, &error));
+  assert(streams.size() == 2);
+  assert(streams[0].name == "alice");
+  assert(streams[0].output_dir == "out/alice");
+  assert(streams[0].mp4_path == "out/alice/capture.mp4");
+  assert(streams[1].rtp_url == "rtp://0.0.0.0:5006");
+  assert(streams[1].output_dir == "/data/bob");
+
+  std::filesystem::path duplicate = temp_dir / "duplicate.txt";
+  {
+    std::ofstream out(duplicate);
+    out << "alice a.sdp\nalice b.sdp\n";
+  }
+  streams.clear();
+  assert(!app::LoadStreamConfig(duplicate.string(), "out", &streams, &error));
+  assert(error.find("duplicate") != std::string::npos);
+
+  std::filesystem::path missing_url = temp_dir / "missing.txt";
+  {
+    std::ofstream out(missing_url);
+    out << "carol\n";
+  }
+  assert(!app::LoadStreamConfig(missing_url.string(), "out", &streams, &error));
+
+  return 0;
+}
@@ -0,0 +1,59 @@
+// Shared-memory frame consumer.
+//
+// Follows the ring published with --shm-publish (media::ShmPublisher)
+// and prints one line per frame: sequence, PTS, geometry, pixel format,
+// frames skipped and the latency from publish to this process seeing the
+// frame. Meant as a smoke test and as the smallest example of a
+// media::ShmFrameClient consumer; it links capture_shm_client only (no
+// OpenCV or FFmpeg).
+//
+// Usage: capture_shm_tail <name> [frames]
+//   frames - stop after this many frames (default: run until the
+//            producer is gone for 5 seconds)
+
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "media/ShmFrameClient.h"
+
+namespace {
+
+// Wait this long for a frame before giving up
+constexpr int kIdleTimeoutMs = 5000;
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 2) {
+    std::cerr << "Usage: capture_shm_tail <name> [frames]\n";
+    return 2;
+  }
+  const uint64_t limit = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 0;
+
+  media::ShmFrameClient client;
+  std::string error;
+  if (!client.Open(argv[1], &error)) {
+    std::cerr << error << "\n";
+    return 1;
+  }
+
+  uint64_t frames = 0;
+  uint64_t torn = 0;
+  media::ShmFrameView frame;
+  while ((limit == 0 || frames < limit) && client.Next(&frame, kIdleTimeoutMs)) {
+    const int64_t latency_us = media::ShmNowUs() - frame.publish_us;
+    // A real consumer would run inference on frame.data[] here
+    const uint8_t first_byte = frame.data[0] ? frame.data[0][0] : 0;
+    const bool valid = client.Valid(frame);
+    torn += valid ? 0 : 1;
+    std::cout << "seq=" << frame.sequence << " pts_us=" << frame.pts_us << " " << frame.width << "x"
+              << frame.height << " " << frame.pixel_format_name << (frame.key_frame ? " key" : "")
+              << " skipped=" << frame.skipped << " latency_us=" << latency_us
+              << " first_byte=" << static_cast<int>(first_byte) << (valid ? "" : " (overwritten)") << "\n";
+    ++frames;
+  }
+  std::cerr << frames << " frames, " << torn << " overwritten while read\n";
+  return frames > 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+// Spool inspection tool.
+//
+// Reads a spool directory written with --image-output spool
+// (media::FrameSpool) without loading the payloads:
+//   info    - frame count, segments, keyframes, PTS range and total size
+//   list    - one line per frame: position, frame number, PTS, keyframe
+//             flag, geometry, size and segment offset
+//   extract - copy the payload of the frame at a position (1-based, as
+//             printed by list) to a file, e.g. "frame.jpg"; raw formats
+//             are written as-is (see list for geometry and pixel format)
+//
+// Usage: capture_spool info <dir>
+//        capture_spool list <dir>
+//        capture_spool extract <dir> <position> <output file>
+
+extern "C" {
+#include <libavutil/pixdesc.h>
+}
+
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "media/FrameSpool.h"
+
+namespace {
+
+const char* FormatName(uint8_t format) {
+  switch (static_cast<media::ImageFormat>(format)) {
+    case media::ImageFormat::kPng:
+      return "png";
+    case media::ImageFormat::kJpeg:
+      return "jpeg";
+    case media::ImageFormat::kWebp:
+      return "webp";
+    case media::ImageFormat::kRawBgr:
+      return "bgr24";
+    case media::ImageFormat::kRawYuv:
+      return "yuv";
+  }
+  return "unknown";
+}
+
+// "yuv420p" style name for raw yuv frames, else the image format.
+std::string PixelName(const media::SpoolIndexEntry& entry) {
+  if (static_cast<media::ImageFormat>(entry.format) == media::ImageFormat::kRawYuv) {
+    const char* name = av_get_pix_fmt_name(static_cast<AVPixelFormat>(entry.pixel_format));
+    return name ? name : "yuv";
+  }
+  return FormatName(entry.format);
+}
+
+int Usage() {
+  std::cerr << "Usage: capture_spool info <dir>\n"
+               "       capture_spool list <dir>\n"
+               "       capture_spool extract <dir> <position> <output file>\n";
+  return 2;
+}
+
+int Info(const media::SpoolReader& reader) {
+  uint64_t bytes = 0;
+  size_t keyframes = 0;
+  int64_t first_pts = -1;
+  int64_t last_pts = -1;
+  for (size_t i = 1; i <= reader.size(); ++i) {
+    const media::SpoolIndexEntry* entry = reader.Entry(i);
+    bytes += entry->size;
+    keyframes += (entry->flags & media::kSpoolKeyFrame) ? 1 : 0;
+    if (entry->pts_us >= 0) {
+      first_pts = first_pts < 0 ? entry->pts_us : first_pts;
+      last_pts = entry->pts_us;
+    }
+  }
+  std::cout << "frames:    " << reader.size() << "\n"
+            << "keyframes: " << keyframes << "\n"
+            << "bytes:     " << bytes << "\n";
+  if (first_pts >= 0) {
+    std::cout << "pts:       " << first_pts << " .. " << last_pts << " us\n";
+  }
+  return 0;
+}
+
+int List(const media::SpoolReader& reader) {
+  std::cout << "position number pts_us key width height format bytes offset\n";
+  for (size_t i = 1; i <= reader.size(); ++i) {
+    const media::SpoolIndexEntry* entry = reader.Entry(i);
+    std::cout << i << ' ' << entry->number << ' ' << entry->pts_us << ' '
+              << ((entry->flags & media::kSpoolKeyFrame) ? 1 : 0) << ' ' << entry->width << ' ' << entry->height
+              << ' ' << PixelName(*entry) << ' ' << entry->size << ' ' << entry->offset << '\n';
+  }
+  return 0;
+}
+
+int Extract(const media::SpoolReader& reader, const std::string& position_arg, const std::string& path) {
+  char* end = nullptr;
+  const unsigned long long position = std::strtoull(position_arg.c_str(), &end, 10);
+  std::vector<uint8_t> bytes;
+  if (end == position_arg.c_str() || *end != '\0' || !reader.Read(position, &bytes)) {
+    std::cerr << "No frame at position " << position_arg << " (spool has " << reader.size() << ")\n";
+    return 1;
+  }
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(reinterpret_cast<const char*>(bytes.data()), static_cast<std::streamsize>(bytes.size()));
+  out.close();
+  if (!out) {
+    std::cerr << "Failed to write " << path << "\n";
+    return 1;
+  }
+  const media::SpoolIndexEntry* entry = reader.Entry(position);
+  std::cerr << "Frame " << entry->number << " (" << entry->width << "x" << entry->height << " "
+            << PixelName(*entry) << ", " << bytes.size() << " bytes) -> " << path << "\n";
+  return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+  if (argc < 3) {
+    return Usage();
+  }
+  const std::string command = argv[1];
+  media::SpoolReader reader;
+  std::string error;
+  if (!reader.Open(argv[2], &error)) {
+    std::cerr << error << "\n";
+    return 1;
+  }
+  if (command == "info") {
+    return Info(reader);
+  }
+  if (command == "list") {
+    return List(reader);
+  }
+  if (command == "extract" && argc == 5) {
+    return Extract(reader, argv[3], argv[4]);
+  }
+  return Usage();
+}